@@ -28,6 +28,7 @@
 
 #include <sstream>
 #include <cmath>
+#include <chrono>
 
 namespace sigrok
 {
@@ -902,12 +903,302 @@ DatafeedCallbackData::DatafeedCallbackData(Session *session,
 {
 }
 
+DatafeedCallbackData::~DatafeedCallbackData()
+{
+	/* Break the reference cycles of pooled packets and their payloads. */
+	for (auto &packet : _packets)
+		if (packet)
+			packet->_payload_ref.reset();
+}
+
+shared_ptr<Device> DatafeedCallbackData::get_device(
+	const struct sr_dev_inst *sdi)
+{
+	for (const auto &entry : _devices)
+		if (entry.first == sdi)
+			return entry.second;
+	auto device = _session->get_device(sdi);
+	_devices.emplace_back(sdi, device);
+	return device;
+}
+
+/* Index into DatafeedCallbackData::_packets, by type of payload object. */
+static unsigned int packet_slot(uint16_t type)
+{
+	switch (type)
+	{
+		case SR_DF_HEADER:
+			return 0;
+		case SR_DF_META:
+			return 1;
+		case SR_DF_LOGIC:
+			return 2;
+		case SR_DF_ANALOG:
+			return 3;
+		default:
+			return 4;
+	}
+}
+
+bool DatafeedCallbackData::unused(const shared_ptr<Packet> &packet)
+{
+	if (!packet->_payload_ref)
+		return packet.use_count() == 1;
+	/* The payload refers back to its packet. */
+	return packet.use_count() == 2 && packet->_payload_ref.use_count() == 1;
+}
+
+shared_ptr<Packet> DatafeedCallbackData::get_packet(shared_ptr<Device> device,
+	const struct sr_datafeed_packet *pkt)
+{
+	auto &slot = _packets[packet_slot(pkt->type)];
+	if (slot && unused(slot))
+	{
+		slot->reset(move(device), pkt);
+		return slot;
+	}
+
+	/* Pool the first packet of its type; callbacks nested into run()
+	 * find the pooled one in use and get one of their own. */
+	shared_ptr<Packet> packet {new Packet{move(device), pkt}, default_delete<Packet>{}};
+	if (!slot)
+	{
+		if (packet->_payload)
+			packet->_payload_ref = packet->payload();
+		slot = packet;
+	}
+	return packet;
+}
+
+void DatafeedCallbackData::release_packet(shared_ptr<Packet> packet)
+{
+	auto &slot = _packets[packet_slot(packet->_structure->type)];
+
+	/* The session's buffer goes away on return, keep kept packets valid. */
+	if (packet != slot)
+	{
+		if (packet.use_count() > 1)
+			packet->detach();
+		return;
+	}
+	packet.reset();
+	if (unused(slot))
+	{
+		slot->_device.reset();
+		return;
+	}
+	slot->_payload_ref.reset();
+	slot->detach();
+	slot.reset();
+}
+
 void DatafeedCallbackData::run(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *pkt)
 {
-	auto device = _session->get_device(sdi);
-	shared_ptr<Packet> packet {new Packet{device, pkt}, default_delete<Packet>{}};
-	_callback(move(device), move(packet));
+	auto device = get_device(sdi);
+	auto packet = get_packet(device, pkt);
+	packet->_borrowed = true;
+	_callback(move(device), packet);
+	release_packet(move(packet));
+	if (pkt->type == SR_DF_END)
+		_devices.clear();
+}
+
+/* Unread samples after which Session::read() holds up the session. */
+static const size_t read_buffer_size = 64 << 20;
+
+SessionReader::SessionReader() :
+	_logic_head(0),
+	_unit_size(0),
+	_size(0),
+	_want(UINT64_MAX),
+	_waiting(false),
+	_cancelled(false),
+	_done(false)
+{
+}
+
+SessionReader::~SessionReader()
+{
+}
+
+void SessionReader::datafeed(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *pkt, void *cb_data) noexcept
+{
+	auto *const reader = static_cast<SessionReader *>(cb_data);
+
+	switch (pkt->type)
+	{
+		case SR_DF_LOGIC:
+			reader->push_logic(
+				static_cast<const struct sr_datafeed_logic *>(
+					pkt->payload));
+			break;
+		case SR_DF_ANALOG:
+			reader->push_analog(sdi,
+				static_cast<const struct sr_datafeed_analog *>(
+					pkt->payload));
+			break;
+	}
+}
+
+/* Drop the part of a buffer read so far, once it's the larger part. */
+template <class T>
+static void compact(vector<T> &data, size_t &head)
+{
+	if (head > 0 && head >= data.size() - head) {
+		data.erase(data.begin(), data.begin() + head);
+		head = 0;
+	}
+}
+
+void SessionReader::wait_space(unique_lock<mutex> &lock, size_t bytes)
+{
+	while (!_cancelled && _size > 0 && _size + bytes > read_buffer_size) {
+		_waiting = true;
+		_cond.notify_all();
+		_cond.wait(lock);
+	}
+	_waiting = false;
+}
+
+void SessionReader::push_logic(const struct sr_datafeed_logic *logic)
+{
+	unique_lock<mutex> lock(_mutex);
+
+	/* A block holds samples of one size only. */
+	while (!_cancelled && _logic.size() > _logic_head
+			&& _unit_size != logic->unitsize) {
+		_waiting = true;
+		_cond.notify_all();
+		_cond.wait(lock);
+	}
+	wait_space(lock, logic->length);
+	if (_cancelled)
+		return;
+
+	auto *const data = static_cast<const uint8_t *>(logic->data);
+	_unit_size = logic->unitsize;
+	compact(_logic, _logic_head);
+	_logic.insert(_logic.end(), data, data + logic->length);
+	_size += logic->length;
+	if (ready(_want))
+		_cond.notify_all();
+}
+
+void SessionReader::push_analog(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_analog *analog)
+{
+	const size_t num_samples = analog->num_samples;
+	const size_t count = num_samples * g_slist_length(analog->meaning->channels);
+
+	if (!count)
+		return;
+	/* Only the session thread converts, no need to lock yet. */
+	_scratch.resize(count);
+	if (sr_analog_to_float(analog, _scratch.data()) != SR_OK)
+		return;
+
+	unique_lock<mutex> lock(_mutex);
+	wait_space(lock, count * sizeof(float));
+	if (_cancelled)
+		return;
+
+	/* Samples of one channel follow those of the previous one. */
+	auto src = _scratch.data();
+	for (auto l = analog->meaning->channels; l; l = l->next) {
+		auto *const ch = static_cast<struct sr_channel *>(l->data);
+		AnalogBuffer *buffer = nullptr;
+		for (auto &entry : _analog)
+			if (entry.channel == ch)
+				buffer = &entry;
+		if (!buffer) {
+			_analog.push_back(AnalogBuffer{sdi, ch, vector<float>(), 0});
+			buffer = &_analog.back();
+		}
+		compact(buffer->data, buffer->head);
+		buffer->data.insert(buffer->data.end(), src, src + num_samples);
+		src += num_samples;
+	}
+	_size += count * sizeof(float);
+	if (ready(_want))
+		_cond.notify_all();
+}
+
+bool SessionReader::ready(uint64_t max_samples) const
+{
+	if (_done || _waiting)
+		return true;
+	if (_unit_size && (_logic.size() - _logic_head) / _unit_size >= max_samples)
+		return true;
+	for (const auto &buffer : _analog)
+		if (buffer.data.size() - buffer.head >= max_samples)
+			return true;
+	return false;
+}
+
+bool SessionReader::empty() const
+{
+	if (_logic.size() > _logic_head)
+		return false;
+	for (const auto &buffer : _analog)
+		if (buffer.data.size() > buffer.head)
+			return false;
+	return true;
+}
+
+void SessionReader::take(uint64_t max_samples, vector<uint8_t> &logic,
+	vector<AnalogBuffer> &analog)
+{
+	size_t count;
+
+	count = _unit_size ? (_logic.size() - _logic_head) / _unit_size : 0;
+	count = min<uint64_t>(count, max_samples) * _unit_size;
+	if (_logic_head == 0 && count == _logic.size()) {
+		/* Hand everything over without a copy. */
+		logic.swap(_logic);
+		_logic.reserve(logic.size());
+	} else {
+		logic.assign(_logic.begin() + _logic_head,
+			_logic.begin() + _logic_head + count);
+		_logic_head += count;
+	}
+	_size -= count;
+
+	for (auto &buffer : _analog) {
+		count = min<uint64_t>(buffer.data.size() - buffer.head, max_samples);
+		if (!count)
+			continue;
+		analog.push_back(AnalogBuffer{buffer.sdi, buffer.channel,
+			vector<float>(buffer.data.begin() + buffer.head,
+				buffer.data.begin() + buffer.head + count), 0});
+		buffer.head += count;
+		_size -= count * sizeof(float);
+	}
+
+	if (_waiting)
+		_cond.notify_all();
+}
+
+void SessionReader::reset()
+{
+	lock_guard<mutex> lock(_mutex);
+	_cancelled = false;
+	_done = false;
+}
+
+void SessionReader::finish()
+{
+	lock_guard<mutex> lock(_mutex);
+	_done = true;
+	_cond.notify_all();
+}
+
+void SessionReader::cancel()
+{
+	lock_guard<mutex> lock(_mutex);
+	_cancelled = true;
+	_cond.notify_all();
 }
 
 SessionDevice::SessionDevice(struct sr_dev_inst *structure) :
@@ -951,6 +1242,11 @@ Session::Session(shared_ptr<Context> context, string filename) :
 
 Session::~Session()
 {
+	if (_reader && _reader->_thread.joinable()) {
+		_reader->cancel();
+		sr_session_stop(_structure);
+		_reader->_thread.join();
+	}
 	check(sr_session_destroy(_structure));
 }
 
@@ -1003,6 +1299,9 @@ void Session::run()
 
 void Session::stop()
 {
+	/* The session thread may be waiting for read() to make room. */
+	if (_reader)
+		_reader->cancel();
 	check(sr_session_stop(_structure));
 }
 
@@ -1014,6 +1313,87 @@ bool Session::is_running() const
 	return (ret != 0);
 }
 
+void Session::set_stats_enabled(bool enabled)
+{
+	check(sr_session_stats_enable(_structure, enabled));
+}
+
+void Session::reset_stats()
+{
+	check(sr_session_stats_reset(_structure));
+}
+
+vector<SessionStats> Session::stats()
+{
+	GSList *list;
+	check(sr_session_stats_get(_structure, &list));
+	vector<SessionStats> result;
+	for (GSList *l = list; l; l = l->next) {
+		auto *const entry = static_cast<struct sr_session_stats *>(l->data);
+		result.push_back(SessionStats{
+			StatsKind::get(entry->kind),
+			entry->name,
+			entry->count,
+			entry->bytes,
+			entry->time_ns,
+			entry->max_ns,
+			vector<uint64_t>(entry->hist, entry->hist + SR_STATS_HIST_BUCKETS),
+			entry->late_ns,
+			entry->late_max_ns});
+	}
+	sr_session_stats_free(list);
+	return result;
+}
+
+shared_ptr<Block> Session::read(uint64_t max_samples, int timeout)
+{
+	if (!_reader) {
+		unique_ptr<SessionReader> reader {new SessionReader};
+		check(sr_session_datafeed_callback_add(_structure,
+				&SessionReader::datafeed, reader.get()));
+		_reader = move(reader);
+	}
+	auto &reader = *_reader;
+
+	if (!reader._thread.joinable()) {
+		reader.reset();
+		if (!is_running())
+			start();
+		auto *const structure = _structure;
+		reader._thread = thread([structure, &reader] {
+			sr_session_run(structure);
+			reader.finish();
+		});
+	}
+
+	shared_ptr<Block> block {new Block, default_delete<Block>{}};
+	vector<SessionReader::AnalogBuffer> analog;
+	{
+		unique_lock<mutex> lock(reader._mutex);
+		auto ready = [&] { return reader.ready(max_samples); };
+		reader._want = max_samples;
+		if (timeout < 0)
+			reader._cond.wait(lock, ready);
+		else
+			reader._cond.wait_for(lock,
+				chrono::milliseconds(timeout), ready);
+		reader._want = UINT64_MAX;
+		if (reader._done && reader.empty()) {
+			lock.unlock();
+			reader._thread.join();
+			return nullptr;
+		}
+		reader.take(max_samples, block->_logic, analog);
+		block->_unit_size = reader._unit_size;
+	}
+	for (auto &buffer : analog)
+		block->_analog.emplace_back(
+			get_device(buffer.sdi)->get_channel(buffer.channel),
+			move(buffer.data));
+
+	return block;
+}
+
 static void session_stopped_callback(void *data) noexcept
 {
 	auto *const callback = static_cast<SessionStoppedCallback*>(data);
@@ -1051,6 +1431,9 @@ void Session::remove_datafeed_callbacks()
 {
 	check(sr_session_datafeed_callback_remove_all(_structure));
 	_datafeed_callbacks.clear();
+	if (_reader)
+		check(sr_session_datafeed_callback_add(_structure,
+				&SessionReader::datafeed, _reader.get()));
 }
 
 shared_ptr<Trigger> Session::trigger()
@@ -1081,7 +1464,9 @@ shared_ptr<Context> Session::context()
 Packet::Packet(shared_ptr<Device> device,
 	const struct sr_datafeed_packet *structure) :
 	_structure(structure),
-	_device(move(device))
+	_device(move(device)),
+	_borrowed(false),
+	_copy(nullptr)
 {
 	switch (structure->type)
 	{
@@ -1110,6 +1495,60 @@ Packet::Packet(shared_ptr<Device> device,
 
 Packet::~Packet()
 {
+	if (_copy)
+		sr_packet_free(_copy);
+}
+
+void Packet::detach()
+{
+	if (!_borrowed)
+		return;
+
+	check(sr_packet_copy(_structure, &_copy));
+	_structure = _copy;
+	_borrowed = false;
+	update_payload();
+}
+
+void Packet::reset(shared_ptr<Device> device,
+	const struct sr_datafeed_packet *structure)
+{
+	if (_copy)
+	{
+		sr_packet_free(_copy);
+		_copy = nullptr;
+	}
+	_structure = structure;
+	_device = move(device);
+	update_payload();
+}
+
+/* Point the payload object, possibly handed out before, to _structure. */
+void Packet::update_payload()
+{
+	switch (_structure->type)
+	{
+		case SR_DF_HEADER:
+			static_cast<Header *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_header *>(
+					_structure->payload);
+			break;
+		case SR_DF_META:
+			static_cast<Meta *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_meta *>(
+					_structure->payload);
+			break;
+		case SR_DF_LOGIC:
+			static_cast<Logic *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_logic *>(
+					_structure->payload);
+			break;
+		case SR_DF_ANALOG:
+			static_cast<Analog *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_analog *>(
+					_structure->payload);
+			break;
+	}
 }
 
 const PacketType *Packet::type() const
@@ -1218,6 +1657,13 @@ unsigned int Logic::unit_size() const
 	return _structure->unitsize;
 }
 
+Span<const uint8_t> Logic::bytes() const
+{
+	return Span<const uint8_t>(
+		static_cast<const uint8_t *>(_structure->data),
+		_structure->length);
+}
+
 Analog::Analog(const struct sr_datafeed_analog *structure) :
 	PacketPayload(),
 	_structure(structure)
@@ -1251,14 +1697,37 @@ unsigned int Analog::num_samples() const
 
 vector<shared_ptr<Channel>> Analog::channels()
 {
-	vector<shared_ptr<Channel>> result;
-	for (auto l = _structure->meaning->channels; l; l = l->next) {
-		auto *const ch = static_cast<struct sr_channel *>(l->data);
-		result.push_back(_parent->_device->get_channel(ch));
+	auto device = _parent->_device;
+	auto l = _structure->meaning->channels;
+	size_t i = 0;
+
+	/* Consecutive packets mostly carry the same channels. */
+	if (!_channels_device.owner_before(device)
+			&& !device.owner_before(_channels_device))
+		for (; l && i < _channels.size()
+				&& l->data == _channels[i].first; l = l->next)
+			i++;
+	if (l || i < _channels.size()) {
+		_channels.clear();
+		for (l = _structure->meaning->channels; l; l = l->next) {
+			auto *const ch = static_cast<struct sr_channel *>(l->data);
+			_channels.emplace_back(ch, device->_channels[ch].get());
+		}
+		_channels_device = device;
 	}
+
+	vector<shared_ptr<Channel>> result;
+	result.reserve(_channels.size());
+	for (const auto &entry : _channels)
+		result.push_back(entry.second->share_owned_by(device));
 	return result;
 }
 
+unsigned int Analog::num_channels() const
+{
+	return g_slist_length(_structure->meaning->channels);
+}
+
 unsigned int Analog::unitsize() const
 {
 	return _structure->encoding->unitsize;
@@ -1368,6 +1837,47 @@ shared_ptr<Logic> Analog::get_logic_via_schmitt_trigger(float lo_thr,
 	return logic;
 }
 
+Block::Block() :
+	_unit_size(0)
+{
+}
+
+Block::~Block()
+{
+}
+
+uint64_t Block::logic_samples() const
+{
+	return _unit_size ? _logic.size() / _unit_size : 0;
+}
+
+unsigned int Block::unit_size() const
+{
+	return _unit_size;
+}
+
+Span<const uint8_t> Block::logic() const
+{
+	return Span<const uint8_t>(_logic.data(), _logic.size());
+}
+
+vector<shared_ptr<Channel>> Block::analog_channels() const
+{
+	vector<shared_ptr<Channel>> result;
+	for (const auto &entry : _analog)
+		result.push_back(entry.first);
+	return result;
+}
+
+Span<const float> Block::analog(shared_ptr<Channel> channel) const
+{
+	for (const auto &entry : _analog)
+		if (entry.first == channel)
+			return Span<const float>(entry.second.data(),
+				entry.second.size());
+	return Span<const float>();
+}
+
 Rational::Rational(const struct sr_rational *structure) :
 	_structure(structure)
 {
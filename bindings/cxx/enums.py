@@ -44,7 +44,8 @@ mapping = dict([
     ('sr_datatype', ('DataType', 'Configuration data type')),
     ('sr_channeltype', ('ChannelType', 'Channel type')),
     ('sr_trigger_matches', ('TriggerMatchType', 'Trigger match type')),
-    ('sr_output_flag', ('OutputFlag', 'Flag applied to output modules'))])
+    ('sr_output_flag', ('OutputFlag', 'Flag applied to output modules')),
+    ('sr_stats_kind', ('StatsKind', 'Kind of session statistics entry'))])
 
 index = ElementTree.parse(index_file)
 
@@ -78,9 +78,14 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 #include <glibmm.h>
 G_GNUC_END_IGNORE_DEPRECATIONS
 
+#include <condition_variable>
 #include <functional>
 #include <stdexcept>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <map>
 #include <set>
@@ -115,12 +120,14 @@ class SR_API Quantity;
 class SR_API Unit;
 class SR_API QuantityFlag;
 class SR_API Rational;
+class SR_API Block;
 class SR_API Input;
 class SR_API InputDevice;
 class SR_API Output;
 class SR_API DataType;
 class SR_API Option;
 class SR_API UserDevice;
+class SR_API StatsKind;
 
 /** Exception thrown when an error code is returned by any libsigrok call. */
 class SR_API Error: public std::exception
@@ -211,6 +218,30 @@ protected:
 	}
 };
 
+/**
+ * View of a contiguous array owned by someone else, in the manner of
+ * C++20 std::span. Valid for as long as the array is.
+ */
+template <class T>
+class SR_API Span
+{
+public:
+	Span() : _data(nullptr), _size(0) {}
+	Span(T *data, size_t size) : _data(data), _size(size) {}
+	/** Pointer to the first element. */
+	T *data() const { return _data; }
+	/** Number of elements. */
+	size_t size() const { return _size; }
+	/** Whether there are no elements. */
+	bool empty() const { return _size == 0; }
+	T *begin() const { return _data; }
+	T *end() const { return _data + _size; }
+	T &operator[](size_t index) const { return _data[index]; }
+private:
+	T *_data;
+	size_t _size;
+};
+
 /** Type of log callback */
 typedef std::function<void(const LogLevel *, std::string message)> LogCallbackFunction;
 
@@ -481,6 +512,7 @@ private:
 	friend class ChannelGroup;
 	friend class Session;
 	friend class TriggerStage;
+	friend class Analog;
 	friend class Context;
 	friend struct std::default_delete<Channel>;
 };
@@ -584,12 +616,78 @@ class SR_PRIV DatafeedCallbackData
 public:
 	void run(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *pkt);
+	~DatafeedCallbackData();
 private:
 	DatafeedCallbackFunction _callback;
 	DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback);
+	std::shared_ptr<Device> get_device(const struct sr_dev_inst *sdi);
+	std::shared_ptr<Packet> get_packet(std::shared_ptr<Device> device,
+		const struct sr_datafeed_packet *pkt);
+	void release_packet(std::shared_ptr<Packet> packet);
+	static bool unused(const std::shared_ptr<Packet> &packet);
 	Session *_session;
+	/* Devices looked up so far, dropped at the end of acquisition. */
+	std::vector<std::pair<const struct sr_dev_inst *,
+		std::shared_ptr<Device> > > _devices;
+	/* Packets reused for the next callback, one per payload type. */
+	std::shared_ptr<Packet> _packets[5];
+	friend class Session;
+};
+
+/* Samples accumulated for Session::read() */
+class SR_PRIV SessionReader
+{
+private:
+	/* Unread samples of one analog channel, from offset head on. */
+	struct AnalogBuffer
+	{
+		const struct sr_dev_inst *sdi;
+		struct sr_channel *channel;
+		std::vector<float> data;
+		size_t head;
+	};
+
+	SessionReader();
+	~SessionReader();
+	static void datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *pkt, void *cb_data) noexcept;
+	void push_logic(const struct sr_datafeed_logic *logic);
+	void push_analog(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_analog *analog);
+	void wait_space(std::unique_lock<std::mutex> &lock, size_t bytes);
+	bool ready(uint64_t max_samples) const;
+	bool empty() const;
+	void take(uint64_t max_samples, std::vector<uint8_t> &logic,
+		std::vector<AnalogBuffer> &analog);
+	void reset();
+	void finish();
+	void cancel();
+
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	/* Runs the session event loop. */
+	std::thread _thread;
+	/* Unread logic samples, from offset _logic_head on. */
+	std::vector<uint8_t> _logic;
+	size_t _logic_head;
+	unsigned int _unit_size;
+	std::vector<AnalogBuffer> _analog;
+	/* Analog packet converted to float, before it's split by channel. */
+	std::vector<float> _scratch;
+	/* Bytes of unread samples in total. */
+	size_t _size;
+	/* Block size the reader waits for, UINT64_MAX if it doesn't. */
+	uint64_t _want;
+	/* The session thread waits for the reader to make room. */
+	bool _waiting;
+	/* Stop accepting samples, the session is being stopped. */
+	bool _cancelled;
+	/* The session event loop has returned. */
+	bool _done;
+
 	friend class Session;
+	friend struct std::default_delete<SessionReader>;
 };
 
 /** A virtual device associated with a stored session */
@@ -606,6 +704,31 @@ private:
 	friend struct std::default_delete<SessionDevice>;
 };
 
+/** Performance counters of one device, transform, datafeed callback or
+ * event source in a session, see Session::stats() */
+struct SR_API SessionStats
+{
+	/** What this entry describes. */
+	const StatsKind *kind;
+	/** Driver name, transform module ID, "callbackN", "fd" or "timer". */
+	std::string name;
+	/** Number of packets processed, or event source invocations. */
+	uint64_t count;
+	/** Payload size of the logic and analog packets processed. */
+	uint64_t bytes;
+	/** Total time spent, in nanoseconds. */
+	uint64_t time_ns;
+	/** Longest single call, in nanoseconds. */
+	uint64_t max_ns;
+	/** Call duration histogram, bucket i counts durations in
+	 * [2^(i-1), 2^i) ns, the last bucket also all longer ones. */
+	std::vector<uint64_t> histogram;
+	/** Event sources only: total delay past the timeout, in nanoseconds. */
+	uint64_t late_ns;
+	/** Event sources only: maximum delay past the timeout. */
+	uint64_t late_max_ns;
+};
+
 /** A sigrok session */
 class SR_API Session : public UserOwned<Session>
 {
@@ -641,6 +764,35 @@ public:
 	void set_trigger(std::shared_ptr<Trigger> trigger);
 	/** Get filename this session was loaded from. */
 	std::string filename() const;
+	/** Enable or disable the collection of performance counters.
+	 * @param enabled Whether to collect counters. */
+	void set_stats_enabled(bool enabled);
+	/** Reset all performance counters to zero. */
+	void reset_stats();
+	/** Get a snapshot of the performance counters. */
+	std::vector<SessionStats> stats();
+	/**
+	 * Read the samples acquired since the last call.
+	 *
+	 * The first call starts the session, unless it is running already,
+	 * and runs its event loop in a thread of its own; don't call run()
+	 * then. From then on, samples are collected natively in the
+	 * background, without packet objects, until read.
+	 *
+	 * Returns when at least max_samples logic samples or max_samples
+	 * samples of an analog channel are available, when the session
+	 * thread runs out of buffer space, or when the timeout expires.
+	 * The block holds at most max_samples samples of each kind, the
+	 * rest is kept for the next call.
+	 *
+	 * @param max_samples Maximum number of samples per block.
+	 * @param timeout Timeout in milliseconds, or -1 to wait as long as
+	 *                it takes.
+	 * @return The samples read, possibly none after a timeout, or
+	 *         nullptr when the acquisition has ended and all samples
+	 *         have been read. A call after that starts a new one.
+	 */
+	std::shared_ptr<Block> read(uint64_t max_samples, int timeout = -1);
 private:
 	explicit Session(std::shared_ptr<Context> context);
 	Session(std::shared_ptr<Context> context, std::string filename);
@@ -654,6 +806,7 @@ private:
 	SessionStoppedCallback _stopped_callback;
 	std::string _filename;
 	std::shared_ptr<Trigger> _trigger;
+	std::unique_ptr<SessionReader> _reader;
 
 	friend class Context;
 	friend class DatafeedCallbackData;
@@ -669,6 +822,17 @@ public:
 	const PacketType *type() const;
 	/** Payload of this packet. */
 	std::shared_ptr<PacketPayload> payload();
+	/**
+	 * Make this packet keep its own copy of its data.
+	 *
+	 * Packets passed to datafeed callbacks refer to buffers of the
+	 * session, which are only valid until the callback returns. Such
+	 * packets are detached automatically if still referenced after the
+	 * callback, but pointers to their data obtained in the callback are
+	 * not. Detach first to keep using those. Does nothing for packets
+	 * which don't refer to session buffers.
+	 */
+	void detach();
 private:
 	Packet(std::shared_ptr<Device> device,
 		const struct sr_datafeed_packet *structure);
@@ -676,6 +840,15 @@ private:
 	const struct sr_datafeed_packet *_structure;
 	std::shared_ptr<Device> _device;
 	std::unique_ptr<PacketPayload> _payload;
+	/* Whether _structure refers to a buffer of the session. */
+	bool _borrowed;
+	/* Copy owned by this packet after detach(), or nullptr. */
+	struct sr_datafeed_packet *_copy;
+	/* Reference to _payload held while in a DatafeedCallbackData pool. */
+	std::shared_ptr<PacketPayload> _payload_ref;
+	void reset(std::shared_ptr<Device> device,
+		const struct sr_datafeed_packet *structure);
+	void update_payload();
 
 	friend class Session;
 	friend class Output;
@@ -753,6 +926,13 @@ public:
 	size_t data_length() const;
 	/* Size of each sample in bytes. */
 	unsigned int unit_size() const;
+	/** Data as bytes. */
+	Span<const uint8_t> bytes() const;
+	/**
+	 * Data as one T per sample, T being an unsigned integer type of
+	 * unit_size() bytes. Throws Error(SR_ERR_ARG) for other types.
+	 */
+	template <class T> Span<const T> samples() const;
 private:
 	explicit Logic(const struct sr_datafeed_logic *structure);
 	~Logic();
@@ -782,6 +962,16 @@ public:
 	unsigned int num_samples() const;
 	/** Channels for which this packet contains data. */
 	std::vector<std::shared_ptr<Channel> > channels();
+	/** Number of channels for which this packet contains data. */
+	unsigned int num_channels() const;
+	/**
+	 * Data as num_samples() samples of each channel, without conversion.
+	 * T must match the encoding: float or double for float data, else
+	 * an integer type of the same size and signedness. Data in non-host
+	 * byte order can't be accessed this way. Throws Error(SR_ERR_ARG)
+	 * if the encoding doesn't match, see get_data_as_float() then.
+	 */
+	template <class T> Span<const T> samples() const;
 	/** Size of a single sample in bytes. */
 	unsigned int unitsize() const;
 	/** Samples use a signed data type. */
@@ -842,10 +1032,69 @@ private:
 	std::shared_ptr<PacketPayload> share_owned_by(std::shared_ptr<Packet> parent);
 
 	const struct sr_datafeed_analog *_structure;
+	/* Channels of the last channels() call, and the device they are of. */
+	std::weak_ptr<Device> _channels_device;
+	std::vector<std::pair<struct sr_channel *, Channel *> > _channels;
 
 	friend class Packet;
 };
 
+template <class T>
+Span<const T> Logic::samples() const
+{
+	static_assert(std::is_integral<T>::value && std::is_unsigned<T>::value,
+		"Logic samples are unsigned integers");
+	if (sizeof(T) != _structure->unitsize)
+		throw Error(SR_ERR_ARG);
+	return Span<const T>(static_cast<const T *>(_structure->data),
+		_structure->length / sizeof(T));
+}
+
+template <class T>
+Span<const T> Analog::samples() const
+{
+	static_assert(std::is_arithmetic<T>::value,
+		"Analog samples are numbers");
+	const struct sr_analog_encoding *encoding = _structure->encoding;
+	if (sizeof(T) != encoding->unitsize
+			|| std::is_floating_point<T>::value != !!encoding->is_float
+			|| (std::is_integral<T>::value
+				&& std::is_signed<T>::value != !!encoding->is_signed)
+			|| (sizeof(T) > 1 && !!encoding->is_bigendian
+				!= (G_BYTE_ORDER == G_BIG_ENDIAN)))
+		throw Error(SR_ERR_ARG);
+	return Span<const T>(static_cast<const T *>(_structure->data),
+		static_cast<size_t>(_structure->num_samples) * num_channels());
+}
+
+/** Samples read from a session in one go, see Session::read() */
+class SR_API Block : public UserOwned<Block>
+{
+public:
+	/** Number of logic samples. */
+	uint64_t logic_samples() const;
+	/** Size of each logic sample in bytes. */
+	unsigned int unit_size() const;
+	/** Logic samples, unit_size() bytes each. */
+	Span<const uint8_t> logic() const;
+	/** Channels with analog samples in this block. */
+	std::vector<std::shared_ptr<Channel> > analog_channels() const;
+	/** Analog samples of a channel, converted to float. Empty for
+	 * channels without samples in this block. */
+	Span<const float> analog(std::shared_ptr<Channel> channel) const;
+private:
+	Block();
+	~Block();
+	std::vector<uint8_t> _logic;
+	unsigned int _unit_size;
+	std::vector<std::pair<std::shared_ptr<Channel>,
+		std::vector<float> > > _analog;
+
+	friend class Session;
+	friend class SessionReader;
+	friend struct std::default_delete<Block>;
+};
+
 /** Number represented by a numerator/denominator integer pair */
 class SR_API Rational :
 	public ParentOwned<Rational, Analog>
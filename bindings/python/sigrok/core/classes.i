@@ -48,6 +48,7 @@ which provides access to the error code and description."
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <pygobject.h>
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
@@ -539,18 +540,147 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     }
 }
 
+%{
+template <class T>
+static void owner_capsule_free(PyObject *capsule)
+{
+    delete static_cast<std::shared_ptr<T> *>(
+        PyCapsule_GetPointer(capsule, nullptr));
+}
+
+/*
+ * Wrap data in a NumPy array without copying. The array's base object
+ * keeps the data's owner alive. Packets must have been detached, so
+ * that the array stays valid after the datafeed callback. Steals the
+ * reference to descr.
+ */
+template <class T>
+static PyObject *owner_array(std::shared_ptr<T> owner,
+    const void *data, int nd, npy_intp *dims, PyArray_Descr *descr)
+{
+    auto array = PyArray_NewFromDescr(&PyArray_Type, descr, nd, dims,
+        nullptr, const_cast<void *>(data), NPY_ARRAY_CARRAY, nullptr);
+    if (!array)
+        return nullptr;
+
+    auto capsule = PyCapsule_New(new std::shared_ptr<T>(owner),
+        nullptr, owner_capsule_free<T>);
+    /* Steals the capsule reference, even on failure. */
+    if (!capsule || PyArray_SetBaseObject((PyArrayObject *)array, capsule) < 0)
+    {
+        Py_DECREF(array);
+        return nullptr;
+    }
+
+    return array;
+}
+
+/* Unpack logic samples into one byte per channel, 0 or 1. */
+static PyObject *unpack_bits(const void *data, npy_intp samples,
+    unsigned int unit_size)
+{
+    static uint64_t table[256];
+    npy_intp dims[2];
+
+    if (!table[255])
+    {
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            uint8_t bits[8];
+            for (unsigned int j = 0; j < 8; j++)
+                bits[j] = (i >> j) & 1;
+            memcpy(&table[i], bits, sizeof(bits));
+        }
+    }
+
+    dims[0] = samples;
+    dims[1] = unit_size * 8;
+    auto array = PyArray_SimpleNew(2, dims, NPY_UINT8);
+    if (!array)
+        return nullptr;
+
+    auto src = static_cast<const uint8_t *>(data);
+    auto dst = static_cast<uint8_t *>(PyArray_DATA((PyArrayObject *)array));
+    size_t length = samples * unit_size;
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < length; i++)
+        memcpy(dst + 8 * i, &table[src[i]], 8);
+    Py_END_ALLOW_THREADS
+
+    return array;
+}
+
+/* NumPy type of an analog packet's samples, or NPY_NOTYPE. */
+static int analog_typenum(sigrok::Analog *analog)
+{
+    if (analog->is_float())
+    {
+        switch (analog->unitsize())
+        {
+            case 4: return NPY_FLOAT32;
+            case 8: return NPY_FLOAT64;
+        }
+    }
+    else if (analog->is_signed())
+    {
+        switch (analog->unitsize())
+        {
+            case 1: return NPY_INT8;
+            case 2: return NPY_INT16;
+            case 4: return NPY_INT32;
+            case 8: return NPY_INT64;
+        }
+    }
+    else
+    {
+        switch (analog->unitsize())
+        {
+            case 1: return NPY_UINT8;
+            case 2: return NPY_UINT16;
+            case 4: return NPY_UINT32;
+            case 8: return NPY_UINT64;
+        }
+    }
+    return NPY_NOTYPE;
+}
+%}
+
 /* Return NumPy array from Analog::data(). */
 %extend sigrok::Analog
 {
     PyObject * _data()
     {
-        int nd = 2;
+        auto packet = $self->parent();
+        packet->detach();
+
         npy_intp dims[2];
         dims[0] = $self->channels().size();
         dims[1] = $self->num_samples();
-        int typenum = NPY_FLOAT;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(nd, dims, typenum, data);
+
+        int typenum = analog_typenum($self);
+        if (typenum == NPY_NOTYPE)
+        {
+            PyErr_Format(PyExc_ValueError,
+                "Unsupported analog encoding: %u byte %s samples",
+                $self->unitsize(), $self->is_float() ? "float" : "integer");
+            return nullptr;
+        }
+        auto descr = PyArray_DescrFromType(typenum);
+#ifdef WORDS_BIGENDIAN
+        bool swap = !$self->is_bigendian() && $self->unitsize() > 1;
+#else
+        bool swap = $self->is_bigendian() && $self->unitsize() > 1;
+#endif
+        if (swap)
+        {
+            auto swapped = PyArray_DescrNewByteorder(descr, NPY_SWAP);
+            Py_DECREF(descr);
+            if (!swapped)
+                return nullptr;
+            descr = swapped;
+        }
+
+        return owner_array(packet, $self->data_pointer(), 2, dims, descr);
     }
 
 %pythoncode
@@ -567,14 +697,97 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
         npy_intp dims[2];
         dims[0] = $self->data_length() / $self->unit_size();
         dims[1] = $self->unit_size();
-        int typenum = NPY_UINT8;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(2, dims, typenum, data);
+        auto packet = $self->parent();
+        packet->detach();
+        return owner_array(packet, $self->data_pointer(), 2, dims,
+            PyArray_DescrFromType(NPY_UINT8));
+    }
+
+    /* Unpack samples into one byte per channel, 0 or 1. */
+    PyObject * _unpack_bits()
+    {
+        return unpack_bits($self->data_pointer(),
+            $self->data_length() / $self->unit_size(), $self->unit_size());
     }
 
 %pythoncode
 {
     data = property(_data)
+
+    def unpack_bits(self, dtype=None):
+        """Return samples as a (samples, channels) array of 0 and 1.
+
+        Column i holds channel i, i.e. bit i of each sample. With
+        dtype=bool, the result is a boolean view of the same array.
+        """
+        bits = self._unpack_bits()
+        return bits if dtype is None else bits.view(dtype)
+}
+}
+
+/* Return NumPy arrays from Block::logic() and Block::analog(). */
+%extend sigrok::Block
+{
+    PyObject * _logic()
+    {
+        auto block = static_cast<std::enable_shared_from_this<sigrok::Block> *>(
+            $self)->shared_from_this();
+        npy_intp dims[2];
+        dims[0] = $self->logic_samples();
+        dims[1] = $self->unit_size();
+        return owner_array(block, $self->logic().data(), 2, dims,
+            PyArray_DescrFromType(NPY_UINT8));
+    }
+
+    PyObject * _analog_array(std::shared_ptr<sigrok::Channel> channel)
+    {
+        auto block = static_cast<std::enable_shared_from_this<sigrok::Block> *>(
+            $self)->shared_from_this();
+        auto samples = $self->analog(channel);
+        npy_intp dims[1];
+        dims[0] = samples.size();
+        return owner_array(block, samples.data(), 1, dims,
+            PyArray_DescrFromType(NPY_FLOAT32));
+    }
+
+    PyObject * _unpack_bits()
+    {
+        return unpack_bits($self->logic().data(), $self->logic_samples(),
+            $self->unit_size());
+    }
+
+%pythoncode
+{
+    logic = property(_logic)
+
+    def _analog(self):
+        return dict((channel.name, self._analog_array(channel))
+            for channel in self.analog_channels)
+
+    analog = property(_analog)
+
+    def unpack_bits(self, dtype=None):
+        """Return logic samples as a (samples, channels) array of 0 and 1.
+
+        See Logic.unpack_bits().
+        """
+        bits = self._unpack_bits()
+        return bits if dtype is None else bits.view(dtype)
+}
+}
+
+%extend sigrok::Session
+{
+%pythoncode
+{
+    def blocks(self, max_samples, timeout=-1):
+        """Iterate over the blocks read(max_samples, timeout) returns.
+
+        Blocks without samples are skipped, iteration ends with the
+        acquisition. Also usable with "async for", which reads in the
+        default executor of the running event loop.
+        """
+        return _SessionBlocks(self, max_samples, timeout)
 }
 }
 
@@ -595,6 +808,40 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
         return self._create_logic_packet_buf(buf, unit_size)
 
     Context.create_logic_packet = _Context_create_logic_packet
+
+    class _SessionBlocks(object):
+        def __init__(self, session, max_samples, timeout):
+            self._session = session
+            self._max_samples = max_samples
+            self._timeout = timeout
+
+        def __iter__(self):
+            return self
+
+        def __next__(self):
+            while True:
+                block = self._session.read(self._max_samples, self._timeout)
+                if block is None:
+                    raise StopIteration
+                if block.logic_samples or block.analog_channels:
+                    return block
+
+        next = __next__
+
+        def __aiter__(self):
+            return self
+
+        def __anext__(self):
+            import asyncio
+            return asyncio.get_event_loop().run_in_executor(None,
+                self._next_async)
+
+        def _next_async(self):
+            # Futures can't carry StopIteration.
+            try:
+                return self.__next__()
+            except StopIteration:
+                raise StopAsyncIteration
 }
 
 %include "doc_end.i"
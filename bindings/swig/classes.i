@@ -65,6 +65,7 @@ template< class T > class enable_shared_from_this;
 %shared_ptr(sigrok::Meta);
 %shared_ptr(sigrok::Analog);
 %shared_ptr(sigrok::Logic);
+%shared_ptr(sigrok::Block);
 %shared_ptr(sigrok::InputFormat);
 %shared_ptr(sigrok::Input);
 %shared_ptr(sigrok::InputDevice);
@@ -80,6 +81,11 @@ template< class T > class enable_shared_from_this;
 #define SR_PRIV
 
 %ignore sigrok::DatafeedCallbackData;
+%ignore sigrok::Span;
+%ignore sigrok::Logic::bytes;
+%ignore sigrok::Block::logic;
+%ignore sigrok::Block::analog;
+%ignore sigrok::SessionReader;
 
 #ifndef SWIGJAVA
 
@@ -199,9 +205,18 @@ typedef std::map<const sigrok::ConfigKey *, Glib::VariantBase>
 
 %attributestring(sigrok::Session, std::string, filename, filename);
 
+%attributevector(Session,
+    std::vector<sigrok::SessionStats>, stats, stats);
+
 %attribute(sigrok::Packet,
     const sigrok::PacketType *, type, type);
 
+%attribute(sigrok::Block, uint64_t, logic_samples, logic_samples);
+%attribute(sigrok::Block, unsigned int, unit_size, unit_size);
+%attributevector(Block,
+    std::vector<std::shared_ptr<sigrok::Channel> >,
+    analog_channels, analog_channels);
+
 %attributemap(Meta, map_ConfigKey_Variant, config, config);
 
 %attributevector(Analog,
@@ -22,6 +22,7 @@
 using namespace std;
 %}
 
+%include "stdint.i"
 %include "std_string.i"
 %include "std_shared_ptr.i"
 %include "std_vector.i"
@@ -76,6 +77,11 @@ namespace std {
 %template(CapabilitySet)
     std::set<const sigrok::Capability *>;
 
+%template(UInt64Vector) std::vector<uint64_t>;
+
+%template(SessionStatsVector)
+    std::vector<sigrok::SessionStats>;
+
 %template(OptionVector)
     std::vector<std::shared_ptr<sigrok::Option> >;
 %template(OptionMap)
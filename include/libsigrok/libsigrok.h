@@ -482,6 +482,112 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_envelope
+ * Opaque structure holding multi-resolution summaries of sample data.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_envelope_new(), sr_envelope_free().
+ */
+struct sr_envelope;
+
+/** Number of latency histogram buckets in struct sr_session_stats. */
+#define SR_STATS_HIST_BUCKETS 32
+
+/** What a struct sr_session_stats entry describes. */
+enum sr_stats_kind {
+	/** Packets a device sent into the session. */
+	SR_STATS_DEVICE,
+	/** A transform module's receive() method. */
+	SR_STATS_TRANSFORM,
+	/** A datafeed callback. */
+	SR_STATS_CALLBACK,
+	/** An event source (driver receive_data callback). */
+	SR_STATS_SOURCE,
+};
+
+/**
+ * Performance counters of one device, transform, datafeed callback or
+ * event source in a session.
+ *
+ * @see sr_session_stats_enable(), sr_session_stats_get().
+ */
+struct sr_session_stats {
+	/** What this entry describes. */
+	enum sr_stats_kind kind;
+	/**
+	 * Identifies the entity within its kind: the device instance,
+	 * transform, or an opaque key for callbacks and event sources.
+	 * Only meant for telling entries apart, do not dereference.
+	 */
+	const void *id;
+	/** Driver name, transform module ID, "callbackN", "fd" or "timer". */
+	char *name;
+	/** Number of packets processed, or source callback invocations. */
+	uint64_t count;
+	/** Payload size of the logic and analog packets processed. */
+	uint64_t bytes;
+	/**
+	 * Total time spent, in nanoseconds. For devices this is the time
+	 * the session took to pass their packets on (transforms and
+	 * callbacks included).
+	 */
+	uint64_t time_ns;
+	/** Longest single call, in nanoseconds. */
+	uint64_t max_ns;
+	/**
+	 * Call duration histogram. Bucket 0 counts calls which took less
+	 * than 1 ns, bucket i counts durations in [2^(i-1), 2^i) ns. The
+	 * last bucket also counts all longer calls.
+	 */
+	uint64_t hist[SR_STATS_HIST_BUCKETS];
+	/**
+	 * Event sources only: total and maximum delay between the expiry
+	 * of the source's timeout and the actual invocation, in nanoseconds.
+	 */
+	uint64_t late_ns;
+	uint64_t late_max_ns;
+};
+
+/** What sr_session_send_async() does when the session's queue is full. */
+enum sr_async_policy {
+	/** Block the sending thread until the session caught up. */
+	SR_ASYNC_BLOCK,
+	/** Drop logic and analog packets, queue all others anyway. */
+	SR_ASYNC_DROP,
+};
+
+/**
+ * Options for sr_convert_file(). Fields not used must be zero.
+ */
+struct sr_convert_options {
+	/** Input module ID, or NULL to detect the format from the file. */
+	const char *input_format;
+	/** Input module options as for sr_input_new(), or NULL. */
+	GHashTable *input_options;
+	/** Output module ID. Must not be NULL. */
+	const char *output_format;
+	/** Output module options as for sr_output_new(), or NULL. */
+	GHashTable *output_options;
+	/**
+	 * NULL-terminated list of transform module IDs, applied in this
+	 * order. May be NULL.
+	 */
+	const char **transforms;
+	/**
+	 * Transform module options as for sr_transform_new(), one (possibly
+	 * NULL) entry per transform. May be NULL.
+	 */
+	GHashTable **transform_options;
+	/** Size of the chunks the input file is read in, 0 for a default. */
+	size_t chunk_size;
+	/** Packets queued between two stages at most, 0 for a default. */
+	unsigned int queue_length;
+	/** Run all stages in the calling thread. */
+	gboolean single_thread;
+};
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -1262,6 +1368,32 @@ struct sr_dev_driver {
 	/* Dynamic */
 	/** Device driver context, considered private. Initialized by init(). */
 	void *context;
+
+	/* Static */
+	/** Config keys whose lists only change along with the device
+	 *  configuration, terminated by 0. sr_config_list() caches these,
+	 *  as well as SR_CONF_SCAN_OPTIONS and SR_CONF_DEVICE_OPTIONS.
+	 *  Can be NULL. */
+	const uint32_t *static_lists;
+};
+
+/**
+ * Description and result of one driver scan within a multi-driver scan.
+ *
+ * @see sr_driver_scan_multi().
+ * @since 0.6.0
+ */
+struct sr_driver_scan_job {
+	/** The driver to scan with. Must have been initialized. */
+	struct sr_dev_driver *driver;
+	/** Scan options for this driver, see sr_driver_scan(). Can be NULL. */
+	GSList *options;
+	/** Devices found by the scan, to be freed like the return value
+	 *  of sr_driver_scan(). Set by sr_driver_scan_multi(). */
+	GSList *devices;
+	/** Wall clock time the scan took, in microseconds.
+	 *  Set by sr_driver_scan_multi(). */
+	uint64_t duration_us;
 };
 
 /** Serial port descriptor. */
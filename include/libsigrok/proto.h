@@ -105,6 +105,8 @@ SR_API int sr_driver_init(struct sr_context *ctx,
 		struct sr_dev_driver *driver);
 SR_API GArray *sr_driver_scan_options_list(const struct sr_dev_driver *driver);
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options);
+SR_API int sr_driver_scan_multi(struct sr_driver_scan_job *jobs,
+		size_t num_jobs, unsigned int max_threads);
 SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -154,10 +156,47 @@ SR_API int sr_session_is_running(struct sr_session *session);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
 
+/* Performance counters */
+SR_API int sr_session_stats_enable(struct sr_session *session, gboolean enable);
+SR_API int sr_session_stats_reset(struct sr_session *session);
+SR_API int sr_session_stats_get(struct sr_session *session, GSList **stats);
+SR_API void sr_session_stats_free(GSList *stats);
+
+/* Datafeed from other threads */
+SR_API int sr_session_dev_thread_set(struct sr_session *session,
+		struct sr_dev_inst *sdi, int group);
+SR_API int sr_session_send_async(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_API int sr_session_async_limit_set(struct sr_session *session,
+		uint64_t max_bytes, enum sr_async_policy policy);
+
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
 
+/*--- convert.c -------------------------------------------------------------*/
+
+SR_API int sr_convert_file(struct sr_context *ctx, const char *input_file,
+		const char *output_file, const struct sr_convert_options *options);
+
+/*--- envelope.c ------------------------------------------------------------*/
+
+SR_API int sr_envelope_new(struct sr_envelope **env, uint64_t block_size);
+SR_API void sr_envelope_free(struct sr_envelope *env);
+SR_API int sr_envelope_feed(struct sr_envelope *env,
+		const struct sr_datafeed_packet *packet);
+SR_API int sr_envelope_logic_info(struct sr_envelope *env,
+		uint64_t *num_samples, unsigned int *unitsize);
+SR_API int sr_envelope_analog_info(struct sr_envelope *env,
+		const char *channel, uint64_t *num_samples);
+SR_API int sr_envelope_logic_get(struct sr_envelope *env, uint64_t start,
+		uint64_t end, unsigned int num_buckets, uint8_t *low,
+		uint8_t *high);
+SR_API int sr_envelope_analog_get(struct sr_envelope *env,
+		const char *channel, uint64_t start, uint64_t end,
+		unsigned int num_buckets, float *min, float *max);
+SR_API int sr_envelope_load(const char *filename, struct sr_envelope **env);
+
 /*--- input/input.c ---------------------------------------------------------*/
 
 SR_API const struct sr_input_module **sr_input_list(void);
@@ -198,6 +237,11 @@ SR_API gboolean sr_output_test_flag(const struct sr_output_module *omod,
 		uint64_t flag);
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
+SR_API int sr_output_send_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out);
+SR_API int sr_output_send_fd(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, int fd);
+SR_API int sr_output_flush_fd(const struct sr_output *o, int fd);
 SR_API int sr_output_free(const struct sr_output *o);
 
 /*--- transform/transform.c -------------------------------------------------*/
@@ -242,6 +242,10 @@ static void print_versions(void)
 	char *str;
 	const char *lib, *version;
 
+	/* Collecting the version strings isn't free, skip it if unused. */
+	if (!sr_log_enabled(SR_LOG_DBG))
+		return;
+
 	sr_dbg("libsigrok %s/%s.",
 		sr_package_version_string_get(), sr_lib_version_string_get());
 
@@ -274,6 +278,9 @@ static void print_resourcepaths(void)
 {
 	GSList *l, *l_orig;
 
+	if (!sr_log_enabled(SR_LOG_DBG))
+		return;
+
 	sr_dbg("Firmware search paths:");
 	l_orig = sr_resourcepaths_get(SR_RESOURCE_FIRMWARE);
 	for (l = l_orig; l; l = l->next)
@@ -281,253 +288,311 @@ static void print_resourcepaths(void)
 	g_slist_free_full(l_orig, g_free);
 }
 
-/**
- * Sanity-check all libsigrok drivers.
- *
- * @param[in] ctx Pointer to a libsigrok context struct. Must not be NULL.
- *
- * @retval SR_OK All drivers are OK
- * @retval SR_ERR One or more drivers have issues.
- * @retval SR_ERR_ARG Invalid argument.
+/*
+ * Drivers and modules which passed their sanity check. They do not change
+ * at runtime, so each of them is checked once only.
  */
-static int sanity_check_all_drivers(const struct sr_context *ctx)
+static GMutex sanity_mutex;
+static GHashTable *sanity_passed;
+
+static gboolean sanity_check_passed(const void *mod)
 {
-	int i, errors, ret = SR_OK;
-	struct sr_dev_driver **drivers;
-	const char *d;
+	gboolean passed;
 
-	if (!ctx)
-		return SR_ERR_ARG;
+	g_mutex_lock(&sanity_mutex);
+	passed = sanity_passed && g_hash_table_contains(sanity_passed, mod);
+	g_mutex_unlock(&sanity_mutex);
 
-	sr_spew("Sanity-checking all drivers.");
+	return passed;
+}
 
-	drivers = sr_driver_list(ctx);
-	for (i = 0; drivers[i]; i++) {
-		errors = 0;
+static int sanity_check_done(const void *mod, int errors)
+{
+	if (errors != 0)
+		return SR_ERR;
 
-		d = (drivers[i]->name) ? drivers[i]->name : "NULL";
+	g_mutex_lock(&sanity_mutex);
+	if (!sanity_passed)
+		sanity_passed = g_hash_table_new(NULL, NULL);
+	g_hash_table_add(sanity_passed, (void *)mod);
+	g_mutex_unlock(&sanity_mutex);
 
-		if (!drivers[i]->name) {
-			sr_err("No name in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->longname) {
-			sr_err("No longname in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (drivers[i]->api_version < 1) {
-			sr_err("API version in driver %d ('%s') < 1.", i, d);
-			errors++;
-		}
-		if (!drivers[i]->init) {
-			sr_err("No init in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->cleanup) {
-			sr_err("No cleanup in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->scan) {
-			sr_err("No scan in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_list) {
-			sr_err("No dev_list in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_clear) {
-			sr_err("No dev_clear in driver %d ('%s').", i, d);
-			errors++;
-		}
-		/* Note: config_get() is optional. */
-		if (!drivers[i]->config_set) {
-			sr_err("No config_set in driver %d ('%s').", i, d);
-			errors++;
-		}
-		/* Note: config_channel_set() is optional. */
-		/* Note: config_commit() is optional. */
-		if (!drivers[i]->config_list) {
-			sr_err("No config_list in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_open) {
-			sr_err("No dev_open in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_close) {
-			sr_err("No dev_close in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_acquisition_start) {
-			sr_err("No dev_acquisition_start in driver %d ('%s').",
-			       i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_acquisition_stop) {
-			sr_err("No dev_acquisition_stop in driver %d ('%s').",
-			       i, d);
-			errors++;
-		}
+	return SR_OK;
+}
 
-		/* Note: 'priv' is allowed to be NULL. */
+/**
+ * Sanity-check a libsigrok driver.
+ *
+ * This runs when the driver gets initialized for the first time, see
+ * sr_driver_init().
+ *
+ * @param[in] driver The driver to check. Must not be NULL.
+ *
+ * @retval SR_OK The driver is OK.
+ * @retval SR_ERR The driver has issues.
+ *
+ * @private
+ */
+SR_PRIV int sr_driver_sanity_check(const struct sr_dev_driver *driver)
+{
+	int errors;
+	const char *d;
 
-		if (errors == 0)
-			continue;
+	if (sanity_check_passed(driver))
+		return SR_OK;
 
-		ret = SR_ERR;
+	errors = 0;
+
+	d = (driver->name) ? driver->name : "NULL";
+
+	if (!driver->name) {
+		sr_err("No name in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->longname) {
+		sr_err("No longname in driver '%s'.", d);
+		errors++;
+	}
+	if (driver->api_version < 1) {
+		sr_err("API version in driver '%s' < 1.", d);
+		errors++;
+	}
+	if (!driver->init) {
+		sr_err("No init in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->cleanup) {
+		sr_err("No cleanup in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->scan) {
+		sr_err("No scan in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_list) {
+		sr_err("No dev_list in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_clear) {
+		sr_err("No dev_clear in driver '%s'.", d);
+		errors++;
+	}
+	/* Note: config_get() is optional. */
+	if (!driver->config_set) {
+		sr_err("No config_set in driver '%s'.", d);
+		errors++;
+	}
+	/* Note: config_channel_set() is optional. */
+	/* Note: config_commit() is optional. */
+	if (!driver->config_list) {
+		sr_err("No config_list in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_open) {
+		sr_err("No dev_open in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_close) {
+		sr_err("No dev_close in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_acquisition_start) {
+		sr_err("No dev_acquisition_start in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_acquisition_stop) {
+		sr_err("No dev_acquisition_stop in driver '%s'.", d);
+		errors++;
 	}
 
-	return ret;
+	/* Note: 'priv' is allowed to be NULL. */
+
+	return sanity_check_done(driver, errors);
 }
 
 /**
- * Sanity-check all libsigrok input modules.
+ * Sanity-check a libsigrok input module.
+ *
+ * This runs when the module gets instantiated for the first time.
+ *
+ * @param[in] mod The module to check. Must not be NULL.
  *
- * @retval SR_OK All modules are OK
- * @retval SR_ERR One or more modules have issues.
+ * @retval SR_OK The module is OK.
+ * @retval SR_ERR The module has issues.
+ *
+ * @private
  */
-static int sanity_check_all_input_modules(void)
+SR_PRIV int sr_input_module_sanity_check(const struct sr_input_module *mod)
 {
-	int i, errors, ret = SR_OK;
-	const struct sr_input_module **inputs;
+	int errors;
 	const char *d;
 
-	sr_spew("Sanity-checking all input modules.");
-
-	inputs = sr_input_list();
-	for (i = 0; inputs[i]; i++) {
-		errors = 0;
-
-		d = (inputs[i]->id) ? inputs[i]->id : "NULL";
+	if (sanity_check_passed(mod))
+		return SR_OK;
 
-		if (!inputs[i]->id) {
-			sr_err("No ID in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!inputs[i]->name) {
-			sr_err("No name in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!inputs[i]->desc) {
-			sr_err("No description in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!inputs[i]->init) {
-			sr_err("No init in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!inputs[i]->receive) {
-			sr_err("No receive in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!inputs[i]->end) {
-			sr_err("No end in module %d ('%s').", i, d);
-			errors++;
-		}
+	errors = 0;
 
-		if (errors == 0)
-			continue;
+	d = (mod->id) ? mod->id : "NULL";
 
-		ret = SR_ERR;
+	if (!mod->id) {
+		sr_err("No ID in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->name) {
+		sr_err("No name in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->desc) {
+		sr_err("No description in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->init) {
+		sr_err("No init in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->receive) {
+		sr_err("No receive in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->end) {
+		sr_err("No end in module '%s'.", d);
+		errors++;
 	}
 
-	return ret;
+	return sanity_check_done(mod, errors);
 }
 
 /**
- * Sanity-check all libsigrok output modules.
+ * Sanity-check a libsigrok output module.
+ *
+ * This runs when the module gets instantiated for the first time.
  *
- * @retval SR_OK All modules are OK
- * @retval SR_ERR One or more modules have issues.
+ * @param[in] mod The module to check. Must not be NULL.
+ *
+ * @retval SR_OK The module is OK.
+ * @retval SR_ERR The module has issues.
+ *
+ * @private
  */
-static int sanity_check_all_output_modules(void)
+SR_PRIV int sr_output_module_sanity_check(const struct sr_output_module *mod)
 {
-	int i, errors, ret = SR_OK;
-	const struct sr_output_module **outputs;
+	int errors;
 	const char *d;
 
-	sr_spew("Sanity-checking all output modules.");
+	if (sanity_check_passed(mod))
+		return SR_OK;
 
-	outputs = sr_output_list();
-	for (i = 0; outputs[i]; i++) {
-		errors = 0;
+	errors = 0;
 
-		d = (outputs[i]->id) ? outputs[i]->id : "NULL";
+	d = (mod->id) ? mod->id : "NULL";
 
-		if (!outputs[i]->id) {
-			sr_err("No ID in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!outputs[i]->name) {
-			sr_err("No name in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!outputs[i]->desc) {
-			sr_err("No description in module '%s'.", d);
-			errors++;
-		}
-		if (!outputs[i]->receive) {
-			sr_err("No receive in module '%s'.", d);
-			errors++;
-		}
-
-		if (errors == 0)
-			continue;
-
-		ret = SR_ERR;
+	if (!mod->id) {
+		sr_err("No ID in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->name) {
+		sr_err("No name in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->desc) {
+		sr_err("No description in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->receive && !mod->receive_sink) {
+		sr_err("No receive in module '%s'.", d);
+		errors++;
 	}
 
-	return ret;
+	return sanity_check_done(mod, errors);
 }
 
 /**
- * Sanity-check all libsigrok transform modules.
+ * Sanity-check a libsigrok transform module.
+ *
+ * This runs when the module gets instantiated for the first time.
+ *
+ * @param[in] mod The module to check. Must not be NULL.
+ *
+ * @retval SR_OK The module is OK.
+ * @retval SR_ERR The module has issues.
  *
- * @retval SR_OK All modules are OK
- * @retval SR_ERR One or more modules have issues.
+ * @private
  */
-static int sanity_check_all_transform_modules(void)
+SR_PRIV int sr_transform_module_sanity_check(const struct sr_transform_module *mod)
 {
-	int i, errors, ret = SR_OK;
-	const struct sr_transform_module **transforms;
+	int errors;
 	const char *d;
 
-	sr_spew("Sanity-checking all transform modules.");
+	if (sanity_check_passed(mod))
+		return SR_OK;
 
-	transforms = sr_transform_list();
-	for (i = 0; transforms[i]; i++) {
-		errors = 0;
+	errors = 0;
 
-		d = (transforms[i]->id) ? transforms[i]->id : "NULL";
+	d = (mod->id) ? mod->id : "NULL";
 
-		if (!transforms[i]->id) {
-			sr_err("No ID in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!transforms[i]->name) {
-			sr_err("No name in module %d ('%s').", i, d);
-			errors++;
-		}
-		if (!transforms[i]->desc) {
-			sr_err("No description in module '%s'.", d);
-			errors++;
-		}
-		/* Note: options() is optional. */
-		/* Note: init() is optional. */
-		if (!transforms[i]->receive) {
-			sr_err("No receive in module '%s'.", d);
-			errors++;
-		}
-		/* Note: cleanup() is optional. */
+	if (!mod->id) {
+		sr_err("No ID in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->name) {
+		sr_err("No name in module '%s'.", d);
+		errors++;
+	}
+	if (!mod->desc) {
+		sr_err("No description in module '%s'.", d);
+		errors++;
+	}
+	/* Note: options() is optional. */
+	/* Note: init() is optional. */
+	if (!mod->receive) {
+		sr_err("No receive in module '%s'.", d);
+		errors++;
+	}
+	/* Note: cleanup() is optional. */
 
-		if (errors == 0)
-			continue;
+	return sanity_check_done(mod, errors);
+}
 
-		ret = SR_ERR;
+#ifdef SR_SANITY_CHECK_AT_INIT
+/*
+ * Sanity-check all drivers and modules up front. By default each one
+ * gets checked on first use instead, which keeps sr_init() cheap.
+ */
+static int sanity_check_all(const struct sr_context *ctx)
+{
+	struct sr_dev_driver **drivers;
+	const struct sr_input_module **inputs;
+	const struct sr_output_module **outputs;
+	const struct sr_transform_module **transforms;
+	int i, ret;
+
+	sr_spew("Sanity-checking all drivers and modules.");
+
+	ret = SR_OK;
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers[i]; i++) {
+		if (sr_driver_sanity_check(drivers[i]) != SR_OK)
+			ret = SR_ERR;
+	}
+	inputs = sr_input_list();
+	for (i = 0; inputs[i]; i++) {
+		if (sr_input_module_sanity_check(inputs[i]) != SR_OK)
+			ret = SR_ERR;
+	}
+	outputs = sr_output_list();
+	for (i = 0; outputs[i]; i++) {
+		if (sr_output_module_sanity_check(outputs[i]) != SR_OK)
+			ret = SR_ERR;
+	}
+	transforms = sr_transform_list();
+	for (i = 0; transforms[i]; i++) {
+		if (sr_transform_module_sanity_check(transforms[i]) != SR_OK)
+			ret = SR_ERR;
 	}
 
 	return ret;
 }
+#endif
 
 /**
  * Initialize libsigrok.
@@ -566,25 +631,12 @@ SR_API int sr_init(struct sr_context **ctx)
 
 	sr_drivers_init(context);
 
-	if (sanity_check_all_drivers(context) < 0) {
-		sr_err("Internal driver error(s), aborting.");
-		goto done;
-	}
-
-	if (sanity_check_all_input_modules() < 0) {
-		sr_err("Internal input module error(s), aborting.");
-		goto done;
-	}
-
-	if (sanity_check_all_output_modules() < 0) {
-		sr_err("Internal output module error(s), aborting.");
-		goto done;
-	}
-
-	if (sanity_check_all_transform_modules() < 0) {
-		sr_err("Internal transform module error(s), aborting.");
+#ifdef SR_SANITY_CHECK_AT_INIT
+	if (sanity_check_all(context) < 0) {
+		sr_err("Internal driver or module error(s), aborting.");
 		goto done;
 	}
+#endif
 
 #ifdef _WIN32
 	if ((ret = WSAStartup(MAKEWORD(2, 2), &wsadata)) != 0) {
@@ -601,6 +653,7 @@ SR_API int sr_init(struct sr_context **ctx)
 		ret = SR_ERR;
 		goto done;
 	}
+	usb_events_init(context);
 #endif
 #ifdef HAVE_LIBHIDAPI
 	/*
@@ -623,6 +676,16 @@ SR_API int sr_init(struct sr_context **ctx)
 	ret = SR_OK;
 
 done:
+	if (context) {
+#ifdef HAVE_LIBUSB_1_0
+		if (context->libusb_ctx) {
+			usb_events_exit(context);
+			libusb_exit(context->libusb_ctx);
+		}
+#endif
+		/* Lazy driver init must not pick up the freed context. */
+		sr_drivers_exit(context);
+	}
 	g_free(context);
 	return ret;
 }
@@ -654,10 +717,11 @@ SR_API int sr_exit(struct sr_context *ctx)
 	hid_exit();
 #endif
 #ifdef HAVE_LIBUSB_1_0
+	usb_events_exit(ctx);
 	libusb_exit(ctx->libusb_ctx);
 #endif
 
-	g_free(sr_driver_list(ctx));
+	sr_drivers_exit(ctx);
 	g_free(ctx);
 
 	return SR_OK;
@@ -0,0 +1,572 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "convert"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * File conversion between input and output formats.
+ */
+
+/**
+ * @defgroup grp_convert File conversion
+ *
+ * Convert files from one format into another.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+#define CONVERT_CHUNK_SIZE	(1024 * 1024)
+#define CONVERT_QUEUE_LENGTH	64
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*
+ * Bounded packet queue between two pipeline stages. There is exactly
+ * one producer and one consumer, and only one of them can be waiting
+ * at any time (for space or for packets), so a single condition
+ * variable serves both.
+ */
+struct convert_queue {
+	GMutex mutex;
+	GCond cond;
+	GQueue packets;
+	unsigned int max;
+	/* The producer is done, the consumer drains what is left. */
+	gboolean closed;
+	/* A stage failed, everybody stops. */
+	gboolean aborted;
+};
+
+struct convert {
+	/* The input's device, set before its first packet is sent. */
+	const struct sr_dev_inst *sdi;
+	const char *const *transform_ids;
+	GHashTable **transform_options;
+	/* Transform instances, in order. Run by the pipeline itself. */
+	GSList *transforms;
+	struct sr_transform_fuse fuse;
+	const struct sr_output_module *omod;
+	GHashTable *output_options;
+	const char *filename;
+	/* Output file, or -1 if the output module writes it itself. */
+	int fd;
+	/* Created for the input's device at its first packet. */
+	const struct sr_output *o;
+	gboolean threaded;
+	/* Input to transform stage, or to output stage without transforms. */
+	struct convert_queue in_queue;
+	/* Transform to output stage. */
+	struct convert_queue out_queue;
+	GMutex mutex;
+	int ret;
+};
+/** @endcond */
+
+static void queue_init(struct convert_queue *q, unsigned int max)
+{
+	g_mutex_init(&q->mutex);
+	g_cond_init(&q->cond);
+	g_queue_init(&q->packets);
+	q->max = max;
+	q->closed = FALSE;
+	q->aborted = FALSE;
+}
+
+static void queue_clear(struct convert_queue *q)
+{
+	struct sr_datafeed_packet *packet;
+
+	while ((packet = g_queue_pop_head(&q->packets)))
+		sr_packet_free(packet);
+	g_cond_clear(&q->cond);
+	g_mutex_clear(&q->mutex);
+}
+
+/* Takes ownership of the packet, even if it fails. */
+static int queue_push(struct convert_queue *q,
+		struct sr_datafeed_packet *packet)
+{
+	g_mutex_lock(&q->mutex);
+	while (!q->aborted && q->packets.length >= q->max)
+		g_cond_wait(&q->cond, &q->mutex);
+	if (q->aborted) {
+		g_mutex_unlock(&q->mutex);
+		sr_packet_free(packet);
+		return SR_ERR;
+	}
+	g_queue_push_tail(&q->packets, packet);
+	g_cond_signal(&q->cond);
+	g_mutex_unlock(&q->mutex);
+
+	return SR_OK;
+}
+
+/* Returns NULL once the queue is closed and drained, or aborted. */
+static struct sr_datafeed_packet *queue_pop(struct convert_queue *q)
+{
+	struct sr_datafeed_packet *packet;
+
+	g_mutex_lock(&q->mutex);
+	while (!q->aborted && !q->closed && !q->packets.length)
+		g_cond_wait(&q->cond, &q->mutex);
+	packet = q->aborted ? NULL : g_queue_pop_head(&q->packets);
+	if (packet)
+		g_cond_signal(&q->cond);
+	g_mutex_unlock(&q->mutex);
+
+	return packet;
+}
+
+static void queue_close(struct convert_queue *q)
+{
+	g_mutex_lock(&q->mutex);
+	q->closed = TRUE;
+	g_cond_signal(&q->cond);
+	g_mutex_unlock(&q->mutex);
+}
+
+static void queue_abort(struct convert_queue *q)
+{
+	g_mutex_lock(&q->mutex);
+	q->aborted = TRUE;
+	g_cond_signal(&q->cond);
+	g_mutex_unlock(&q->mutex);
+}
+
+/* Record the first error of any stage and stop all of them. */
+static void convert_fail(struct convert *c, int ret)
+{
+	g_mutex_lock(&c->mutex);
+	if (c->ret == SR_OK)
+		c->ret = ret;
+	g_mutex_unlock(&c->mutex);
+	queue_abort(&c->in_queue);
+	queue_abort(&c->out_queue);
+}
+
+static int convert_status(struct convert *c)
+{
+	int ret;
+
+	g_mutex_lock(&c->mutex);
+	ret = c->ret;
+	g_mutex_unlock(&c->mutex);
+
+	return ret;
+}
+
+/*
+ * Run a packet through the transforms. The result is NULL if one of
+ * them dropped the packet. Like in sr_session_send(), it's only valid
+ * until the next packet.
+ */
+static int convert_transform(struct convert *c,
+		struct sr_datafeed_packet *packet, struct sr_datafeed_packet **out)
+{
+	const struct sr_transform *t;
+	struct sr_datafeed_packet *packet_out;
+	unsigned int fused;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	for (l = c->transforms; l && packet; l = l->next) {
+		ret = sr_transform_fuse_run(&c->fuse, l, packet, &fused);
+		if (ret < 0) {
+			sr_err("Error while running transform module: %d.", ret);
+			return SR_ERR;
+		}
+		if (fused) {
+			while (--fused)
+				l = l->next;
+			continue;
+		}
+		t = l->data;
+		packet_out = NULL;
+		ret = t->module->receive(t, packet, &packet_out);
+		if (ret < 0) {
+			sr_err("Error while running transform module: %d.", ret);
+			return SR_ERR;
+		}
+		packet = packet_out;
+	}
+	*out = packet;
+
+	return SR_OK;
+}
+
+static int convert_output(struct convert *c,
+		const struct sr_datafeed_packet *packet)
+{
+	GString *out;
+	int ret;
+
+	if (!c->o) {
+		c->o = sr_output_new(c->omod, c->output_options,
+			sr_transform_dev_inst_get(c->transforms, c->sdi),
+			c->filename);
+		if (!c->o)
+			return SR_ERR;
+	}
+
+	if (c->fd >= 0)
+		return sr_output_send_fd(c->o, packet, c->fd);
+
+	out = NULL;
+	ret = sr_output_send(c->o, packet, &out);
+	if (out)
+		g_string_free(out, TRUE);
+
+	return ret;
+}
+
+static gpointer transform_thread(gpointer data)
+{
+	struct convert *c;
+	struct sr_datafeed_packet *packet, *out, *copy;
+	int ret;
+
+	c = data;
+	while ((packet = queue_pop(&c->in_queue))) {
+		ret = convert_transform(c, packet, &out);
+		copy = out;
+		/* Transforms may return a buffer of their own. */
+		if (ret == SR_OK && out && out != packet)
+			ret = sr_packet_copy(out, &copy);
+		if (copy != packet)
+			sr_packet_free(packet);
+		if (ret != SR_OK) {
+			convert_fail(c, ret);
+			break;
+		}
+		if (copy && queue_push(&c->out_queue, copy) != SR_OK)
+			break;
+	}
+	queue_close(&c->out_queue);
+
+	return NULL;
+}
+
+static gpointer output_thread(gpointer data)
+{
+	struct convert *c;
+	struct convert_queue *q;
+	struct sr_datafeed_packet *packet;
+	int ret;
+
+	c = data;
+	q = c->transform_ids ? &c->out_queue : &c->in_queue;
+	while ((packet = queue_pop(q))) {
+		ret = convert_output(c, packet);
+		sr_packet_free(packet);
+		if (ret != SR_OK) {
+			convert_fail(c, ret);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Runs in the input stage, i.e. the calling thread. Threaded, packets
+ * are copied since input modules reuse their buffers.
+ */
+static void convert_datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct convert *c;
+	struct sr_datafeed_packet *out;
+	int ret;
+
+	(void)sdi;
+
+	c = cb_data;
+	if (c->threaded) {
+		if ((ret = sr_packet_copy(packet, &out)) != SR_OK)
+			convert_fail(c, ret);
+		else
+			queue_push(&c->in_queue, out);
+		return;
+	}
+
+	if (c->ret != SR_OK)
+		return;
+	ret = convert_transform(c, (struct sr_datafeed_packet *)packet, &out);
+	if (ret == SR_OK && out)
+		ret = convert_output(c, out);
+	if (ret != SR_OK)
+		c->ret = ret;
+}
+
+static int convert_dev_add(struct convert *c, struct sr_session *session,
+		struct sr_dev_inst *sdi)
+{
+	const struct sr_transform_module *tmod;
+	const struct sr_transform *t;
+	unsigned int i;
+	int ret;
+
+	if ((ret = sr_session_dev_add(session, sdi)) != SR_OK)
+		return ret;
+	c->sdi = sdi;
+
+	for (i = 0; c->transform_ids && c->transform_ids[i]; i++) {
+		tmod = sr_transform_find(c->transform_ids[i]);
+		t = sr_transform_new(tmod, c->transform_options ?
+			c->transform_options[i] : NULL, sdi);
+		/* Run by the pipeline stages, not by sr_session_send(). */
+		session->transforms = g_slist_remove(session->transforms, t);
+		if (!t)
+			return SR_ERR;
+		c->transforms = g_slist_append(c->transforms, (gpointer)t);
+	}
+
+	return SR_OK;
+}
+
+/* The input stage: read the file and feed it to the input module. */
+static int convert_input(struct convert *c, struct sr_session *session,
+		const struct sr_input *in, const char *filename, size_t chunk_size)
+{
+	struct sr_dev_inst *sdi;
+	FILE *stream;
+	GString *buf;
+	size_t count;
+	int ret;
+
+	if (!(stream = g_fopen(filename, "rb"))) {
+		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+
+	buf = g_string_sized_new(chunk_size);
+	ret = SR_OK;
+	while (ret == SR_OK) {
+		count = fread(buf->str, 1, chunk_size, stream);
+		if (ferror(stream)) {
+			sr_err("Failed to read %s: %s", filename,
+				g_strerror(errno));
+			ret = SR_ERR_IO;
+			break;
+		}
+		if (!count)
+			break;
+		g_string_set_size(buf, count);
+		ret = sr_input_send(in, buf);
+		/* Some modules only create their device once they saw a header. */
+		if (ret == SR_OK && !c->sdi && (sdi = sr_input_dev_inst_get(in)))
+			ret = convert_dev_add(c, session, sdi);
+		if (ret == SR_OK)
+			ret = convert_status(c);
+	}
+	if (ret == SR_OK)
+		ret = sr_input_end(in);
+
+	g_string_free(buf, TRUE);
+	fclose(stream);
+
+	return ret;
+}
+
+static const struct sr_input *convert_input_new(const char *filename,
+		const struct sr_convert_options *options)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+
+	if (options->input_format) {
+		if (!(imod = sr_input_find((char *)options->input_format))) {
+			sr_err("Unknown input module '%s'.",
+				options->input_format);
+			return NULL;
+		}
+		return sr_input_new(imod, options->input_options);
+	}
+
+	if (sr_input_scan_file(filename, &in) != SR_OK || !in) {
+		sr_err("Unable to detect the format of %s.", filename);
+		return NULL;
+	}
+	if (!options->input_options)
+		return in;
+
+	/* Detection instantiates the module without options. */
+	imod = sr_input_module_get(in);
+	sr_input_free(in);
+
+	return sr_input_new(imod, options->input_options);
+}
+
+/**
+ * Convert a file from one format into another.
+ *
+ * The input module parses the file, the transforms (if any) run over
+ * the data, and the output module writes the result. Unless
+ * single-threaded operation is requested, these stages run in threads
+ * of their own, connected by bounded queues: the calling thread reads
+ * and parses the file, while a transform and an output thread process
+ * the packets parsed earlier. Throughput is then bound by the slowest
+ * stage instead of the sum of all stages.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param input_file The file to convert. Must not be NULL.
+ * @param output_file The file to write. It is replaced if it exists and
+ *                    may remain incomplete on errors. Must not be NULL.
+ * @param options The formats and conversion options. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or unknown module.
+ * @retval SR_ERR_IO Reading or writing a file failed.
+ * @retval SR_ERR_DATA The input file contains no data.
+ * @retval other Error code of an input, transform or output module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_file(struct sr_context *ctx, const char *input_file,
+		const char *output_file, const struct sr_convert_options *options)
+{
+	struct convert c;
+	struct sr_session *session;
+	const struct sr_input *in;
+	GThread *transformer, *writer;
+	GSList *l;
+	unsigned int i;
+	int ret;
+
+	if (!ctx || !input_file || !output_file || !options
+			|| !options->output_format)
+		return SR_ERR_ARG;
+
+	memset(&c, 0, sizeof(c));
+	c.fd = -1;
+	c.filename = output_file;
+	c.output_options = options->output_options;
+	c.transform_ids = options->transforms;
+	c.transform_options = options->transform_options;
+	c.threaded = !options->single_thread;
+
+	if (!(c.omod = sr_output_find((char *)options->output_format))) {
+		sr_err("Unknown output module '%s'.", options->output_format);
+		return SR_ERR_ARG;
+	}
+	for (i = 0; c.transform_ids && c.transform_ids[i]; i++) {
+		if (!sr_transform_find(c.transform_ids[i])) {
+			sr_err("Unknown transform module '%s'.",
+				c.transform_ids[i]);
+			return SR_ERR_ARG;
+		}
+	}
+	/* An empty list needs no transform stage. */
+	if (c.transform_ids && !c.transform_ids[0])
+		c.transform_ids = NULL;
+
+	if (!(in = convert_input_new(input_file, options)))
+		return SR_ERR_ARG;
+
+	if (!sr_output_test_flag(c.omod, SR_OUTPUT_INTERNAL_IO_HANDLING)) {
+		c.fd = g_open(output_file,
+			O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+		if (c.fd < 0) {
+			sr_err("Failed to open %s: %s", output_file,
+				g_strerror(errno));
+			sr_input_free(in);
+			return SR_ERR_IO;
+		}
+	}
+
+	g_mutex_init(&c.mutex);
+	queue_init(&c.in_queue, options->queue_length ?
+		options->queue_length : CONVERT_QUEUE_LENGTH);
+	queue_init(&c.out_queue, options->queue_length ?
+		options->queue_length : CONVERT_QUEUE_LENGTH);
+
+	sr_session_new(ctx, &session);
+	sr_session_datafeed_callback_add(session, convert_datafeed_in, &c);
+
+	transformer = writer = NULL;
+	if (c.threaded) {
+		if (c.transform_ids)
+			transformer = g_thread_new("sr-convert-transform",
+				transform_thread, &c);
+		writer = g_thread_new("sr-convert-output", output_thread, &c);
+	}
+
+	ret = convert_input(&c, session, in, input_file,
+		options->chunk_size ? options->chunk_size : CONVERT_CHUNK_SIZE);
+	if (ret != SR_OK)
+		convert_fail(&c, ret);
+	else
+		queue_close(&c.in_queue);
+
+	if (transformer)
+		g_thread_join(transformer);
+	if (writer)
+		g_thread_join(writer);
+
+	if (ret == SR_OK)
+		ret = c.ret;
+	if (ret == SR_OK && !c.o) {
+		sr_err("No data in %s.", input_file);
+		ret = SR_ERR_DATA;
+	}
+	if (ret == SR_OK && c.fd >= 0)
+		ret = sr_output_flush_fd(c.o, c.fd);
+
+	if (c.o)
+		sr_output_free(c.o);
+	if (c.fd >= 0 && close(c.fd) < 0 && ret == SR_OK) {
+		sr_err("Failed to write %s: %s", output_file,
+			g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	for (l = c.transforms; l; l = l->next)
+		sr_transform_free(l->data);
+	g_slist_free(c.transforms);
+	sr_transform_fuse_clear(&c.fuse);
+
+	sr_session_destroy(session);
+	sr_input_free(in);
+
+	queue_clear(&c.in_queue);
+	queue_clear(&c.out_queue);
+	g_mutex_clear(&c.mutex);
+
+	return ret;
+}
+
+/** @} */
@@ -159,6 +159,8 @@ SR_API int sr_dev_channel_enable(struct sr_channel *channel, gboolean state)
 		if (ret != SR_OK)
 			return ret;
 	}
+	if (!state != !was_enabled)
+		sr_config_cache_invalidate(sdi);
 
 	return SR_OK;
 }
@@ -274,29 +276,15 @@ SR_PRIV gboolean sr_channel_lists_differ(GSList *l1, GSList *l2)
  */
 SR_API gboolean sr_dev_has_option(const struct sr_dev_inst *sdi, int key)
 {
-	GVariant *gvar;
-	const int *devopts;
-	gsize num_opts, i;
-	int ret;
+	uint32_t caps;
 
 	if (!sdi || !sdi->driver || !sdi->driver->config_list)
 		return FALSE;
 
-	if (sdi->driver->config_list(SR_CONF_DEVICE_OPTIONS,
-				&gvar, sdi, NULL) != SR_OK)
+	if (sr_config_caps_get(sdi->driver, sdi, NULL, key, &caps) != SR_OK)
 		return FALSE;
 
-	ret = FALSE;
-	devopts = g_variant_get_fixed_array(gvar, &num_opts, sizeof(int32_t));
-	for (i = 0; i < num_opts; i++) {
-		if ((devopts[i] & SR_CONF_MASK) == key) {
-			ret = TRUE;
-			break;
-		}
-	}
-	g_variant_unref(gvar);
-
-	return ret;
+	return caps != 0;
 }
 
 /**
@@ -329,7 +317,7 @@ SR_API GArray *sr_dev_options(const struct sr_dev_driver *driver,
 	if (sdi && sdi->driver != driver)
 		return NULL;
 
-	if (driver->config_list(SR_CONF_DEVICE_OPTIONS, &gvar, sdi, cg) != SR_OK)
+	if (sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, &gvar) != SR_OK)
 		return NULL;
 
 	opts = g_variant_get_fixed_array(gvar, &num_opts, sizeof(uint32_t));
@@ -367,29 +355,15 @@ SR_API GArray *sr_dev_options(const struct sr_dev_driver *driver,
 SR_API int sr_dev_config_capabilities_list(const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg, const int key)
 {
-	GVariant *gvar;
-	const int *devopts;
-	gsize num_opts, i;
-	int ret;
+	uint32_t caps;
 
 	if (!sdi || !sdi->driver || !sdi->driver->config_list)
 		return 0;
 
-	if (sdi->driver->config_list(SR_CONF_DEVICE_OPTIONS,
-				&gvar, sdi, cg) != SR_OK)
+	if (sr_config_caps_get(sdi->driver, sdi, cg, key, &caps) != SR_OK)
 		return 0;
 
-	ret = 0;
-	devopts = g_variant_get_fixed_array(gvar, &num_opts, sizeof(int32_t));
-	for (i = 0; i < num_opts; i++) {
-		if ((devopts[i] & SR_CONF_MASK) == key) {
-			ret = devopts[i] & ~SR_CONF_MASK;
-			break;
-		}
-	}
-	g_variant_unref(gvar);
-
-	return ret;
+	return caps & ~SR_CONF_MASK;
 }
 
 /**
@@ -477,6 +451,7 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	g_free(sdi->version);
 	g_free(sdi->serial_num);
 	g_free(sdi->connection_id);
+	sr_config_cache_free(sdi);
 	g_free(sdi);
 }
 
@@ -684,6 +659,9 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 	if (ret == SR_OK)
 		sdi->status = SR_ST_ACTIVE;
 
+	/* Drivers may only learn the full option set from the hardware. */
+	sr_config_cache_invalidate(sdi);
+
 	return ret;
 }
 
@@ -721,6 +699,8 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Closing device instance.", sdi->driver->name);
 
+	sr_config_cache_invalidate(sdi);
+
 	return sdi->driver->dev_close(sdi);
 }
 
@@ -691,7 +691,7 @@ static int bm52x_rec_next_rsp(struct sr_serial_dev_inst *serial,
 	state->rsp.fill_pos += l;
 
 	/* Devel support: dump the new receive data. */
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		GString *text;
 		const char *req_text;
 
@@ -24,6 +24,10 @@
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
+/** @cond PRIVATE */
+#define LOG_PREFIX "drivers"
+/** @endcond */
+
 /*
  * sr_driver_list is a special section contains pointers to all the hardware
  * drivers built into the library. The __start and __stop symbols are
@@ -34,23 +38,84 @@
 SR_PRIV extern const struct sr_dev_driver *sr_driver_list__start[];
 SR_PRIV extern const struct sr_dev_driver *sr_driver_list__stop[];
 
+#ifndef HAVE_DRIVERS
+static const struct sr_dev_driver *no_drivers[] = { NULL };
+#endif
+
+/*
+ * Live contexts, most recent first. Drivers which haven't been
+ * initialized explicitly get initialized on first use, with the most
+ * recently created context.
+ */
+static GMutex drivers_mutex;
+static GSList *contexts;
+
 /**
  * Initialize the driver list in a fresh libsigrok context.
  *
+ * The list is the linker section itself, its terminating NULL is the
+ * dummy entry from driver_list_stop.c. Nothing gets copied or touched.
+ *
  * @param ctx Pointer to a libsigrok context struct. Must not be NULL.
  *
  * @private
  */
 SR_API void sr_drivers_init(struct sr_context *ctx)
 {
-	GArray *array;
-
-	array = g_array_new(TRUE, FALSE, sizeof(struct sr_dev_driver *));
 #ifdef HAVE_DRIVERS
-	for (const struct sr_dev_driver **drivers = sr_driver_list__start + 1;
-	     drivers < sr_driver_list__stop; drivers++)
-		g_array_append_val(array, *drivers);
+	ctx->driver_list = (struct sr_dev_driver **)(sr_driver_list__start + 1);
+#else
+	ctx->driver_list = (struct sr_dev_driver **)no_drivers;
 #endif
-	ctx->driver_list = (struct sr_dev_driver **)array->data;
-	g_array_free(array, FALSE);
+
+	g_mutex_lock(&drivers_mutex);
+	contexts = g_slist_prepend(contexts, ctx);
+	g_mutex_unlock(&drivers_mutex);
+}
+
+/**
+ * Forget a libsigrok context which is about to be destroyed.
+ *
+ * @param ctx Pointer to a libsigrok context struct. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_drivers_exit(struct sr_context *ctx)
+{
+	g_mutex_lock(&drivers_mutex);
+	contexts = g_slist_remove(contexts, ctx);
+	if (!contexts)
+		sr_config_cache_free(NULL);
+	g_mutex_unlock(&drivers_mutex);
+}
+
+/**
+ * Initialize a driver on first use, unless the application did so.
+ *
+ * @param driver The driver to initialize. Must not be NULL.
+ *
+ * @retval SR_OK The driver is initialized.
+ * @retval SR_ERR No libsigrok context exists, or the driver failed
+ *                to initialize.
+ *
+ * @private
+ */
+SR_PRIV int sr_driver_init_lazy(struct sr_dev_driver *driver)
+{
+	int ret;
+
+	g_mutex_lock(&drivers_mutex);
+	ret = SR_OK;
+	if (!driver->context) {
+		if (contexts) {
+			sr_dbg("Initializing driver '%s' on first use.",
+				driver->name);
+			ret = sr_driver_init(contexts->data, driver);
+		} else {
+			ret = SR_ERR;
+		}
+	}
+	g_mutex_unlock(&drivers_mutex);
+
+	return (ret < 0) ? SR_ERR : SR_OK;
 }
@@ -0,0 +1,1019 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+#include <zip.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "envelope"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Multi-resolution envelopes of logic and analog data.
+ */
+
+/**
+ * @defgroup grp_envelope Envelopes
+ *
+ * Summaries of sample data for drawing overviews.
+ *
+ * An envelope holds, for blocks of samples, the bitwise AND and OR of
+ * logic samples (a channel toggles within a block where they differ),
+ * and the minimum and maximum of the samples of each analog channel.
+ * Blocks are kept at several levels of resolution: level 0 blocks span
+ * the block size given at creation, every following level combines
+ * ENVELOPE_FACTOR blocks of the level below. Envelopes are built
+ * incrementally, as packets are fed to them, and queried by sample
+ * range: a query touches a bounded number of blocks per bucket it
+ * returns, whatever the length of the range.
+ *
+ * The srzip output module stores an envelope alongside the sample data
+ * of a session file, sr_envelope_load() reads it back.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+#define ENVELOPE_BLOCK_SIZE	256
+#define ENVELOPE_FACTOR		16
+/* Top level blocks of the largest block size still fit in 64 bits. */
+#define ENVELOPE_MAX_LEVELS	12
+#define ENVELOPE_MAX_BLOCK_SIZE	(1 << 16)
+#define ENVELOPE_VERSION	1
+#define ENVELOPE_HEADER_SIZE	40
+
+enum envelope_type {
+	ENVELOPE_LOGIC,
+	ENVELOPE_ANALOG,
+};
+
+/*
+ * Envelope of one stream. Entries hold the lower bound and then the
+ * upper bound of a block: AND and OR of unitsize bytes for logic,
+ * minimum and maximum as float for analog.
+ */
+struct envelope_track {
+	enum envelope_type type;
+	size_t unitsize;
+	uint64_t num_samples;
+	/* Complete blocks, by level. NULL for levels not reached yet. */
+	GByteArray *levels[ENVELOPE_MAX_LEVELS];
+	/* Incomplete level 0 block. */
+	uint8_t *tail;
+	uint64_t tail_count;
+};
+/** @endcond */
+
+/**
+ * Opaque structure holding an envelope.
+ *
+ * @see sr_envelope_new(), sr_envelope_free().
+ */
+struct sr_envelope {
+	/* Feeding and queries may come from different threads. */
+	GMutex mutex;
+	uint64_t block_size;
+	struct envelope_track *logic;
+	/* Analog tracks, by channel name. */
+	GHashTable *analog;
+	/* Analog samples of the packet being fed, as float. */
+	float *values;
+	size_t values_size;
+};
+
+static struct envelope_track *track_new(enum envelope_type type,
+		size_t unitsize)
+{
+	struct envelope_track *track;
+
+	track = g_malloc0(sizeof(*track));
+	track->type = type;
+	track->unitsize = unitsize;
+	track->tail = g_malloc(2 * unitsize);
+
+	return track;
+}
+
+static void track_free(struct envelope_track *track)
+{
+	unsigned int l;
+
+	if (!track)
+		return;
+
+	for (l = 0; l < ENVELOPE_MAX_LEVELS; l++) {
+		if (track->levels[l])
+			g_byte_array_free(track->levels[l], TRUE);
+	}
+	g_free(track->tail);
+	g_free(track);
+}
+
+static size_t entry_size(const struct envelope_track *track)
+{
+	return 2 * track->unitsize;
+}
+
+static uint64_t level_num_blocks(const struct envelope_track *track,
+		unsigned int level)
+{
+	if (!track->levels[level])
+		return 0;
+
+	return track->levels[level]->len / entry_size(track);
+}
+
+static uint64_t level_block_size(const struct sr_envelope *env,
+		unsigned int level)
+{
+	uint64_t size;
+
+	size = env->block_size;
+	while (level--)
+		size *= ENVELOPE_FACTOR;
+
+	return size;
+}
+
+/* Set an entry to the identity of entry_merge(). */
+static void entry_clear(const struct envelope_track *track, uint8_t *entry)
+{
+	float *f;
+
+	if (track->type == ENVELOPE_LOGIC) {
+		memset(entry, 0xff, track->unitsize);
+		memset(entry + track->unitsize, 0, track->unitsize);
+	} else {
+		f = (float *)entry;
+		f[0] = INFINITY;
+		f[1] = -INFINITY;
+	}
+}
+
+/* Widen an entry to cover another one. */
+static void entry_merge(const struct envelope_track *track, uint8_t *dst,
+		const uint8_t *src)
+{
+	const float *s;
+	float *d;
+	size_t i;
+
+	if (track->type == ENVELOPE_LOGIC) {
+		for (i = 0; i < track->unitsize; i++) {
+			dst[i] &= src[i];
+			dst[track->unitsize + i] |= src[track->unitsize + i];
+		}
+	} else {
+		s = (const float *)src;
+		d = (float *)dst;
+		d[0] = MIN(d[0], s[0]);
+		d[1] = MAX(d[1], s[1]);
+	}
+}
+
+/*
+ * Append a complete level 0 block. Every ENVELOPE_FACTOR blocks of a
+ * level complete a block of the level above.
+ */
+static void track_push(struct envelope_track *track, const uint8_t *entry)
+{
+	const uint8_t *last;
+	uint8_t *merged;
+	size_t size;
+	unsigned int level, i;
+
+	size = entry_size(track);
+	merged = NULL;
+	for (level = 0; level < ENVELOPE_MAX_LEVELS; level++) {
+		if (!track->levels[level])
+			track->levels[level] = g_byte_array_new();
+		g_byte_array_append(track->levels[level], entry, size);
+		if (level + 1 == ENVELOPE_MAX_LEVELS
+				|| level_num_blocks(track, level) % ENVELOPE_FACTOR)
+			break;
+		if (!merged)
+			merged = g_malloc(size);
+		last = track->levels[level]->data + track->levels[level]->len
+			- ENVELOPE_FACTOR * size;
+		memcpy(merged, last, size);
+		for (i = 1; i < ENVELOPE_FACTOR; i++)
+			entry_merge(track, merged, last + i * size);
+		entry = merged;
+	}
+	g_free(merged);
+}
+
+/* Fold logic samples into the incomplete block. */
+static void logic_merge(struct envelope_track *track, const uint8_t *data,
+		uint64_t num_samples)
+{
+	uint64_t i, v, and_acc, or_acc;
+	size_t unitsize, j;
+	uint8_t *low, *high;
+
+	unitsize = track->unitsize;
+	low = track->tail;
+	high = track->tail + unitsize;
+	if (track->tail_count == 0)
+		entry_clear(track, track->tail);
+
+	if (unitsize <= sizeof(uint64_t)) {
+		/* Samples fit a word, only its first unitsize bytes count. */
+		and_acc = or_acc = 0;
+		memcpy(&and_acc, low, unitsize);
+		memcpy(&or_acc, high, unitsize);
+		for (i = 0; i < num_samples; i++) {
+			v = 0;
+			memcpy(&v, data, unitsize);
+			and_acc &= v;
+			or_acc |= v;
+			data += unitsize;
+		}
+		memcpy(low, &and_acc, unitsize);
+		memcpy(high, &or_acc, unitsize);
+		return;
+	}
+
+	for (i = 0; i < num_samples; i++) {
+		for (j = 0; j < unitsize; j++) {
+			low[j] &= data[j];
+			high[j] |= data[j];
+		}
+		data += unitsize;
+	}
+}
+
+/* Fold samples of one analog channel, interleaved by a stride. */
+static void analog_merge(struct envelope_track *track, const float *values,
+		size_t stride, uint64_t num_samples)
+{
+	float *bounds, v;
+	uint64_t i;
+
+	bounds = (float *)track->tail;
+	if (track->tail_count == 0)
+		entry_clear(track, track->tail);
+
+	for (i = 0; i < num_samples; i++) {
+		v = values[i * stride];
+		bounds[0] = MIN(bounds[0], v);
+		bounds[1] = MAX(bounds[1], v);
+	}
+}
+
+static void track_feed(const struct sr_envelope *env,
+		struct envelope_track *track, const void *data, size_t stride,
+		uint64_t num_samples)
+{
+	uint64_t n;
+
+	track->num_samples += num_samples;
+	while (num_samples) {
+		n = MIN(num_samples, env->block_size - track->tail_count);
+		if (track->type == ENVELOPE_LOGIC) {
+			logic_merge(track, data, n);
+			data = (const uint8_t *)data + n * track->unitsize;
+		} else {
+			analog_merge(track, data, stride, n);
+			data = (const float *)data + n * stride;
+		}
+		num_samples -= n;
+		track->tail_count += n;
+		if (track->tail_count < env->block_size)
+			break;
+		track_push(track, track->tail);
+		track->tail_count = 0;
+	}
+}
+
+/*
+ * Merge the blocks of a track overlapping a sample range, starting at
+ * a level. Ranges beyond the complete blocks of that level are covered
+ * by the levels below and eventually the incomplete block.
+ */
+static void track_range(const struct sr_envelope *env,
+		const struct envelope_track *track, unsigned int level,
+		uint64_t start, uint64_t end, uint8_t *acc)
+{
+	const uint8_t *entries;
+	uint64_t size, covered, first, last, i;
+	size_t esize;
+
+	esize = entry_size(track);
+	for (;;) {
+		size = level_block_size(env, level);
+		covered = level_num_blocks(track, level) * size;
+		if (start < covered) {
+			entries = track->levels[level]->data;
+			first = start / size;
+			last = (MIN(end, covered) - 1) / size;
+			for (i = first; i <= last; i++)
+				entry_merge(track, acc, entries + i * esize);
+		}
+		if (end <= covered)
+			return;
+		start = MAX(start, covered);
+		if (level == 0)
+			break;
+		level--;
+	}
+	if (track->tail_count)
+		entry_merge(track, acc, track->tail);
+}
+
+/*
+ * Fill buckets of a track. Entries of buckets without samples are
+ * left at the identity.
+ */
+static void track_query(const struct sr_envelope *env,
+		const struct envelope_track *track, uint64_t start, uint64_t end,
+		unsigned int num_buckets, uint8_t *entries)
+{
+	uint64_t span, width, b0, b1;
+	unsigned int level, i;
+	size_t esize;
+
+	esize = entry_size(track);
+	for (i = 0; i < num_buckets; i++)
+		entry_clear(track, entries + i * esize);
+
+	if (start >= end)
+		return;
+	span = end - start;
+
+	/* The coarsest level with blocks no wider than a bucket. */
+	width = span / num_buckets;
+	level = 0;
+	while (level + 1 < ENVELOPE_MAX_LEVELS
+			&& level_block_size(env, level + 1) <= width)
+		level++;
+
+	for (i = 0; i < num_buckets; i++) {
+		b0 = start + span * i / num_buckets;
+		b1 = start + span * (i + 1) / num_buckets;
+		b1 = MIN(b1, track->num_samples);
+		if (b0 < b1)
+			track_range(env, track, level, b0, b1,
+				entries + i * esize);
+	}
+}
+
+static void envelope_reset(struct sr_envelope *env)
+{
+	track_free(env->logic);
+	env->logic = NULL;
+	g_hash_table_remove_all(env->analog);
+}
+
+static int envelope_feed_analog(struct sr_envelope *env,
+		const struct sr_datafeed_analog *analog)
+{
+	struct envelope_track *track;
+	const struct sr_channel *ch;
+	unsigned int num_channels, c;
+	size_t size;
+	GSList *l;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+
+	size = analog->num_samples * num_channels * sizeof(float);
+	if (size > env->values_size) {
+		env->values = g_realloc(env->values, size);
+		env->values_size = size;
+	}
+	if ((ret = sr_analog_to_float(analog, env->values)) != SR_OK)
+		return ret;
+
+	/* Samples of several channels are interleaved. */
+	for (l = analog->meaning->channels, c = 0; l; l = l->next, c++) {
+		ch = l->data;
+		track = g_hash_table_lookup(env->analog, ch->name);
+		if (!track) {
+			track = track_new(ENVELOPE_ANALOG, sizeof(float));
+			g_hash_table_insert(env->analog, g_strdup(ch->name),
+				track);
+		}
+		track_feed(env, track, env->values + c, num_channels,
+			analog->num_samples);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Create a new envelope.
+ *
+ * @param env Pointer to store the new envelope in. Must not be NULL.
+ * @param block_size Number of samples summarized by a block of the
+ *                   finest level, 0 for the default (256). Queries for
+ *                   buckets narrower than this can't be any finer.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_envelope_new(struct sr_envelope **env, uint64_t block_size)
+{
+	struct sr_envelope *e;
+
+	if (!env || block_size > ENVELOPE_MAX_BLOCK_SIZE)
+		return SR_ERR_ARG;
+
+	e = g_malloc0(sizeof(*e));
+	g_mutex_init(&e->mutex);
+	e->block_size = block_size ? block_size : ENVELOPE_BLOCK_SIZE;
+	e->analog = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)track_free);
+	*env = e;
+
+	return SR_OK;
+}
+
+/**
+ * Free an envelope.
+ *
+ * @param env The envelope to free. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_envelope_free(struct sr_envelope *env)
+{
+	if (!env)
+		return;
+
+	track_free(env->logic);
+	g_hash_table_destroy(env->analog);
+	g_free(env->values);
+	g_mutex_clear(&env->mutex);
+	g_free(env);
+}
+
+/**
+ * Add the samples of a datafeed packet to an envelope.
+ *
+ * Call this for every packet of a session, for example from a datafeed
+ * callback. Logic and analog packets extend the envelope, a header
+ * packet starts it over. Other packets are ignored.
+ *
+ * @param env The envelope. Must not be NULL.
+ * @param packet The packet. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error converting analog data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_envelope_feed(struct sr_envelope *env,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	int ret;
+
+	if (!env || !packet)
+		return SR_ERR_ARG;
+
+	ret = SR_OK;
+	g_mutex_lock(&env->mutex);
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		envelope_reset(env);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!logic->unitsize)
+			break;
+		if (env->logic && env->logic->unitsize != logic->unitsize) {
+			sr_warn("Unit size changed from %zu to %u, "
+				"restarting logic envelope.",
+				env->logic->unitsize, logic->unitsize);
+			track_free(env->logic);
+			env->logic = NULL;
+		}
+		if (!env->logic)
+			env->logic = track_new(ENVELOPE_LOGIC, logic->unitsize);
+		track_feed(env, env->logic, logic->data, 1,
+			logic->length / logic->unitsize);
+		break;
+	case SR_DF_ANALOG:
+		ret = envelope_feed_analog(env, packet->payload);
+		break;
+	default:
+		break;
+	}
+	g_mutex_unlock(&env->mutex);
+
+	return ret;
+}
+
+/**
+ * Get the extent of the logic data in an envelope.
+ *
+ * @param env The envelope. Must not be NULL.
+ * @param num_samples Pointer to store the number of samples in.
+ *                    May be NULL.
+ * @param unitsize Pointer to store the number of bytes per sample in.
+ *                 May be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The envelope has no logic data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_envelope_logic_info(struct sr_envelope *env,
+		uint64_t *num_samples, unsigned int *unitsize)
+{
+	int ret;
+
+	if (!env)
+		return SR_ERR_ARG;
+
+	ret = SR_ERR_NA;
+	g_mutex_lock(&env->mutex);
+	if (env->logic) {
+		if (num_samples)
+			*num_samples = env->logic->num_samples;
+		if (unitsize)
+			*unitsize = env->logic->unitsize;
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&env->mutex);
+
+	return ret;
+}
+
+/**
+ * Get the extent of an analog channel's data in an envelope.
+ *
+ * @param env The envelope. Must not be NULL.
+ * @param channel The channel name. Must not be NULL.
+ * @param num_samples Pointer to store the number of samples in.
+ *                    Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The envelope has no data for the channel.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_envelope_analog_info(struct sr_envelope *env,
+		const char *channel, uint64_t *num_samples)
+{
+	struct envelope_track *track;
+	int ret;
+
+	if (!env || !channel || !num_samples)
+		return SR_ERR_ARG;
+
+	ret = SR_ERR_NA;
+	g_mutex_lock(&env->mutex);
+	if ((track = g_hash_table_lookup(env->analog, channel))) {
+		*num_samples = track->num_samples;
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&env->mutex);
+
+	return ret;
+}
+
+/**
+ * Summarize a range of logic samples.
+ *
+ * The range is split into buckets of equal width (give or take one
+ * sample), for example one per pixel. Each bucket gets the bitwise AND
+ * and OR of its samples: channels with the bit set in @p low are high
+ * throughout, channels with the bit cleared in @p high are low
+ * throughout, all others toggle within the bucket. Buckets are rounded
+ * out to the blocks the envelope keeps, so they can cover some samples
+ * of their neighbours, in particular when they are narrower than the
+ * envelope's block size. Buckets past the end of the data get all bits
+ * set in @p low and cleared in @p high.
+ *
+ * @param env The envelope. Must not be NULL.
+ * @param start The first sample of the range.
+ * @param end The sample after the last one of the range.
+ * @param num_buckets The number of buckets. Must be greater than 0.
+ * @param low Buffer for the AND of every bucket, @p num_buckets times
+ *            the unit size bytes. Must not be NULL.
+ * @param high Buffer for the OR of every bucket, @p num_buckets times
+ *             the unit size bytes. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The envelope has no logic data.
+ *
+ * @see sr_envelope_logic_info()
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_envelope_logic_get(struct sr_envelope *env, uint64_t start,
+		uint64_t end, unsigned int num_buckets, uint8_t *low,
+		uint8_t *high)
+{
+	uint8_t *entries;
+	size_t unitsize;
+	unsigned int i;
+
+	if (!env || !num_buckets || !low || !high)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&env->mutex);
+	if (!env->logic) {
+		g_mutex_unlock(&env->mutex);
+		return SR_ERR_NA;
+	}
+	unitsize = env->logic->unitsize;
+	entries = g_malloc(num_buckets * 2 * unitsize);
+	track_query(env, env->logic, start, end, num_buckets, entries);
+	g_mutex_unlock(&env->mutex);
+
+	for (i = 0; i < num_buckets; i++) {
+		memcpy(low + i * unitsize, entries + i * 2 * unitsize, unitsize);
+		memcpy(high + i * unitsize, entries + (i * 2 + 1) * unitsize,
+			unitsize);
+	}
+	g_free(entries);
+
+	return SR_OK;
+}
+
+/**
+ * Summarize a range of samples of an analog channel.
+ *
+ * Like sr_envelope_logic_get(), with the minimum and maximum of each
+ * bucket. Buckets past the end of the data get NAN.
+ *
+ * @param env The envelope. Must not be NULL.
+ * @param channel The channel name. Must not be NULL.
+ * @param start The first sample of the range.
+ * @param end The sample after the last one of the range.
+ * @param num_buckets The number of buckets. Must be greater than 0.
+ * @param min Buffer for the minimum of every bucket. Must not be NULL.
+ * @param max Buffer for the maximum of every bucket. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The envelope has no data for the channel.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_envelope_analog_get(struct sr_envelope *env,
+		const char *channel, uint64_t start, uint64_t end,
+		unsigned int num_buckets, float *min, float *max)
+{
+	struct envelope_track *track;
+	float *entries;
+	unsigned int i;
+
+	if (!env || !channel || !num_buckets || !min || !max)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&env->mutex);
+	if (!(track = g_hash_table_lookup(env->analog, channel))) {
+		g_mutex_unlock(&env->mutex);
+		return SR_ERR_NA;
+	}
+	entries = g_malloc(num_buckets * 2 * sizeof(float));
+	track_query(env, track, start, end, num_buckets, (uint8_t *)entries);
+	g_mutex_unlock(&env->mutex);
+
+	for (i = 0; i < num_buckets; i++) {
+		if (entries[2 * i] > entries[2 * i + 1]) {
+			min[i] = max[i] = NAN;
+		} else {
+			min[i] = entries[2 * i];
+			max[i] = entries[2 * i + 1];
+		}
+	}
+	g_free(entries);
+
+	return SR_OK;
+}
+
+static struct envelope_track *envelope_track_get(struct sr_envelope *env,
+		const char *channel)
+{
+	if (!channel)
+		return env->logic;
+
+	return g_hash_table_lookup(env->analog, channel);
+}
+
+/*
+ * Serialized envelope track, all fields little endian:
+ *
+ *   u32 version, u32 type (0 logic, 1 analog), u32 unitsize,
+ *   u32 level factor, u64 block size, u64 number of samples,
+ *   u32 number of levels, u32 number of samples in the incomplete block,
+ *   u64 number of blocks of each level,
+ *   the incomplete block's entry, the entries of each level in turn.
+ *
+ * Entries are AND and OR bytes of logic samples, minimum and maximum
+ * as 32 bit floats for analog samples.
+ */
+
+static void entries_write(const struct envelope_track *track, uint8_t *p,
+		const uint8_t *entries, uint64_t num_entries)
+{
+	const float *f;
+	uint64_t i;
+
+	if (track->type == ENVELOPE_LOGIC) {
+		memcpy(p, entries, num_entries * entry_size(track));
+		return;
+	}
+	f = (const float *)entries;
+	for (i = 0; i < 2 * num_entries; i++)
+		write_fltle(p + i * sizeof(float), f[i]);
+}
+
+static void entries_read(const struct envelope_track *track, uint8_t *entries,
+		const uint8_t *p, uint64_t num_entries)
+{
+	float *f;
+	uint64_t i;
+
+	if (track->type == ENVELOPE_LOGIC) {
+		memcpy(entries, p, num_entries * entry_size(track));
+		return;
+	}
+	f = (float *)entries;
+	for (i = 0; i < 2 * num_entries; i++)
+		f[i] = read_fltle(p + i * sizeof(float));
+}
+
+/**
+ * Serialize a track of an envelope.
+ *
+ * @param env The envelope.
+ * @param channel The analog channel name, NULL for logic data.
+ * @param size Pointer to store the size of the result in.
+ *
+ * @return A newly allocated buffer, or NULL if the envelope has no data
+ *         for the channel.
+ *
+ * @private
+ */
+SR_PRIV uint8_t *sr_envelope_save(struct sr_envelope *env,
+		const char *channel, size_t *size)
+{
+	const struct envelope_track *track;
+	unsigned int num_levels, l;
+	uint8_t *buf, *p;
+	size_t esize;
+
+	g_mutex_lock(&env->mutex);
+	if (!(track = envelope_track_get(env, channel))) {
+		g_mutex_unlock(&env->mutex);
+		return NULL;
+	}
+
+	esize = entry_size(track);
+	num_levels = 0;
+	*size = ENVELOPE_HEADER_SIZE + esize;
+	for (l = 0; l < ENVELOPE_MAX_LEVELS && track->levels[l]; l++) {
+		num_levels++;
+		*size += sizeof(uint64_t) + track->levels[l]->len;
+	}
+
+	p = buf = g_malloc(*size);
+	WL32(p, ENVELOPE_VERSION);
+	WL32(p + 4, track->type);
+	WL32(p + 8, track->unitsize);
+	WL32(p + 12, ENVELOPE_FACTOR);
+	WL64(p + 16, env->block_size);
+	WL64(p + 24, track->num_samples);
+	WL32(p + 32, num_levels);
+	WL32(p + 36, track->tail_count);
+	p += ENVELOPE_HEADER_SIZE;
+	for (l = 0; l < num_levels; l++, p += sizeof(uint64_t))
+		WL64(p, level_num_blocks(track, l));
+	if (track->tail_count)
+		entries_write(track, p, track->tail, 1);
+	else
+		memset(p, 0, esize);
+	p += esize;
+	for (l = 0; l < num_levels; l++) {
+		entries_write(track, p, track->levels[l]->data,
+			level_num_blocks(track, l));
+		p += track->levels[l]->len;
+	}
+	g_mutex_unlock(&env->mutex);
+
+	return buf;
+}
+
+/**
+ * Restore a track of an envelope from its serialized form.
+ *
+ * The envelope takes the block size of the first track restored.
+ *
+ * @param env The envelope.
+ * @param channel The analog channel name, NULL for logic data.
+ * @param buf The serialized track.
+ * @param size The size of the serialized track.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA The data is invalid or doesn't match the envelope.
+ *
+ * @private
+ */
+SR_PRIV int sr_envelope_restore(struct sr_envelope *env, const char *channel,
+		const uint8_t *buf, size_t size)
+{
+	struct envelope_track *track;
+	const uint8_t *p;
+	uint64_t block_size, num_blocks, expected;
+	unsigned int type, unitsize, num_levels, l;
+	size_t esize;
+
+	if (size < ENVELOPE_HEADER_SIZE || RL32(buf) != ENVELOPE_VERSION
+			|| RL32(buf + 12) != ENVELOPE_FACTOR)
+		return SR_ERR_DATA;
+	type = RL32(buf + 4);
+	unitsize = RL32(buf + 8);
+	block_size = RL64(buf + 16);
+	num_levels = RL32(buf + 32);
+	if (type != (channel ? ENVELOPE_ANALOG : ENVELOPE_LOGIC)
+			|| !unitsize || (channel && unitsize != sizeof(float))
+			|| !block_size || block_size > ENVELOPE_MAX_BLOCK_SIZE
+			|| num_levels > ENVELOPE_MAX_LEVELS
+			|| RL32(buf + 36) >= block_size)
+		return SR_ERR_DATA;
+
+	/* Check the sizes before allocating anything. */
+	esize = 2 * unitsize;
+	p = buf + ENVELOPE_HEADER_SIZE;
+	expected = ENVELOPE_HEADER_SIZE + num_levels * sizeof(uint64_t) + esize;
+	if (size < expected)
+		return SR_ERR_DATA;
+	for (l = 0; l < num_levels; l++) {
+		num_blocks = RL64(p + l * sizeof(uint64_t));
+		if (num_blocks > (size - expected) / esize)
+			return SR_ERR_DATA;
+		expected += num_blocks * esize;
+	}
+	if (size != expected)
+		return SR_ERR_DATA;
+
+	g_mutex_lock(&env->mutex);
+	if ((env->logic || g_hash_table_size(env->analog))
+			&& block_size != env->block_size) {
+		g_mutex_unlock(&env->mutex);
+		sr_err("Envelope block sizes differ.");
+		return SR_ERR_DATA;
+	}
+	env->block_size = block_size;
+
+	track = track_new(type, unitsize);
+	track->num_samples = RL64(buf + 24);
+	track->tail_count = RL32(buf + 36);
+	p += num_levels * sizeof(uint64_t);
+	entries_read(track, track->tail, p, 1);
+	p += esize;
+	for (l = 0; l < num_levels; l++) {
+		num_blocks = RL64(buf + ENVELOPE_HEADER_SIZE + l * sizeof(uint64_t));
+		track->levels[l] = g_byte_array_sized_new(num_blocks * esize);
+		g_byte_array_set_size(track->levels[l], num_blocks * esize);
+		entries_read(track, track->levels[l]->data, p, num_blocks);
+		p += num_blocks * esize;
+	}
+
+	if (channel) {
+		g_hash_table_replace(env->analog, g_strdup(channel), track);
+	} else {
+		track_free(env->logic);
+		env->logic = track;
+	}
+	g_mutex_unlock(&env->mutex);
+
+	return SR_OK;
+}
+
+static int envelope_read_member(struct zip *archive, zip_uint64_t index,
+		uint64_t size, struct sr_envelope *env, const char *channel)
+{
+	struct zip_file *zf;
+	uint8_t *buf;
+	int ret;
+
+	if (size > G_MAXINT || !(buf = g_try_malloc(size)))
+		return SR_ERR_MALLOC;
+	if (!(zf = zip_fopen_index(archive, index, 0))) {
+		g_free(buf);
+		return SR_ERR_IO;
+	}
+	if (zip_fread(zf, buf, size) != (zip_int64_t)size)
+		ret = SR_ERR_IO;
+	else
+		ret = sr_envelope_restore(env, channel, buf, size);
+	zip_fclose(zf);
+	g_free(buf);
+
+	return ret;
+}
+
+/**
+ * Load the envelope stored in a session file.
+ *
+ * The srzip output module stores envelopes along with the sample data.
+ * Analog channels are named as in the session file's metadata.
+ *
+ * @param filename The session file. Must not be NULL.
+ * @param env Pointer to store the new envelope in. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO The file can't be read.
+ * @retval SR_ERR_NA The file holds no envelope.
+ * @retval SR_ERR_DATA The envelope in the file is invalid.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_envelope_load(const char *filename, struct sr_envelope **env)
+{
+	struct zip *archive;
+	struct zip_stat zs;
+	struct sr_envelope *e;
+	GKeyFile *kf;
+	const char *name, *nr;
+	char *key, *channel;
+	int64_t i, num_files;
+	int ret;
+
+	if (!filename || !env)
+		return SR_ERR_ARG;
+
+	if (!(archive = zip_open(filename, 0, NULL)))
+		return SR_ERR_IO;
+	if (zip_stat(archive, "metadata", 0, &zs) < 0
+			|| !(kf = sr_sessionfile_read_metadata(archive, &zs))) {
+		zip_discard(archive);
+		return SR_ERR_IO;
+	}
+
+	sr_envelope_new(&e, 0);
+	ret = SR_OK;
+	num_files = zip_get_num_entries(archive, 0);
+	for (i = 0; ret == SR_OK && i < num_files; i++) {
+		if (!(name = zip_get_name(archive, i, 0))
+				|| zip_stat_index(archive, i, 0, &zs) < 0)
+			continue;
+		if (!strcmp(name, "envelope-logic-1")) {
+			ret = envelope_read_member(archive, i, zs.size, e, NULL);
+		} else if (!strncmp(name, "envelope-analog-1-", 18)) {
+			/* Channel names are in the "analog<nr>" keys. */
+			nr = name + 18;
+			key = g_strconcat("analog", nr, NULL);
+			channel = g_key_file_get_string(kf, "device 1", key, NULL);
+			g_free(key);
+			if (!channel) {
+				sr_warn("No channel name for '%s', ignoring.", name);
+				continue;
+			}
+			ret = envelope_read_member(archive, i, zs.size, e,
+				channel);
+			g_free(channel);
+		}
+	}
+	g_key_file_free(kf);
+	zip_discard(archive);
+
+	if (ret == SR_OK && !e->logic && !g_hash_table_size(e->analog))
+		ret = SR_ERR_NA;
+	if (ret != SR_OK) {
+		sr_envelope_free(e);
+		return ret;
+	}
+	*env = e;
+
+	return SR_OK;
+}
+
+/** @} */
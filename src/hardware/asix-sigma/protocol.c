@@ -381,8 +381,15 @@ static int sigma_read_pos(struct dev_context *devc,
 	return SR_OK;
 }
 
-static int sigma_read_dram(struct dev_context *devc,
-	size_t startchunk, size_t numchunks, uint8_t *data)
+/*
+ * Request DRAM rows from the device. The read is submitted to the USB
+ * layer but not waited for, see sigma_read_dram_wait(). This lets the
+ * device transfer the next set of rows while the caller is busy with
+ * interpreting the previous set.
+ */
+static int sigma_read_dram_submit(struct dev_context *devc,
+	size_t startchunk, size_t numchunks, uint8_t *data,
+	struct ftdi_transfer_control **xfer)
 {
 	uint8_t buf[128], *wrptr, regval;
 	size_t chunk;
@@ -425,7 +432,34 @@ static int sigma_read_dram(struct dev_context *devc,
 	if (ret != SR_OK)
 		return ret;
 
-	return sigma_read_sr(devc, data, numchunks * ROW_LENGTH_BYTES);
+	*xfer = ftdi_read_data_submit(&devc->ftdi.ctx, data,
+		numchunks * ROW_LENGTH_BYTES);
+	if (!*xfer) {
+		sr_err("USB data read submit failed: %s",
+			ftdi_get_error_string(&devc->ftdi.ctx));
+		return SR_ERR_IO;
+	}
+
+	return SR_OK;
+}
+
+static int sigma_read_dram_wait(struct dev_context *devc,
+	struct ftdi_transfer_control *xfer, size_t numchunks)
+{
+	int ret;
+
+	ret = ftdi_transfer_data_done(xfer);
+	if (ret < 0) {
+		sr_err("USB data read failed: %s",
+			ftdi_get_error_string(&devc->ftdi.ctx));
+		return SR_ERR_IO;
+	}
+	if ((size_t)ret != numchunks * ROW_LENGTH_BYTES) {
+		sr_err("Short DRAM read, got %d bytes.", ret);
+		return SR_ERR_IO;
+	}
+
+	return SR_OK;
 }
 
 /* Upload trigger look-up tables to Sigma. */
@@ -1265,6 +1299,8 @@ static int addto_submit_buffer(struct dev_context *devc,
 {
 	struct submit_buffer *buffer;
 	struct sr_sw_limits *limits;
+	size_t chunk;
+	uint64_t remain;
 	int ret;
 
 	buffer = devc->buffer;
@@ -1273,19 +1309,30 @@ static int addto_submit_buffer(struct dev_context *devc,
 		count = 0;
 
 	/*
-	 * Individually accumulate and check each sample, such that
-	 * accumulation between flushes won't exceed local storage, and
-	 * enforcement of user specified limits is exact.
+	 * Accumulate runs of samples in batches which neither exceed
+	 * local storage nor the user specified sample count limit, such
+	 * that flushes happen in large packets and enforcement of the
+	 * limit remains exact.
 	 */
-	while (count--) {
-		write_u16le_inc(&buffer->write_pointer, sample);
-		buffer->curr_samples++;
+	while (count) {
+		chunk = buffer->max_samples - buffer->curr_samples;
+		if (chunk > count)
+			chunk = count;
+		if (!devc->use_triggers && limits->limit_samples) {
+			remain = limits->limit_samples - limits->samples_read;
+			if (chunk > remain)
+				chunk = remain;
+		}
+		count -= chunk;
+		buffer->curr_samples += chunk;
+		sr_sw_limits_update_samples_read(limits, chunk);
+		while (chunk--)
+			write_u16le_inc(&buffer->write_pointer, sample);
 		if (buffer->curr_samples == buffer->max_samples) {
 			ret = flush_submit_buffer(devc);
 			if (ret != SR_OK)
 				return ret;
 		}
-		sr_sw_limits_update_samples_read(limits, 1);
 		if (!devc->use_triggers && sr_sw_limits_check(limits))
 			break;
 	}
@@ -1395,7 +1442,8 @@ static int alloc_sample_buffer(struct dev_context *devc,
 {
 	struct sigma_sample_interp *interp;
 	gboolean wrapped;
-	size_t alloc_size;
+	size_t alloc_size, lines, packet_size;
+	unsigned int chunksize;
 
 	interp = &devc->interp;
 
@@ -1447,10 +1495,32 @@ static int alloc_sample_buffer(struct dev_context *devc,
 	interp->fetch.lines_total %= ROW_COUNT;
 	interp->fetch.lines_done = 0;
 
-	/* Arrange for chunked download, N lines per USB request. */
-	interp->fetch.lines_per_read = 32;
+	/*
+	 * Arrange for chunked download, N lines per USB request. Use two
+	 * sets of lines, one gets received while the other gets decoded.
+	 *
+	 * libftdi keeps one USB transfer of its read chunk size in flight,
+	 * and only continues with the next one when the read is waited for.
+	 * A set of lines must fit a single chunk (including the two status
+	 * bytes in every USB packet) to get transferred entirely while the
+	 * previous set is decoded. On Linux libftdi caps chunks at 16KiB.
+	 */
+	packet_size = devc->ftdi.ctx.max_packet_size;
+	if (packet_size <= 2)
+		packet_size = 64;
+	lines = SIGMA_READ_CHUNKSIZE / packet_size * (packet_size - 2);
+	lines /= ROW_LENGTH_BYTES;
+	interp->fetch.lines_per_read = CLAMP(lines, 1, 32);
+	if (ftdi_read_data_get_chunksize(&devc->ftdi.ctx, &chunksize) == 0
+			&& chunksize < SIGMA_READ_CHUNKSIZE
+			&& ftdi_read_data_set_chunksize(&devc->ftdi.ctx,
+				SIGMA_READ_CHUNKSIZE) == 0)
+		interp->fetch.saved_chunksize = chunksize;
+	sr_dbg("Downloading %zu DRAM lines per USB read.",
+		interp->fetch.lines_per_read);
 	alloc_size = sizeof(devc->interp.fetch.rcvd_lines[0]);
 	alloc_size *= devc->interp.fetch.lines_per_read;
+	alloc_size *= 2;
 	devc->interp.fetch.rcvd_lines = g_try_malloc0(alloc_size);
 	if (!devc->interp.fetch.rcvd_lines)
 		return SR_ERR_MALLOC;
@@ -1461,9 +1531,41 @@ static int alloc_sample_buffer(struct dev_context *devc,
 static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx);
 static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx);
 
+/* Start the download of the next set of DRAM lines (if any remain). */
+static int submit_sample_fetch(struct dev_context *devc)
+{
+	struct sigma_sample_interp *interp;
+	size_t count, line;
+	struct sigma_dram_line *dest;
+	int ret;
+
+	interp = &devc->interp;
+
+	count = interp->fetch.lines_total - interp->fetch.lines_issued;
+	if (!count)
+		return SR_OK;
+	if (count > interp->fetch.lines_per_read)
+		count = interp->fetch.lines_per_read;
+	line = interp->start.line + interp->fetch.lines_issued;
+	line %= ROW_COUNT;
+	dest = interp->fetch.rcvd_lines;
+	if (interp->fetch.pend_sel)
+		dest += interp->fetch.lines_per_read;
+
+	ret = sigma_read_dram_submit(devc, line, count, (uint8_t *)dest,
+		&interp->fetch.pend_xfer);
+	if (ret != SR_OK)
+		return ret;
+	interp->fetch.pend_count = count;
+	interp->fetch.lines_issued += count;
+
+	return SR_OK;
+}
+
 static int fetch_sample_buffer(struct dev_context *devc)
 {
 	struct sigma_sample_interp *interp;
+	struct ftdi_transfer_control *xfer;
 	size_t count;
 	int ret;
 	const uint8_t *rdptr;
@@ -1471,21 +1573,37 @@ static int fetch_sample_buffer(struct dev_context *devc)
 
 	interp = &devc->interp;
 
-	/* First invocation? Seed the iteration position. */
+	/* First invocation? Seed the iteration position and the pipeline. */
 	if (!interp->fetch.lines_done) {
 		interp->iter = interp->start;
+		interp->fetch.lines_issued = 0;
+		interp->fetch.pend_sel = 0;
+		ret = submit_sample_fetch(devc);
+		if (ret != SR_OK)
+			return ret;
 	}
 
-	/* Get another set of DRAM lines in one read call. */
-	count = interp->fetch.lines_total - interp->fetch.lines_done;
-	if (count > interp->fetch.lines_per_read)
-		count = interp->fetch.lines_per_read;
-	ret = sigma_read_dram(devc, interp->iter.line, count,
-		(uint8_t *)interp->fetch.rcvd_lines);
+	/*
+	 * Wait for the pending set of DRAM lines. Immediately request
+	 * the next set into the other half of the receive buffer, which
+	 * the device transfers while the caller decodes this set.
+	 */
+	xfer = interp->fetch.pend_xfer;
+	count = interp->fetch.pend_count;
+	if (!xfer)
+		return SR_ERR_BUG;
+	interp->fetch.pend_xfer = NULL;
+	ret = sigma_read_dram_wait(devc, xfer, count);
 	if (ret != SR_OK)
 		return ret;
 	interp->fetch.lines_rcvd = count;
-	interp->fetch.curr_line = &interp->fetch.rcvd_lines[0];
+	interp->fetch.curr_line = interp->fetch.rcvd_lines;
+	if (interp->fetch.pend_sel)
+		interp->fetch.curr_line += interp->fetch.lines_per_read;
+	interp->fetch.pend_sel = !interp->fetch.pend_sel;
+	ret = submit_sample_fetch(devc);
+	if (ret != SR_OK)
+		return ret;
 
 	/* First invocation? Get initial timestamp and sample data. */
 	if (!interp->fetch.lines_done) {
@@ -1506,9 +1624,19 @@ static int fetch_sample_buffer(struct dev_context *devc)
 
 static void free_sample_buffer(struct dev_context *devc)
 {
+	/* The receive buffer must not be in use by a pending transfer. */
+	if (devc->interp.fetch.pend_xfer) {
+		(void)ftdi_transfer_data_done(devc->interp.fetch.pend_xfer);
+		devc->interp.fetch.pend_xfer = NULL;
+	}
 	g_free(devc->interp.fetch.rcvd_lines);
 	devc->interp.fetch.rcvd_lines = NULL;
 	devc->interp.fetch.lines_per_read = 0;
+	if (devc->interp.fetch.saved_chunksize) {
+		(void)ftdi_read_data_set_chunksize(&devc->ftdi.ctx,
+			devc->interp.fetch.saved_chunksize);
+		devc->interp.fetch.saved_chunksize = 0;
+	}
 }
 
 /*
@@ -1808,6 +1936,41 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
 	return read_u16le((const uint8_t *)&cl->samples[idx]);
 }
 
+/*
+ * Lookup tables for the deinterlace of sample data. Each byte of the
+ * raw 16bit item gets translated in one step.
+ *
+ * For 2x8 the low nibble of an entry holds the even bits of the input
+ * byte (sample 0), the high nibble holds the odd bits (sample 1). For
+ * 4x4 an entry holds four 2bit fields, field N holds bits N and N + 4
+ * of the input byte (sample N).
+ */
+static uint8_t deinterlace_lut_2x8[256];
+static uint8_t deinterlace_lut_4x4[256];
+
+static void sigma_deinterlace_init(void)
+{
+	static gsize initialized;
+	size_t byte, bit;
+	uint8_t val2, val4;
+
+	if (!g_once_init_enter(&initialized))
+		return;
+	for (byte = 0; byte < ARRAY_SIZE(deinterlace_lut_2x8); byte++) {
+		val2 = 0;
+		val4 = 0;
+		for (bit = 0; bit < 8; bit++) {
+			if (!(byte & (1 << bit)))
+				continue;
+			val2 |= 1 << ((bit % 2) * 4 + bit / 2);
+			val4 |= 1 << ((bit % 4) * 2 + bit / 4);
+		}
+		deinterlace_lut_2x8[byte] = val2;
+		deinterlace_lut_4x4[byte] = val4;
+	}
+	g_once_init_leave(&initialized, 1);
+}
+
 /*
  * Deinterlace sample data that was retrieved at 100MHz samplerate.
  * One 16bit item contains two samples of 8bits each. The bits of
@@ -1816,17 +1979,11 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
 static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
 {
 	uint16_t outdata;
+	int shift;
 
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
+	shift = idx ? 4 : 0;
+	outdata = (deinterlace_lut_2x8[indata & 0xff] >> shift) & 0xf;
+	outdata |= ((deinterlace_lut_2x8[indata >> 8] >> shift) & 0xf) << 4;
 	return outdata;
 }
 
@@ -1838,13 +1995,11 @@ static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
 static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
 {
 	uint16_t outdata;
+	int shift;
 
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
+	shift = idx * 2;
+	outdata = (deinterlace_lut_4x4[indata & 0xff] >> shift) & 0x3;
+	outdata |= ((deinterlace_lut_4x4[indata >> 8] >> shift) & 0x3) << 2;
 	return outdata;
 }
 
@@ -1853,8 +2008,9 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	size_t events_in_cluster)
 {
 	uint16_t tsdiff, ts, sample, item16;
+	uint8_t lo, hi;
 	size_t count;
-	size_t evt;
+	size_t evt, idx;
 
 	/*
 	 * If this cluster is not adjacent to the previously received
@@ -1886,23 +2042,22 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	for (evt = 0; evt < events_in_cluster; evt++) {
 		item16 = sigma_dram_cluster_data(dram_cluster, evt);
 		if (devc->interp.samples_per_event == 4) {
-			sample = sigma_deinterlace_data_4x4(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 2);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 3);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			lo = deinterlace_lut_4x4[item16 & 0xff];
+			hi = deinterlace_lut_4x4[item16 >> 8];
+			for (idx = 0; idx < 4; idx++) {
+				sample = (lo & 0x3) | ((hi & 0x3) << 2);
+				lo >>= 2;
+				hi >>= 2;
+				check_and_submit_sample(devc, sample, 1);
+				devc->interp.last.sample = sample;
+			}
 		} else if (devc->interp.samples_per_event == 2) {
-			sample = sigma_deinterlace_data_2x8(item16, 0);
+			lo = deinterlace_lut_2x8[item16 & 0xff];
+			hi = deinterlace_lut_2x8[item16 >> 8];
+			sample = (lo & 0xf) | ((hi & 0xf) << 4);
 			check_and_submit_sample(devc, sample, 1);
 			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_2x8(item16, 1);
+			sample = (lo >> 4) | ((hi >> 4) << 4);
 			check_and_submit_sample(devc, sample, 1);
 			devc->interp.last.sample = sample;
 		} else {
@@ -2028,6 +2183,7 @@ static int download_capture(struct sr_dev_inst *sdi)
 		if (!(modestatus & RMR_TRIGGERED))
 			triggerpos = ~0;
 
+		sigma_deinterlace_init();
 		ret = alloc_sample_buffer(devc, stoppos, triggerpos, modestatus);
 		if (ret != SR_OK)
 			return FALSE;
@@ -240,6 +240,9 @@ enum trgsel_selcode_t {
 #define ROW_LENGTH_U16		(ROW_LENGTH_BYTES / sizeof(uint16_t))
 #define ROW_SHIFT		9 /* log2 of u16 count */
 #define ROW_MASK		BITS_MASK(ROW_SHIFT)
+
+/* USB read chunk size for the DRAM download, libftdi's limit on Linux. */
+#define SIGMA_READ_CHUNKSIZE	16384
 #define EVENTS_PER_CLUSTER	7
 #define CLUSTERS_PER_ROW	(ROW_LENGTH_U16 / (1 + EVENTS_PER_CLUSTER))
 #define EVENTS_PER_ROW		(CLUSTERS_PER_ROW * EVENTS_PER_CLUSTER)
@@ -366,8 +369,15 @@ struct dev_context {
 			size_t lines_total, lines_done;
 			size_t lines_per_read; /* USB transfer limit */
 			size_t lines_rcvd;
-			struct sigma_dram_line *rcvd_lines;
+			struct sigma_dram_line *rcvd_lines; /* two sets */
 			struct sigma_dram_line *curr_line;
+			/* Read-ahead of the next set of lines. */
+			size_t lines_issued;
+			size_t pend_count;
+			int pend_sel;
+			struct ftdi_transfer_control *pend_xfer;
+			/* libftdi read chunk size before the download. */
+			unsigned int saved_chunksize;
 		} fetch;
 		struct {
 			gboolean armed;
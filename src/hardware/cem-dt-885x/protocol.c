@@ -75,7 +75,7 @@ static void process_mset(const struct sr_dev_inst *sdi)
 	int i;
 
 	devc = sdi->priv;
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		dbg = g_string_sized_new(128);
 		g_string_printf(dbg, "got command 0x%.2x token 0x%.2x",
 				devc->cmd, devc->token);
@@ -38,7 +38,7 @@ static void process_packet(const struct sr_dev_inst *sdi)
 	int checksum, mode, i;
 
 	devc = sdi->priv;
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		dbg = g_string_sized_new(128);
 		g_string_printf(dbg, "received packet:");
 		for (i = 0; i < 10; i++)
@@ -47,12 +47,26 @@ static const char *logic_pattern_str[] = {
 	"graycode",
 };
 
+/* SR_CONF_TEST_MODE, "max-throughput" ignores the samplerate. */
+static const char *test_modes[] = {
+	"none",
+	"max-throughput",
+};
+
 static const uint32_t scanopts[] = {
 	SR_CONF_NUM_LOGIC_CHANNELS,
 	SR_CONF_NUM_ANALOG_CHANNELS,
 	SR_CONF_LIMIT_FRAMES,
 };
 
+static const uint32_t static_lists[] = {
+	SR_CONF_SAMPLERATE,
+	SR_CONF_TRIGGER_MATCH,
+	SR_CONF_TEST_MODE,
+	SR_CONF_PATTERN_MODE,
+	0,
+};
+
 static const uint32_t drvopts[] = {
 	SR_CONF_DEMO_DEV,
 	SR_CONF_LOGIC_ANALYZER,
@@ -69,6 +83,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TEST_MODE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -144,6 +160,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devc->all_logic_channels_mask <<= devc->num_logic_channels;
 	devc->all_logic_channels_mask--;
 	devc->logic_pattern = DEFAULT_LOGIC_PATTERN;
+	devc->logic_bufsize = LOGIC_BUFSIZE;
 	devc->num_analog_channels = num_analog_channels;
 	devc->limit_frames = limit_frames;
 	devc->capture_ratio = 20;
@@ -226,6 +243,7 @@ static void clear_helper(struct dev_context *devc)
 	void *value;
 
 	demo_free_analog_pattern(devc);
+	demo_free_logic(devc);
 
 	/* Analog generators. */
 	g_hash_table_iter_init(&iter, devc->ch_ag);
@@ -321,6 +339,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_BUFFERSIZE:
+		*data = g_variant_new_uint64(devc->logic_bufsize);
+		break;
+	case SR_CONF_TEST_MODE:
+		*data = g_variant_new_string(test_modes[devc->max_throughput ? 1 : 0]);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -336,7 +360,8 @@ static int config_set(uint32_t key, GVariant *data,
 	struct sr_channel *ch;
 	GVariant *mq_tuple_child;
 	GSList *l;
-	int logic_pattern, analog_pattern;
+	int logic_pattern, analog_pattern, idx;
+	uint64_t bufsize;
 
 	devc = sdi->priv;
 
@@ -393,11 +418,6 @@ static int config_set(uint32_t key, GVariant *data,
 				sr_dbg("Setting logic pattern to %s",
 						logic_pattern_str[logic_pattern]);
 				devc->logic_pattern = logic_pattern;
-				/* Might as well do this now, these are static. */
-				if (logic_pattern == PATTERN_ALL_LOW)
-					memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
-				else if (logic_pattern == PATTERN_ALL_HIGH)
-					memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
 			} else if (ch->type == SR_CHANNEL_ANALOG) {
 				if (analog_pattern == -1)
 					return SR_ERR_ARG;
@@ -434,6 +454,18 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_BUFFERSIZE:
+		bufsize = g_variant_get_uint64(data);
+		if (bufsize < LOGIC_BUFSIZE_MIN || bufsize > LOGIC_BUFSIZE_MAX)
+			return SR_ERR_ARG;
+		devc->logic_bufsize = bufsize;
+		break;
+	case SR_CONF_TEST_MODE:
+		idx = std_str_idx(data, ARRAY_AND_SIZE(test_modes));
+		if (idx < 0)
+			return SR_ERR_ARG;
+		devc->max_throughput = idx == 1;
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -457,6 +489,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_TRIGGER_MATCH:
 			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
 			break;
+		case SR_CONF_TEST_MODE:
+			*data = g_variant_new_strv(ARRAY_AND_SIZE(test_modes));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -500,7 +535,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	GSList *l;
 	struct sr_channel *ch;
-	int bitpos;
+	int bitpos, ret;
 	uint8_t mask;
 	struct sr_trigger *trigger;
 
@@ -567,8 +602,31 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
+	if (demo_prepare_logic(devc) != SR_OK) {
+		if (devc->stl) {
+			soft_trigger_logic_free(devc->stl);
+			devc->stl = NULL;
+		}
+		return SR_ERR_MALLOC;
+	}
+	devc->sent_bytes = 0;
+	devc->sent_packets = 0;
+
+	/*
+	 * Unthrottled mode gets invoked whenever the main loop is idle.
+	 * The timer is keyed on the device, so that several demo devices
+	 * can run in one session.
+	 */
+	ret = sr_session_fd_source_add(sdi->session, devc, -1, 0,
+			devc->max_throughput ? 0 : 100,
 			demo_prepare_data, (struct sr_dev_inst *)sdi);
+	if (ret != SR_OK) {
+		if (devc->stl) {
+			soft_trigger_logic_free(devc->stl);
+			devc->stl = NULL;
+		}
+		return ret;
+	}
 
 	std_session_send_df_header(sdi);
 
@@ -586,13 +644,23 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-
-	sr_session_source_remove(sdi->session, -1);
+	int64_t elapsed_us;
 
 	devc = sdi->priv;
+	sr_session_source_remove_internal(sdi->session, devc);
+
 	if (devc->limit_frames > 0)
 		std_session_send_df_frame_end(sdi);
 
+	elapsed_us = g_get_monotonic_time() - devc->start_us;
+	if (elapsed_us > 0) {
+		sr_info("Sent %" PRIu64 " bytes in %" PRIu64 " packets: "
+			"%.2f MB/s, %.0f packets/s.",
+			devc->sent_bytes, devc->sent_packets,
+			(double)devc->sent_bytes / elapsed_us,
+			(double)devc->sent_packets * G_USEC_PER_SEC / elapsed_us);
+	}
+
 	std_session_send_df_end(sdi);
 
 	if (devc->stl) {
@@ -620,5 +688,6 @@ static struct sr_dev_driver demo_driver_info = {
 	.dev_acquisition_start = dev_acquisition_start,
 	.dev_acquisition_stop = dev_acquisition_stop,
 	.context = NULL,
+	.static_lists = static_lists,
 };
 SR_REGISTER_DEV_DRIVER(demo_driver_info);
@@ -274,37 +274,56 @@ static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 	}
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+/* Fast PRNG (xorshift64*), rand() per byte would dominate the cost. */
+static uint64_t demo_random(struct dev_context *devc)
+{
+	uint64_t x;
+
+	x = devc->prng_state;
+	if (!x)
+		x = 0x9e3779b97f4a7c15ULL;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	devc->prng_state = x;
+
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+static void logic_generator(struct dev_context *devc,
+		uint8_t *logic_data, uint64_t size)
 {
-	struct dev_context *devc;
 	uint64_t i, j;
 	uint8_t pat;
 	uint8_t *sample;
 	const uint8_t *image_col;
 	size_t col_count, col_height;
-	uint64_t gray;
-
-	devc = sdi->priv;
+	uint64_t gray, rnd;
 
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
+		memset(logic_data, 0x00, size);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				logic_data[i + j] = ~pat;
 			}
 			devc->step++;
 		}
 		break;
 	case PATTERN_RANDOM:
-		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+		for (i = 0; i + sizeof(rnd) <= size; i += sizeof(rnd)) {
+			rnd = demo_random(devc);
+			memcpy(&logic_data[i], &rnd, sizeof(rnd));
+		}
+		rnd = demo_random(devc);
+		for (; i < size; i++, rnd >>= 8)
+			logic_data[i] = rnd & 0xff;
 		break;
 	case PATTERN_INC:
 		for (i = 0; i < size; i++) {
 			for (j = 0; j < devc->logic_unitsize; j++)
-				devc->logic_data[i + j] = devc->step;
+				logic_data[i + j] = devc->step;
 			devc->step++;
 		}
 		break;
@@ -312,7 +331,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		/* j contains the value of the highest bit */
 		j = 1 << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = devc->step;
+			logic_data[i] = devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -327,7 +346,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		/* j contains the value of the highest bit */
 		j = 1 << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = ~devc->step;
+			logic_data[i] = ~devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -338,15 +357,17 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		}
 		break;
 	case PATTERN_ALL_LOW:
+		memset(logic_data, 0x00, size);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(logic_data, 0xff, size);
 		break;
 	case PATTERN_SQUID:
-		memset(devc->logic_data, 0x00, size);
+		memset(logic_data, 0x00, size);
 		col_count = ARRAY_SIZE(pattern_squid);
 		col_height = ARRAY_SIZE(pattern_squid[0]);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
-			sample = &devc->logic_data[i];
+			sample = &logic_data[i];
 			image_col = pattern_squid[devc->step];
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = image_col[j % col_height];
@@ -362,7 +383,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 			devc->step &= devc->all_logic_channels_mask;
 			gray = encode_number_to_gray(devc->step);
 			gray &= devc->all_logic_channels_mask;
-			set_logic_data(gray, &devc->logic_data[i], devc->logic_unitsize);
+			set_logic_data(gray, &logic_data[i], devc->logic_unitsize);
 		}
 		break;
 	default:
@@ -379,7 +400,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
  * of the enabled channels' data?
  */
 static void logic_fixup_feed(struct dev_context *devc,
-		struct sr_datafeed_logic *logic)
+		uint8_t *logic_data, size_t length)
 {
 	size_t fp_off;
 	uint8_t fp_mask;
@@ -388,17 +409,135 @@ static void logic_fixup_feed(struct dev_context *devc,
 
 	fp_off = devc->first_partial_logic_index;
 	fp_mask = devc->first_partial_logic_mask;
-	if (fp_off == logic->unitsize)
+	if (fp_off == devc->logic_unitsize)
 		return;
 
-	for (off = 0; off < logic->length; off += logic->unitsize) {
-		sample = logic->data + off;
+	for (off = 0; off < length; off += devc->logic_unitsize) {
+		sample = logic_data + off;
 		sample[fp_off] &= fp_mask;
-		for (idx = fp_off + 1; idx < logic->unitsize; idx++)
+		for (idx = fp_off + 1; idx < devc->logic_unitsize; idx++)
 			sample[idx] = 0x00;
 	}
 }
 
+/*
+ * Determine the period of the logic pattern in samples. Returns 0 for
+ * patterns which don't repeat (or repeat after too many samples), these
+ * get generated for every chunk.
+ */
+static size_t logic_pattern_period(struct dev_context *devc)
+{
+	uint64_t period;
+
+	switch (devc->logic_pattern) {
+	case PATTERN_SIGROK:
+		period = sizeof(pattern_sigrok);
+		break;
+	case PATTERN_INC:
+		/* Byte-wise increment, a multiple of 256 bytes. */
+		period = 256;
+		break;
+	case PATTERN_WALKING_ONE:
+	case PATTERN_WALKING_ZERO:
+		/* Byte-wise walk, a multiple of the number of states. */
+		period = devc->num_logic_channels + 1;
+		break;
+	case PATTERN_ALL_LOW:
+	case PATTERN_ALL_HIGH:
+		period = 1;
+		break;
+	case PATTERN_SQUID:
+		period = ARRAY_SIZE(pattern_squid);
+		break;
+	case PATTERN_GRAYCODE:
+		if (devc->num_logic_channels >= 32)
+			return 0;
+		period = devc->all_logic_channels_mask + 1;
+		break;
+	default:
+		return 0;
+	}
+	if (period * devc->logic_unitsize > LOGIC_PERIOD_MAX)
+		return 0;
+
+	return period;
+}
+
+/*
+ * Prepare the logic data generation for an acquisition. Periodic
+ * patterns get generated once, for one period plus one chunk, such
+ * that any chunk can be sent as a view into that memory.
+ */
+SR_PRIV int demo_prepare_logic(struct dev_context *devc)
+{
+	size_t period, slack, size;
+
+	demo_free_logic(devc);
+	if (!devc->logic_unitsize)
+		return SR_OK;
+
+	/* Some generators write one sample past the requested size. */
+	slack = devc->logic_unitsize;
+	devc->logic_data = g_try_malloc0(devc->logic_bufsize + slack);
+	if (!devc->logic_data)
+		return SR_ERR_MALLOC;
+
+	period = logic_pattern_period(devc);
+	if (!period)
+		return SR_OK;
+	devc->logic_ring_period = period * devc->logic_unitsize;
+	size = devc->logic_ring_period + devc->logic_bufsize;
+	devc->logic_ring = g_try_malloc0(size + slack);
+	if (!devc->logic_ring) {
+		devc->logic_ring_period = 0;
+		return SR_OK;
+	}
+	devc->step = 0;
+	logic_generator(devc, devc->logic_ring, size);
+	logic_fixup_feed(devc, devc->logic_ring, size);
+	devc->step = 0;
+	devc->logic_ring_pos = 0;
+
+	return SR_OK;
+}
+
+SR_PRIV void demo_free_logic(struct dev_context *devc)
+{
+	g_free(devc->logic_data);
+	devc->logic_data = NULL;
+	g_free(devc->logic_ring);
+	devc->logic_ring = NULL;
+	devc->logic_ring_period = 0;
+	devc->logic_ring_pos = 0;
+}
+
+/*
+ * Get the next chunk of logic data, @p size must not exceed the chunk
+ * size. Transforms may modify packets in place, a copy of the pattern
+ * is sent when the session has any.
+ */
+static uint8_t *logic_next(struct sr_dev_inst *sdi, size_t size)
+{
+	struct dev_context *devc;
+	uint8_t *data;
+
+	devc = sdi->priv;
+	if (devc->logic_ring) {
+		data = devc->logic_ring + devc->logic_ring_pos;
+		devc->logic_ring_pos += size;
+		devc->logic_ring_pos %= devc->logic_ring_period;
+		if (!sdi->session || !sdi->session->transforms)
+			return data;
+		memcpy(devc->logic_data, data, size);
+		return devc->logic_data;
+	}
+
+	logic_generator(devc, devc->logic_data, size);
+	logic_fixup_feed(devc, devc->logic_data, size);
+
+	return devc->logic_data;
+}
+
 static void send_analog_packet(struct analog_gen *ag,
 		struct sr_dev_inst *sdi, uint64_t *analog_sent,
 		uint64_t analog_pos, uint64_t analog_todo)
@@ -515,7 +654,7 @@ static void send_analog_packet(struct analog_gen *ag,
 			data = ag->packet.data;
 			for (i = 0; i < sending_now; i++) {
 				if (ag->pattern == PATTERN_ANALOG_RANDOM)
-					data[i] = (rand() % 1000) * amplitude + offset;
+					data[i] = (demo_random(devc) % 1000) * amplitude + offset;
 				else
 					data[i] = pattern->data[ag_pattern_pos + i] * amplitude + offset;
 			}
@@ -525,6 +664,8 @@ static void send_analog_packet(struct analog_gen *ag,
 		}
 		ag->packet.num_samples = sending_now;
 		sr_session_send(sdi, &packet);
+		devc->sent_bytes += sending_now * sizeof(float);
+		devc->sent_packets++;
 
 		/* Whichever channel group gets there first. */
 		*analog_sent = MAX(*analog_sent, sending_now);
@@ -541,7 +682,7 @@ static void send_analog_packet(struct analog_gen *ag,
 
 		for (i = 0; i < to_avg; i++) {
 			if (ag->pattern == PATTERN_ANALOG_RANDOM)
-				value = (rand() % 1000) * amplitude + offset;
+				value = (demo_random(devc) % 1000) * amplitude + offset;
 			else
 				value = *(pattern->data + ag_pattern_pos + i) * amplitude + offset;
 			ag->avg_val = (ag->avg_val + value) / 2;
@@ -565,6 +706,8 @@ do_send:
 		ag->packet.num_samples = 1;
 
 		sr_session_send(sdi, &packet);
+		devc->sent_bytes += sizeof(float);
+		devc->sent_packets++;
 		*analog_sent = ag->num_avgs;
 
 		ag->num_avgs = 0;
@@ -586,6 +729,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	int64_t elapsed_us, limit_us, todo_us;
 	int64_t trigger_offset;
 	int pre_trigger_samples;
+	uint8_t *logic_data;
 
 	(void)fd;
 	(void)revents;
@@ -613,6 +757,25 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
 			/ G_USEC_PER_SEC;
 
+	/*
+	 * Unthrottled mode: ignore the samplerate, send a fixed number
+	 * of chunks per invocation. The time limit is wall clock time.
+	 */
+	if (devc->max_throughput) {
+		if (limit_us > 0 && elapsed_us >= limit_us)
+			samples_todo = 0;
+		else if (devc->enabled_logic_channels)
+			samples_todo = THROUGHPUT_CHUNKS *
+				(devc->logic_bufsize / devc->logic_unitsize);
+		else
+			samples_todo = THROUGHPUT_CHUNKS * ANALOG_BUFSIZE;
+		if (!samples_todo) {
+			sr_dbg("Requested sampling time reached.");
+			sr_dev_acquisition_stop(sdi);
+			return G_SOURCE_CONTINUE;
+		}
+	}
+
 	if (devc->limit_samples > 0) {
 		if (devc->limit_samples < devc->sent_samples)
 			samples_todo = 0;
@@ -636,6 +799,8 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	 * time delta with no samples being sent due to round-off.
 	 */
 	todo_us = samples_todo * G_USEC_PER_SEC / devc->cur_samplerate;
+	if (devc->max_throughput)
+		todo_us = 0;
 
 	logic_done = devc->num_logic_channels > 0 ? 0 : samples_todo;
 	if (!devc->enabled_logic_channels)
@@ -649,12 +814,13 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		/* Logic */
 		if (logic_done < samples_todo) {
 			sending_now = MIN(samples_todo - logic_done,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+					devc->logic_bufsize / devc->logic_unitsize);
+			logic_data = logic_next(sdi,
+					sending_now * devc->logic_unitsize);
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
 				trigger_offset = soft_trigger_logic_check(devc->stl,
-						devc->logic_data, sending_now * devc->logic_unitsize,
+						logic_data, sending_now * devc->logic_unitsize,
 						&pre_trigger_samples);
 				if (trigger_offset > -1) {
 					devc->trigger_fired = TRUE;
@@ -672,9 +838,10 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 				if (devc->trigger_fired && (trigger_offset < (int)sending_now)) {
 					/* Send after-trigger data */
 					logic.length = (sending_now - trigger_offset) * devc->logic_unitsize;
-					logic.data = devc->logic_data + trigger_offset * devc->logic_unitsize;
-					logic_fixup_feed(devc, &logic);
+					logic.data = logic_data + trigger_offset * devc->logic_unitsize;
 					sr_session_send(sdi, &packet);
+					devc->sent_bytes += logic.length;
+					devc->sent_packets++;
 					logic_done += sending_now - trigger_offset;
 					/* End acquisition */
 					sr_dbg("Triggered, stopping acquisition.");
@@ -687,9 +854,10 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 			} else if (!devc->stl) {
 				/* No trigger defined, send logic samples */
 				logic.length = sending_now * devc->logic_unitsize;
-				logic.data = devc->logic_data;
-				logic_fixup_feed(devc, &logic);
+				logic.data = logic_data;
 				sr_session_send(sdi, &packet);
+				devc->sent_bytes += logic.length;
+				devc->sent_packets++;
 				logic_done += sending_now;
 			}
 		}
@@ -712,6 +880,8 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	devc->sent_samples += min;
 	devc->sent_frame_samples += min;
 	devc->spent_us += todo_us;
+	if (devc->max_throughput)
+		devc->spent_us = g_get_monotonic_time() - devc->start_us;
 
 	if (devc->limit_frames && devc->sent_frame_samples >= SAMPLES_PER_FRAME) {
 		std_session_send_df_frame_end(sdi);
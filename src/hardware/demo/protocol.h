@@ -32,6 +32,13 @@
 
 /* The size in bytes of chunks to send through the session bus. */
 #define LOGIC_BUFSIZE			4096
+/* Limits for the user specified logic chunk size (SR_CONF_BUFFERSIZE). */
+#define LOGIC_BUFSIZE_MIN		64
+#define LOGIC_BUFSIZE_MAX		(16 * 1024 * 1024)
+/* Periodic logic patterns up to this size are generated only once. */
+#define LOGIC_PERIOD_MAX		(4 * 1024 * 1024)
+/* Chunks per callback in "max-throughput" mode, keeps the UI responsive. */
+#define THROUGHPUT_CHUNKS		64
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE			4096
 /* This is a development feature: it starts a new frame every n samples. */
@@ -127,7 +134,13 @@ struct dev_context {
 	uint64_t all_logic_channels_mask;
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
-	uint8_t logic_data[LOGIC_BUFSIZE];
+	size_t logic_bufsize;
+	uint8_t *logic_data;
+	/* Precomputed periodic pattern, chunks are sent as views into it. */
+	uint8_t *logic_ring;
+	size_t logic_ring_period;
+	size_t logic_ring_pos;
+	uint64_t prng_state;
 	/* Analog */
 	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
@@ -142,6 +155,10 @@ struct dev_context {
 	uint64_t capture_ratio;
 	gboolean trigger_fired;
 	struct soft_trigger_logic *stl;
+	/* Generate data as fast as the session accepts it. */
+	gboolean max_throughput;
+	uint64_t sent_bytes;
+	uint64_t sent_packets;
 };
 
 struct analog_gen {
@@ -162,6 +179,8 @@ struct analog_gen {
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV int demo_prepare_logic(struct dev_context *devc);
+SR_PRIV void demo_free_logic(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
@@ -680,7 +680,7 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	std_session_send_df_end(sdi);
 
-	usb_source_remove(sdi->session, devc->ctx);
+	usb_source_remove(sdi, devc->ctx);
 
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
@@ -1011,7 +1011,7 @@ static void LIBUSB_CALL trigger_receive(struct libusb_transfer *transfer)
 		sr_dbg("Trigger transfer canceled.");
 		/* Terminate session. */
 		std_session_send_df_end(sdi);
-		usb_source_remove(sdi->session, devc->ctx);
+		usb_source_remove(sdi, devc->ctx);
 		devc->num_transfers = 0;
 		g_free(devc->transfers);
 	} else if (transfer->status == LIBUSB_TRANSFER_COMPLETED
@@ -1048,7 +1048,7 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->empty_transfer_count = 0;
 	devc->acq_aborted = FALSE;
 
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	usb_source_add(sdi, devc->ctx, timeout, receive_data, drvc);
 
 	if ((ret = command_stop_acquisition(sdi)) != SR_OK)
 		return ret;
@@ -119,6 +119,12 @@ static const uint32_t scanopts[] = {
 	SR_CONF_CONN,
 };
 
+static const uint32_t static_lists[] = {
+	SR_CONF_SAMPLERATE,
+	SR_CONF_TRIGGER_MATCH,
+	0,
+};
+
 static const uint32_t drvopts[] = {
 	SR_CONF_LOGIC_ANALYZER,
 };
@@ -371,6 +377,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 static void clear_helper(struct dev_context *devc)
 {
 	g_slist_free(devc->enabled_analog_channels);
+	fx2lafw_free_buffers(devc);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -461,6 +468,8 @@ static int dev_close(struct sr_dev_inst *sdi)
 
 	sr_info("Closing device on %d.%d (logical) / %s (physical) interface %d.",
 		usb->bus, usb->address, sdi->connection_id, USB_INTERFACE);
+	/* Zero-copy transfer buffers belong to the device handle. */
+	fx2lafw_free_buffers(sdi->priv);
 	libusb_release_interface(usb->devhdl, USB_INTERFACE);
 	libusb_close(usb->devhdl);
 	usb->devhdl = NULL;
@@ -598,5 +607,6 @@ static struct sr_dev_driver fx2lafw_driver_info = {
 	.dev_acquisition_start = fx2lafw_start_acquisition,
 	.dev_acquisition_stop = dev_acquisition_stop,
 	.context = NULL,
+	.static_lists = static_lists,
 };
 SR_REGISTER_DEV_DRIVER(fx2lafw_driver_info);
@@ -107,27 +107,25 @@ struct dev_context {
 	uint64_t capture_ratio;
 
 	gboolean trigger_fired;
-	gboolean acq_aborted;
 	gboolean sample_wide;
 	struct soft_trigger_logic *stl;
 
 	uint64_t num_frames;
 	uint64_t sent_samples;
-	int submitted_transfers;
-	int empty_transfer_count;
 
-	unsigned int num_transfers;
-	struct libusb_transfer **transfers;
+	struct sr_usb_stream *stream;
 	struct sr_context *ctx;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
 	uint8_t *logic_buffer;
 	float *analog_buffer;
+	size_t mso_buffer_length;
 };
 
 SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di);
 SR_PRIV struct dev_context *fx2lafw_dev_new(void);
 SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc);
+SR_PRIV void fx2lafw_free_buffers(struct dev_context *devc);
 
 #endif
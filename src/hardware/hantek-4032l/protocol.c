@@ -59,7 +59,7 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 	struct drv_context *drvc = sdi->driver->context;
 
 	std_session_send_df_end(sdi);
-	usb_source_remove(sdi->session, drvc->sr_ctx);
+	usb_source_remove(sdi, drvc->sr_ctx);
 
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
@@ -710,7 +710,7 @@ static int handle_event(int fd, int revents, void *cb_data)
 		 * TODO: Doesn't really cancel pending transfers so they might
 		 * come in after SR_DF_END is sent.
 		 */
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_source_remove(sdi, drvc->sr_ctx);
 
 		std_session_send_df_end(sdi);
 
@@ -743,7 +743,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->samp_received = 0;
 	devc->dev_state = FLUSH;
 
-	usb_source_add(sdi->session, drvc->sr_ctx, TICK,
+	usb_source_add(sdi, drvc->sr_ctx, TICK,
 		       handle_event, (void *)sdi);
 
 	hantek_6xxx_start_data_collecting(sdi);
@@ -820,7 +820,7 @@ static int handle_event(int fd, int revents, void *cb_data)
 		 * TODO: Doesn't really cancel pending transfers so they might
 		 * come in after SR_DF_END is sent.
 		 */
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_source_remove(sdi, drvc->sr_ctx);
 
 		std_session_send_df_end(sdi);
 
@@ -926,7 +926,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 
 	devc->dev_state = CAPTURE;
-	usb_source_add(sdi->session, drvc->sr_ctx, TICK, handle_event, (void *)sdi);
+	usb_source_add(sdi, drvc->sr_ctx, TICK, handle_event, (void *)sdi);
 
 	std_session_send_df_header(sdi);
 
@@ -390,7 +390,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	usb_source_add(sdi->session, drvc->sr_ctx, 100,
+	usb_source_add(sdi, drvc->sr_ctx, 100,
 			ikalogic_scanalogic2_receive_data, (void *)sdi);
 
 	std_session_send_df_header(sdi);
@@ -26,7 +26,7 @@ static void stop_acquisition(struct sr_dev_inst *sdi)
 {
 	struct drv_context *drvc = sdi->driver->context;
 
-	usb_source_remove(sdi->session, drvc->sr_ctx);
+	usb_source_remove(sdi, drvc->sr_ctx);
 
 	std_session_send_df_end(sdi);
 
@@ -37,7 +37,7 @@ static void abort_acquisition(struct sr_dev_inst *sdi)
 {
 	struct drv_context *drvc = sdi->driver->context;
 
-	usb_source_remove(sdi->session, drvc->sr_ctx);
+	usb_source_remove(sdi, drvc->sr_ctx);
 
 	std_session_send_df_end(sdi);
 
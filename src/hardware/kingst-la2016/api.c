@@ -673,7 +673,7 @@ static int handle_event(int fd, int revents, void *cb_data)
 		sr_dbg("transfer is finished!");
 		std_session_send_df_frame_end(sdi);
 
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_source_remove(sdi, drvc->sr_ctx);
 		std_session_send_df_end(sdi);
 
 		la2016_stop_acquisition(sdi);
@@ -748,7 +748,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	}
 
 	devc->have_trigger = 0;
-	usb_source_add(sdi->session, drvc->sr_ctx, 50, handle_event, (void *)sdi);
+	usb_source_add(sdi, drvc->sr_ctx, 50, handle_event, (void *)sdi);
 
 	std_session_send_df_header(sdi);
 
@@ -354,7 +354,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->log_size = xfer_in->buffer[1] + (xfer_in->buffer[2] << 8);
 	libusb_free_transfer(xfer_out);
 
-	usb_source_add(sdi->session, drvc->sr_ctx, 100,
+	usb_source_add(sdi, drvc->sr_ctx, 100,
 			lascar_el_usb_handle_events, (void *)sdi);
 
 	buf = g_malloc(4096);
@@ -508,7 +508,7 @@ SR_PRIV int lascar_el_usb_handle_events(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 
 	if (sdi->status == SR_ST_STOPPING) {
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_source_remove(sdi, drvc->sr_ctx);
 		std_session_send_df_end(sdi);
 	}
 
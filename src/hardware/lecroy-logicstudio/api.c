@@ -460,7 +460,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	std_session_send_df_header(sdi);
 
-	return usb_source_add(sdi->session, drvc->sr_ctx, 100,
+	return usb_source_add(sdi, drvc->sr_ctx, 100,
 		receive_usb_data, drvc);
 }
 
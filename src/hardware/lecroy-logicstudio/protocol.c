@@ -919,7 +919,7 @@ static void LIBUSB_CALL recv_intr_transfer(struct libusb_transfer *xfer)
 
 	if (devc->abort_acquisition) {
 		std_session_send_df_end(sdi);
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_source_remove(sdi, drvc->sr_ctx);
 		return;
 	}
 
@@ -1027,7 +1027,7 @@ static void LIBUSB_CALL recv_bulk_transfer(struct libusb_transfer *xfer)
 		return;
 	}
 
-	usb_source_remove(sdi->session, drvc->sr_ctx);
+	usb_source_remove(sdi, drvc->sr_ctx);
 
 	read_offset = sample_to_byte_offset(devc, devc->earliest_sample);
 	trigger_offset = sample_to_byte_offset(devc, devc->trigger_sample);
@@ -458,6 +458,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	std_session_send_df_header(sdi);
 
+	/*
+	 * Multi frame acquisitions: have the conversion of a waveform
+	 * overlap with the download of subsequent waveforms.
+	 */
+	if (devc->frame_limit != 1)
+		devc->frames = sr_scpi_frame_pipe_new(sdi,
+			SCPI_FRAME_PIPE_DEPTH);
+
 	devc->current_channel = devc->enabled_channels;
 
 	return lecroy_xstream_request_data(sdi);
@@ -474,10 +482,12 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct sr_scpi_dev_inst *scpi;
 
-	std_session_send_df_end(sdi);
-
 	devc = sdi->priv;
 
+	sr_scpi_frame_pipe_free(devc->frames);
+	devc->frames = NULL;
+	std_session_send_df_end(sdi);
+
 	devc->num_frames = 0;
 	g_slist_free(devc->enabled_channels);
 	devc->enabled_channels = NULL;
@@ -544,60 +544,33 @@ SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static int lecroy_waveform_2_x_to_analog(GByteArray *data,
-		struct lecroy_wavedesc *desc, struct sr_datafeed_analog *analog)
+static int lecroy_waveform_2_x_to_block(GByteArray *data,
+		struct lecroy_wavedesc *desc, struct sr_scpi_analog_block *block)
 {
-	struct sr_analog_encoding *encoding = analog->encoding;
-	struct sr_analog_meaning *meaning = analog->meaning;
-	struct sr_analog_spec *spec = analog->spec;
-	float *data_float;
-	int16_t *waveform_data;
-	unsigned int i, num_samples;
-
-	data_float = g_malloc(desc->version_2_x.wave_array_count * sizeof(float));
-	num_samples = desc->version_2_x.wave_array_count;
-
-	waveform_data = (int16_t*)(data->data +
+	block->format = SR_SCPI_SAMPLE_S16;
+	block->num_samples = desc->version_2_x.wave_array_count;
+	block->raw = data->data
 		+ desc->version_2_x.wave_descriptor_length
-		+ desc->version_2_x.user_text_len);
-
-	for (i = 0; i < num_samples; i++)
-		data_float[i] = (float)waveform_data[i]
-			* desc->version_2_x.vertical_gain
-			+ desc->version_2_x.vertical_offset;
-
-	analog->data = data_float;
-	analog->num_samples = num_samples;
-
-	encoding->unitsize = sizeof(float);
-	encoding->is_signed = TRUE;
-	encoding->is_float = TRUE;
-	encoding->is_bigendian = FALSE;
-	encoding->scale.p = 1;
-	encoding->scale.q = 1;
-	encoding->offset.p = 0;
-	encoding->offset.q = 1;
-
-	encoding->digits = 6;
-	encoding->is_digits_decimal = FALSE;
+		+ desc->version_2_x.user_text_len;
+	block->scale = desc->version_2_x.vertical_gain;
+	block->offset = desc->version_2_x.vertical_offset;
+	block->digits = 6;
+	block->spec_digits = 3;
 
 	if (strcmp(desc->version_2_x.vertunit, "A")) {
-		meaning->mq = SR_MQ_CURRENT;
-		meaning->unit = SR_UNIT_AMPERE;
+		block->mq = SR_MQ_CURRENT;
+		block->unit = SR_UNIT_AMPERE;
 	} else {
 		/* Default to voltage. */
-		meaning->mq = SR_MQ_VOLTAGE;
-		meaning->unit = SR_UNIT_VOLT;
+		block->mq = SR_MQ_VOLTAGE;
+		block->unit = SR_UNIT_VOLT;
 	}
 
-	meaning->mqflags = 0;
-	spec->spec_digits = 3;
-
 	return SR_OK;
 }
 
-static int lecroy_waveform_to_analog(GByteArray *data,
-		struct sr_datafeed_analog *analog)
+static int lecroy_waveform_to_block(GByteArray *data,
+		struct sr_scpi_analog_block *block)
 {
 	struct lecroy_wavedesc *desc;
 
@@ -608,7 +581,7 @@ static int lecroy_waveform_to_analog(GByteArray *data,
 
 	if (!strncmp(desc->template_name, "LECROY_2_2", 16) ||
 	    !strncmp(desc->template_name, "LECROY_2_3", 16)) {
-		return lecroy_waveform_2_x_to_analog(data, desc, analog);
+		return lecroy_waveform_2_x_to_block(data, desc, block);
 	}
 
 	sr_err("Waveformat template '%.16s' not supported.", desc->template_name);
@@ -622,12 +595,8 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct scope_state *state;
-	struct sr_datafeed_packet packet;
 	GByteArray *data;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
+	struct sr_scpi_analog_block block;
 
 	(void)fd;
 	(void)revents;
@@ -638,6 +607,9 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	if (!(devc = sdi->priv))
 		return TRUE;
 
+	/* Send data of previous waveforms which completed conversion. */
+	sr_scpi_frame_pipe_dispatch(devc->frames);
+
 	ch = devc->current_channel->data;
 	state = devc->model_state;
 
@@ -651,15 +623,13 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	}
 
-	analog.encoding = &encoding;
-	analog.meaning = &meaning;
-	analog.spec = &spec;
-
-	if (lecroy_waveform_to_analog(data, &analog) != SR_OK)
+	memset(&block, 0, sizeof(block));
+	block.sdi = sdi;
+	block.ch = ch;
+	if (lecroy_waveform_to_block(data, &block) != SR_OK)
 		return SR_ERR;
 
-	if (analog.num_samples == 0) {
-		g_free(analog.data);
+	if (block.num_samples == 0) {
 		g_byte_array_free(data, TRUE);
 
 		/* No data available, we have to acquire data first. */
@@ -671,8 +641,7 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	} else {
 		/* Update sample rate if needed. */
 		if (state->sample_rate == 0)
-			if (lecroy_xstream_update_sample_rate(sdi, analog.num_samples) != SR_OK) {
-				g_free(analog.data);
+			if (lecroy_xstream_update_sample_rate(sdi, block.num_samples) != SR_OK) {
 				g_byte_array_free(data, TRUE);
 				return SR_ERR;
 			}
@@ -683,19 +652,13 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	 * first enabled channel.
 	 */
 	if (devc->current_channel == devc->enabled_channels)
-		std_session_send_df_frame_begin(sdi);
+		sr_scpi_frame_pipe_begin(devc->frames, sdi);
 
-	meaning.channels = g_slist_append(NULL, ch);
-	packet.payload = &analog;
-	packet.type = SR_DF_ANALOG;
-	sr_session_send(sdi, &packet);
+	sr_scpi_frame_pipe_analog(devc->frames, &block);
 
 	g_byte_array_free(data, TRUE);
 	data = NULL;
 
-	g_slist_free(meaning.channels);
-	g_free(analog.data);
-
 	/*
 	 * Advance to the next enabled channel. When data for all enabled
 	 * channels was received, then flush potentially queued logic data,
@@ -707,7 +670,7 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	}
 
-	std_session_send_df_frame_end(sdi);
+	sr_scpi_frame_pipe_end(devc->frames, sdi);
 
 	/*
 	 * End of frame was reached. Stop acquisition after the specified
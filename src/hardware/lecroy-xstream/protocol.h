@@ -88,6 +88,9 @@ struct dev_context {
 	uint64_t num_frames;
 
 	uint64_t frame_limit;
+
+	/* Conversion of frames on a worker, see scpi_frames.c */
+	struct sr_scpi_frame_pipe *frames;
 };
 
 SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi);
@@ -609,14 +609,9 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
-	struct sr_datafeed_logic logic;
+	struct sr_scpi_analog_block block;
 	double vdiv, offset, origin;
-	int len, i, vref;
+	int len, vref;
 	struct sr_channel *ch;
 	gsize expected_data_bytes;
 
@@ -633,6 +628,9 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
 
+	/* Send data of previous blocks which completed conversion. */
+	sr_scpi_frame_pipe_dispatch(devc->frames);
+
 	const gboolean first_frame = (devc->num_frames == 0);
 
 	switch (devc->wait_event) {
@@ -695,7 +693,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 				return TRUE;
 			if (len == -1) {
 				sr_err("Error while reading block header, aborting capture.");
-				std_session_send_df_frame_end(sdi);
+				sr_scpi_frame_pipe_end(devc->frames, sdi);
 				sr_dev_acquisition_stop(sdi);
 				return TRUE;
 			}
@@ -728,7 +726,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 
 	if (len == -1) {
 		sr_err("Error while reading block data, aborting capture.");
-		std_session_send_df_frame_end(sdi);
+		sr_scpi_frame_pipe_end(devc->frames, sdi);
 		sr_dev_acquisition_stop(sdi);
 		return TRUE;
 	}
@@ -742,35 +740,34 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		vdiv = devc->vert_inc[ch->index];
 		origin = devc->vert_origin[ch->index];
 		offset = devc->vert_offset[ch->index];
-		if (devc->model->series->protocol >= PROTOCOL_V3)
-			for (i = 0; i < len; i++)
-				devc->data[i] = ((int)devc->buffer[i] - vref - origin) * vdiv;
-		else
-			for (i = 0; i < len; i++)
-				devc->data[i] = (128 - devc->buffer[i]) * vdiv - offset;
 		float vdivlog = log10f(vdiv);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-		analog.meaning->channels = g_slist_append(NULL, ch);
-		analog.num_samples = len;
-		analog.data = devc->data;
-		analog.meaning->mq = SR_MQ_VOLTAGE;
-		analog.meaning->unit = SR_UNIT_VOLT;
-		analog.meaning->mqflags = 0;
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
+		memset(&block, 0, sizeof(block));
+		block.sdi = sdi;
+		block.ch = ch;
+		block.format = SR_SCPI_SAMPLE_U8;
+		block.raw = devc->buffer;
+		block.num_samples = len;
+		if (devc->model->series->protocol >= PROTOCOL_V3) {
+			/* (raw - vref - origin) * vdiv */
+			block.scale = vdiv;
+			block.offset = -(vref + origin) * vdiv;
+		} else {
+			/* (128 - raw) * vdiv - offset */
+			block.scale = -vdiv;
+			block.offset = 128 * vdiv - offset;
+		}
+		block.digits = digits;
+		block.mq = SR_MQ_VOLTAGE;
+		block.unit = SR_UNIT_VOLT;
+		block.scratch = devc->data;
+		sr_scpi_frame_pipe_analog(devc->frames, &block);
 	} else {
-		logic.length = len;
 		// TODO: For the MSO1000Z series, we need a way to express that
 		// this data is in fact just for a single channel, with the valid
 		// data for that channel in the LSB of each byte.
-		logic.unitsize = devc->model->series->protocol >= PROTOCOL_V4 ? 1 : 2;
-		logic.data = devc->buffer;
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		sr_session_send(sdi, &packet);
+		sr_scpi_frame_pipe_logic(devc->frames, sdi, devc->buffer, len,
+			devc->model->series->protocol >= PROTOCOL_V4 ? 1 : 2);
 	}
 
 	if (devc->num_block_read == devc->num_block_bytes) {
@@ -819,7 +816,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		rigol_ds_channel_start(sdi);
 	} else {
 		/* Done with this frame. */
-		std_session_send_df_frame_end(sdi);
+		sr_scpi_frame_pipe_end(devc->frames, sdi);
 
 		devc->num_frames++;
 
@@ -848,7 +845,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 			rigol_ds_capture_start(sdi);
 
 			/* Start of next frame. */
-			std_session_send_df_frame_begin(sdi);
+			sr_scpi_frame_pipe_begin(devc->frames, sdi);
 		}
 	}
 
@@ -163,6 +163,8 @@ struct dev_context {
 	/* Acq buffers used for reading from the scope and sending data to app */
 	unsigned char *buffer;
 	float *data;
+	/* Conversion of segmented frames on a worker, see scpi_frames.c */
+	struct sr_scpi_frame_pipe *frames;
 };
 
 SR_PRIV int rigol_ds_config_set(const struct sr_dev_inst *sdi, const char *format, ...);
@@ -430,7 +430,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->submitted_transfers++;
 	}
 
-	usb_source_add(sdi->session, drvc->sr_ctx, BUF_TIMEOUT, dev_acquisition_handle, (void *)sdi);
+	usb_source_add(sdi, drvc->sr_ctx, BUF_TIMEOUT, dev_acquisition_handle, (void *)sdi);
 
 	std_session_send_df_header(sdi);
 
@@ -450,7 +450,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	std_session_send_df_end(sdi);
 
-	usb_source_remove(sdi->session, drvc->sr_ctx);
+	usb_source_remove(sdi, drvc->sr_ctx);
 
 	g_free(devc->conv_buffer);
 
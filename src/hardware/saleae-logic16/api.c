@@ -716,7 +716,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	devc->ctx = drvc->sr_ctx;
 
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, (void *)sdi);
+	usb_source_add(sdi, devc->ctx, timeout, receive_data, (void *)sdi);
 
 	std_session_send_df_header(sdi);
 
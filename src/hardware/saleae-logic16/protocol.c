@@ -754,7 +754,7 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	std_session_send_df_end(sdi);
 
-	usb_source_remove(sdi->session, devc->ctx);
+	usb_source_remove(sdi, devc->ctx);
 
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
@@ -893,13 +893,21 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	std_session_send_df_header(sdi);
 
+	/*
+	 * History mode yields many frames. Have their conversion
+	 * overlap with the download of subsequent blocks.
+	 */
+	if (devc->data_source == DATA_SOURCE_HISTORY)
+		devc->frames = sr_scpi_frame_pipe_new(sdi,
+			SCPI_FRAME_PIPE_DEPTH);
+
 	devc->channel_entry = devc->enabled_channels;
 
 	if (siglent_sds_capture_start(sdi) != SR_OK)
 		return SR_ERR;
 
 	/* Start of first frame. */
-	std_session_send_df_frame_begin(sdi);
+	sr_scpi_frame_pipe_begin(devc->frames, sdi);
 
 	return SR_OK;
 }
@@ -911,6 +919,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
+	sr_scpi_frame_pipe_free(devc->frames);
+	devc->frames = NULL;
 	std_session_send_df_end(sdi);
 
 	g_slist_free(devc->enabled_channels);
@@ -462,14 +462,9 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
-	struct sr_datafeed_logic logic;
+	struct sr_scpi_analog_block block;
 	struct sr_channel *ch;
-	int len, i;
+	int len;
 	float wait;
 	gboolean read_complete = FALSE;
 
@@ -486,6 +481,9 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
 
+	/* Send data of previous blocks which completed conversion. */
+	sr_scpi_frame_pipe_dispatch(devc->frames);
+
 	switch (devc->wait_event) {
 	case WAIT_NONE:
 		break;
@@ -543,7 +541,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 				return TRUE;
 			if (len == -1) {
 				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
+				sr_scpi_frame_pipe_end(devc->frames, sdi);
 				sdi->driver->dev_acquisition_stop(sdi);
 				return TRUE;
 			}
@@ -552,7 +550,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 
 			if (len == -1) {
 				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
+				sr_scpi_frame_pipe_end(devc->frames, sdi);
 				sdi->driver->dev_acquisition_stop(sdi);
 				return TRUE;
 			}
@@ -569,7 +567,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 					len = sr_scpi_read_data(scpi, (char *)devc->buffer, devc->num_samples-devc->num_block_bytes);
 					if (len == -1) {
 						sr_err("Read error, aborting capture.");
-						std_session_send_df_frame_end(sdi);
+						sr_scpi_frame_pipe_end(devc->frames, sdi);
 						sdi->driver->dev_acquisition_stop(sdi);
 						return TRUE;
 					}
@@ -580,33 +578,22 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 				if (ch->type == SR_CHANNEL_ANALOG) {
 					float vdiv = devc->vdiv[ch->index];
 					float offset = devc->vert_offset[ch->index];
-					GArray *float_data;
-					static GArray *data;
-					float voltage, vdivlog;
-					int digits;
-
-					data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-					g_array_append_vals(data, devc->buffer, len);
-					float_data = g_array_new(FALSE, FALSE, sizeof(float));
-					for (i = 0; i < len; i++) {
-						voltage = (float)g_array_index(data, int8_t, i) / 25;
-						voltage = ((vdiv * voltage) - offset);
-						g_array_append_val(float_data, voltage);
-					}
+					float vdivlog;
+
 					vdivlog = log10f(vdiv);
-					digits = -(int) vdivlog + (vdivlog < 0.0);
-					sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-					analog.meaning->channels = g_slist_append(NULL, ch);
-					analog.num_samples = float_data->len;
-					analog.data = (float *)float_data->data;
-					analog.meaning->mq = SR_MQ_VOLTAGE;
-					analog.meaning->unit = SR_UNIT_VOLT;
-					analog.meaning->mqflags = 0;
-					packet.type = SR_DF_ANALOG;
-					packet.payload = &analog;
-					sr_session_send(sdi, &packet);
-					g_slist_free(analog.meaning->channels);
-					g_array_free(data, TRUE);
+					/* vdiv * (raw / 25) - offset */
+					memset(&block, 0, sizeof(block));
+					block.sdi = sdi;
+					block.ch = ch;
+					block.format = SR_SCPI_SAMPLE_S8;
+					block.raw = devc->buffer;
+					block.num_samples = len;
+					block.scale = vdiv / 25;
+					block.offset = -offset;
+					block.digits = -(int) vdivlog + (vdivlog < 0.0);
+					block.mq = SR_MQ_VOLTAGE;
+					block.unit = SR_UNIT_VOLT;
+					sr_scpi_frame_pipe_analog(devc->frames, &block);
 				}
 				len = 0;
 				if (devc->num_samples == (devc->num_block_bytes - SIGLENT_HEADER_SIZE)) {
@@ -616,7 +603,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 					read_complete = TRUE;
 					if (!sr_scpi_read_complete(scpi)) {
 						sr_err("Read should have been completed.");
-						std_session_send_df_frame_end(sdi);
+						sr_scpi_frame_pipe_end(devc->frames, sdi);
 						sdi->driver->dev_acquisition_stop(sdi);
 						return TRUE;
 					}
@@ -633,7 +620,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 				siglent_sds_channel_start(sdi);
 			} else {
 				/* Done with this frame. */
-				std_session_send_df_frame_end(sdi);
+				sr_scpi_frame_pipe_end(devc->frames, sdi);
 				if (++devc->num_frames == devc->limit_frames) {
 					/* Last frame, stop capture. */
 					sdi->driver->dev_acquisition_stop(sdi);
@@ -643,20 +630,16 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 					siglent_sds_capture_start(sdi);
 
 					/* Start of next frame. */
-					std_session_send_df_frame_begin(sdi);
+					sr_scpi_frame_pipe_begin(devc->frames, sdi);
 				}
 			}
 		}
 	} else {
 		if (!siglent_sds_get_digital(sdi, ch))
 			return TRUE;
-		logic.length = devc->dig_buffer->len;
-		logic.unitsize = 2;
-		logic.data = devc->dig_buffer->data;
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		sr_session_send(sdi, &packet);
-		std_session_send_df_frame_end(sdi);
+		sr_scpi_frame_pipe_logic(devc->frames, sdi,
+			devc->dig_buffer->data, devc->dig_buffer->len, 2);
+		sr_scpi_frame_pipe_end(devc->frames, sdi);
 		sdi->driver->dev_acquisition_stop(sdi);
 
 		if (++devc->num_frames == devc->limit_frames) {
@@ -668,7 +651,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 			siglent_sds_capture_start(sdi);
 
 			/* Start of next frame. */
-			std_session_send_df_frame_begin(sdi);
+			sr_scpi_frame_pipe_begin(devc->frames, sdi);
 		}
 	}
 
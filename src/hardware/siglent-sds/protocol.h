@@ -153,6 +153,8 @@ struct dev_context {
 	unsigned char *buffer;
 	float *data;
 	GArray *dig_buffer;
+	/* Conversion of history frames on a worker, see scpi_frames.c */
+	struct sr_scpi_frame_pipe *frames;
 };
 
 SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi,
@@ -552,7 +552,7 @@ SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 		return ret;
 	}
 	/* Register event source for asynchronous USB I/O. */
-	ret = usb_source_add(sdi->session, drvc->sr_ctx, poll_interval_ms,
+	ret = usb_source_add(sdi, drvc->sr_ctx, poll_interval_ms,
 			     &transfer_event, (struct sr_dev_inst *)sdi);
 	if (ret != SR_OK) {
 		clear_acquisition_state(sdi);
@@ -564,7 +564,7 @@ SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 		ret = std_session_send_df_header(sdi);
 
 	if (ret != SR_OK) {
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_source_remove(sdi, drvc->sr_ctx);
 		clear_acquisition_state(sdi);
 	}
 
@@ -329,7 +329,7 @@ static int handle_events(int fd, int revents, void *cb_data)
 		sr_dev_acquisition_stop(sdi);
 
 	if (sdi->status == SR_ST_STOPPING) {
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_source_remove(sdi, drvc->sr_ctx);
 		dev_close(sdi);
 		std_session_send_df_end(sdi);
 	}
@@ -358,7 +358,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	std_session_send_df_header(sdi);
 
-	usb_source_add(sdi->session, drvc->sr_ctx, 100,
+	usb_source_add(sdi, drvc->sr_ctx, 100,
 			handle_events, (void *)sdi);
 
 	if (testo_set_serial_params(usb) != SR_OK)
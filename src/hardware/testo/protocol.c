@@ -235,7 +235,7 @@ SR_PRIV void testo_receive_packet(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	sr_dbg("Got %d-byte packet.", devc->reply_size);
 
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		dbg = g_string_sized_new(128);
 		g_string_printf(dbg, "Packet:");
 		for (i = 0; i < devc->reply_size; i++)
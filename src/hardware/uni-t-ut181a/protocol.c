@@ -1073,7 +1073,7 @@ static int ut181a_send_frame(struct sr_serial_dev_inst *serial,
 	uint16_t cs_value;
 	int ret;
 
-	if (FRAME_DUMP_BYTES && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_BYTES && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(data, dlen);
 		FRAME_DUMP_CALL("TX payload, %zu bytes: %s", dlen, spew->str);
@@ -1107,7 +1107,7 @@ static int ut181a_send_frame(struct sr_serial_dev_inst *serial,
 	WL16(&frame_buff[frame_off], cs_value);
 	frame_off += sizeof(uint16_t);
 
-	if (FRAME_DUMP_FRAME && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_FRAME && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(frame_buff, frame_off);
 		FRAME_DUMP_CALL("TX frame, %zu bytes: %s", frame_off, spew->str);
@@ -1753,7 +1753,7 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	devc = sdi ? sdi->priv : NULL;
 	state = devc ? &devc->wait_state : NULL;
 	info = devc ? &devc->info : NULL;
-	if (FRAME_DUMP_FRAME && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_FRAME && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(pkt, len);
 		FRAME_DUMP_CALL("RX frame, %zu bytes: %s", len, spew->str);
@@ -1812,7 +1812,7 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	}
 	if (state)
 		state->response_count++;
-	if (FRAME_DUMP_BYTES && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_BYTES && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		GString *spew;
 		spew = sr_hexdump_new(payload, pl_dlen);
 		FRAME_DUMP_CALL("RX payload, %zu bytes: %s", pl_dlen, spew->str);
@@ -2761,7 +2761,7 @@ static int process_buffer(struct sr_dev_inst *sdi)
 		}
 
 		/* Process the packet which completed reception. */
-		if (FRAME_DUMP_CSUM && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+		if (FRAME_DUMP_CSUM && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 			GString *spew;
 			spew = sr_hexdump_new(pkt, pkt_len);
 			FRAME_DUMP_CALL("Found RX frame, %zu bytes: %s", pkt_len, spew->str);
@@ -2865,7 +2865,7 @@ static int ut181a_receive_data(struct sr_dev_inst *sdi)
 		return 0;
 	}
 	len = slen;
-	if (FRAME_DUMP_RXDATA && sr_log_loglevel_get() >= FRAME_DUMP_LEVEL) {
+	if (FRAME_DUMP_RXDATA && sr_log_enabled(FRAME_DUMP_LEVEL)) {
 		spew = sr_hexdump_new(data, len);
 		FRAME_DUMP_CALL("UART RX, %zu bytes: %s", len, spew->str);
 		sr_hexdump_free(spew);
@@ -75,7 +75,7 @@ static void process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	float temp;
 	gboolean is_valid;
 
-	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+	if (sr_log_enabled(SR_LOG_SPEW)) {
 		spew = sr_hexdump_new(pkt, len);
 		sr_spew("Got a packet, len %zu, bytes%s", len, spew->str);
 		sr_hexdump_free(spew);
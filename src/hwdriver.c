@@ -45,7 +45,10 @@
  * @{
  */
 
-/* Please use the same order/grouping as in enum sr_configkey (libsigrok.h). */
+/*
+ * Please use the same order/grouping as in enum sr_configkey (libsigrok.h).
+ * The key lookup is a binary search, so the keys must stay sorted.
+ */
 static struct sr_key_info sr_key_info_config[] = {
 	/* Device classes */
 	{SR_CONF_LOGIC_ANALYZER, SR_T_STRING, NULL, "Logic analyzer", NULL},
@@ -180,10 +183,10 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Under-voltage condition", NULL},
 	{SR_CONF_UNDER_VOLTAGE_CONDITION_ACTIVE, SR_T_BOOL, "uvc_active",
 		"Under-voltage condition active", NULL},
-	{SR_CONF_UNDER_VOLTAGE_CONDITION_THRESHOLD, SR_T_FLOAT, "uvc_threshold",
-		"Under-voltage condition threshold", NULL},
 	{SR_CONF_TRIGGER_LEVEL, SR_T_FLOAT, "triggerlevel",
 		"Trigger level", NULL},
+	{SR_CONF_UNDER_VOLTAGE_CONDITION_THRESHOLD, SR_T_FLOAT, "uvc_threshold",
+		"Under-voltage condition threshold", NULL},
 	{SR_CONF_EXTERNAL_CLOCK_SOURCE, SR_T_STRING, "external_clock_source",
 		"External clock source", NULL},
 	{SR_CONF_OFFSET, SR_T_FLOAT, "offset",
@@ -248,7 +251,7 @@ static struct sr_key_info sr_key_info_config[] = {
 	ALL_ZERO
 };
 
-/* Please use the same order as in enum sr_mq (libsigrok.h). */
+/* Please use the same order as in enum sr_mq (libsigrok.h), keys sorted. */
 static struct sr_key_info sr_key_info_mq[] = {
 	{SR_MQ_VOLTAGE, 0, "voltage", "Voltage", NULL},
 	{SR_MQ_CURRENT, 0, "current", "Current", NULL},
@@ -288,7 +291,7 @@ static struct sr_key_info sr_key_info_mq[] = {
 	ALL_ZERO
 };
 
-/* Please use the same order as in enum sr_mqflag (libsigrok.h). */
+/* Please use the same order as in enum sr_mqflag (libsigrok.h), keys sorted. */
 static struct sr_key_info sr_key_info_mqflag[] = {
 	{SR_MQFLAG_AC, 0, "ac", "AC", NULL},
 	{SR_MQFLAG_DC, 0, "dc", "DC", NULL},
@@ -432,6 +435,11 @@ SR_API int sr_driver_init(struct sr_context *ctx, struct sr_dev_driver *driver)
 
 	/* No log message here, too verbose and not very useful. */
 
+	if (sr_driver_sanity_check(driver) != SR_OK) {
+		sr_err("Internal error(s) in driver '%s'.", driver->name);
+		return SR_ERR_BUG;
+	}
+
 	if ((ret = driver->init(driver, ctx)) < 0)
 		sr_err("Failed to initialize the driver: %d.", ret);
 
@@ -553,7 +561,7 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 		return NULL;
 	}
 
-	if (!driver->context) {
+	if (!driver->context && sr_driver_init_lazy(driver) != SR_OK) {
 		sr_err("Driver not initialized, can't scan for devices.");
 		return NULL;
 	}
@@ -570,6 +578,210 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 	return l;
 }
 
+/** @cond PRIVATE */
+/* Upper limit for the number of concurrently running driver scans. */
+#define SCAN_THREADS_MAX 16
+/** @endcond */
+
+/*
+ * Scan jobs which talk to the same connection must not run concurrently,
+ * they would fight over the port. Neither must jobs of the same driver:
+ * scans register their devices in the driver's instance list, which is
+ * not locked. Jobs are grouped by their SR_CONF_CONN option and their
+ * driver, all groups run in parallel, the jobs within a group run in
+ * their original order. Jobs without a conn= spec end up in one common
+ * group, since their drivers may enumerate and claim the same USB or
+ * serial devices.
+ */
+struct scan_group {
+	GSList *jobs;
+};
+
+static const char *scan_job_conn(const struct sr_driver_scan_job *job)
+{
+	struct sr_config *src;
+	GSList *l;
+
+	for (l = job->options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			return g_variant_get_string(src->data, NULL);
+	}
+
+	return NULL;
+}
+
+static gboolean scan_group_matches(const struct scan_group *group,
+		const struct sr_driver_scan_job *job, const char *conn)
+{
+	const struct sr_driver_scan_job *other;
+	GSList *l;
+
+	for (l = group->jobs; l; l = l->next) {
+		other = l->data;
+		if (other->driver == job->driver)
+			return TRUE;
+		if (g_strcmp0(scan_job_conn(other), conn) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Jobs point into the caller's array, so their order is their address. */
+static int scan_job_cmp(const void *a, const void *b)
+{
+	return (a > b) - (a < b);
+}
+
+static void scan_group_run(void *data, void *user_data)
+{
+	struct scan_group *group;
+	struct sr_driver_scan_job *job;
+	const char *conn;
+	GSList *l;
+	int64_t start;
+
+	(void)user_data;
+
+	group = data;
+	for (l = group->jobs; l; l = l->next) {
+		job = l->data;
+		conn = scan_job_conn(job);
+		start = g_get_monotonic_time();
+		job->devices = sr_driver_scan(job->driver, job->options);
+		job->duration_us = g_get_monotonic_time() - start;
+		sr_dbg("Scan with %s on %s took %" PRIu64 " us, found %u devices.",
+			job->driver->name, conn ? conn : "(any)",
+			job->duration_us, g_slist_length(job->devices));
+	}
+}
+
+static void scan_group_free(void *data)
+{
+	struct scan_group *group;
+
+	group = data;
+	g_slist_free(group->jobs);
+	g_free(group);
+}
+
+/**
+ * Scan for devices with several drivers concurrently.
+ *
+ * Each job describes one sr_driver_scan() call. Jobs which share the same
+ * SR_CONF_CONN option or the same driver, as well as all jobs without a
+ * SR_CONF_CONN option, are executed one after another in the order they
+ * appear in @a jobs. Jobs of different drivers for different connections
+ * run in parallel on a pool of worker threads. This speeds up scanning
+ * a set of serial port devices, where each individual probe may take
+ * until the port's read timeout expires.
+ *
+ * The result of each job is stored in the job itself, so the order of
+ * the results does not depend on the order of completion.
+ *
+ * Before calling sr_driver_scan_multi(), the user must have previously
+ * initialized all involved drivers by calling sr_driver_init().
+ *
+ * @param jobs Array of scan jobs. The caller fills in the driver and
+ *             options fields, the devices and duration_us fields are
+ *             set by this function. Must not be NULL.
+ * @param num_jobs Number of entries in @a jobs.
+ * @param max_threads Maximum number of scans to run in parallel, or 0
+ *                    to let libsigrok decide.
+ *
+ * @retval SR_OK Success. Note that this does not imply that any
+ *               devices were found.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Could not set up the worker threads.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_driver_scan_multi(struct sr_driver_scan_job *jobs,
+		size_t num_jobs, unsigned int max_threads)
+{
+	struct sr_driver_scan_job *job;
+	struct scan_group *group, *match;
+	GSList *groups, *l, *next;
+	GThreadPool *pool;
+	GError *error;
+	const char *conn;
+	unsigned int num_groups;
+	size_t i;
+	int64_t start;
+
+	if (!jobs && num_jobs) {
+		sr_err("%s: jobs was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	groups = NULL;
+	num_groups = 0;
+	for (i = 0; i < num_jobs; i++) {
+		job = &jobs[i];
+		job->devices = NULL;
+		job->duration_us = 0;
+		conn = scan_job_conn(job);
+		match = NULL;
+		for (l = groups; l; l = next) {
+			next = l->next;
+			group = l->data;
+			if (!scan_group_matches(group, job, conn))
+				continue;
+			if (!match) {
+				match = group;
+				continue;
+			}
+			/* The job ties two groups together, merge them. */
+			match->jobs = g_slist_concat(match->jobs, group->jobs);
+			match->jobs = g_slist_sort(match->jobs, scan_job_cmp);
+			g_free(group);
+			groups = g_slist_delete_link(groups, l);
+			num_groups--;
+		}
+		if (match) {
+			match->jobs = g_slist_append(match->jobs, job);
+			continue;
+		}
+		group = g_malloc0(sizeof(*group));
+		group->jobs = g_slist_append(NULL, job);
+		groups = g_slist_append(groups, group);
+		num_groups++;
+	}
+
+	if (max_threads == 0 || max_threads > SCAN_THREADS_MAX)
+		max_threads = SCAN_THREADS_MAX;
+	max_threads = MIN(max_threads, num_groups);
+
+	sr_dbg("Scanning %zu jobs in %u groups, using %u threads.",
+		num_jobs, num_groups, max_threads);
+
+	start = g_get_monotonic_time();
+	if (max_threads <= 1) {
+		g_slist_foreach(groups, scan_group_run, NULL);
+	} else {
+		error = NULL;
+		pool = g_thread_pool_new(scan_group_run, NULL,
+			max_threads, TRUE, &error);
+		if (!pool) {
+			sr_err("Cannot create scan threads: %s.", error->message);
+			g_error_free(error);
+			g_slist_free_full(groups, scan_group_free);
+			return SR_ERR;
+		}
+		for (l = groups; l; l = l->next)
+			g_thread_pool_push(pool, l->data, NULL);
+		/* Blocks until all groups have been processed. */
+		g_thread_pool_free(pool, FALSE, TRUE);
+	}
+	sr_dbg("Multi-driver scan took %" PRIi64 " us.",
+		g_get_monotonic_time() - start);
+
+	g_slist_free_full(groups, scan_group_free);
+
+	return SR_OK;
+}
+
 /**
  * Call driver cleanup function for all drivers.
  *
@@ -589,6 +801,9 @@ SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx)
 
 	drivers = sr_driver_list(ctx);
 	for (i = 0; drivers[i]; i++) {
+		/* Drivers are initialized lazily, skip unused ones. */
+		if (!drivers[i]->context)
+			continue;
 		if (drivers[i]->cleanup)
 			drivers[i]->cleanup(drivers[i]);
 		drivers[i]->context = NULL;
@@ -651,6 +866,9 @@ SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Starting acquisition.", sdi->driver->name);
 
+	/* Some lists differ while acquiring. */
+	sr_config_cache_invalidate(sdi);
+
 	return sdi->driver->dev_acquisition_start(sdi);
 }
 
@@ -670,6 +888,9 @@ SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Stopping acquisition.", sdi->driver->name);
 
+	/* Some lists differ while acquiring. */
+	sr_config_cache_invalidate(sdi);
+
 	return sdi->driver->dev_acquisition_stop(sdi);
 }
 
@@ -695,14 +916,267 @@ static void log_key(const struct sr_dev_inst *sdi,
 	g_free(tmp_str);
 }
 
-static int check_key(const struct sr_dev_driver *driver,
+/*
+ * Cache of config_list() results. Frontends poll these lists, and every
+ * config call validates its key against SR_CONF_DEVICE_OPTIONS, so they
+ * are kept until something happens that may change them. Other than the
+ * option lists, only keys the driver declares in static_lists are cached:
+ * some lists come from the device on every call.
+ *
+ * An entry covers one device instance and channel group, or one driver
+ * for driver options. It holds the (immutable) GVariants the driver
+ * returned, by key, plus the capability bits of every config key as
+ * published via SR_CONF_DEVICE_OPTIONS, indexed by sr_key_info_index().
+ * Entries for device instances live in sdi->config_cache, keyed by
+ * channel group; entries for drivers are kept here.
+ */
+#define CAPS_PUBLISHED (1 << 0)
+
+struct config_cache {
+	GHashTable *lists;
+	uint32_t *caps;
+};
+
+static GMutex cache_mutex;
+static GHashTable *driver_cache;
+static unsigned int cache_generation;
+
+static void config_cache_entry_free(void *data)
+{
+	struct config_cache *cache;
+
+	cache = data;
+	g_hash_table_destroy(cache->lists);
+	g_free(cache->caps);
+	g_free(cache);
+}
+
+/* Must be called with cache_mutex held. */
+static struct config_cache *config_cache_entry(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
-		uint32_t key, unsigned int op, GVariant *data)
+		gboolean create)
 {
-	const struct sr_key_info *srci;
+	GHashTable **table;
+	struct config_cache *cache;
+	gpointer key;
+
+	if (sdi) {
+		table = &((struct sr_dev_inst *)sdi)->config_cache;
+		key = (gpointer)cg;
+	} else if (!cg) {
+		table = &driver_cache;
+		key = (gpointer)driver;
+	} else {
+		return NULL;
+	}
+
+	if (!*table) {
+		if (!create)
+			return NULL;
+		*table = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, config_cache_entry_free);
+	}
+
+	if (!(cache = g_hash_table_lookup(*table, key)) && create) {
+		cache = g_malloc0(sizeof(*cache));
+		cache->lists = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, (GDestroyNotify)g_variant_unref);
+		g_hash_table_insert(*table, key, cache);
+	}
+
+	return cache;
+}
+
+static gboolean config_list_static(const struct sr_dev_driver *driver,
+		uint32_t key)
+{
+	const uint32_t *k;
+
+	if (key == SR_CONF_SCAN_OPTIONS || key == SR_CONF_DEVICE_OPTIONS)
+		return TRUE;
+	for (k = driver->static_lists; k && *k; k++) {
+		if (*k == key)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static GVariant *config_cache_lookup(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		uint32_t key, unsigned int *generation)
+{
+	struct config_cache *cache;
+	GVariant *data;
+
+	data = NULL;
+	g_mutex_lock(&cache_mutex);
+	if ((cache = config_cache_entry(driver, sdi, cg, FALSE))
+			&& (data = g_hash_table_lookup(cache->lists,
+				GUINT_TO_POINTER(key))))
+		g_variant_ref(data);
+	*generation = cache_generation;
+	g_mutex_unlock(&cache_mutex);
+
+	return data;
+}
+
+static void config_cache_store(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		uint32_t key, GVariant *data, unsigned int generation)
+{
+	struct config_cache *cache;
+
+	g_mutex_lock(&cache_mutex);
+	/* Don't store a list that was invalidated while it was built. */
+	if (generation == cache_generation
+			&& (cache = config_cache_entry(driver, sdi, cg, TRUE)))
+		g_hash_table_replace(cache->lists, GUINT_TO_POINTER(key),
+			g_variant_ref(data));
+	g_mutex_unlock(&cache_mutex);
+}
+
+static uint32_t *caps_build(GVariant *gvar_opts)
+{
+	const uint32_t *opts;
+	uint32_t *caps;
 	gsize num_opts, i;
+	int idx;
+
+	caps = g_malloc0(sr_key_info_count(SR_KEY_CONFIG) * sizeof(uint32_t));
+	opts = g_variant_get_fixed_array(gvar_opts, &num_opts, sizeof(uint32_t));
+	for (i = 0; i < num_opts; i++) {
+		idx = sr_key_info_index(SR_KEY_CONFIG, opts[i] & SR_CONF_MASK);
+		if (idx < 0 || caps[idx])
+			continue;
+		caps[idx] = (opts[i] & ~SR_CONF_MASK) | CAPS_PUBLISHED;
+	}
+
+	return caps;
+}
+
+/**
+ * Get the published capabilities of a config key.
+ *
+ * @param[in] driver The driver. Must not be NULL.
+ * @param[in] sdi The device instance, or NULL for driver options.
+ * @param[in] cg The channel group, or NULL.
+ * @param[in] key The configuration key (SR_CONF_*).
+ * @param[out] caps The SR_CONF_GET/SET/LIST bits published for the key,
+ *             with CAPS_PUBLISHED set, or 0 if the key isn't published.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG The driver publishes no options for this item.
+ *
+ * @private
+ */
+SR_PRIV int sr_config_caps_get(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		uint32_t key, uint32_t *caps)
+{
+	struct config_cache *cache;
 	GVariant *gvar_opts;
 	const uint32_t *opts;
+	uint32_t *entry;
+	gsize num_opts, i;
+	unsigned int generation;
+	gboolean hit;
+	int idx;
+
+	*caps = 0;
+	idx = sr_key_info_index(SR_KEY_CONFIG, key);
+
+	g_mutex_lock(&cache_mutex);
+	cache = config_cache_entry(driver, sdi, cg, FALSE);
+	if ((hit = idx >= 0 && cache && cache->caps))
+		*caps = cache->caps[idx];
+	generation = cache_generation;
+	g_mutex_unlock(&cache_mutex);
+
+	if (hit)
+		return SR_OK;
+
+	if (sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, &gvar_opts) != SR_OK)
+		return SR_ERR_ARG;
+
+	if (idx < 0) {
+		/* Not a known key, scan the list. */
+		opts = g_variant_get_fixed_array(gvar_opts, &num_opts, sizeof(uint32_t));
+		for (i = 0; i < num_opts; i++) {
+			if ((opts[i] & SR_CONF_MASK) == key) {
+				*caps = (opts[i] & ~SR_CONF_MASK) | CAPS_PUBLISHED;
+				break;
+			}
+		}
+		g_variant_unref(gvar_opts);
+		return SR_OK;
+	}
+
+	entry = caps_build(gvar_opts);
+	g_variant_unref(gvar_opts);
+	*caps = entry[idx];
+
+	g_mutex_lock(&cache_mutex);
+	if (generation == cache_generation
+			&& (cache = config_cache_entry(driver, sdi, cg, TRUE))
+			&& !cache->caps) {
+		cache->caps = entry;
+		entry = NULL;
+	}
+	g_mutex_unlock(&cache_mutex);
+	g_free(entry);
+
+	return SR_OK;
+}
+
+/**
+ * Forget the cached config lists of a device instance.
+ *
+ * Must be called whenever the lists a device instance returns may have
+ * changed, e.g. after a config change or (re)opening the device.
+ *
+ * @param[in] sdi The device instance, or NULL to forget the cached
+ *                driver lists.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi)
+{
+	GHashTable *table;
+
+	g_mutex_lock(&cache_mutex);
+	cache_generation++;
+	table = sdi ? sdi->config_cache : driver_cache;
+	if (table)
+		g_hash_table_remove_all(table);
+	g_mutex_unlock(&cache_mutex);
+}
+
+/**
+ * Free the cached config lists of a device instance.
+ *
+ * @param[in] sdi The device instance, or NULL for the driver lists.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_cache_free(struct sr_dev_inst *sdi)
+{
+	GHashTable **table;
+
+	g_mutex_lock(&cache_mutex);
+	cache_generation++;
+	table = sdi ? &sdi->config_cache : &driver_cache;
+	if (*table)
+		g_hash_table_destroy(*table);
+	*table = NULL;
+	g_mutex_unlock(&cache_mutex);
+}
+
+static int check_key(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		uint32_t key, unsigned int op, GVariant *data)
+{
+	const struct sr_key_info *srci;
 	uint32_t pub_opt;
 	const char *suffix;
 	const char *opstr;
@@ -743,20 +1217,11 @@ static int check_key(const struct sr_dev_driver *driver,
 		break;
 	}
 
-	if (sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, &gvar_opts) != SR_OK) {
+	if (sr_config_caps_get(driver, sdi, cg, key, &pub_opt) != SR_OK) {
 		/* Driver publishes no options. */
 		sr_err("No options available%s.", suffix);
 		return SR_ERR_ARG;
 	}
-	opts = g_variant_get_fixed_array(gvar_opts, &num_opts, sizeof(uint32_t));
-	pub_opt = 0;
-	for (i = 0; i < num_opts; i++) {
-		if ((opts[i] & SR_CONF_MASK) == key) {
-			pub_opt = opts[i];
-			break;
-		}
-	}
-	g_variant_unref(gvar_opts);
 	if (!pub_opt) {
 		sr_err("Option '%s' not available%s.", srci->id, suffix);
 		return SR_ERR_ARG;
@@ -871,6 +1336,9 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 	else if ((ret = sr_variant_type_check(key, data)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_SET, data);
 		ret = sdi->driver->config_set(key, data, sdi, cg);
+		/* The published options may depend on the new value. */
+		if (ret == SR_OK)
+			sr_config_cache_invalidate(sdi);
 	}
 
 	g_variant_unref(data);
@@ -903,8 +1371,8 @@ SR_API int sr_config_commit(const struct sr_dev_inst *sdi)
 		sr_err("%s: Device instance not active, can't commit config.",
 			sdi->driver->name);
 		ret = SR_ERR_DEV_CLOSED;
-	} else
-		ret = sdi->driver->config_commit(sdi);
+	} else if ((ret = sdi->driver->config_commit(sdi)) == SR_OK)
+		sr_config_cache_invalidate(sdi);
 
 	return ret;
 }
@@ -929,6 +1397,9 @@ SR_API int sr_config_commit(const struct sr_dev_inst *sdi)
  *                unref the GVariant after use. However if this function
  *                returns an error code, the field should be considered
  *                unused, and should not be unreferenced.
+ *                Option lists and lists the driver declares static are
+ *                cached until the device configuration changes, so the
+ *                same GVariant may be returned by later calls.
  *
  * @retval SR_OK Success.
  * @retval SR_ERR Error.
@@ -943,6 +1414,8 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant **data)
 {
+	unsigned int generation;
+	gboolean cached;
 	int ret;
 
 	if (!driver || !data)
@@ -982,9 +1455,20 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		return SR_ERR_ARG;
 	}
 
+	generation = 0;
+	cached = config_list_static(driver, key);
+	if (cached && (*data = config_cache_lookup(driver, sdi, cg, key,
+			&generation))) {
+		log_key(sdi, cg, key, SR_CONF_LIST, *data);
+		return SR_OK;
+	}
+
 	if ((ret = driver->config_list(key, data, sdi, cg)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_LIST, *data);
 		g_variant_ref_sink(*data);
+		if (cached)
+			config_cache_store(driver, sdi, cg, key, *data,
+				generation);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -1016,6 +1500,81 @@ static struct sr_key_info *get_keytable(int keytype)
 	return table;
 }
 
+/*
+ * The key tables are sorted by key, so lookups by key are a binary
+ * search of the static tables. Lookups by id use a hash table that is
+ * built on first use and never torn down, since the ids cannot be put
+ * in order without breaking the key order.
+ */
+struct key_index {
+	const struct sr_key_info *table;
+	unsigned int count;
+	GHashTable *by_id;
+};
+
+static struct key_index key_indices[SR_KEY_MQFLAGS + 1];
+
+static void key_index_build(int keytype)
+{
+	struct key_index *index;
+	const struct sr_key_info *table;
+	unsigned int i;
+
+	index = &key_indices[keytype];
+	index->table = table = get_keytable(keytype);
+	index->by_id = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (i = 0; table[i].key; i++) {
+		if (i > 0 && table[i].key <= table[i - 1].key)
+			sr_err("Key table %d is not sorted at key %u.",
+				keytype, table[i].key);
+		if (table[i].id && !g_hash_table_contains(index->by_id, table[i].id))
+			g_hash_table_insert(index->by_id,
+				(gpointer)table[i].id, (gpointer)&table[i]);
+	}
+	index->count = i;
+}
+
+static const struct key_index *get_key_index(int keytype)
+{
+	static gsize built = 0;
+
+	if (g_once_init_enter(&built)) {
+		key_index_build(SR_KEY_CONFIG);
+		key_index_build(SR_KEY_MQ);
+		key_index_build(SR_KEY_MQFLAGS);
+		g_once_init_leave(&built, 1);
+	}
+
+	if (keytype < SR_KEY_CONFIG || keytype > SR_KEY_MQFLAGS) {
+		sr_err("Invalid keytype %d", keytype);
+		return NULL;
+	}
+
+	return &key_indices[keytype];
+}
+
+static int key_info_cmp(const void *a, const void *b)
+{
+	uint32_t key;
+	const struct sr_key_info *info;
+
+	key = *(const uint32_t *)a;
+	info = b;
+
+	if (key < info->key)
+		return -1;
+
+	return key > info->key;
+}
+
+static const struct sr_key_info *key_info_find(const struct key_index *index,
+		uint32_t key)
+{
+	return bsearch(&key, index->table, index->count,
+		sizeof(*index->table), key_info_cmp);
+}
+
 /**
  * Get information about a key, by key.
  *
@@ -1029,18 +1588,12 @@ static struct sr_key_info *get_keytable(int keytype)
  */
 SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key)
 {
-	struct sr_key_info *table;
-	int i;
+	const struct key_index *index;
 
-	if (!(table = get_keytable(keytype)))
+	if (!(index = get_key_index(keytype)))
 		return NULL;
 
-	for (i = 0; table[i].key; i++) {
-		if (table[i].key == key)
-			return &table[i];
-	}
-
-	return NULL;
+	return key_info_find(index, key);
 }
 
 /**
@@ -1056,20 +1609,59 @@ SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key)
  */
 SR_API const struct sr_key_info *sr_key_info_name_get(int keytype, const char *keyid)
 {
-	struct sr_key_info *table;
-	int i;
+	const struct key_index *index;
 
-	if (!(table = get_keytable(keytype)))
+	if (!keyid || !(index = get_key_index(keytype)))
 		return NULL;
 
-	for (i = 0; table[i].key; i++) {
-		if (!table[i].id)
-			continue;
-		if (!strcmp(table[i].id, keyid))
-			return &table[i];
-	}
+	return g_hash_table_lookup(index->by_id, keyid);
+}
 
-	return NULL;
+/**
+ * Get the position of a key in its key table.
+ *
+ * The position is dense (0 up to the number of keys in the table) and
+ * stable for the lifetime of the library, so it can be used to index
+ * per-key arrays.
+ *
+ * @param[in] keytype The namespace the key is in.
+ * @param[in] key The key to find.
+ *
+ * @return The position of the key, or -1 if the key was not found.
+ *
+ * @private
+ */
+SR_PRIV int sr_key_info_index(int keytype, uint32_t key)
+{
+	const struct key_index *index;
+	const struct sr_key_info *info;
+
+	if (!(index = get_key_index(keytype)))
+		return -1;
+
+	if (!(info = key_info_find(index, key)))
+		return -1;
+
+	return info - index->table;
+}
+
+/**
+ * Get the number of keys in a key table.
+ *
+ * @param[in] keytype The namespace.
+ *
+ * @return The number of keys, 0 for an invalid namespace.
+ *
+ * @private
+ */
+SR_PRIV unsigned int sr_key_info_count(int keytype)
+{
+	const struct key_index *index;
+
+	if (!(index = get_key_index(keytype)))
+		return 0;
+
+	return index->count;
 }
 
 /** @} */
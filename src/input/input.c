@@ -263,6 +263,9 @@ SR_API struct sr_input *sr_input_new(const struct sr_input_module *imod,
 	gpointer key, value;
 	int i;
 
+	if (sr_input_module_sanity_check(imod) != SR_OK)
+		return NULL;
+
 	in = g_malloc0(sizeof(struct sr_input));
 	in->module = imod;
 
@@ -1827,7 +1827,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 				ret = SR_ERR_DATA;
 				break;
 			}
-			if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
+			if (sr_log_enabled(SR_LOG_SPEW)) {
 				bits_val_text = sr_hexdump_new(inc->conv_bits.value,
 					value_ptr - inc->conv_bits.value + 1);
 				sr_spew("Vector value: %s.", bits_val_text->str);
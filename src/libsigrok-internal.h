@@ -1066,11 +1066,19 @@ static inline void write_dblle_inc(uint8_t **p, double x)
 	SR_REGISTER_DEV_DRIVER_LIST(name##_list, &name);
 
 SR_API void sr_drivers_init(struct sr_context *context);
+SR_PRIV void sr_drivers_exit(struct sr_context *context);
+SR_PRIV int sr_driver_init_lazy(struct sr_dev_driver *driver);
 
 struct sr_context {
 	struct sr_dev_driver **driver_list;
 #ifdef HAVE_LIBUSB_1_0
 	libusb_context *libusb_ctx;
+	/* libusb event thread for devices in device threads, see usb.c. */
+	GRecMutex usb_mutex;
+	GMutex usb_thread_mutex;
+	GThread *usb_thread;
+	gboolean usb_thread_running;
+	unsigned int usb_thread_users;
 #endif
 	sr_resource_open_callback resource_open_cb;
 	sr_resource_close_callback resource_close_cb;
@@ -1259,6 +1267,9 @@ struct sr_output {
 	 * there, and only flush it when it reaches a certain size.
 	 */
 	void *priv;
+
+	/** Output not yet written by sr_output_send_fd(), or NULL. */
+	GString *fd_buf;
 };
 
 /** Output module driver. */
@@ -1341,6 +1352,23 @@ struct sr_output_module {
 	int (*receive) (const struct sr_output *o,
 			const struct sr_datafeed_packet *packet, GString **out);
 
+	/**
+	 * Like receive(), but appends the output to <code>out</code>, a
+	 * buffer provided and reused by the caller. This saves the per
+	 * packet allocation of receive(). A module implements either of
+	 * them, the core adapts the other API to it.
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param out The buffer to append the output to. Must not be
+	 * truncated by the module.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_sink) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet, GString *out);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the output module, and can be used to free any internal
@@ -1368,6 +1396,31 @@ struct sr_transform {
 	 * state between calls into its callback functions.
 	 */
 	void *priv;
+
+	/**
+	 * The device as seen downstream, for modules which change the
+	 * channel layout of logic packets, or NULL. Set by init(), and
+	 * updated when the module receives SR_DF_HEADER.
+	 */
+	struct sr_dev_inst *sdi_out;
+};
+
+/**
+ * What a transform does to a packet, as an element-wise operation.
+ * Adjacent kernels are fused into a single pass over the packet data.
+ *
+ * @see sr_transform_module.kernel()
+ */
+struct sr_transform_kernel {
+	/**
+	 * Logic packets: every sample becomes (sample & and_mask) ^ xor_mask.
+	 * Both masks are one sample wide. NULL stands for all ones and all
+	 * zeros, respectively.
+	 */
+	const uint8_t *and_mask;
+	const uint8_t *xor_mask;
+	/** Analog packets: the encoding's scale is multiplied by this. */
+	struct sr_rational scale;
 };
 
 struct sr_transform_module {
@@ -1428,6 +1481,24 @@ struct sr_transform_module {
 			struct sr_datafeed_packet *packet_in,
 			struct sr_datafeed_packet **packet_out);
 
+	/**
+	 * Optional. Describe what receive() would do to a logic or analog
+	 * packet as an element-wise kernel. Runs of adjacent transforms with
+	 * kernels are then applied in a single pass, without calling their
+	 * receive(). Must not modify the packet.
+	 *
+	 * @param t Pointer to the respective 'struct sr_transform'.
+	 * @param packet The packet receive() would be passed.
+	 * @param kernel The kernel to fill in. Initialized to the identity.
+	 *
+	 * @retval SR_OK Success
+	 * @retval SR_ERR_NA The packet needs receive().
+	 * @retval other Negative error code.
+	 */
+	int (*kernel) (const struct sr_transform *t,
+			const struct sr_datafeed_packet *packet,
+			struct sr_transform_kernel *kernel);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the transform module, and can be used to free any internal
@@ -1439,6 +1510,20 @@ struct sr_transform_module {
 	int (*cleanup) (struct sr_transform *t);
 };
 
+/** Scratch space of sr_transform_fuse_run(). Zero-initialized. */
+struct sr_transform_fuse {
+	/** Sample size of the buffers below. */
+	size_t unitsize;
+	/** Kernels' logic masks, composed, one sample wide. */
+	uint8_t *and_mask;
+	uint8_t *xor_mask;
+	/** The composed masks, repeated for a block of samples. */
+	uint8_t *and_block;
+	uint8_t *xor_block;
+	/** Sample size the blocks were built for, 0 if none. */
+	size_t block_unitsize;
+};
+
 #ifdef HAVE_LIBUSB_1_0
 /** USB device instance */
 struct sr_usb_dev_inst {
@@ -1527,6 +1612,28 @@ struct drv_context {
 	GSList *instances;
 };
 
+/*--- backend.c -------------------------------------------------------------*/
+
+SR_PRIV int sr_driver_sanity_check(const struct sr_dev_driver *driver);
+SR_PRIV int sr_input_module_sanity_check(const struct sr_input_module *mod);
+SR_PRIV int sr_output_module_sanity_check(const struct sr_output_module *mod);
+SR_PRIV int sr_transform_module_sanity_check(const struct sr_transform_module *mod);
+
+/*--- output/output.c -------------------------------------------------------*/
+
+SR_PRIV void sr_output_logic_transpose(const uint8_t *samples,
+		unsigned int unitsize, const int *channel_index,
+		unsigned int num_channels, uint8_t *bits);
+
+/*--- transform/transform.c -------------------------------------------------*/
+
+SR_PRIV int sr_transform_fuse_run(struct sr_transform_fuse *fuse,
+		GSList *transforms, struct sr_datafeed_packet *packet,
+		unsigned int *count);
+SR_PRIV void sr_transform_fuse_clear(struct sr_transform_fuse *fuse);
+SR_PRIV const struct sr_dev_inst *sr_transform_dev_inst_get(GSList *transforms,
+		const struct sr_dev_inst *sdi);
+
 /*--- log.c -----------------------------------------------------------------*/
 
 #if defined(_WIN32) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 4))
@@ -1540,12 +1647,37 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 SR_PRIV int sr_log(int loglevel, const char *format, ...) G_GNUC_PRINTF(2, 3);
 #endif
 
-/* Message logging helpers with subsystem-specific prefix string. */
-#define sr_spew(...)	sr_log(SR_LOG_SPEW, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_dbg(...)	sr_log(SR_LOG_DBG,  LOG_PREFIX ": " __VA_ARGS__)
-#define sr_info(...)	sr_log(SR_LOG_INFO, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_warn(...)	sr_log(SR_LOG_WARN, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_err(...)	sr_log(SR_LOG_ERR,  LOG_PREFIX ": " __VA_ARGS__)
+extern SR_PRIV int sr_log_cur_level;
+
+/*
+ * Most verbose loglevel compiled in, see the --with-max-loglevel
+ * configure option. Messages above it are removed by the compiler.
+ */
+#ifndef SR_LOG_MAX_LEVEL
+#define SR_LOG_MAX_LEVEL SR_LOG_SPEW
+#endif
+
+/*
+ * Whether messages of the given loglevel are shown. Use this to guard
+ * expensive debug output (hex dumps, packet dumps) as well.
+ */
+#define sr_log_enabled(loglevel) \
+	((loglevel) <= SR_LOG_MAX_LEVEL && (loglevel) <= sr_log_cur_level)
+
+/*
+ * Message logging helpers with subsystem-specific prefix string. The
+ * level is checked before the arguments are evaluated, so disabled
+ * messages cost a load and a compare (or nothing, when compiled out).
+ */
+#define sr_log_gated(loglevel, ...) do { \
+	if (G_UNLIKELY(sr_log_enabled(loglevel))) \
+		sr_log(loglevel, LOG_PREFIX ": " __VA_ARGS__); \
+} while (0)
+#define sr_spew(...)	sr_log_gated(SR_LOG_SPEW, __VA_ARGS__)
+#define sr_dbg(...)	sr_log_gated(SR_LOG_DBG,  __VA_ARGS__)
+#define sr_info(...)	sr_log_gated(SR_LOG_INFO, __VA_ARGS__)
+#define sr_warn(...)	sr_log_gated(SR_LOG_WARN, __VA_ARGS__)
+#define sr_err(...)	sr_log_gated(SR_LOG_ERR,  __VA_ARGS__)
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -1601,6 +1733,8 @@ struct sr_dev_inst {
 	void *priv;
 	/** Session to which this device is currently assigned. */
 	struct sr_session *session;
+	/** Cached config lists, per channel group (see hwdriver.c). */
+	GHashTable *config_cache;
 };
 
 /* Generic device instances */
@@ -1655,6 +1789,13 @@ SR_PRIV int sr_variant_type_check(uint32_t key, GVariant *data);
 SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx);
 SR_PRIV struct sr_config *sr_config_new(uint32_t key, GVariant *data);
 SR_PRIV void sr_config_free(struct sr_config *src);
+SR_PRIV int sr_config_caps_get(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		uint32_t key, uint32_t *caps);
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi);
+SR_PRIV void sr_config_cache_free(struct sr_dev_inst *sdi);
+SR_PRIV int sr_key_info_index(int keytype, uint32_t key);
+SR_PRIV unsigned int sr_key_info_count(int keytype);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
 
@@ -1670,6 +1811,8 @@ struct sr_session {
 	/** List of struct datafeed_callback pointers. */
 	GSList *datafeed_callbacks;
 	GSList *transforms;
+	/** Scratch space for running transforms fused. */
+	struct sr_transform_fuse transform_fuse;
 	struct sr_trigger *trigger;
 
 	/** Callback to invoke on session stop. */
@@ -1682,6 +1825,8 @@ struct sr_session {
 	/** Context of the session main loop. */
 	GMainContext *main_context;
 
+	/** Mutex protecting event_sources and stop_check_id. */
+	GMutex sources_mutex;
 	/** Registered event sources for this session. */
 	GHashTable *event_sources;
 	/** Session main loop. */
@@ -1690,6 +1835,16 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Performance counters, NULL unless enabled. */
+	struct session_stats *stats;
+	/** Queue of packets sent via sr_session_send_async(). */
+	struct session_async *async;
+	/** Event source multiplexing fd sources via epoll, or NULL. */
+	GSource *fd_set;
+	/** Device thread group per struct sr_dev_inst, plus one; or NULL. */
+	GHashTable *dev_threads;
+	/** Device threads of a running session. */
+	GSList *workers;
 };
 
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
@@ -1701,6 +1856,11 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 SR_PRIV int sr_session_fd_source_add(struct sr_session *session,
 		void *key, gintptr fd, int events, int timeout,
 		sr_receive_data_callback cb, void *cb_data);
+SR_PRIV gboolean sr_session_dev_threaded(const struct sr_session *session,
+		const struct sr_dev_inst *sdi);
+SR_PRIV int sr_session_dev_source_add(struct sr_session *session,
+		const struct sr_dev_inst *sdi, void *key, GSource *source);
+SR_PRIV void sr_session_async_thread_set(gboolean async);
 
 SR_PRIV int sr_session_source_add(struct sr_session *session, int fd,
 		int events, int timeout, sr_receive_data_callback cb, void *cb_data);
@@ -1735,6 +1895,13 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/*--- envelope.c ------------------------------------------------------------*/
+
+SR_PRIV uint8_t *sr_envelope_save(struct sr_envelope *env,
+		const char *channel, size_t *size);
+SR_PRIV int sr_envelope_restore(struct sr_envelope *env, const char *channel,
+		const uint8_t *buf, size_t size);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -2051,12 +2218,75 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn);
 SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
-SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
-		int timeout, sr_receive_data_callback cb, void *cb_data);
-SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
+SR_PRIV int usb_source_add(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int timeout, sr_receive_data_callback cb,
+		void *cb_data);
+SR_PRIV int usb_source_remove(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx);
+SR_PRIV void usb_events_init(struct sr_context *ctx);
+SR_PRIV void usb_events_exit(struct sr_context *ctx);
+SR_PRIV void usb_events_lock(struct sr_context *ctx);
+SR_PRIV void usb_events_unlock(struct sr_context *ctx);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
 SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		const char *manufacturer, const char *product);
+
+/** Parameters of a bulk IN transfer ring, see sr_usb_stream_new(). */
+struct sr_usb_stream_config {
+	/** Endpoint address, including LIBUSB_ENDPOINT_IN. */
+	unsigned char endpoint;
+	/** Expected data rate in bytes per second, used for sizing. */
+	uint64_t bytes_per_sec;
+	/** Amount of data per transfer in ms, 0 for the default (10 ms). */
+	unsigned int transfer_ms;
+	/** Amount of data in all transfers in ms, 0 for the default (500 ms). */
+	unsigned int ring_ms;
+	/** Maximum number of transfers, 0 for the default (32). */
+	unsigned int max_transfers;
+	/** Transfer size granularity in bytes, 0 for the default (512). */
+	size_t size_align;
+	/** Give up after this many consecutive empty transfers, 0: never. */
+	unsigned int max_empty;
+	/** Try to use libusb_dev_mem_alloc() for the transfer buffers. */
+	gboolean zero_copy;
+};
+
+/** Counters of a USB stream run. */
+struct sr_usb_stream_stats {
+	/** Transfers which returned data. */
+	uint64_t transfers;
+	/** Total amount of data received. */
+	uint64_t bytes;
+	/** Transfers which returned without data, or with an error. */
+	uint64_t empty;
+	/** Transfers which returned an error. */
+	uint64_t errors;
+	/** Transfers which returned LIBUSB_TRANSFER_OVERFLOW. */
+	uint64_t overruns;
+	/** Transfers whose data took longer to process than to acquire. */
+	uint64_t late_resubmits;
+};
+
+struct sr_usb_stream;
+
+typedef gboolean (*sr_usb_stream_data_callback)(void *cb_data,
+		uint8_t *data, size_t length);
+typedef void (*sr_usb_stream_done_callback)(void *cb_data);
+
+SR_PRIV struct sr_usb_stream *sr_usb_stream_new(
+		struct libusb_device_handle *devhdl,
+		const struct sr_usb_stream_config *config,
+		sr_usb_stream_data_callback data_cb,
+		sr_usb_stream_done_callback done_cb, void *cb_data);
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *stream);
+SR_PRIV int sr_usb_stream_start(struct sr_usb_stream *stream);
+SR_PRIV void sr_usb_stream_abort(struct sr_usb_stream *stream);
+SR_PRIV const struct sr_usb_stream_config *sr_usb_stream_config_get(
+		const struct sr_usb_stream *stream);
+SR_PRIV unsigned int sr_usb_stream_timeout(const struct sr_usb_stream *stream);
+SR_PRIV size_t sr_usb_stream_buffer_size(const struct sr_usb_stream *stream);
+SR_PRIV const struct sr_usb_stream_stats *sr_usb_stream_stats_get(
+		const struct sr_usb_stream *stream);
 #endif
 
 /*--- binary_helpers.c ------------------------------------------------------*/
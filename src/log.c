@@ -42,8 +42,12 @@
  * @{
  */
 
-/* Currently selected libsigrok loglevel. Default: SR_LOG_WARN. */
-static int cur_loglevel = SR_LOG_WARN; /* Show errors+warnings per default. */
+/*
+ * Currently selected libsigrok loglevel. Default: SR_LOG_WARN.
+ * Not static: the sr_log_enabled() test of the message logging macros
+ * reads it inline, before any arguments get evaluated.
+ */
+SR_PRIV int sr_log_cur_level = SR_LOG_WARN; /* Show errors+warnings per default. */
 
 /* Function prototype. */
 static int sr_logv(void *cb_data, int loglevel, const char *format,
@@ -90,7 +94,7 @@ SR_API int sr_log_loglevel_set(int loglevel)
 	if (loglevel >= LOGLEVEL_TIMESTAMP && sr_log_start_time == 0)
 		sr_log_start_time = g_get_monotonic_time();
 
-	cur_loglevel = loglevel;
+	sr_log_cur_level = loglevel;
 
 	sr_dbg("libsigrok loglevel set to %d.", loglevel);
 
@@ -106,7 +110,7 @@ SR_API int sr_log_loglevel_set(int loglevel)
  */
 SR_API int sr_log_loglevel_get(void)
 {
-	return cur_loglevel;
+	return sr_log_cur_level;
 }
 
 /**
@@ -194,7 +198,7 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 
 	(void)loglevel;
 
-	if (cur_loglevel >= LOGLEVEL_TIMESTAMP) {
+	if (sr_log_cur_level >= LOGLEVEL_TIMESTAMP) {
 		elapsed_us = g_get_monotonic_time() - sr_log_start_time;
 
 		minutes = elapsed_us / G_TIME_SPAN_MINUTE;
@@ -238,7 +242,7 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 	va_list args;
 
 	/* Only output messages of at least the selected loglevel(s). */
-	if (loglevel > cur_loglevel)
+	if (loglevel > sr_log_cur_level)
 		return SR_OK;
 
 	va_start(args, format);
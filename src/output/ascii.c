@@ -51,8 +51,32 @@ struct context {
 	GString **lines;
 	const char *charset;
 	gboolean edges;
+	uint8_t *bits;
+	/*
+	 * Text of a byte's worth of samples, first sample first. Indexed
+	 * by the samples' bits, plus 256 if the previous sample was high.
+	 */
+	char (*byte_text)[8];
 };
 
+static void byte_text_init(struct context *ctx)
+{
+	unsigned int i, k, curbit, prevbit, charidx;
+
+	ctx->byte_text = g_malloc(512 * sizeof(ctx->byte_text[0]));
+	for (i = 0; i < 512; i++) {
+		prevbit = i >> 8;
+		for (k = 0; k < 8; k++) {
+			curbit = (i >> (7 - k)) & 1;
+			charidx = curbit;
+			if (ctx->edges && curbit != prevbit)
+				charidx += 2;
+			ctx->byte_text[i][k] = ctx->charset[charidx];
+			prevbit = curbit;
+		}
+	}
+}
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
@@ -74,6 +98,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->charset = g_strdup(DEFAULT_ASCII_CHARS);
 	}
 	ctx->edges = (strlen(ctx->charset) >= 4) ? TRUE : FALSE;
+	byte_text_init(ctx);
 
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -87,6 +112,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->aligned_names = g_malloc0(sizeof(ctx->aligned_names[0]) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc0(sizeof(ctx->lines[0]) * ctx->num_enabled_channels);
 	ctx->prev_sample = g_malloc0(g_slist_length(o->sdi->channels));
+	ctx->bits = g_malloc0(ctx->num_enabled_channels);
 
 	/* Get the maximum length across all active logic channels. */
 	max_namelen = 0;
@@ -121,11 +147,10 @@ static int init(struct sr_output *o, GHashTable *options)
 	return SR_OK;
 }
 
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *header)
 {
 	struct context *ctx;
 	GVariant *gvar;
-	GString *header;
 	size_t num_channels;
 	char *samplerate_s;
 
@@ -138,8 +163,7 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 
-	header = g_string_sized_new(512);
-	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
+	g_string_append_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
 	num_channels = g_slist_length(o->sdi->channels);
 	g_string_append_printf(header, "Acquisition with %zu/%zu channels",
 			ctx->num_enabled_channels, num_channels);
@@ -149,8 +173,6 @@ static GString *gen_header(const struct sr_output *o)
 		g_free(samplerate_s);
 	}
 	g_string_append_printf(header, "\n");
-
-	return header;
 }
 
 static void maybe_add_trigger(struct context *ctx, GString *out)
@@ -172,8 +194,22 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 		offset + 1, "^", offset);
 }
 
+static void flush_lines(struct context *ctx, GString *out)
+{
+	size_t j;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		g_string_append_c(out, '\n');
+		g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
+	}
+	if (ctx->num_enabled_channels)
+		maybe_add_trigger(ctx, out);
+	ctx->spl_cnt = 0;
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+		GString *out)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
@@ -188,7 +224,6 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	char c;
 	size_t charidx;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -209,16 +244,41 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			gen_header(o, out);
 			ctx->header_done = TRUE;
-		} else {
-			*out = g_string_sized_new(512);
 		}
 
 		logic = packet->payload;
 		num_samples = logic->length / logic->unitsize;
 		curr_sample = logic->data;
-		while (num_samples--) {
+		while (num_samples > 0) {
+			if ((ctx->spl_cnt & 7) == 0 && num_samples >= 8
+					&& ctx->spl_cnt + 8 <= ctx->spl) {
+				/* A byte's worth of samples, straight from the table. */
+				sr_output_logic_transpose(curr_sample, logic->unitsize,
+					ctx->channel_index, ctx->num_enabled_channels,
+					ctx->bits);
+				for (j = 0; j < ctx->num_enabled_channels; j++) {
+					idx = ctx->channel_index[j];
+					/* No edge at the start of a line. */
+					if (ctx->spl_cnt == 0)
+						prevbit = ctx->bits[j] >> 7;
+					else
+						prevbit = (ctx->prev_sample[idx / 8] >> (idx % 8)) & 1;
+					g_string_append_len(ctx->lines[j],
+						ctx->byte_text[(prevbit << 8) | ctx->bits[j]], 8);
+				}
+				ctx->spl_cnt += 8;
+				if (ctx->spl_cnt == ctx->spl)
+					flush_lines(ctx, out);
+				curr_sample += 7 * logic->unitsize;
+				memcpy(ctx->prev_sample, curr_sample, logic->unitsize);
+				curr_sample += logic->unitsize;
+				num_samples -= 8;
+				continue;
+			}
+
+			/* Line or packet boundary within a byte, one by one. */
 			ctx->spl_cnt++;
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
 				idx = ctx->channel_index[j];
@@ -234,32 +294,22 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 				}
 				c = ctx->charset[charidx];
 				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j + 1 == ctx->num_enabled_channels)
-						maybe_add_trigger(ctx, *out);
-					g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
-				}
 			}
 			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
-				ctx->spl_cnt = 0;
+				flush_lines(ctx, out);
 			memcpy(ctx->prev_sample, curr_sample, logic->unitsize);
 			curr_sample += logic->unitsize;
+			num_samples--;
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
-			maybe_add_trigger(ctx, *out);
+			maybe_add_trigger(ctx, out);
 		}
 		break;
 	}
@@ -280,6 +330,8 @@ static int cleanup(struct sr_output *o)
 
 	g_free(ctx->channel_index);
 	g_free(ctx->prev_sample);
+	g_free(ctx->bits);
+	g_free(ctx->byte_text);
 	for (i = 0; i < ctx->num_enabled_channels; i++) {
 		g_free(ctx->aligned_names[i]);
 		g_string_free(ctx->lines[i], TRUE);
@@ -319,6 +371,6 @@ SR_PRIV struct sr_output_module output_ascii = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive,
 	.cleanup = cleanup,
 };
@@ -38,8 +38,27 @@ struct context {
 	char **channel_names;
 	gboolean header_done;
 	GString **lines;
+	uint8_t *bits;
 };
 
+/* Text of a byte's worth of samples, first sample first, and a separator. */
+static char byte_text[256][9];
+
+static void byte_text_init(void)
+{
+	static gsize initialized;
+	unsigned int i, k;
+
+	if (!g_once_init_enter(&initialized))
+		return;
+	for (i = 0; i < 256; i++) {
+		for (k = 0; k < 8; k++)
+			byte_text[i][k] = (i & (0x80 >> k)) ? '1' : '0';
+		byte_text[i][8] = ' ';
+	}
+	g_once_init_leave(&initialized, 1);
+}
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
@@ -50,6 +69,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 
+	byte_text_init();
+
 	ctx = g_malloc0(sizeof(struct context));
 	o->priv = ctx;
 	ctx->trigger = -1;
@@ -66,6 +87,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
+	ctx->bits = g_malloc(ctx->num_enabled_channels);
 
 	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
@@ -84,11 +106,10 @@ static int init(struct sr_output *o, GHashTable *options)
 	return SR_OK;
 }
 
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *header)
 {
 	struct context *ctx;
 	GVariant *gvar;
-	GString *header;
 	int num_channels;
 	char *samplerate_s;
 
@@ -101,8 +122,7 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 
-	header = g_string_sized_new(512);
-	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
+	g_string_append_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
 	num_channels = g_slist_length(o->sdi->channels);
 	g_string_append_printf(header, "Acquisition with %d/%d channels",
 			ctx->num_enabled_channels, num_channels);
@@ -112,23 +132,45 @@ static GString *gen_header(const struct sr_output *o)
 		g_free(samplerate_s);
 	}
 	g_string_append_printf(header, "\n");
+}
 
-	return header;
+static void flush_lines(struct context *ctx, GString *out)
+{
+	unsigned int j;
+	int offset;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		g_string_append_c(out, '\n');
+		g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
+	}
+	if (ctx->num_enabled_channels && ctx->trigger > -1) {
+		/*
+		 * Sample data lines have one character per bit,
+		 * plus one separator per byte. Align trigger marker
+		 * to this layout.
+		 */
+		offset = ctx->trigger + ctx->trigger / 8;
+		g_string_append_printf(out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+		ctx->trigger = -1;
+	}
+	ctx->spl_cnt = 0;
 }
 
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+		GString *out)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	struct context *ctx;
 	GSList *l;
-	int idx, offset;
+	const uint8_t *sample;
+	uint64_t num_samples;
+	int idx, len;
 	uint64_t i, j;
-	gchar *p, c;
+	gchar c;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -149,52 +191,55 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			gen_header(o, out);
 			ctx->header_done = TRUE;
-		} else
-			*out = g_string_sized_new(512);
+		}
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
+		num_samples = logic->length / logic->unitsize;
+		sample = logic->data;
+		while (num_samples > 0) {
+			if ((ctx->spl_cnt & 7) == 0 && num_samples >= 8
+					&& ctx->spl_cnt + 8 <= ctx->spl) {
+				/* A byte's worth of samples, straight from the table. */
+				sr_output_logic_transpose(sample, logic->unitsize,
+					ctx->channel_index, ctx->num_enabled_channels,
+					ctx->bits);
+				ctx->spl_cnt += 8;
+				/* Separator unless the line ends here. */
+				len = (ctx->spl_cnt == ctx->spl) ? 8 : 9;
+				for (j = 0; j < ctx->num_enabled_channels; j++)
+					g_string_append_len(ctx->lines[j],
+						byte_text[ctx->bits[j]], len);
+				if (ctx->spl_cnt == ctx->spl)
+					flush_lines(ctx, out);
+				sample += 8 * logic->unitsize;
+				num_samples -= 8;
+				continue;
+			}
+
+			/* Line or packet boundary within a byte, one by one. */
 			ctx->spl_cnt++;
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
 				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				c = (*p & (1 << (idx % 8))) ? '1' : '0';
+				c = (sample[idx / 8] & (1 << (idx % 8))) ? '1' : '0';
 				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per bit,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				} else if ((ctx->spl_cnt & 7) == 0) {
-					/* Add a space every 8th bit. */
+				/* Add a space every 8th bit. */
+				if (ctx->spl_cnt != ctx->spl && (ctx->spl_cnt & 7) == 0)
 					g_string_append_c(ctx->lines[j], ' ');
-				}
 			}
 			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
-				ctx->spl_cnt = 0;
+				flush_lines(ctx, out);
+			sample += logic->unitsize;
+			num_samples--;
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
 		}
 		break;
@@ -216,6 +261,7 @@ static int cleanup(struct sr_output *o)
 
 	g_free(ctx->channel_index);
 	g_free(ctx->channel_names);
+	g_free(ctx->bits);
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
 	g_free(ctx->lines);
@@ -248,6 +294,6 @@ SR_PRIV struct sr_output_module output_bits = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive,
 	.cleanup = cleanup,
 };
@@ -18,12 +18,17 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <string.h>
+#include <unistd.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "output"
+
+/* sr_output_send_fd() writes in chunks of at least this size. */
+#define FD_FLUSH_SIZE (64 * 1024)
 /** @endcond */
 
 /**
@@ -271,10 +276,14 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	gpointer key, value;
 	int i;
 
+	if (sr_output_module_sanity_check(omod) != SR_OK)
+		return NULL;
+
 	op = g_malloc(sizeof(struct sr_output));
 	op->module = omod;
 	op->sdi = sdi;
 	op->filename = g_strdup(filename);
+	op->fd_buf = NULL;
 
 	new_opts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
 			(GDestroyNotify)g_variant_unref);
@@ -336,7 +345,225 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	GString *s;
+	int ret;
+
+	if (o->module->receive)
+		return o->module->receive(o, packet, out);
+
+	s = g_string_new(NULL);
+	ret = o->module->receive_sink(o, packet, s);
+	if (ret != SR_OK || s->len == 0) {
+		g_string_free(s, TRUE);
+		s = NULL;
+	}
+	*out = s;
+
+	return ret;
+}
+
+/**
+ * Send a packet to the specified output instance, appending its output
+ * to a caller-provided buffer.
+ *
+ * Unlike sr_output_send(), this needs no allocation per packet when
+ * the buffer is reused, e.g. after truncating it to the output written
+ * out so far.
+ *
+ * @param o The output instance. Must not be NULL.
+ * @param packet The packet to process. Must not be NULL.
+ * @param out The buffer to append the output to. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error code of the output module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
+{
+	GString *s;
+	int ret;
+
+	if (!o || !packet || !out)
+		return SR_ERR_ARG;
+
+	if (o->module->receive_sink)
+		return o->module->receive_sink(o, packet, out);
+
+	s = NULL;
+	ret = o->module->receive(o, packet, &s);
+	if (s) {
+		g_string_append_len(out, s->str, s->len);
+		g_string_free(s, TRUE);
+	}
+
+	return ret;
+}
+
+static int fd_write(int fd, const char *buf, size_t len)
+{
+	ssize_t written;
+
+	while (len > 0) {
+		written = write(fd, buf, len);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			sr_err("Failed to write output: %s.", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		buf += written;
+		len -= written;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Send a packet to the specified output instance, writing its output to
+ * a file descriptor.
+ *
+ * Output is buffered in the instance and written in large chunks. The
+ * buffer is flushed when the SR_DF_END packet is sent, or explicitly by
+ * sr_output_flush_fd().
+ *
+ * @param o The output instance. Must not be NULL.
+ * @param packet The packet to process. Must not be NULL.
+ * @param fd The file descriptor to write to. Must be the same for all
+ *           packets of the instance.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Writing failed.
+ * @retval other Error code of the output module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_fd(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, int fd)
+{
+	struct sr_output *op;
+	GString *s;
+	int ret;
+
+	if (!o || !packet || fd < 0)
+		return SR_ERR_ARG;
+
+	op = (struct sr_output *)o;
+	if (!op->fd_buf)
+		op->fd_buf = g_string_sized_new(FD_FLUSH_SIZE);
+
+	if (o->module->receive_sink) {
+		ret = o->module->receive_sink(o, packet, op->fd_buf);
+	} else {
+		s = NULL;
+		ret = o->module->receive(o, packet, &s);
+		if (s && s->len >= FD_FLUSH_SIZE) {
+			/* Large enough to be written as is, without a copy. */
+			if (ret == SR_OK)
+				ret = sr_output_flush_fd(o, fd);
+			if (ret == SR_OK)
+				ret = fd_write(fd, s->str, s->len);
+		} else if (s) {
+			g_string_append_len(op->fd_buf, s->str, s->len);
+		}
+		if (s)
+			g_string_free(s, TRUE);
+	}
+	if (ret != SR_OK)
+		return ret;
+
+	if (op->fd_buf->len >= FD_FLUSH_SIZE || packet->type == SR_DF_END)
+		return sr_output_flush_fd(o, fd);
+
+	return SR_OK;
+}
+
+/**
+ * Write output buffered by sr_output_send_fd() to a file descriptor.
+ *
+ * @param o The output instance. Must not be NULL.
+ * @param fd The file descriptor to write to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Writing failed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_flush_fd(const struct sr_output *o, int fd)
+{
+	GString *buf;
+	int ret;
+
+	if (!o || fd < 0)
+		return SR_ERR_ARG;
+
+	if (!(buf = o->fd_buf) || buf->len == 0)
+		return SR_OK;
+
+	ret = fd_write(fd, buf->str, buf->len);
+	g_string_truncate(buf, 0);
+
+	return ret;
+}
+
+/* Transpose an 8x8 bit matrix, packed into a 64-bit word. */
+static uint64_t transpose8(uint64_t x)
+{
+	x = (x & 0xaa55aa55aa55aa55ULL)
+		| ((x & 0x00aa00aa00aa00aaULL) << 7)
+		| ((x >> 7) & 0x00aa00aa00aa00aaULL);
+	x = (x & 0xcccc3333cccc3333ULL)
+		| ((x & 0x0000cccc0000ccccULL) << 14)
+		| ((x >> 14) & 0x0000cccc0000ccccULL);
+	x = (x & 0xf0f0f0f00f0f0f0fULL)
+		| ((x & 0x00000000f0f0f0f0ULL) << 28)
+		| ((x >> 28) & 0x00000000f0f0f0f0ULL);
+
+	return x;
+}
+
+/**
+ * Gather the bits of 8 consecutive logic samples per channel.
+ *
+ * This transposes the samples' bytes, one 8x8 bit matrix at a time,
+ * instead of testing each channel's bit in each sample. A byte lane is
+ * transposed once for consecutive channels within it, so sorted channel
+ * indices are the fastest.
+ *
+ * @param samples The 8 samples.
+ * @param unitsize Size of a sample, in bytes.
+ * @param channel_index Indices of the channels to gather.
+ * @param num_channels Number of channels to gather.
+ * @param bits One byte per channel, receiving the channel's bits with
+ *             the first sample in the most significant bit.
+ *
+ * @private
+ */
+SR_PRIV void sr_output_logic_transpose(const uint8_t *samples,
+		unsigned int unitsize, const int *channel_index,
+		unsigned int num_channels, uint8_t *bits)
+{
+	uint64_t x;
+	unsigned int i, k;
+	int lane, idx;
+
+	x = 0;
+	lane = -1;
+	for (i = 0; i < num_channels; i++) {
+		idx = channel_index[i];
+		if (idx / 8 != lane) {
+			lane = idx / 8;
+			x = 0;
+			for (k = 0; k < 8; k++)
+				x |= (uint64_t)samples[k * unitsize + lane] << (8 * (7 - k));
+			x = transpose8(x);
+		}
+		bits[i] = x >> (8 * (idx % 8));
+	}
 }
 
 /**
@@ -354,6 +581,8 @@ SR_API int sr_output_free(const struct sr_output *o)
 	ret = SR_OK;
 	if (o->module->cleanup)
 		ret = o->module->cleanup((struct sr_output *)o);
+	if (o->fd_buf)
+		g_string_free(o->fd_buf, TRUE);
 	g_free((char *)o->filename);
 	g_free((gpointer)o);
 
@@ -48,14 +48,14 @@ struct out_context {
 		float *samples;
 		size_t fill_size;
 	} *analog_buff;
+	/* Overview of the data, stored along with it. NULL if disabled. */
+	struct sr_envelope *envelope;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
 
-	(void)options;
-
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
@@ -63,6 +63,8 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	if (g_variant_get_boolean(g_hash_table_lookup(options, "envelope")))
+		sr_envelope_new(&outc->envelope, 0);
 	o->priv = outc;
 
 	return SR_OK;
@@ -632,6 +634,90 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	return SR_OK;
 }
 
+/* Add or replace an archive member, the archive references the data. */
+static int zip_put(struct zip *archive, const char *name,
+	const void *data, size_t size)
+{
+	struct zip_source *src;
+	int64_t index;
+	int ret;
+
+	src = zip_source_buffer(archive, data, size, FALSE);
+	index = zip_name_locate(archive, name, 0);
+	if (index >= 0)
+		ret = zip_replace(archive, index, src);
+	else
+		ret = zip_add(archive, name, src) < 0 ? -1 : 0;
+	if (ret < 0) {
+		sr_err("Failed to add '%s': %s", name, zip_strerror(archive));
+		zip_source_free(src);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Store the envelope of the data written so far in an srzip archive.
+ *
+ * Logic data goes to "envelope-logic-1", analog channels to
+ * "envelope-analog-1-<nr>", numbered like their "analog-1-<nr>" chunks.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_append_envelope(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct zip *archive;
+	const struct sr_channel *ch;
+	GSList *bufs, *l;
+	uint8_t *buf;
+	size_t idx, size;
+	char *name;
+	int ret;
+
+	outc = o->priv;
+	if (!(archive = zip_open(outc->filename, 0, NULL)))
+		return SR_ERR;
+
+	/* The buffers must stay around until the archive is written. */
+	bufs = NULL;
+	ret = SR_OK;
+	if ((buf = sr_envelope_save(outc->envelope, NULL, &size))) {
+		bufs = g_slist_prepend(bufs, buf);
+		ret = zip_put(archive, "envelope-logic-1", buf, size);
+	}
+	for (idx = 0; ret == SR_OK && idx < outc->analog_ch_count; idx++) {
+		for (l = o->sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (ch->type == SR_CHANNEL_ANALOG
+					&& ch->index == outc->analog_index_map[idx])
+				break;
+		}
+		if (!l || !(buf = sr_envelope_save(outc->envelope,
+				ch->name, &size)))
+			continue;
+		bufs = g_slist_prepend(bufs, buf);
+		name = g_strdup_printf("envelope-analog-1-%zu",
+			outc->first_analog_index + idx);
+		ret = zip_put(archive, name, buf, size);
+		g_free(name);
+	}
+
+	if (ret != SR_OK) {
+		zip_discard(archive);
+	} else if (zip_close(archive) < 0) {
+		sr_err("Error saving session file: %s", zip_strerror(archive));
+		zip_discard(archive);
+		ret = SR_ERR;
+	}
+	g_slist_free_full(bufs, g_free);
+
+	return ret;
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -647,6 +733,10 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	if (!o || !o->sdi || !(outc = o->priv))
 		return SR_ERR_ARG;
 
+	if (outc->envelope && (ret = sr_envelope_feed(outc->envelope,
+			packet)) != SR_OK)
+		return ret;
+
 	switch (packet->type) {
 	case SR_DF_META:
 		meta = packet->payload;
@@ -688,6 +778,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			if (outc->envelope) {
+				ret = zip_append_envelope(o);
+				if (ret != SR_OK)
+					return ret;
+			}
 		}
 		break;
 	}
@@ -696,11 +791,15 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{ "envelope", "Envelope", "Store a multi-resolution overview of the data for fast display", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_boolean(TRUE));
+
 	return options;
 }
 
@@ -717,6 +816,7 @@ static int cleanup(struct sr_output *o)
 	for (idx = 0; idx < outc->analog_ch_count; idx++)
 		g_free(outc->analog_buff[idx].samples);
 	g_free(outc->analog_buff);
+	sr_envelope_free(outc->envelope);
 
 	g_free(outc);
 	o->priv = NULL;
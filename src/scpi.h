@@ -178,6 +178,51 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 		int channel_command, const char *channel_name,
 		GVariant **gvar, const GVariantType *gvtype, int command, ...);
 
+/*--- scpi_frames.c ---------------------------------------------------------*/
+
+enum sr_scpi_sample_format {
+	SR_SCPI_SAMPLE_U8,
+	SR_SCPI_SAMPLE_S8,
+	SR_SCPI_SAMPLE_S16, /* Host byte order. */
+};
+
+/* A block of raw samples, value = raw * scale + offset. */
+struct sr_scpi_analog_block {
+	const struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	enum sr_scpi_sample_format format;
+	const void *raw;
+	size_t num_samples;
+	float scale;
+	float offset;
+	int digits;
+	/* Spec digits, if different from digits (0: same). */
+	int spec_digits;
+	enum sr_mq mq;
+	enum sr_unit unit;
+	/* Optional buffer of num_samples for inline conversion. */
+	float *scratch;
+};
+
+/* Default number of blocks queued for conversion. */
+#define SCPI_FRAME_PIPE_DEPTH 16
+
+struct sr_scpi_frame_pipe;
+
+SR_PRIV struct sr_scpi_frame_pipe *sr_scpi_frame_pipe_new(
+	const struct sr_dev_inst *sdi, size_t max_depth);
+SR_PRIV void sr_scpi_frame_pipe_free(struct sr_scpi_frame_pipe *pipe);
+SR_PRIV int sr_scpi_frame_pipe_dispatch(struct sr_scpi_frame_pipe *pipe);
+SR_PRIV int sr_scpi_frame_pipe_analog(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_scpi_analog_block *block);
+SR_PRIV int sr_scpi_frame_pipe_logic(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_dev_inst *sdi, const void *data,
+	size_t length, size_t unitsize);
+SR_PRIV int sr_scpi_frame_pipe_begin(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_dev_inst *sdi);
+SR_PRIV int sr_scpi_frame_pipe_end(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_dev_inst *sdi);
+
 /*--- GPIB only functions ---------------------------------------------------*/
 
 #ifdef HAVE_LIBGPIB
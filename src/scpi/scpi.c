@@ -29,6 +29,7 @@
 
 #define SCPI_READ_RETRIES 100
 #define SCPI_READ_RETRY_TIMEOUT_US (10 * 1000)
+#define SCPI_SCAN_THREADS_MAX 8
 
 static const char *scpi_vendors[][2] = {
 	{ "Agilent Technologies", "Agilent" },
@@ -310,21 +311,63 @@ static int scpi_get_data(struct sr_scpi_dev_inst *scpi,
 	return SR_OK;
 }
 
+/*
+ * Candidate resource of a SCPI scan. Probes may take until the transport's
+ * read timeout expires when nothing answers on a resource, so candidates
+ * are probed in parallel. Results are collected in the order in which the
+ * transports enumerated the resources. Probes only read the driver context,
+ * the devices found are added to its instance list by the scanning thread
+ * once all probes are done.
+ */
+struct scpi_scan_job {
+	struct drv_context *drvc;
+	struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi);
+	char *connection_id;
+	char *resource;
+	char *serialcomm;
+	struct sr_dev_inst *sdi;
+};
+
+static void scpi_scan_job_run(void *data, void *user_data)
+{
+	struct scpi_scan_job *job;
+
+	(void)user_data;
+
+	job = data;
+	job->sdi = sr_scpi_scan_resource(job->drvc, job->resource,
+		job->serialcomm, job->probe_device);
+}
+
+static void scpi_scan_job_free(void *data)
+{
+	struct scpi_scan_job *job;
+
+	job = data;
+	g_free(job->connection_id);
+	g_free(job->resource);
+	g_free(job->serialcomm);
+	g_free(job);
+}
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi))
 {
-	GSList *resources, *l, *devices;
+	GSList *resources, *l, *jobs, *devices;
+	struct scpi_scan_job *job;
 	struct sr_dev_inst *sdi;
-	const char *resource, *conn;
+	GThreadPool *pool;
+	const char *resource;
 	const char *serialcomm, *comm;
 	gchar **res;
-	unsigned i;
+	unsigned i, num_jobs;
 
 	resource = NULL;
 	serialcomm = NULL;
 	(void)sr_serial_extract_options(options, &resource, &serialcomm);
 
-	devices = NULL;
+	jobs = NULL;
+	num_jobs = 0;
 	for (i = 0; i < ARRAY_SIZE(scpi_devs); i++) {
 		if (resource && strcmp(resource, scpi_devs[i]->prefix) != 0)
 			continue;
@@ -337,18 +380,47 @@ SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 				g_strfreev(res);
 				continue;
 			}
-			conn = res[0];
 			comm = serialcomm ? : res[1];
-			sdi = sr_scpi_scan_resource(drvc, conn, comm, probe_device);
-			if (sdi) {
-				devices = g_slist_append(devices, sdi);
-				sdi->connection_id = g_strdup(l->data);
-			}
+			job = g_malloc0(sizeof(*job));
+			job->drvc = drvc;
+			job->probe_device = probe_device;
+			job->connection_id = g_strdup(l->data);
+			job->resource = g_strdup(res[0]);
+			job->serialcomm = g_strdup(comm);
+			jobs = g_slist_append(jobs, job);
+			num_jobs++;
 			g_strfreev(res);
 		}
 		g_slist_free_full(resources, g_free);
 	}
 
+	pool = NULL;
+	if (num_jobs > 1) {
+		pool = g_thread_pool_new(scpi_scan_job_run, NULL,
+			MIN(num_jobs, SCPI_SCAN_THREADS_MAX), TRUE, NULL);
+		if (!pool)
+			sr_warn("Cannot create scan threads, probing serially.");
+	}
+	if (pool) {
+		for (l = jobs; l; l = l->next)
+			g_thread_pool_push(pool, l->data, NULL);
+		/* Blocks until all probes have completed. */
+		g_thread_pool_free(pool, FALSE, TRUE);
+	} else {
+		g_slist_foreach(jobs, scpi_scan_job_run, NULL);
+	}
+
+	devices = NULL;
+	for (l = jobs; l; l = l->next) {
+		job = l->data;
+		if (!job->sdi)
+			continue;
+		devices = g_slist_append(devices, job->sdi);
+		job->sdi->connection_id = job->connection_id;
+		job->connection_id = NULL;
+	}
+	g_slist_free_full(jobs, scpi_scan_job_free);
+
 	if (!devices && resource) {
 		sdi = sr_scpi_scan_resource(drvc, resource, serialcomm, probe_device);
 		if (sdi)
@@ -0,0 +1,462 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Frame pipeline for SCPI oscilloscope drivers.
+ *
+ * Oscilloscopes with segmented (history) memory deliver hundreds of
+ * frames, each consisting of a raw sample block per channel. Fetching
+ * a block is bound by the instrument's I/O, converting raw samples to
+ * scaled analog values is bound by the CPU. The pipeline moves the
+ * conversion to a worker thread, so that the driver can request the
+ * next block while previous blocks get converted.
+ *
+ * Packets are still sent on the session thread, and strictly in the
+ * order in which the driver queued them. The number of blocks which
+ * are queued but not yet sent is limited, the driver blocks when the
+ * limit is reached. Drivers call the same routines when no pipeline
+ * is used (NULL pointer), data then gets converted and sent inline.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+
+#define LOG_PREFIX "scpi"
+
+enum frame_job_type {
+	FRAME_JOB_ANALOG,
+	FRAME_JOB_LOGIC,
+	FRAME_JOB_FRAME_BEGIN,
+	FRAME_JOB_FRAME_END,
+};
+
+struct frame_job {
+	enum frame_job_type type;
+	struct sr_scpi_analog_block block;
+	uint8_t *raw;
+	size_t raw_len;
+	size_t unitsize;
+	float *data;
+	gboolean done;
+	int64_t convert_us;
+	int64_t fetch_us;
+};
+
+struct sr_scpi_frame_pipe {
+	const struct sr_dev_inst *sdi;
+	GThreadPool *pool;
+	GMutex mutex;
+	GCond cond;
+	GQueue jobs;
+	size_t max_depth;
+	size_t depth;
+	/* Per-frame timing report. */
+	uint64_t frame_count;
+	int64_t frame_start;
+	size_t frame_blocks;
+	size_t frame_samples;
+	int64_t frame_convert_us;
+};
+
+static size_t sample_size(enum sr_scpi_sample_format format)
+{
+	switch (format) {
+	case SR_SCPI_SAMPLE_U8:
+	case SR_SCPI_SAMPLE_S8:
+		return sizeof(uint8_t);
+	case SR_SCPI_SAMPLE_S16:
+		return sizeof(int16_t);
+	}
+
+	return 0;
+}
+
+static void convert_samples(const struct sr_scpi_analog_block *block,
+	const uint8_t *raw, float *data)
+{
+	const int16_t *raw16;
+	size_t i;
+	float scale, offset;
+
+	scale = block->scale;
+	offset = block->offset;
+	switch (block->format) {
+	case SR_SCPI_SAMPLE_U8:
+		for (i = 0; i < block->num_samples; i++)
+			data[i] = raw[i] * scale + offset;
+		break;
+	case SR_SCPI_SAMPLE_S8:
+		for (i = 0; i < block->num_samples; i++)
+			data[i] = (int8_t)raw[i] * scale + offset;
+		break;
+	case SR_SCPI_SAMPLE_S16:
+		raw16 = (const int16_t *)raw;
+		for (i = 0; i < block->num_samples; i++)
+			data[i] = raw16[i] * scale + offset;
+		break;
+	}
+}
+
+static int send_analog(const struct sr_dev_inst *sdi,
+	const struct sr_scpi_analog_block *block, float *data)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	int ret;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, block->digits);
+	if (block->spec_digits)
+		spec.spec_digits = block->spec_digits;
+	meaning.channels = g_slist_append(NULL, block->ch);
+	meaning.mq = block->mq;
+	meaning.unit = block->unit;
+	meaning.mqflags = 0;
+	analog.num_samples = block->num_samples;
+	analog.data = data;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	ret = sr_session_send(sdi, &packet);
+	g_slist_free(meaning.channels);
+
+	return ret;
+}
+
+static int send_logic(const struct sr_dev_inst *sdi,
+	void *data, size_t length, size_t unitsize)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	logic.length = length;
+	logic.unitsize = unitsize;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	return sr_session_send(sdi, &packet);
+}
+
+static void frame_job_free(struct frame_job *job)
+{
+	g_free(job->raw);
+	g_free(job->data);
+	g_free(job);
+}
+
+/* Worker thread: convert one block of raw samples. */
+static void frame_job_run(gpointer data, gpointer user_data)
+{
+	struct frame_job *job;
+	struct sr_scpi_frame_pipe *pipe;
+	int64_t start;
+
+	job = data;
+	pipe = user_data;
+
+	start = g_get_monotonic_time();
+	convert_samples(&job->block, job->raw, job->data);
+	job->convert_us = g_get_monotonic_time() - start;
+
+	g_mutex_lock(&pipe->mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&pipe->cond);
+	g_mutex_unlock(&pipe->mutex);
+}
+
+static void frame_report(struct sr_scpi_frame_pipe *pipe, int64_t fetch_us)
+{
+	sr_dbg("Frame %" PRIu64 ": %zu blocks, %zu samples, "
+		"fetch %.3f ms, convert %.3f ms.", pipe->frame_count,
+		pipe->frame_blocks, pipe->frame_samples,
+		fetch_us / 1000.0, pipe->frame_convert_us / 1000.0);
+	pipe->frame_blocks = 0;
+	pipe->frame_samples = 0;
+	pipe->frame_convert_us = 0;
+}
+
+static int frame_job_send(struct sr_scpi_frame_pipe *pipe,
+	struct frame_job *job)
+{
+	const struct sr_dev_inst *sdi;
+	int ret;
+
+	sdi = pipe->sdi;
+	ret = SR_OK;
+	switch (job->type) {
+	case FRAME_JOB_ANALOG:
+		pipe->frame_blocks++;
+		pipe->frame_samples += job->block.num_samples;
+		pipe->frame_convert_us += job->convert_us;
+		ret = send_analog(sdi, &job->block, job->data);
+		break;
+	case FRAME_JOB_LOGIC:
+		ret = send_logic(sdi, job->raw, job->raw_len, job->unitsize);
+		break;
+	case FRAME_JOB_FRAME_BEGIN:
+		ret = std_session_send_df_frame_begin(sdi);
+		break;
+	case FRAME_JOB_FRAME_END:
+		ret = std_session_send_df_frame_end(sdi);
+		frame_report(pipe, job->fetch_us);
+		pipe->frame_count++;
+		break;
+	}
+
+	return ret;
+}
+
+/*
+ * Send the queued packets in order, up to the first block which is
+ * still being converted. Wait for conversion while the number of
+ * queued blocks exceeds @p max_depth.
+ */
+static int frame_pipe_drain(struct sr_scpi_frame_pipe *pipe, size_t max_depth)
+{
+	struct frame_job *job;
+	int ret;
+
+	ret = SR_OK;
+	while ((job = g_queue_peek_head(&pipe->jobs))) {
+		g_mutex_lock(&pipe->mutex);
+		if (pipe->depth > max_depth) {
+			while (!job->done)
+				g_cond_wait(&pipe->cond, &pipe->mutex);
+		}
+		if (!job->done) {
+			g_mutex_unlock(&pipe->mutex);
+			break;
+		}
+		g_mutex_unlock(&pipe->mutex);
+
+		g_queue_pop_head(&pipe->jobs);
+		if (job->type == FRAME_JOB_ANALOG)
+			pipe->depth--;
+		if (frame_job_send(pipe, job) != SR_OK)
+			ret = SR_ERR;
+		frame_job_free(job);
+	}
+
+	return ret;
+}
+
+static int frame_pipe_enqueue(struct sr_scpi_frame_pipe *pipe,
+	struct frame_job *job)
+{
+	g_queue_push_tail(&pipe->jobs, job);
+	if (job->type != FRAME_JOB_ANALOG) {
+		job->done = TRUE;
+		return frame_pipe_drain(pipe, pipe->max_depth);
+	}
+
+	pipe->depth++;
+	if (!g_thread_pool_push(pipe->pool, job, NULL)) {
+		/* Convert inline when the worker is not available. */
+		frame_job_run(job, pipe);
+	}
+
+	return frame_pipe_drain(pipe, pipe->max_depth);
+}
+
+/**
+ * Create a frame pipeline for a device's acquisition.
+ *
+ * @param sdi The device instance which packets are sent for.
+ * @param max_depth Number of blocks which may be queued for conversion.
+ *
+ * @return The pipeline, or NULL on failure. Callers may continue with
+ *         a NULL pipeline, data then gets converted inline.
+ *
+ * @private
+ */
+SR_PRIV struct sr_scpi_frame_pipe *sr_scpi_frame_pipe_new(
+	const struct sr_dev_inst *sdi, size_t max_depth)
+{
+	struct sr_scpi_frame_pipe *pipe;
+
+	pipe = g_malloc0(sizeof(*pipe));
+	pipe->sdi = sdi;
+	pipe->max_depth = max_depth ? max_depth : 1;
+	g_mutex_init(&pipe->mutex);
+	g_cond_init(&pipe->cond);
+	g_queue_init(&pipe->jobs);
+	/* A single worker keeps the conversion in queue order. */
+	pipe->pool = g_thread_pool_new(frame_job_run, pipe, 1, FALSE, NULL);
+	if (!pipe->pool) {
+		sr_err("Cannot create frame conversion worker.");
+		g_mutex_clear(&pipe->mutex);
+		g_cond_clear(&pipe->cond);
+		g_free(pipe);
+		return NULL;
+	}
+	pipe->frame_start = g_get_monotonic_time();
+
+	return pipe;
+}
+
+/**
+ * Send all queued packets, then release the pipeline.
+ *
+ * Must be called before the driver sends SR_DF_END.
+ *
+ * @private
+ */
+SR_PRIV void sr_scpi_frame_pipe_free(struct sr_scpi_frame_pipe *pipe)
+{
+	if (!pipe)
+		return;
+
+	(void)frame_pipe_drain(pipe, 0);
+	g_thread_pool_free(pipe->pool, FALSE, TRUE);
+	g_mutex_clear(&pipe->mutex);
+	g_cond_clear(&pipe->cond);
+	g_free(pipe);
+}
+
+/**
+ * Send packets for which conversion has completed. Does not block.
+ *
+ * @private
+ */
+SR_PRIV int sr_scpi_frame_pipe_dispatch(struct sr_scpi_frame_pipe *pipe)
+{
+	if (!pipe)
+		return SR_OK;
+
+	return frame_pipe_drain(pipe, G_MAXSIZE);
+}
+
+/**
+ * Queue a block of raw analog samples for conversion and submission.
+ *
+ * The raw data is copied, the caller may re-use its buffer as soon as
+ * the routine returns. Without a pipeline the block gets converted
+ * and sent immediately.
+ *
+ * @private
+ */
+SR_PRIV int sr_scpi_frame_pipe_analog(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_scpi_analog_block *block)
+{
+	struct frame_job *job;
+	float *data;
+	size_t raw_len;
+	int ret;
+
+	if (!block || !block->raw)
+		return SR_ERR_ARG;
+
+	if (!pipe) {
+		data = block->scratch;
+		if (!data)
+			data = g_try_malloc(block->num_samples * sizeof(float));
+		if (!data)
+			return SR_ERR_MALLOC;
+		convert_samples(block, block->raw, data);
+		ret = send_analog(block->sdi, block, data);
+		if (data != block->scratch)
+			g_free(data);
+		return ret;
+	}
+
+	raw_len = block->num_samples * sample_size(block->format);
+	job = g_malloc0(sizeof(*job));
+	job->type = FRAME_JOB_ANALOG;
+	job->block = *block;
+	job->raw = g_try_malloc(raw_len);
+	job->data = g_try_malloc(block->num_samples * sizeof(float));
+	if (!job->raw || !job->data) {
+		frame_job_free(job);
+		return SR_ERR_MALLOC;
+	}
+	memcpy(job->raw, block->raw, raw_len);
+	job->block.raw = NULL;
+	job->block.scratch = NULL;
+
+	return frame_pipe_enqueue(pipe, job);
+}
+
+/**
+ * Queue logic data, keeping its position relative to analog blocks.
+ *
+ * @private
+ */
+SR_PRIV int sr_scpi_frame_pipe_logic(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_dev_inst *sdi, const void *data,
+	size_t length, size_t unitsize)
+{
+	struct frame_job *job;
+
+	if (!pipe)
+		return send_logic(sdi, (void *)data, length, unitsize);
+
+	job = g_malloc0(sizeof(*job));
+	job->type = FRAME_JOB_LOGIC;
+	job->raw = g_memdup(data, length);
+	job->raw_len = length;
+	job->unitsize = unitsize;
+
+	return frame_pipe_enqueue(pipe, job);
+}
+
+/**
+ * Queue an SR_DF_FRAME_BEGIN packet.
+ *
+ * @private
+ */
+SR_PRIV int sr_scpi_frame_pipe_begin(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_dev_inst *sdi)
+{
+	struct frame_job *job;
+
+	if (!pipe)
+		return std_session_send_df_frame_begin(sdi);
+
+	pipe->frame_start = g_get_monotonic_time();
+	job = g_malloc0(sizeof(*job));
+	job->type = FRAME_JOB_FRAME_BEGIN;
+
+	return frame_pipe_enqueue(pipe, job);
+}
+
+/**
+ * Queue an SR_DF_FRAME_END packet. The frame's timing gets reported
+ * when the packet is sent.
+ *
+ * @private
+ */
+SR_PRIV int sr_scpi_frame_pipe_end(struct sr_scpi_frame_pipe *pipe,
+	const struct sr_dev_inst *sdi)
+{
+	struct frame_job *job;
+
+	if (!pipe)
+		return std_session_send_df_frame_end(sdi);
+
+	job = g_malloc0(sizeof(*job));
+	job->type = FRAME_JOB_FRAME_END;
+	job->fetch_us = g_get_monotonic_time() - pipe->frame_start;
+	pipe->frame_start = g_get_monotonic_time();
+
+	return frame_pipe_enqueue(pipe, job);
+}
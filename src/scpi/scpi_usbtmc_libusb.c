@@ -433,14 +433,20 @@ static int scpi_usbtmc_libusb_source_add(struct sr_session *session,
 {
 	struct scpi_usbtmc_libusb *uscpi = priv;
 	(void)events;
-	return usb_source_add(session, uscpi->ctx, timeout, cb, cb_data);
+	/*
+	 * All transfers are synchronous, so there is no libusb I/O to wait
+	 * for, only the timeout. A timer keyed on the device leaves the
+	 * libusb context alone, and works from device threads.
+	 */
+	return sr_session_fd_source_add(session, uscpi, -1, 0, timeout,
+		cb, cb_data);
 }
 
 static int scpi_usbtmc_libusb_source_remove(struct sr_session *session,
 		void *priv)
 {
 	struct scpi_usbtmc_libusb *uscpi = priv;
-	return usb_source_remove(session, uscpi->ctx);
+	return sr_session_source_remove_internal(session, uscpi);
 }
 
 static void usbtmc_bulk_out_header_write(void *header, uint8_t MsgID,
@@ -857,7 +857,7 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 		check_ptr = &buf[check_idx];
 		check_len = fill_idx - check_idx;
 		do_dump = check_len >= packet_size;
-		do_dump &= sr_log_loglevel_get() >= SR_LOG_SPEW;
+		do_dump &= sr_log_enabled(SR_LOG_SPEW);
 		if (do_dump) {
 			GString *text;
 
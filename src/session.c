@@ -24,7 +24,13 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 #include <glib.h>
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#define HAVE_FD_SET_BACKEND 1
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -65,8 +71,198 @@ struct fd_source {
 	void *key;
 
 	GPollFD pollfd;
+
+	sr_receive_data_callback cb;
+	void *cb_data;
+	/* Dispatched by the session's fd set instead of by glib. */
+	gboolean in_set;
+};
+
+/*
+ * Performance counters. Disabled sessions carry a NULL pointer, so the
+ * datafeed and event source paths only pay for a single test.
+ */
+struct session_stats {
+	GMutex mutex;
+	/* struct sr_session_stats per kind, keyed by their id. */
+	GHashTable *entries[SR_STATS_SOURCE + 1];
+};
+
+/* A packet queued by sr_session_send_async(). */
+struct async_node {
+	struct async_node *next;
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+	gsize bytes;
+};
+
+/*
+ * Packets sent from threads other than the session's. The queue is an
+ * intrusive multi-producer, single-consumer list: producers swap their
+ * node in at the head without taking a lock, the session thread pops
+ * from the tail. Since all devices share one FIFO, packets keep the
+ * order in which they were sent. Only producers which have to wait for
+ * room (SR_ASYNC_BLOCK) take the mutex.
+ */
+struct session_async {
+	/* Written by producers. */
+	struct async_node *head;
+	/* Owned by the session thread. */
+	struct async_node *tail;
+	struct async_node stub;
+
+	/* Set while the session runs and accepts packets. */
+	int active;
+	/* Whether the session thread was woken up since the last drain. */
+	int signalled;
+	GMainContext *context;
+	GSource *source;
+
+	/* Bounded memory: queued payload plus node overhead, in bytes. */
+	gsize queued;
+	uint64_t max_bytes;
+	enum sr_async_policy policy;
+	GMutex mutex;
+	GCond cond;
+	int waiters;
+};
+
+/* Default memory bound of the asynchronous datafeed queue. */
+#define ASYNC_MAX_BYTES_DEFAULT (64 * 1024 * 1024)
+
+/*
+ * A device thread, see sr_session_dev_thread_set(). It runs its devices'
+ * acquisition, event sources included, in its own main context. Their
+ * packets reach the session thread through the asynchronous datafeed
+ * queue, so transforms and datafeed callbacks still run in the session
+ * thread only.
+ */
+struct session_worker {
+	struct sr_session *session;
+	int group;
+	GSList *devs;
+	GMainContext *context;
+	GMainLoop *loop;
+	GThread *thread;
+	/* Session main context, to report the thread's exit. */
+	GMainContext *session_context;
+
+	/* Start handshake with sr_session_start(). */
+	GMutex mutex;
+	GCond cond;
+	gboolean started;
+	int start_ret;
+	/* Set when the thread is about to exit. */
+	int done;
 };
 
+/* The device thread the calling thread is, if any. */
+static GPrivate current_worker = G_PRIVATE_INIT(NULL);
+
+/* The device thread of session the calling thread is, or NULL. */
+static struct session_worker *worker_get(const struct sr_session *session)
+{
+	struct session_worker *worker;
+
+	worker = g_private_get(&current_worker);
+
+	return (worker && worker->session == session) ? worker : NULL;
+}
+
+/* Set in other libsigrok threads which send packets, like the USB one. */
+static GPrivate async_thread = G_PRIVATE_INIT(NULL);
+
+static uint64_t stats_now_ns(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return (uint64_t)g_get_monotonic_time() * 1000;
+#endif
+}
+
+static void stats_entry_free(void *data)
+{
+	struct sr_session_stats *entry;
+
+	entry = data;
+	g_free(entry->name);
+	g_free(entry);
+}
+
+static void stats_free(struct session_stats *stats)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(stats->entries); i++)
+		g_hash_table_destroy(stats->entries[i]);
+	g_mutex_clear(&stats->mutex);
+	g_free(stats);
+}
+
+static uint64_t packet_bytes(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return logic->length;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return (uint64_t)analog->num_samples * analog->encoding->unitsize
+			* g_slist_length(analog->meaning->channels);
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Account one call which started at start_ns. The entry is created on
+ * first use and named after name (plus index, if not negative).
+ */
+static void stats_update(struct session_stats *stats, enum sr_stats_kind kind,
+		const void *id, const char *name, int index, uint64_t bytes,
+		uint64_t start_ns, uint64_t late_ns)
+{
+	struct sr_session_stats *entry;
+	uint64_t elapsed_ns;
+	unsigned int bucket;
+
+	elapsed_ns = stats_now_ns() - start_ns;
+	bucket = 0;
+	if (elapsed_ns)
+		bucket = MIN(g_bit_storage(MIN(elapsed_ns,
+			1UL << (SR_STATS_HIST_BUCKETS - 1))),
+			SR_STATS_HIST_BUCKETS - 1);
+
+	g_mutex_lock(&stats->mutex);
+	entry = g_hash_table_lookup(stats->entries[kind], id);
+	if (!entry) {
+		entry = g_malloc0(sizeof(*entry));
+		entry->kind = kind;
+		entry->id = id;
+		if (index >= 0)
+			entry->name = g_strdup_printf("%s%d", name, index);
+		else
+			entry->name = g_strdup(name ? name : "");
+		g_hash_table_insert(stats->entries[kind], (void *)id, entry);
+	}
+	entry->count++;
+	entry->bytes += bytes;
+	entry->time_ns += elapsed_ns;
+	entry->max_ns = MAX(entry->max_ns, elapsed_ns);
+	entry->hist[bucket]++;
+	entry->late_ns += late_ns;
+	entry->late_max_ns = MAX(entry->late_max_ns, late_ns);
+	g_mutex_unlock(&stats->mutex);
+}
+
 /** FD event source prepare() method.
  * This is called immediately before poll().
  */
@@ -109,33 +305,58 @@ static gboolean fd_source_check(GSource *source)
 			&& fsource->due_us <= g_source_get_time(source)));
 }
 
-/** FD event source dispatch() method.
- * This is called if either prepare() or check() returned TRUE.
+/*
+ * Invoke an fd source's callback, with the events found at now_us, and
+ * restart its timeout. Shared by glib's and the fd set's dispatching.
  */
-static gboolean fd_source_dispatch(GSource *source,
-		GSourceFunc callback, void *user_data)
+static gboolean fd_source_call(struct fd_source *fsource,
+		sr_receive_data_callback cb, void *cb_data, int64_t now_us)
 {
-	struct fd_source *fsource;
+	GSource *source;
+	struct session_stats *stats;
 	unsigned int revents;
+	uint64_t start_ns, late_ns;
 	gboolean keep;
 
-	fsource = (struct fd_source *)source;
+	source = &fsource->base;
 	revents = fsource->pollfd.revents;
 
-	if (!callback) {
-		sr_err("Callback not set, cannot dispatch event.");
-		return G_SOURCE_REMOVE;
+	stats = fsource->session->stats;
+	start_ns = late_ns = 0;
+	if (G_UNLIKELY(stats)) {
+		if (!revents && fsource->timeout_us >= 0)
+			late_ns = 1000 * MAX(0, now_us - fsource->due_us);
+		start_ns = stats_now_ns();
 	}
-	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))
-			(fsource->pollfd.fd, revents, user_data);
+
+	keep = cb(fsource->pollfd.fd, revents, cb_data);
+
+	if (G_UNLIKELY(stats))
+		stats_update(stats, SR_STATS_SOURCE, fsource->key,
+			g_source_get_name(source), -1, 0, start_ns, late_ns);
 
 	if (fsource->timeout_us >= 0 && G_LIKELY(keep)
 			&& G_LIKELY(!g_source_is_destroyed(source)))
-		fsource->due_us = g_source_get_time(source)
-				+ fsource->timeout_us;
+		fsource->due_us = now_us + fsource->timeout_us;
 	return keep;
 }
 
+/** FD event source dispatch() method.
+ * This is called if either prepare() or check() returned TRUE.
+ */
+static gboolean fd_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	if (!callback) {
+		sr_err("Callback not set, cannot dispatch event.");
+		return G_SOURCE_REMOVE;
+	}
+
+	return fd_source_call((struct fd_source *)source,
+		SR_RECEIVE_DATA_CALLBACK(callback), user_data,
+		g_source_get_time(source));
+}
+
 /** FD event source finalize() method.
  */
 static void fd_source_finalize(GSource *source)
@@ -199,6 +420,209 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	return source;
 }
 
+/* Release the session's fd set. It has no members left by now. */
+static void fd_set_free(struct sr_session *session)
+{
+	if (!session->fd_set)
+		return;
+	g_source_destroy(session->fd_set);
+	g_source_unref(session->fd_set);
+	session->fd_set = NULL;
+}
+
+/*
+ * Asynchronous datafeed, see struct session_async and
+ * sr_session_send_async().
+ */
+
+/* Upper bound of packets delivered per main loop iteration. */
+#define ASYNC_DRAIN_MAX 256
+
+struct async_source {
+	GSource base;
+	struct session_async *async;
+};
+
+static void async_push(struct session_async *async, struct async_node *node)
+{
+	struct async_node *prev;
+
+	node->next = NULL;
+	do {
+		prev = g_atomic_pointer_get(&async->head);
+	} while (!g_atomic_pointer_compare_and_exchange(&async->head, prev, node));
+	/* Until this store, the consumer sees the queue end at prev. */
+	g_atomic_pointer_set(&prev->next, node);
+}
+
+/*
+ * Take the oldest node off the queue. Only ever called by the session
+ * thread. Returns NULL if the queue is empty, or if a producer has not
+ * finished linking in the next node yet; that producer wakes up the
+ * session thread again once it has.
+ */
+static struct async_node *async_pop(struct session_async *async)
+{
+	struct async_node *tail, *next;
+
+	tail = async->tail;
+	next = g_atomic_pointer_get(&tail->next);
+	if (tail == &async->stub) {
+		if (!next)
+			return NULL;
+		async->tail = tail = next;
+		next = g_atomic_pointer_get(&next->next);
+	}
+	if (next) {
+		async->tail = next;
+		return tail;
+	}
+	if (tail != g_atomic_pointer_get(&async->head))
+		return NULL;
+	/* tail is the last node, queue the stub behind it to take it. */
+	async_push(async, &async->stub);
+	if ((next = g_atomic_pointer_get(&tail->next))) {
+		async->tail = next;
+		return tail;
+	}
+
+	return NULL;
+}
+
+static gboolean async_pending(struct session_async *async)
+{
+	return async->tail != &async->stub
+		|| g_atomic_pointer_get(&async->stub.next) != NULL;
+}
+
+static void async_node_free(struct async_node *node)
+{
+	sr_packet_free(node->packet);
+	g_free(node);
+}
+
+/* Return a packet's share of the memory bound, waking up waiters. */
+static void async_release(struct session_async *async, gsize bytes)
+{
+	g_atomic_pointer_add(&async->queued, -(gssize)bytes);
+	if (g_atomic_int_get(&async->waiters)) {
+		g_mutex_lock(&async->mutex);
+		g_cond_broadcast(&async->cond);
+		g_mutex_unlock(&async->mutex);
+	}
+}
+
+/*
+ * Claim a packet's share of the memory bound. Depending on the policy,
+ * a full queue makes the caller wait, or drops data packets. An empty
+ * queue takes any packet, however large. Several producers may overshoot
+ * the bound a bit, by at most one packet each.
+ */
+static int async_reserve(struct session_async *async,
+		const struct sr_datafeed_packet *packet, gsize bytes)
+{
+	gsize queued;
+	int active;
+
+	queued = (gsize)g_atomic_pointer_get(&async->queued);
+	if (async->max_bytes && queued && queued + bytes > async->max_bytes) {
+		if (async->policy == SR_ASYNC_DROP) {
+			if (packet->type == SR_DF_LOGIC
+					|| packet->type == SR_DF_ANALOG)
+				return SR_ERR_NA;
+		} else {
+			g_mutex_lock(&async->mutex);
+			g_atomic_int_inc(&async->waiters);
+			while ((active = g_atomic_int_get(&async->active))
+					&& (queued = (gsize)g_atomic_pointer_get(&async->queued))
+					&& queued + bytes > async->max_bytes)
+				g_cond_wait(&async->cond, &async->mutex);
+			g_atomic_int_add(&async->waiters, -1);
+			g_mutex_unlock(&async->mutex);
+			if (!active)
+				return SR_ERR;
+		}
+	}
+	g_atomic_pointer_add(&async->queued, bytes);
+
+	return SR_OK;
+}
+
+/* Deliver up to max queued packets. Runs in the session thread. */
+static void async_drain(struct session_async *async, unsigned int max)
+{
+	struct async_node *node;
+
+	g_atomic_int_set(&async->signalled, 0);
+	while (max-- && (node = async_pop(async))) {
+		sr_session_send(node->sdi, node->packet);
+		async_release(async, node->bytes);
+		async_node_free(node);
+	}
+}
+
+static gboolean async_source_prepare(GSource *source, int *timeout)
+{
+	*timeout = -1;
+
+	return async_pending(((struct async_source *)source)->async);
+}
+
+static gboolean async_source_check(GSource *source)
+{
+	return async_pending(((struct async_source *)source)->async);
+}
+
+static gboolean async_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	(void)callback;
+	(void)user_data;
+
+	async_drain(((struct async_source *)source)->async, ASYNC_DRAIN_MAX);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static struct session_async *async_new(void)
+{
+	struct session_async *async;
+
+	async = g_malloc0(sizeof(*async));
+	async->head = async->tail = &async->stub;
+	async->max_bytes = ASYNC_MAX_BYTES_DEFAULT;
+	async->policy = SR_ASYNC_BLOCK;
+	g_mutex_init(&async->mutex);
+	g_cond_init(&async->cond);
+
+	return async;
+}
+
+/* Discard packets which were sent too late for the last run. */
+static void async_discard(struct session_async *async)
+{
+	struct async_node *node;
+
+	while ((node = async_pop(async))) {
+		async_release(async, node->bytes);
+		async_node_free(node);
+	}
+}
+
+static void async_free(struct session_async *async)
+{
+	if (async->source) {
+		g_source_destroy(async->source);
+		g_source_unref(async->source);
+	}
+	async_discard(async);
+	if (async->context)
+		g_main_context_unref(async->context);
+	g_mutex_clear(&async->mutex);
+	g_cond_clear(&async->cond);
+	g_free(async);
+}
+
 /**
  * Create a new session.
  *
@@ -225,12 +649,15 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	session->ctx = ctx;
 
 	g_mutex_init(&session->main_mutex);
+	g_mutex_init(&session->sources_mutex);
 
 	/* To maintain API compatibility, we need a lookup table
 	 * which maps poll_object IDs to GSource* pointers.
 	 */
 	session->event_sources = g_hash_table_new(NULL, NULL);
 
+	session->async = async_new();
+
 	*new_session = session;
 
 	return SR_OK;
@@ -259,9 +686,21 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	sr_session_datafeed_callback_remove_all(session);
 
+	fd_set_free(session);
 	g_hash_table_unref(session->event_sources);
 
+	if (session->stats)
+		stats_free(session->stats);
+
+	sr_transform_fuse_clear(&session->transform_fuse);
+
+	async_free(session->async);
+
+	if (session->dev_threads)
+		g_hash_table_destroy(session->dev_threads);
+
 	g_mutex_clear(&session->main_mutex);
+	g_mutex_clear(&session->sources_mutex);
 
 	g_free(session);
 
@@ -439,11 +878,65 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 	}
 
 	session->devs = g_slist_remove(session->devs, sdi);
+	if (session->dev_threads)
+		g_hash_table_remove(session->dev_threads, sdi);
 	sdi->session = NULL;
 
 	return SR_OK;
 }
 
+/**
+ * Run a device's acquisition in a thread of its own.
+ *
+ * The devices of a group share one thread, with its own main context for
+ * their event sources. Device threads are started by sr_session_start(),
+ * before the devices left in the session thread, and exit once their
+ * devices are done. Their packets are passed to the session thread as if
+ * sent with sr_session_send_async(); transforms and datafeed callbacks
+ * still run in the session thread only. Packets of one device keep their
+ * order, packets of different devices are interleaved as they arrive.
+ *
+ * The libusb events of USB devices in device threads are handled by a
+ * thread of the libusb context, which runs the drivers' transfer
+ * callbacks one at a time, between their calls from the device threads.
+ * USB devices can be in any groups, but either all of them or none run
+ * in device threads: sr_session_start() fails otherwise.
+ *
+ * @param session The session to use. Must not be NULL or running.
+ * @param sdi The device, which must have been added to the session.
+ * @param group Thread group of the device, or a negative value to run
+ *              the device in the session thread (the default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_dev_thread_set(struct sr_session *session,
+		struct sr_dev_inst *sdi, int group)
+{
+	if (!session || !sdi || sdi->session != session) {
+		sr_err("%s: Invalid arguments.", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("%s: Session is running.", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (group < 0) {
+		if (session->dev_threads)
+			g_hash_table_remove(session->dev_threads, sdi);
+		return SR_OK;
+	}
+	if (!session->dev_threads)
+		session->dev_threads = g_hash_table_new(NULL, NULL);
+	g_hash_table_insert(session->dev_threads, sdi,
+		GINT_TO_POINTER(group + 1));
+
+	return SR_OK;
+}
+
 /**
  * Remove all datafeed callbacks in a session.
  *
@@ -470,6 +963,10 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 /**
  * Add a datafeed callback to a session.
  *
+ * If a transform changes the channel layout, e.g. "subset", the callback
+ * is passed a device instance with the channels of its output. Outputs
+ * for the data must be created for that one.
+ *
  * @param session The session to use. Must not be NULL.
  * @param cb Function to call when a chunk of data is received.
  *           Must not be NULL.
@@ -659,35 +1156,644 @@ static unsigned int session_source_attach(struct sr_session *session,
 {
 	unsigned int id = 0;
 
-	g_mutex_lock(&session->main_mutex);
+	g_mutex_lock(&session->main_mutex);
+
+	if (session->main_context)
+		id = g_source_attach(source, session->main_context);
+	else
+		sr_err("Cannot add event source without main context.");
+
+	g_mutex_unlock(&session->main_mutex);
+
+	return id;
+}
+
+#ifdef HAVE_FD_SET_BACKEND
+/*
+ * Linux event backend for fd sources. Instead of attaching one GSource
+ * per descriptor, whose descriptors glib's poll() then scans on every
+ * iteration, all of a session's fd sources join one epoll instance. Their
+ * timeouts share a timerfd in that same instance. glib only polls the
+ * epoll descriptor, and only sources which are ready or due get
+ * dispatched. The fd sources are still GSource objects, they just never
+ * get attached; the set holds a reference on each of its members.
+ *
+ * Descriptors epoll doesn't take (e.g. regular files) fall back to a
+ * regular, attached fd source.
+ */
+
+/* Timeouts due within this interval of each other are dispatched together. */
+#define FD_SET_TIMER_SLACK_US 500
+
+/* Maximum number of epoll events fetched per dispatch. */
+#define FD_SET_MAX_EVENTS 64
+
+struct fd_set_source {
+	GSource base;
+	struct sr_session *session;
+	GPollFD epoll_pollfd;
+	int timer_fd;
+	/* Expiry the timerfd is armed for, INT64_MAX if disarmed. */
+	int64_t armed_us;
+	/* Earliest expiry of all members' timeouts, INT64_MAX if none. */
+	int64_t next_due_us;
+	/* struct fd_source members. */
+	GSList *members;
+	/* Sources to dispatch in the current iteration, reused. */
+	GPtrArray *batch;
+};
+
+/* Recompute the earliest member timeout, and rearm the timerfd for it. */
+static void fd_set_rearm(struct fd_set_source *set)
+{
+	struct fd_source *fsource;
+	struct itimerspec its;
+	GSList *l;
+	int64_t due_us;
+
+	due_us = INT64_MAX;
+	for (l = set->members; l; l = l->next) {
+		fsource = l->data;
+		if (fsource->timeout_us >= 0)
+			due_us = MIN(due_us, fsource->due_us);
+	}
+	set->next_due_us = due_us;
+
+	/* Due right away: prepare() handles it, no need for the timer. */
+	if (due_us <= g_get_monotonic_time())
+		due_us = INT64_MAX;
+	if (due_us == set->armed_us)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	if (due_us != INT64_MAX) {
+		/* g_get_monotonic_time() is CLOCK_MONOTONIC on Linux. */
+		its.it_value.tv_sec = due_us / G_USEC_PER_SEC;
+		its.it_value.tv_nsec = (due_us % G_USEC_PER_SEC) * 1000;
+	}
+	if (timerfd_settime(set->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+		sr_err("Failed to arm timer: %s.", g_strerror(errno));
+	else
+		set->armed_us = due_us;
+}
+
+static gboolean fd_set_prepare(GSource *source, int *timeout)
+{
+	struct fd_set_source *set;
+
+	set = (struct fd_set_source *)source;
+	*timeout = -1;
+
+	return set->next_due_us <= g_source_get_time(source);
+}
+
+static gboolean fd_set_check(GSource *source)
+{
+	struct fd_set_source *set;
+
+	set = (struct fd_set_source *)source;
+
+	return set->epoll_pollfd.revents != 0
+		|| set->next_due_us <= g_source_get_time(source);
+}
+
+static gboolean fd_set_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct fd_set_source *set;
+	struct fd_source *fsource;
+	struct epoll_event events[FD_SET_MAX_EVENTS];
+	uint64_t expirations;
+	int64_t now_us;
+	GSList *l;
+	unsigned int i;
+	int num_events;
+	gboolean keep;
+
+	(void)callback;
+	(void)user_data;
+
+	set = (struct fd_set_source *)source;
+	now_us = g_source_get_time(source);
+
+	num_events = 0;
+	if (set->epoll_pollfd.revents) {
+		num_events = epoll_wait(set->epoll_pollfd.fd, events,
+			G_N_ELEMENTS(events), 0);
+		if (num_events < 0)
+			num_events = 0;
+	}
+	for (i = 0; i < (unsigned int)num_events; i++) {
+		if (!(fsource = events[i].data.ptr)) {
+			/* The timerfd; the expiry count is of no interest. */
+			if (read(set->timer_fd, &expirations,
+					sizeof(expirations)) < 0)
+				sr_spew("Timer read: %s.", g_strerror(errno));
+			set->armed_us = INT64_MAX;
+			continue;
+		}
+		/* EPOLL* and G_IO_* share the poll() bit values on Linux. */
+		fsource->pollfd.revents = events[i].events
+			& (G_IO_IN | G_IO_OUT | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+		g_ptr_array_add(set->batch, fsource);
+	}
+	if (set->next_due_us <= now_us + FD_SET_TIMER_SLACK_US) {
+		for (l = set->members; l; l = l->next) {
+			fsource = l->data;
+			if (!fsource->pollfd.revents && fsource->timeout_us >= 0
+					&& fsource->due_us <= now_us + FD_SET_TIMER_SLACK_US)
+				g_ptr_array_add(set->batch, fsource);
+		}
+	}
+
+	/* Callbacks may remove any member, keep them alive meanwhile. */
+	for (i = 0; i < set->batch->len; i++)
+		g_source_ref(g_ptr_array_index(set->batch, i));
+	for (i = 0; i < set->batch->len; i++) {
+		fsource = g_ptr_array_index(set->batch, i);
+		if (!g_source_is_destroyed(&fsource->base)) {
+			keep = fd_source_call(fsource, fsource->cb,
+				fsource->cb_data, now_us);
+			if (!keep && !g_source_is_destroyed(&fsource->base))
+				sr_session_source_remove_internal(set->session,
+					fsource->key);
+		}
+		fsource->pollfd.revents = 0;
+		g_source_unref(&fsource->base);
+	}
+	g_ptr_array_set_size(set->batch, 0);
+
+	fd_set_rearm(set);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void fd_set_finalize(GSource *source)
+{
+	struct fd_set_source *set;
+
+	set = (struct fd_set_source *)source;
+	g_slist_free_full(set->members, (GDestroyNotify)g_source_unref);
+	g_ptr_array_free(set->batch, TRUE);
+	close(set->timer_fd);
+	close(set->epoll_pollfd.fd);
+}
+
+static struct fd_set_source *fd_set_get(struct sr_session *session)
+{
+	static GSourceFuncs fd_set_funcs = {
+		.prepare  = &fd_set_prepare,
+		.check    = &fd_set_check,
+		.dispatch = &fd_set_dispatch,
+		.finalize = &fd_set_finalize,
+	};
+	struct fd_set_source *set;
+	struct epoll_event event;
+	GSource *source;
+	int epoll_fd, timer_fd;
+
+	if (session->fd_set)
+		return (struct fd_set_source *)session->fd_set;
+
+	if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		return NULL;
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (timer_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD,
+			timer_fd, &event) < 0) {
+		if (timer_fd >= 0)
+			close(timer_fd);
+		close(epoll_fd);
+		return NULL;
+	}
+
+	source = g_source_new(&fd_set_funcs, sizeof(struct fd_set_source));
+	g_source_set_name(source, "fd set");
+	set = (struct fd_set_source *)source;
+	set->session = session;
+	set->epoll_pollfd.fd = epoll_fd;
+	set->epoll_pollfd.events = G_IO_IN;
+	set->timer_fd = timer_fd;
+	set->armed_us = set->next_due_us = INT64_MAX;
+	set->batch = g_ptr_array_new();
+	g_source_add_poll(source, &set->epoll_pollfd);
+
+	if (session_source_attach(session, source) == 0) {
+		g_source_unref(source);
+		return NULL;
+	}
+	session->fd_set = source;
+
+	return set;
+}
+
+/*
+ * Make an fd source a member of the session's fd set.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The source can't join the set, attach it to glib.
+ */
+static int fd_set_add(struct sr_session *session, void *key,
+		struct fd_source *fsource)
+{
+	struct fd_set_source *set;
+	struct epoll_event event;
+	gboolean exists;
+
+	/* The set belongs to the session thread. */
+	if (worker_get(session))
+		return SR_ERR_NA;
+
+	/* Let the regular path report duplicates. */
+	g_mutex_lock(&session->sources_mutex);
+	exists = g_hash_table_contains(session->event_sources, key);
+	g_mutex_unlock(&session->sources_mutex);
+	if (exists)
+		return SR_ERR_NA;
+
+	if (!(set = fd_set_get(session)))
+		return SR_ERR_NA;
+
+	if (fsource->pollfd.fd >= 0) {
+		memset(&event, 0, sizeof(event));
+		event.events = fsource->pollfd.events
+			& (G_IO_IN | G_IO_OUT | G_IO_PRI);
+		event.data.ptr = fsource;
+		if (epoll_ctl(set->epoll_pollfd.fd, EPOLL_CTL_ADD,
+				fsource->pollfd.fd, &event) < 0) {
+			sr_dbg("fd %d not usable with epoll: %s.",
+				(int)fsource->pollfd.fd, g_strerror(errno));
+			return SR_ERR_NA;
+		}
+	}
+
+	g_mutex_lock(&session->sources_mutex);
+	g_hash_table_insert(session->event_sources, key, fsource);
+	g_mutex_unlock(&session->sources_mutex);
+	g_source_ref(&fsource->base);
+	set->members = g_slist_prepend(set->members, fsource);
+	fsource->in_set = TRUE;
+	if (fsource->timeout_us >= 0) {
+		fsource->due_us = g_get_monotonic_time() + fsource->timeout_us;
+		fd_set_rearm(set);
+	}
+
+	return SR_OK;
+}
+
+/* Drop an fd source from the set, which releases (and finalizes) it. */
+static void fd_set_remove(struct sr_session *session, struct fd_source *fsource)
+{
+	struct fd_set_source *set;
+
+	set = (struct fd_set_source *)session->fd_set;
+	/* Fails harmlessly if the descriptor was already closed. */
+	if (fsource->pollfd.fd >= 0)
+		epoll_ctl(set->epoll_pollfd.fd, EPOLL_CTL_DEL,
+			fsource->pollfd.fd, NULL);
+	set->members = g_slist_remove(set->members, fsource);
+	fsource->in_set = FALSE;
+	if (fsource->timeout_us >= 0)
+		fd_set_rearm(set);
+	g_source_unref(&fsource->base);
+}
+#endif
+
+/*
+ * Attach a driver's event source to the main context of the calling
+ * device thread, or of the session.
+ */
+static unsigned int session_source_attach_current(struct sr_session *session,
+		GSource *source)
+{
+	struct session_worker *worker;
+
+	if ((worker = worker_get(session)))
+		return g_source_attach(source, worker->context);
+
+	return session_source_attach(session, source);
+}
+
+/*
+ * Start accepting packets from other threads. The queue's event source
+ * is not registered in session->event_sources: it doesn't keep the
+ * session running on its own.
+ */
+static int async_start(struct sr_session *session)
+{
+	static GSourceFuncs async_source_funcs = {
+		.prepare  = &async_source_prepare,
+		.check    = &async_source_check,
+		.dispatch = &async_source_dispatch,
+	};
+	struct session_async *async;
+	GSource *source;
+
+	async = session->async;
+	async_discard(async);
+
+	if (async->context)
+		g_main_context_unref(async->context);
+	async->context = g_main_context_ref(session->main_context);
+
+	source = g_source_new(&async_source_funcs, sizeof(struct async_source));
+	((struct async_source *)source)->async = async;
+	g_source_set_name(source, "async");
+	if (session_source_attach(session, source) == 0) {
+		g_source_unref(source);
+		return SR_ERR;
+	}
+	async->source = source;
+	g_atomic_int_set(&async->active, 1);
+
+	return SR_OK;
+}
+
+/* Stop accepting packets, and deliver those already queued. */
+static void async_stop(struct sr_session *session)
+{
+	struct session_async *async;
+
+	async = session->async;
+	if (!async->source)
+		return;
+
+	g_atomic_int_set(&async->active, 0);
+	g_mutex_lock(&async->mutex);
+	g_cond_broadcast(&async->cond);
+	g_mutex_unlock(&async->mutex);
+
+	async_drain(async, G_MAXUINT);
+
+	g_source_destroy(async->source);
+	g_source_unref(async->source);
+	async->source = NULL;
+}
+
+/*
+ * Start or stop a device in its device thread. USB drivers' transfer
+ * callbacks run in the libusb event thread, keep them out meanwhile.
+ */
+static int worker_dev_acquisition(struct session_worker *worker,
+		struct sr_dev_inst *sdi, gboolean start)
+{
+	int ret;
+
+#ifdef HAVE_LIBUSB_1_0
+	if (sdi->inst_type == SR_INST_USB)
+		usb_events_lock(worker->session->ctx);
+#endif
+	if (start)
+		ret = sr_dev_acquisition_start(sdi);
+	else
+		ret = sr_dev_acquisition_stop(sdi);
+#ifdef HAVE_LIBUSB_1_0
+	if (sdi->inst_type == SR_INST_USB)
+		usb_events_unlock(worker->session->ctx);
+#endif
+
+	return ret;
+}
+
+static gpointer worker_thread(gpointer data)
+{
+	struct session_worker *worker;
+	struct sr_dev_inst *sdi;
+	GSList *l, *lend;
+	int ret;
+
+	worker = data;
+	g_main_context_push_thread_default(worker->context);
+	g_private_set(&current_worker, worker);
+
+	ret = SR_OK;
+	for (l = worker->devs; l; l = l->next) {
+		sdi = l->data;
+		ret = worker_dev_acquisition(worker, sdi, TRUE);
+		if (ret != SR_OK) {
+			sr_err("Could not start %s device %s acquisition.",
+				sdi->driver->name, sdi->connection_id);
+			break;
+		}
+	}
+	if (ret != SR_OK) {
+		lend = l;
+		for (l = worker->devs; l != lend; l = l->next)
+			worker_dev_acquisition(worker, l->data, FALSE);
+	}
+
+	g_mutex_lock(&worker->mutex);
+	worker->start_ret = ret;
+	worker->started = TRUE;
+	g_cond_signal(&worker->cond);
+	g_mutex_unlock(&worker->mutex);
+
+	if (ret == SR_OK)
+		g_main_loop_run(worker->loop);
+
+	g_private_set(&current_worker, NULL);
+	g_main_context_pop_thread_default(worker->context);
+
+	g_atomic_int_set(&worker->done, 1);
+	g_main_context_wakeup(worker->session_context);
+
+	return NULL;
+}
+
+static gboolean worker_stop_sync(void *user_data)
+{
+	struct session_worker *worker;
+	GSList *l;
+
+	worker = user_data;
+	for (l = worker->devs; l; l = l->next)
+		worker_dev_acquisition(worker, l->data, FALSE);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void worker_free(struct session_worker *worker)
+{
+	g_slist_free(worker->devs);
+	g_main_loop_unref(worker->loop);
+	g_main_context_unref(worker->context);
+	g_main_context_unref(worker->session_context);
+	g_mutex_clear(&worker->mutex);
+	g_cond_clear(&worker->cond);
+	g_free(worker);
+}
+
+static int dev_thread_group(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	void *group;
+
+	if (!session->dev_threads)
+		return -1;
+	group = g_hash_table_lookup(session->dev_threads, sdi);
+
+	return group ? GPOINTER_TO_INT(group) - 1 : -1;
+}
+
+/* Ask all device threads to finish, and reap those which have. */
+static gboolean workers_reap(struct sr_session *session)
+{
+	struct session_worker *worker;
+	GSList *l, *next;
+
+	for (l = session->workers; l; l = next) {
+		next = l->next;
+		worker = l->data;
+		g_main_loop_quit(worker->loop);
+		if (!g_atomic_int_get(&worker->done))
+			continue;
+		g_thread_join(worker->thread);
+		session->workers = g_slist_delete_link(session->workers, l);
+		worker_free(worker);
+	}
+
+	return session->workers == NULL;
+}
+
+/* Stop the devices of all device threads, and wait for them to exit. */
+static void workers_abort(struct sr_session *session)
+{
+	GSList *l;
+
+	for (l = session->workers; l; l = l->next)
+		g_main_context_invoke(((struct session_worker *)l->data)->context,
+			&worker_stop_sync, l->data);
+	/* Threads may wait for room in the queue, keep draining it. */
+	while (!workers_reap(session)) {
+		if (session->async->source)
+			async_drain(session->async, G_MAXUINT);
+		g_usleep(1000);
+	}
+}
+
+/*
+ * Start the device threads, and have each start its devices. Either all
+ * of them start, or none: if any device fails, those already started are
+ * stopped again.
+ */
+static int workers_start(struct sr_session *session)
+{
+	struct session_worker *worker;
+	struct sr_dev_inst *sdi, *usb_sdi;
+	GSList *l, *w;
+	int group, ret;
+
+	/*
+	 * The libusb event thread and the session thread's USB source
+	 * can't share devices, see sr_session_dev_thread_set().
+	 */
+	usb_sdi = NULL;
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		if (sdi->inst_type != SR_INST_USB)
+			continue;
+		if (!usb_sdi) {
+			usb_sdi = sdi;
+		} else if ((dev_thread_group(session, sdi) < 0)
+				!= (dev_thread_group(session, usb_sdi) < 0)) {
+			sr_err("USB devices %s and %s must both run in device "
+				"threads, or both in the session thread.",
+				usb_sdi->connection_id, sdi->connection_id);
+			return SR_ERR_ARG;
+		}
+	}
+
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		if ((group = dev_thread_group(session, sdi)) < 0)
+			continue;
+		for (w = session->workers; w; w = w->next) {
+			if (((struct session_worker *)w->data)->group == group)
+				break;
+		}
+		if (w) {
+			worker = w->data;
+		} else {
+			worker = g_malloc0(sizeof(*worker));
+			worker->session = session;
+			worker->group = group;
+			worker->context = g_main_context_new();
+			worker->loop = g_main_loop_new(worker->context, FALSE);
+			worker->session_context = g_main_context_ref(session->main_context);
+			g_mutex_init(&worker->mutex);
+			g_cond_init(&worker->cond);
+			session->workers = g_slist_append(session->workers, worker);
+		}
+		worker->devs = g_slist_append(worker->devs, sdi);
+	}
 
-	if (session->main_context)
-		id = g_source_attach(source, session->main_context);
-	else
-		sr_err("Cannot add event source without main context.");
+	for (w = session->workers; w; w = w->next) {
+		worker = w->data;
+		worker->thread = g_thread_new("sr-device", &worker_thread, worker);
+	}
 
-	g_mutex_unlock(&session->main_mutex);
+	ret = SR_OK;
+	for (w = session->workers; w; w = w->next) {
+		worker = w->data;
+		g_mutex_lock(&worker->mutex);
+		while (!worker->started)
+			g_cond_wait(&worker->cond, &worker->mutex);
+		if (worker->start_ret != SR_OK)
+			ret = worker->start_ret;
+		g_mutex_unlock(&worker->mutex);
+	}
+	if (ret != SR_OK)
+		workers_abort(session);
 
-	return id;
+	return ret;
 }
 
+/* Interval at which to check again for device threads to exit, in ms. */
+#define STOP_CHECK_RETRY_MS 5
+
 /* Idle handler; invoked when the number of registered event sources
  * for a running session drops to zero.
  */
 static gboolean delayed_stop_check(void *data)
 {
 	struct sr_session *session;
+	GSource *source;
+	unsigned int size;
 
 	session = data;
+
+	g_mutex_lock(&session->sources_mutex);
 	session->stop_check_id = 0;
+	/* New event sources may have been installed in the meantime. */
+	size = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->sources_mutex);
 
 	/* Session already ended? */
 	if (!session->running)
 		return G_SOURCE_REMOVE;
 
-	/* New event sources may have been installed in the meantime. */
-	if (g_hash_table_size(session->event_sources) != 0)
+	if (size != 0)
+		return G_SOURCE_REMOVE;
+
+	/*
+	 * Device threads may still be on their way out. Check again a
+	 * little later; staying idle would spin until they are gone.
+	 */
+	if (!workers_reap(session)) {
+		source = g_timeout_source_new(STOP_CHECK_RETRY_MS);
+		g_source_set_callback(source, &delayed_stop_check, session, NULL);
+		g_mutex_lock(&session->sources_mutex);
+		session->stop_check_id = session_source_attach(session, source);
+		g_mutex_unlock(&session->sources_mutex);
+		g_source_unref(source);
 		return G_SOURCE_REMOVE;
+	}
+
+	/* Deliver what other threads sent before the last source went away. */
+	async_stop(session);
+	fd_set_free(session);
 
 	session->running = FALSE;
 	unset_main_context(session);
@@ -715,8 +1821,12 @@ static int stop_check_later(struct sr_session *session)
 	GSource *source;
 	unsigned int source_id;
 
-	if (session->stop_check_id != 0)
+	g_mutex_lock(&session->sources_mutex);
+
+	if (session->stop_check_id != 0) {
+		g_mutex_unlock(&session->sources_mutex);
 		return SR_OK; /* idle handler already installed */
+	}
 
 	source = g_idle_source_new();
 	g_source_set_callback(source, &delayed_stop_check, session, NULL);
@@ -724,6 +1834,8 @@ static int stop_check_later(struct sr_session *session)
 	source_id = session_source_attach(session, source);
 	session->stop_check_id = source_id;
 
+	g_mutex_unlock(&session->sources_mutex);
+
 	g_source_unref(source);
 
 	return (source_id != 0) ? SR_OK : SR_ERR;
@@ -755,6 +1867,7 @@ SR_API int sr_session_start(struct sr_session *session)
 	struct sr_dev_inst *sdi;
 	struct sr_channel *ch;
 	GSList *l, *c, *lend;
+	unsigned int size;
 	int ret;
 
 	if (!session) {
@@ -810,6 +1923,19 @@ SR_API int sr_session_start(struct sr_session *session)
 
 	session->running = TRUE;
 
+	if ((ret = async_start(session)) != SR_OK) {
+		session->running = FALSE;
+		unset_main_context(session);
+		return ret;
+	}
+
+	if ((ret = workers_start(session)) != SR_OK) {
+		async_stop(session);
+		session->running = FALSE;
+		unset_main_context(session);
+		return ret;
+	}
+
 	/* Have all devices start acquisition. */
 	for (l = session->devs; l; l = l->next) {
 		if (!(sdi = l->data)) {
@@ -817,6 +1943,9 @@ SR_API int sr_session_start(struct sr_session *session)
 			ret = SR_ERR;
 			break;
 		}
+		/* Device threads started theirs already. */
+		if (dev_thread_group(session, sdi) >= 0)
+			continue;
 		ret = sr_dev_acquisition_start(sdi);
 		if (ret != SR_OK) {
 			sr_err("Could not start %s device %s acquisition.",
@@ -831,17 +1960,24 @@ SR_API int sr_session_start(struct sr_session *session)
 		lend = l->next;
 		for (l = session->devs; l != lend; l = l->next) {
 			sdi = l->data;
-			sr_dev_acquisition_stop(sdi);
+			if (dev_thread_group(session, sdi) < 0)
+				sr_dev_acquisition_stop(sdi);
 		}
+		workers_abort(session);
 		/* TODO: Handle delayed stops. Need to iterate the event
 		 * sources... */
+		async_stop(session);
+		fd_set_free(session);
 		session->running = FALSE;
 
 		unset_main_context(session);
 		return ret;
 	}
 
-	if (g_hash_table_size(session->event_sources) == 0)
+	g_mutex_lock(&session->sources_mutex);
+	size = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->sources_mutex);
+	if (size == 0)
 		stop_check_later(session);
 
 	return SR_OK;
@@ -914,8 +2050,12 @@ static gboolean session_stop_sync(void *user_data)
 
 	for (node = session->devs; node; node = node->next) {
 		sdi = node->data;
-		sr_dev_acquisition_stop(sdi);
+		if (dev_thread_group(session, sdi) < 0)
+			sr_dev_acquisition_stop(sdi);
 	}
+	for (node = session->workers; node; node = node->next)
+		g_main_context_invoke(((struct session_worker *)node->data)->context,
+			&worker_stop_sync, node->data);
 
 	return G_SOURCE_REMOVE;
 }
@@ -1026,6 +2166,152 @@ SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 	return SR_OK;
 }
 
+/**
+ * Enable or disable the collection of performance counters.
+ *
+ * While enabled, the session counts packets and bytes per device,
+ * transform and datafeed callback, and times every transform receive(),
+ * datafeed callback and event source invocation. When disabled (the
+ * default) the cost is one pointer test per packet and per event.
+ *
+ * Disabling discards all counters collected so far.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to enable, FALSE to disable.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_enable(struct sr_session *session, gboolean enable)
+{
+	struct session_stats *stats;
+	unsigned int i;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!enable == !session->stats)
+		return SR_OK;
+
+	if (session->running) {
+		sr_err("Cannot change statistics collection while running.");
+		return SR_ERR;
+	}
+
+	if (enable) {
+		stats = g_malloc0(sizeof(*stats));
+		g_mutex_init(&stats->mutex);
+		for (i = 0; i < G_N_ELEMENTS(stats->entries); i++)
+			stats->entries[i] = g_hash_table_new_full(NULL, NULL,
+				NULL, stats_entry_free);
+		session->stats = stats;
+	} else {
+		stats = session->stats;
+		session->stats = NULL;
+		stats_free(stats);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Reset all performance counters of a session to zero.
+ *
+ * This may be called while the session is running.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR_NA Performance counters are not enabled.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_reset(struct sr_session *session)
+{
+	struct session_stats *stats;
+	unsigned int i;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (!(stats = session->stats))
+		return SR_ERR_NA;
+
+	g_mutex_lock(&stats->mutex);
+	for (i = 0; i < G_N_ELEMENTS(stats->entries); i++)
+		g_hash_table_remove_all(stats->entries[i]);
+	g_mutex_unlock(&stats->mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Get a snapshot of the performance counters of a session.
+ *
+ * This may be called while the session is running, from any thread.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Pointer where to store a list of struct sr_session_stats
+ *              copies, ordered by kind. Must not be NULL. Free the list
+ *              with sr_session_stats_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA Performance counters are not enabled.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_get(struct sr_session *session, GSList **stats)
+{
+	struct session_stats *ss;
+	struct sr_session_stats *copy;
+	GHashTableIter iter;
+	void *value;
+	GSList *list;
+	unsigned int i;
+
+	if (!session || !stats) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+	if (!(ss = session->stats))
+		return SR_ERR_NA;
+
+	list = NULL;
+	g_mutex_lock(&ss->mutex);
+	for (i = G_N_ELEMENTS(ss->entries); i-- > 0; ) {
+		g_hash_table_iter_init(&iter, ss->entries[i]);
+		while (g_hash_table_iter_next(&iter, NULL, &value)) {
+			copy = g_memdup(value, sizeof(*copy));
+			copy->name = g_strdup(copy->name);
+			list = g_slist_prepend(list, copy);
+		}
+	}
+	g_mutex_unlock(&ss->mutex);
+	*stats = list;
+
+	return SR_OK;
+}
+
+/**
+ * Free a list returned by sr_session_stats_get().
+ *
+ * @param stats The list to free. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_stats_free(GSList *stats)
+{
+	g_slist_free_full(stats, stats_entry_free);
+}
+
 /**
  * Debug helper.
  *
@@ -1108,6 +2394,16 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
+static const char *sdi_stats_name(const struct sr_dev_inst *sdi)
+{
+	if (sdi->driver)
+		return sdi->driver->name;
+	if (sdi->model)
+		return sdi->model;
+
+	return "device";
+}
+
 /**
  * Send a packet to whatever is listening on the datafeed bus.
  *
@@ -1128,7 +2424,11 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 	struct datafeed_callback *cb_struct;
 	struct sr_datafeed_packet *packet_in, *packet_out;
 	struct sr_transform *t;
-	int ret;
+	const struct sr_dev_inst *sdi_out;
+	struct session_stats *stats;
+	uint64_t send_ns, start_ns;
+	unsigned int fused;
+	int ret, i;
 
 	if (!sdi) {
 		sr_err("%s: sdi was NULL", __func__);
@@ -1145,16 +2445,53 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
+	/* Device threads hand their packets to the session thread. */
+	if (G_UNLIKELY(worker_get(sdi->session)
+			|| g_private_get(&async_thread)))
+		return sr_session_send_async(sdi, packet);
+
 	/*
 	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
-	 * transform module in the list, and so on.
+	 * transform module in the list, and so on. Runs of transforms with
+	 * element-wise kernels are applied together, in a single pass.
 	 */
+	stats = sdi->session->stats;
+	send_ns = start_ns = 0;
+	if (G_UNLIKELY(stats))
+		send_ns = stats_now_ns();
+
 	packet_in = (struct sr_datafeed_packet *)packet;
 	for (l = sdi->session->transforms; l; l = l->next) {
 		t = l->data;
+		if (G_UNLIKELY(stats))
+			start_ns = stats_now_ns();
+		ret = sr_transform_fuse_run(&sdi->session->transform_fuse, l,
+			packet_in, &fused);
+		if (ret < 0) {
+			sr_err("Error while running transform module: %d.", ret);
+			return SR_ERR;
+		}
+		if (fused) {
+			/* The pass is accounted to the first transform. */
+			for (; ; l = l->next) {
+				t = l->data;
+				if (G_UNLIKELY(stats))
+					stats_update(stats, SR_STATS_TRANSFORM, t,
+						t->module->id, -1,
+						packet_bytes(packet_in), start_ns, 0);
+				if (!--fused)
+					break;
+				if (G_UNLIKELY(stats))
+					start_ns = stats_now_ns();
+			}
+			continue;
+		}
 		sr_spew("Running transform module '%s'.", t->module->id);
 		ret = t->module->receive(t, packet_in, &packet_out);
+		if (G_UNLIKELY(stats))
+			stats_update(stats, SR_STATS_TRANSFORM, t, t->module->id,
+				-1, packet_bytes(packet_in), start_ns, 0);
 		if (ret < 0) {
 			sr_err("Error while running transform module: %d.", ret);
 			return SR_ERR;
@@ -1165,6 +2502,10 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 			 * packet, abort.
 			 */
 			sr_spew("Transform module didn't return a packet, aborting.");
+			if (G_UNLIKELY(stats))
+				stats_update(stats, SR_STATS_DEVICE, sdi,
+					sdi_stats_name(sdi), -1,
+					packet_bytes(packet), send_ns, 0);
 			return SR_OK;
 		} else {
 			/*
@@ -1174,19 +2515,151 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 			packet_in = packet_out;
 		}
 	}
-	packet = packet_in;
 
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
-	 * callbacks.
+	 * callbacks, along with the device's channels as the transforms
+	 * left them.
 	 */
-	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
+	sdi_out = sr_transform_dev_inst_get(sdi->session->transforms, sdi);
+	for (l = sdi->session->datafeed_callbacks, i = 0; l; l = l->next, i++) {
+		if (sr_log_enabled(SR_LOG_DBG))
+			datafeed_dump(packet_in);
 		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		if (G_UNLIKELY(stats))
+			start_ns = stats_now_ns();
+		cb_struct->cb(sdi_out, packet_in, cb_struct->cb_data);
+		if (G_UNLIKELY(stats))
+			stats_update(stats, SR_STATS_CALLBACK, cb_struct,
+				"callback", i, packet_bytes(packet_in),
+				start_ns, 0);
+	}
+
+	if (G_UNLIKELY(stats))
+		stats_update(stats, SR_STATS_DEVICE, sdi, sdi_stats_name(sdi),
+			-1, packet_bytes(packet), send_ns, 0);
+
+	return SR_OK;
+}
+
+/**
+ * Send a packet to the datafeed bus from any thread.
+ *
+ * This is the thread-safe counterpart of sr_session_send(), for devices
+ * which produce data outside of the session's main context, e.g. from
+ * a helper thread. The packet is copied and queued, and delivered from
+ * the session thread, in the order sr_session_send_async() calls on the
+ * session returned. Called from the session thread itself, the packet
+ * is delivered right away, after anything still queued.
+ *
+ * The session only runs as long as it has event sources. A device that
+ * produces data from a thread must keep one installed until its thread
+ * has sent SR_DF_END. Whatever is queued when the session stops is
+ * still delivered.
+ *
+ * Queued packets count against a memory bound, see
+ * sr_session_async_limit_set().
+ *
+ * @param sdi The device instance to send the packet from. Must not be NULL.
+ * @param packet The datafeed packet to send. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The queue is full and the packet was dropped, as
+ *         per the SR_ASYNC_DROP policy.
+ * @retval SR_ERR The session is not running (anymore).
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_send_async(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct session_async *async;
+	struct async_node *node;
+	struct sr_datafeed_packet *copy;
+	GMainContext *context;
+	gsize bytes;
+	int ret;
+
+	if (!sdi || !packet) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!sdi->session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	async = sdi->session->async;
+	if (!g_atomic_int_get(&async->active)) {
+		sr_err("%s: session not running", __func__);
+		return SR_ERR;
+	}
+	context = g_atomic_pointer_get(&async->context);
+
+	if (g_main_context_is_owner(context)) {
+		async_drain(async, G_MAXUINT);
+		return sr_session_send(sdi, packet);
+	}
+
+	bytes = sizeof(*node) + packet_bytes(packet);
+	if ((ret = async_reserve(async, packet, bytes)) != SR_OK)
+		return ret;
+
+	if ((ret = sr_packet_copy(packet, &copy)) != SR_OK) {
+		async_release(async, bytes);
+		return ret;
+	}
+	node = g_malloc(sizeof(*node));
+	node->sdi = sdi;
+	node->packet = copy;
+	node->bytes = bytes;
+	async_push(async, node);
+
+	/* One wakeup per drain is enough. */
+	if (g_atomic_int_compare_and_exchange(&async->signalled, 0, 1))
+		g_main_context_wakeup(context);
+
+	return SR_OK;
+}
+
+/**
+ * Bound the memory used by packets queued via sr_session_send_async().
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_bytes Maximum size of the queued packets' payloads plus a
+ *                  small per-packet overhead, or 0 for no limit.
+ *                  The default is 64 MiB.
+ * @param policy What to do with packets that don't fit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_async_limit_set(struct sr_session *session,
+		uint64_t max_bytes, enum sr_async_policy policy)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (policy != SR_ASYNC_BLOCK && policy != SR_ASYNC_DROP) {
+		sr_err("Invalid queue policy %d.", policy);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change the queue limit while running.");
+		return SR_ERR;
 	}
 
+	session->async->max_bytes = max_bytes;
+	session->async->policy = policy;
+
 	return SR_OK;
 }
 
@@ -1213,13 +2686,16 @@ SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 	 * already installed source. (Well it would, if we did not have
 	 * another sanity check there.)
 	 */
+	g_mutex_lock(&session->sources_mutex);
 	if (g_hash_table_contains(session->event_sources, key)) {
+		g_mutex_unlock(&session->sources_mutex);
 		sr_err("Event source with key %p already exists.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_insert(session->event_sources, key, source);
+	g_mutex_unlock(&session->sources_mutex);
 
-	if (session_source_attach(session, source) == 0)
+	if (session_source_attach_current(session, source) == 0)
 		return SR_ERR;
 
 	return SR_OK;
@@ -1237,6 +2713,15 @@ SR_PRIV int sr_session_fd_source_add(struct sr_session *session,
 	if (!source)
 		return SR_ERR;
 
+	((struct fd_source *)source)->cb = cb;
+	((struct fd_source *)source)->cb_data = cb_data;
+#ifdef HAVE_FD_SET_BACKEND
+	if (fd_set_add(session, key, (struct fd_source *)source) == SR_OK) {
+		g_source_unref(source);
+		return SR_OK;
+	}
+#endif
+
 	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
 
 	ret = sr_session_source_add_internal(session, key, source);
@@ -1245,6 +2730,85 @@ SR_PRIV int sr_session_fd_source_add(struct sr_session *session,
 	return ret;
 }
 
+/**
+ * Whether a device runs in a device thread.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_dev_threaded(const struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	return dev_thread_group((struct sr_session *)session, sdi) >= 0;
+}
+
+/**
+ * Add a device's event source, to the main context of the thread the
+ * device runs in rather than the calling thread's. For sources added
+ * from other threads, like USB transfer callbacks.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device the source is for. Must not be NULL.
+ * @param key The key which identifies the event source.
+ * @param source An event source object. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG Event source with @a key already installed.
+ * @retval SR_ERR Other error.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_dev_source_add(struct sr_session *session,
+		const struct sr_dev_inst *sdi, void *key, GSource *source)
+{
+	struct session_worker *worker;
+	GSList *l;
+	int group;
+
+	if ((group = dev_thread_group(session, sdi)) < 0)
+		return sr_session_source_add_internal(session, key, source);
+
+	for (l = session->workers; l; l = l->next) {
+		worker = l->data;
+		if (worker->group == group)
+			break;
+	}
+	if (!l) {
+		sr_err("No device thread for %s.", sdi->connection_id);
+		return SR_ERR;
+	}
+
+	g_mutex_lock(&session->sources_mutex);
+	if (g_hash_table_contains(session->event_sources, key)) {
+		g_mutex_unlock(&session->sources_mutex);
+		sr_err("Event source with key %p already exists.", key);
+		return SR_ERR_BUG;
+	}
+	g_hash_table_insert(session->event_sources, key, source);
+	g_mutex_unlock(&session->sources_mutex);
+
+	if (g_source_attach(source, worker->context) == 0)
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+/**
+ * Have packets sent from the calling thread go through the session's
+ * asynchronous queue, like those of device threads. For libsigrok's
+ * own threads which run driver code, like the libusb event thread.
+ *
+ * @param async Whether the calling thread is such a thread.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_async_thread_set(gboolean async)
+{
+	g_private_set(&async_thread, GINT_TO_POINTER(async));
+}
+
 /**
  * Add an event source for a file descriptor.
  *
@@ -1357,7 +2921,9 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 {
 	GSource *source;
 
+	g_mutex_lock(&session->sources_mutex);
 	source = g_hash_table_lookup(session->event_sources, key);
+	g_mutex_unlock(&session->sources_mutex);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
@@ -1367,6 +2933,12 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 		return SR_ERR_BUG;
 	}
 	g_source_destroy(source);
+#ifdef HAVE_FD_SET_BACKEND
+	/* Not attached, so glib won't let go of it. */
+	if (!g_source_get_context(source)
+			&& ((struct fd_source *)source)->in_set)
+		fd_set_remove(session, (struct fd_source *)source);
+#endif
 
 	return SR_OK;
 }
@@ -1453,24 +3025,30 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 		void *key, GSource *source)
 {
 	GSource *registered_source;
+	unsigned int size;
 
+	g_mutex_lock(&session->sources_mutex);
 	registered_source = g_hash_table_lookup(session->event_sources, key);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
 	 */
 	if (!registered_source) {
+		g_mutex_unlock(&session->sources_mutex);
 		sr_err("No event source for key %p found.", key);
 		return SR_ERR_BUG;
 	}
 	if (registered_source != source) {
+		g_mutex_unlock(&session->sources_mutex);
 		sr_err("Event source for key %p does not match"
 			" destroyed source.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_remove(session->event_sources, key);
+	size = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->sources_mutex);
 
-	if (g_hash_table_size(session->event_sources) > 0)
+	if (size > 0)
 		return SR_OK;
 
 	/* If no event sources are left, consider the acquisition finished.
@@ -1497,6 +3075,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
 	uint8_t *payload;
+	size_t size;
 
 	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
 	(*copy)->type = packet->type;
@@ -1504,6 +3083,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1514,7 +3095,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1524,21 +3105,23 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
+		/* The length is in bytes, not samples. */
+		logic_copy->data = g_malloc(logic->length);
 		if (!logic_copy->data) {
 			g_free(logic_copy);
 			return SR_ERR;
 		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
+		memcpy(logic_copy->data, logic->data, logic->length);
 		(*copy)->payload = logic_copy;
 		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
 		analog_copy = g_malloc(sizeof(*analog_copy));
-		analog_copy->data = g_malloc(
-				analog->encoding->unitsize * analog->num_samples);
-		memcpy(analog_copy->data, analog->data,
-				analog->encoding->unitsize * analog->num_samples);
+		/* Samples of all channels, interleaved. */
+		size = analog->encoding->unitsize * analog->num_samples
+			* g_slist_length(analog->meaning->channels);
+		analog_copy->data = g_malloc(size);
+		memcpy(analog_copy->data, analog->data, size);
 		analog_copy->num_samples = analog->num_samples;
 		analog_copy->encoding = g_memdup(analog->encoding,
 				sizeof(struct sr_analog_encoding));
@@ -1569,6 +3152,8 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -0,0 +1,397 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/decimate"
+
+/* Group accumulator of one analog channel. */
+struct analog_acc {
+	float min, max;
+	double sum;
+};
+
+/* Partial group of an analog stream (the channels of a packet). */
+struct analog_state {
+	unsigned int num_channels;
+	uint64_t count;
+	struct analog_acc *acc;
+};
+
+struct context {
+	uint64_t factor;
+	/* Averages (one sample per group) instead of min/max envelopes. */
+	gboolean average;
+
+	/* Partial logic group. */
+	uint16_t unitsize;
+	uint64_t count;
+	uint8_t *and_acc;
+	uint8_t *or_acc;
+
+	/* Partial analog groups, by the first channel of the stream. */
+	GHashTable *analog_state;
+
+	/* Output packet, valid until the next one. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_meta meta;
+	struct sr_config samplerate;
+	uint8_t *buf;
+	size_t buf_size;
+	float *in;
+	size_t in_size;
+};
+
+static void analog_state_free(void *data)
+{
+	struct analog_state *state;
+
+	state = data;
+	g_free(state->acc);
+	g_free(state);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *mode;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	mode = g_variant_get_string(g_hash_table_lookup(options, "mode"), NULL);
+	if (!ctx->factor || (strcmp(mode, "minmax") && strcmp(mode, "average"))) {
+		sr_err("Invalid factor %" PRIu64 " or mode '%s'.",
+			ctx->factor, mode);
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+	ctx->average = !strcmp(mode, "average");
+	ctx->analog_state = g_hash_table_new_full(g_direct_hash,
+		g_direct_equal, NULL, analog_state_free);
+
+	return SR_OK;
+}
+
+static void *buf_get(struct context *ctx, size_t size)
+{
+	if (size > ctx->buf_size) {
+		ctx->buf = g_realloc(ctx->buf, size);
+		ctx->buf_size = size;
+	}
+
+	return ctx->buf;
+}
+
+/*
+ * Min/max envelopes of logic data are the bitwise AND and OR of a group,
+ * the average mode keeps the first sample of each group.
+ */
+static uint64_t decimate_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *in;
+	uint8_t *out;
+	uint64_t num_samples, i;
+	size_t unitsize, j;
+
+	unitsize = logic->unitsize;
+	if (unitsize != ctx->unitsize) {
+		ctx->and_acc = g_realloc(ctx->and_acc, unitsize);
+		ctx->or_acc = g_realloc(ctx->or_acc, unitsize);
+		ctx->unitsize = unitsize;
+		ctx->count = 0;
+	}
+
+	num_samples = logic->length / unitsize;
+	out = buf_get(ctx, ((ctx->count + num_samples) / ctx->factor + 1)
+		* 2 * unitsize);
+	ctx->logic.data = out;
+
+	in = logic->data;
+	for (i = 0; i < num_samples; i++, in += unitsize) {
+		if (ctx->average) {
+			if (ctx->count == 0) {
+				memcpy(out, in, unitsize);
+				out += unitsize;
+			}
+		} else if (ctx->count == 0) {
+			memcpy(ctx->and_acc, in, unitsize);
+			memcpy(ctx->or_acc, in, unitsize);
+		} else {
+			for (j = 0; j < unitsize; j++) {
+				ctx->and_acc[j] &= in[j];
+				ctx->or_acc[j] |= in[j];
+			}
+		}
+		if (++ctx->count < ctx->factor)
+			continue;
+		ctx->count = 0;
+		if (!ctx->average) {
+			memcpy(out, ctx->and_acc, unitsize);
+			memcpy(out + unitsize, ctx->or_acc, unitsize);
+			out += 2 * unitsize;
+		}
+	}
+
+	ctx->logic.length = out - (uint8_t *)ctx->logic.data;
+	ctx->logic.unitsize = unitsize;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+
+	return ctx->logic.length;
+}
+
+static int decimate_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog, uint64_t *num_out)
+{
+	struct analog_state *state;
+	struct analog_acc *acc;
+	unsigned int num_channels, c;
+	uint64_t i, groups;
+	float *out, v;
+	size_t size;
+	int ret;
+
+	*num_out = 0;
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+
+	size = analog->num_samples * num_channels * sizeof(float);
+	if (size > ctx->in_size) {
+		ctx->in = g_realloc(ctx->in, size);
+		ctx->in_size = size;
+	}
+	if ((ret = sr_analog_to_float(analog, ctx->in)) != SR_OK)
+		return ret;
+
+	state = g_hash_table_lookup(ctx->analog_state,
+		analog->meaning->channels->data);
+	if (!state || state->num_channels != num_channels) {
+		state = g_malloc0(sizeof(*state));
+		state->num_channels = num_channels;
+		state->acc = g_malloc0(num_channels * sizeof(*state->acc));
+		g_hash_table_replace(ctx->analog_state,
+			analog->meaning->channels->data, state);
+	}
+
+	groups = (state->count + analog->num_samples) / ctx->factor;
+	out = buf_get(ctx, (groups * 2 + 1) * num_channels * sizeof(float));
+	ctx->analog.data = out;
+
+	for (i = 0; i < analog->num_samples; i++) {
+		for (c = 0; c < num_channels; c++) {
+			v = ctx->in[i * num_channels + c];
+			acc = &state->acc[c];
+			if (state->count == 0) {
+				acc->min = acc->max = v;
+				acc->sum = v;
+			} else {
+				acc->min = MIN(acc->min, v);
+				acc->max = MAX(acc->max, v);
+				acc->sum += v;
+			}
+		}
+		if (++state->count < ctx->factor)
+			continue;
+		state->count = 0;
+		/* Samples stay interleaved by channel. */
+		for (c = 0; c < num_channels; c++) {
+			acc = &state->acc[c];
+			if (ctx->average) {
+				out[c] = acc->sum / ctx->factor;
+			} else {
+				out[c] = acc->min;
+				out[num_channels + c] = acc->max;
+			}
+		}
+		out += (ctx->average ? 1 : 2) * num_channels;
+		*num_out += ctx->average ? 1 : 2;
+	}
+
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_signed = TRUE;
+	ctx->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+	ctx->meaning = *analog->meaning;
+	ctx->spec = *analog->spec;
+	ctx->analog.num_samples = *num_out;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->analog.meaning = &ctx->meaning;
+	ctx->analog.spec = &ctx->spec;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+
+	return SR_OK;
+}
+
+/* Pass on the meta packet, with the samplerate of the decimated data. */
+static gboolean decimate_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta)
+{
+	struct sr_config *src;
+	uint64_t samplerate;
+	gboolean found;
+	GSList *l;
+
+	g_slist_free(ctx->meta.config);
+	ctx->meta.config = NULL;
+	found = FALSE;
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE) {
+			ctx->meta.config = g_slist_append(ctx->meta.config, src);
+			continue;
+		}
+		samplerate = g_variant_get_uint64(src->data);
+		samplerate = samplerate / ctx->factor * (ctx->average ? 1 : 2);
+		if (ctx->samplerate.data)
+			g_variant_unref(ctx->samplerate.data);
+		ctx->samplerate.key = SR_CONF_SAMPLERATE;
+		ctx->samplerate.data = g_variant_ref_sink(
+			g_variant_new_uint64(samplerate));
+		ctx->meta.config = g_slist_append(ctx->meta.config,
+			&ctx->samplerate);
+		found = TRUE;
+	}
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+
+	return found;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	uint64_t num_out;
+	int ret;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	if (ctx->factor == 1)
+		return SR_OK;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		/* Samples left over from a previous acquisition are dropped. */
+		ctx->count = 0;
+		g_hash_table_remove_all(ctx->analog_state);
+		break;
+	case SR_DF_META:
+		if (decimate_meta(ctx, packet_in->payload))
+			*packet_out = &ctx->packet;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!logic->unitsize)
+			break;
+		/* Nothing to pass on until a group is complete. */
+		*packet_out = decimate_logic(ctx, logic) ? &ctx->packet : NULL;
+		break;
+	case SR_DF_ANALOG:
+		if ((ret = decimate_analog(ctx, packet_in->payload, &num_out)) != SR_OK)
+			return ret;
+		*packet_out = num_out ? &ctx->packet : NULL;
+		break;
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->analog_state);
+	g_slist_free(ctx->meta.config);
+	if (ctx->samplerate.data)
+		g_variant_unref(ctx->samplerate.data);
+	g_free(ctx->and_acc);
+	g_free(ctx->or_acc);
+	g_free(ctx->buf);
+	g_free(ctx->in);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of samples combined into each group", NULL, NULL },
+	{ "mode", "Mode", "Envelope of a group: 'minmax' passes on two samples (minimum and maximum, logic: AND and OR), 'average' one (logic: the first)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(1));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("minmax"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("minmax")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("average")));
+		options[1].values = l;
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_decimate = {
+	.id = "decimate",
+	.name = "Decimate",
+	.desc = "Reduce the samplerate by combining groups of samples",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,32 +24,180 @@
 
 #define LOG_PREFIX "transform/invert"
 
+/* Samples in the XOR pattern, which is applied one block at a time. */
+#define MASK_SAMPLES 64
+
+struct context {
+	/* Selected channels, NULL for all enabled channels. */
+	GSList *channels;
+	/*
+	 * XOR pattern of MASK_SAMPLES samples, for mask_unitsize. Compiled
+	 * on the first logic packet of an acquisition, 0 until then.
+	 */
+	uint8_t *mask;
+	uint16_t mask_unitsize;
+	/* None of the selected channels are in the logic data. */
+	gboolean mask_empty;
+};
+
+static struct sr_channel *find_channel(const struct sr_dev_inst *sdi,
+		const char *name)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!strcmp(ch->name, name))
+			return ch;
+	}
+
+	return NULL;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *names;
+	char **tokens;
+	int i, ret;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	names = g_variant_get_string(g_hash_table_lookup(options, "channels"),
+			NULL);
+	tokens = g_strsplit(names, ",", 0);
+	ret = SR_OK;
+	for (i = 0; tokens[i]; i++) {
+		g_strstrip(tokens[i]);
+		if (!tokens[i][0])
+			continue;
+		if (!(ch = find_channel(t->sdi, tokens[i]))) {
+			sr_err("Unknown channel '%s'.", tokens[i]);
+			ret = SR_ERR_ARG;
+			break;
+		}
+		ctx->channels = g_slist_append(ctx->channels, ch);
+	}
+	g_strfreev(tokens);
+
+	if (ret != SR_OK) {
+		g_slist_free(ctx->channels);
+		g_free(ctx);
+		t->priv = NULL;
+	}
+
+	return ret;
+}
+
+/*
+ * Compile the channel selection into an XOR pattern for the unit size.
+ * Logic channel N is bit N of a sample.
+ */
+static void mask_compile(struct context *ctx, const struct sr_dev_inst *sdi,
+		uint16_t unitsize)
+{
+	struct sr_channel *ch;
+	GSList *l;
+	size_t i;
+
+	g_free(ctx->mask);
+	ctx->mask = g_malloc0(MASK_SAMPLES * unitsize);
+	ctx->mask_unitsize = unitsize;
+	ctx->mask_empty = TRUE;
+
+	for (l = ctx->channels ? ctx->channels : sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if (!ctx->channels && !ch->enabled)
+			continue;
+		if (ch->index < 0 || ch->index >= unitsize * 8)
+			continue;
+		ctx->mask[ch->index / 8] |= 1 << (ch->index % 8);
+		ctx->mask_empty = FALSE;
+	}
+	for (i = unitsize; i < MASK_SAMPLES * unitsize; i++)
+		ctx->mask[i] = ctx->mask[i - unitsize];
+}
+
+static void invert_logic(struct context *ctx, const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *mask;
+	uint8_t *data;
+	uint64_t length, i, j;
+	size_t block;
+
+	if (!logic->unitsize)
+		return;
+	if (logic->unitsize != ctx->mask_unitsize)
+		mask_compile(ctx, sdi, logic->unitsize);
+	if (ctx->mask_empty)
+		return;
+
+	mask = ctx->mask;
+	block = MASK_SAMPLES * logic->unitsize;
+	length = logic->length / logic->unitsize * logic->unitsize;
+
+	/*
+	 * Whole blocks XOR the pattern as is. Compilers turn the inner
+	 * loop into vector instructions.
+	 */
+	for (i = 0; i + block <= length; i += block) {
+		data = (uint8_t *)logic->data + i;
+		for (j = 0; j < block; j++)
+			data[j] ^= mask[j];
+	}
+	data = (uint8_t *)logic->data + i;
+	for (j = 0; j < length - i; j++)
+		data[j] ^= mask[j];
+}
+
+static gboolean analog_selected(const struct context *ctx,
+		const struct sr_datafeed_analog *analog)
+{
+	GSList *l;
+
+	if (!ctx->channels)
+		return TRUE;
+	for (l = analog->meaning->channels; l; l = l->next) {
+		if (g_slist_find(ctx->channels, l->data))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
-	const struct sr_datafeed_logic *logic;
+	struct context *ctx;
 	const struct sr_datafeed_analog *analog;
-	uint8_t *b;
 	int64_t p;
-	uint64_t i, j, q;
+	uint64_t q;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
+	ctx = t->priv;
 
 	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		/* Channels may have been enabled or disabled since. */
+		ctx->mask_unitsize = 0;
+		break;
 	case SR_DF_LOGIC:
-		logic = packet_in->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* For now invert every bit in every byte. */
-				b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
-				*b = ~(*b);
-			}
-		}
+		invert_logic(ctx, t->sdi, packet_in->payload);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
+		if (!analog_selected(ctx, analog))
+			break;
 		p = analog->encoding->scale.p;
 		q = analog->encoding->scale.q;
 		if (q > INT64_MAX)
@@ -68,12 +216,66 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int kernel(const struct sr_transform *t,
+		const struct sr_datafeed_packet *packet,
+		struct sr_transform_kernel *kernel)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+
+	ctx = t->priv;
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (logic->unitsize != ctx->mask_unitsize)
+			mask_compile(ctx, t->sdi, logic->unitsize);
+		if (!ctx->mask_empty)
+			kernel->xor_mask = ctx->mask;
+		return SR_OK;
+	case SR_DF_ANALOG:
+		/* Taking the reciprocal of the scale is not a product. */
+		return analog_selected(ctx, packet->payload) ? SR_ERR_NA : SR_OK;
+	default:
+		return SR_ERR_NA;
+	}
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_slist_free(ctx->channels);
+	g_free(ctx->mask);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma-separated list of channels to invert, all enabled channels if empty", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
 SR_PRIV struct sr_transform_module transform_invert = {
 	.id = "invert",
 	.name = "Invert",
 	.desc = "Invert values",
-	.options = NULL,
-	.init = NULL,
+	.options = get_options,
+	.init = init,
 	.receive = receive,
-	.cleanup = NULL,
+	.kernel = kernel,
+	.cleanup = cleanup,
 };
@@ -38,6 +38,18 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int kernel(const struct sr_transform *t,
+		const struct sr_datafeed_packet *packet,
+		struct sr_transform_kernel *kernel)
+{
+	(void)t;
+	(void)packet;
+	(void)kernel;
+
+	/* The identity, which the kernel is initialized to. */
+	return SR_OK;
+}
+
 SR_PRIV struct sr_transform_module transform_nop = {
 	.id = "nop",
 	.name = "NOP",
@@ -45,5 +57,6 @@ SR_PRIV struct sr_transform_module transform_nop = {
 	.options = NULL,
 	.init = NULL,
 	.receive = receive,
+	.kernel = kernel,
 	.cleanup = NULL,
 };
@@ -71,6 +71,19 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int kernel(const struct sr_transform *t,
+		const struct sr_datafeed_packet *packet,
+		struct sr_transform_kernel *kernel)
+{
+	struct context *ctx;
+
+	ctx = t->priv;
+	if (packet->type == SR_DF_ANALOG)
+		kernel->scale = ctx->factor;
+
+	return SR_OK;
+}
+
 static int cleanup(struct sr_transform *t)
 {
 	struct context *ctx;
@@ -109,5 +122,6 @@ SR_PRIV struct sr_transform_module transform_scale = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.kernel = kernel,
 	.cleanup = cleanup,
 };
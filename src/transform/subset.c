@@ -0,0 +1,325 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/subset"
+
+/* Output samples are gathered in a 64-bit word. */
+#define MAX_CHANNELS 64
+
+struct context {
+	/* Selected channels, in output bit order. NULL for all enabled. */
+	GSList *channels;
+	/*
+	 * The device as seen downstream: the selected channels, indexed by
+	 * their output bit, then the device's other channels.
+	 */
+	struct sr_dev_inst dev_out;
+	/* The channels of dev_out owned by this transform. */
+	GSList *out_channels;
+	/* Input channel index of each output bit. */
+	int in_index[MAX_CHANNELS];
+	unsigned int num_channels;
+	/*
+	 * Input sample size the tables below were built for, 0 until the
+	 * first logic packet of an acquisition.
+	 */
+	uint16_t in_unitsize;
+	uint16_t out_unitsize;
+	/* Input bytes holding selected channels. */
+	unsigned int num_bytes;
+	unsigned int *byte_offsets;
+	/*
+	 * Bit gathering tables, 256 entries per input byte: the output
+	 * bits set by each value of the byte.
+	 */
+	uint64_t *table;
+	/* Output packet, valid until the next one. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t *buf;
+	size_t buf_size;
+};
+
+static struct sr_channel *find_channel(const struct sr_dev_inst *sdi,
+		const char *name)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!strcmp(ch->name, name))
+			return ch;
+	}
+
+	return NULL;
+}
+
+/*
+ * Publish the output layout. Outputs map logic bits to channels by
+ * their index, so they need to see the selected channels renumbered.
+ */
+static void dev_out_update(struct context *ctx, const struct sr_dev_inst *sdi)
+{
+	struct sr_channel *ch;
+	GHashTable *config_cache;
+	GSList *l;
+
+	g_slist_free_full(ctx->out_channels, sr_channel_free_cb);
+	g_slist_free(ctx->dev_out.channels);
+	config_cache = ctx->dev_out.config_cache;
+	ctx->dev_out = *sdi;
+	ctx->dev_out.channels = NULL;
+	ctx->dev_out.channel_groups = NULL;
+	ctx->dev_out.config_cache = config_cache;
+
+	ctx->num_channels = 0;
+	for (l = ctx->channels ? ctx->channels : sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ctx->channels && (ch->type != SR_CHANNEL_LOGIC || !ch->enabled))
+			continue;
+		if (ctx->num_channels == MAX_CHANNELS)
+			break;
+		ctx->in_index[ctx->num_channels] = ch->index;
+		sr_channel_new(&ctx->dev_out, ctx->num_channels++,
+			SR_CHANNEL_LOGIC, TRUE, ch->name);
+	}
+	ctx->out_channels = g_slist_copy(ctx->dev_out.channels);
+
+	/* Non-logic packets pass unchanged, so do their channels. */
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			ctx->dev_out.channels = g_slist_append(
+				ctx->dev_out.channels, ch);
+	}
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *names;
+	char **tokens;
+	int i, ret;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	names = g_variant_get_string(g_hash_table_lookup(options, "channels"),
+			NULL);
+	tokens = g_strsplit(names, ",", 0);
+	ret = SR_OK;
+	for (i = 0; tokens[i]; i++) {
+		g_strstrip(tokens[i]);
+		if (!tokens[i][0])
+			continue;
+		ch = find_channel(t->sdi, tokens[i]);
+		if (!ch || ch->type != SR_CHANNEL_LOGIC) {
+			sr_err("Unknown logic channel '%s'.", tokens[i]);
+			ret = SR_ERR_ARG;
+			break;
+		}
+		ctx->channels = g_slist_append(ctx->channels, ch);
+	}
+	g_strfreev(tokens);
+	if (ret == SR_OK && g_slist_length(ctx->channels) > MAX_CHANNELS) {
+		sr_err("At most %d channels can be selected.", MAX_CHANNELS);
+		ret = SR_ERR_ARG;
+	}
+
+	if (ret != SR_OK) {
+		g_slist_free(ctx->channels);
+		g_free(ctx);
+		t->priv = NULL;
+		return ret;
+	}
+
+	dev_out_update(ctx, t->sdi);
+	t->sdi_out = &ctx->dev_out;
+
+	return SR_OK;
+}
+
+/* Build the gathering tables for an input sample size. */
+static void tables_build(struct context *ctx, uint16_t unitsize)
+{
+	unsigned int bit, byte, k, v;
+	int *offset_of, index;
+
+	g_free(ctx->byte_offsets);
+	g_free(ctx->table);
+	ctx->byte_offsets = g_malloc(unitsize * sizeof(unsigned int));
+	ctx->table = g_malloc0(unitsize * 256 * sizeof(uint64_t));
+	ctx->num_bytes = 0;
+	ctx->in_unitsize = unitsize;
+
+	/* Table index of each input byte, -1 if it has no selected channel. */
+	offset_of = g_malloc(unitsize * sizeof(int));
+	for (byte = 0; byte < unitsize; byte++)
+		offset_of[byte] = -1;
+
+	for (bit = 0; bit < ctx->num_channels; bit++) {
+		index = ctx->in_index[bit];
+		/* Channels the input doesn't have stay zero. */
+		if (index < 0 || index >= unitsize * 8)
+			continue;
+		byte = index / 8;
+		if (offset_of[byte] < 0) {
+			offset_of[byte] = ctx->num_bytes;
+			ctx->byte_offsets[ctx->num_bytes++] = byte;
+		}
+		k = offset_of[byte];
+		for (v = 0; v < 256; v++) {
+			if (v & (1 << (index % 8)))
+				ctx->table[k * 256 + v] |= 1ULL << bit;
+		}
+	}
+	ctx->out_unitsize = MAX((ctx->num_channels + 7) / 8, 1);
+
+	g_free(offset_of);
+}
+
+static void subset_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *in;
+	const uint64_t *table;
+	const unsigned int *offsets;
+	uint8_t *out;
+	uint64_t num_samples, i, v;
+	unsigned int k, num_bytes;
+	size_t size;
+
+	if (logic->unitsize != ctx->in_unitsize)
+		tables_build(ctx, logic->unitsize);
+
+	num_samples = logic->length / logic->unitsize;
+	/* Room to store a whole word for the last sample. */
+	size = num_samples * ctx->out_unitsize + sizeof(uint64_t);
+	if (size > ctx->buf_size) {
+		ctx->buf = g_realloc(ctx->buf, size);
+		ctx->buf_size = size;
+	}
+
+	in = logic->data;
+	out = ctx->buf;
+	table = ctx->table;
+	offsets = ctx->byte_offsets;
+	num_bytes = ctx->num_bytes;
+	for (i = 0; i < num_samples; i++) {
+		v = 0;
+		for (k = 0; k < num_bytes; k++)
+			v |= table[k * 256 + in[offsets[k]]];
+		/* Following samples overwrite the excess bytes. */
+		WL64(out, v);
+		in += logic->unitsize;
+		out += ctx->out_unitsize;
+	}
+
+	ctx->logic.length = num_samples * ctx->out_unitsize;
+	ctx->logic.unitsize = ctx->out_unitsize;
+	ctx->logic.data = ctx->buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		/* Channels may have been enabled or disabled since. */
+		dev_out_update(ctx, t->sdi);
+		ctx->in_unitsize = 0;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!logic->unitsize)
+			break;
+		subset_logic(ctx, logic);
+		*packet_out = &ctx->packet;
+		return SR_OK;
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	*packet_out = packet_in;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_slist_free(ctx->channels);
+	g_slist_free_full(ctx->out_channels, sr_channel_free_cb);
+	g_slist_free(ctx->dev_out.channels);
+	sr_config_cache_free(&ctx->dev_out);
+	t->sdi_out = NULL;
+	g_free(ctx->byte_offsets);
+	g_free(ctx->table);
+	g_free(ctx->buf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma-separated list of logic channels to keep, in output bit order; all enabled channels if empty", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_subset = {
+	.id = "subset",
+	.name = "Channel subset",
+	.desc = "Repack logic data to only the selected channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
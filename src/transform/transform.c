@@ -45,12 +45,16 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_subset;
+extern SR_PRIV struct sr_transform_module transform_decimate;
 /** @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_subset,
+	&transform_decimate,
 	NULL,
 };
 
@@ -208,9 +212,13 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 	gpointer key, value;
 	int i;
 
+	if (sr_transform_module_sanity_check(tmod) != SR_OK)
+		return NULL;
+
 	t = g_malloc(sizeof(struct sr_transform));
 	t->module = tmod;
 	t->sdi = sdi;
+	t->sdi_out = NULL;
 
 	new_opts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
 			(GDestroyNotify)g_variant_unref);
@@ -259,7 +267,8 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 		g_hash_table_destroy(new_opts);
 
 	/* Add the transform to the session's list of transforms. */
-	sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
+	if (t)
+		sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
 
 	return t;
 }
@@ -284,4 +293,219 @@ SR_API int sr_transform_free(const struct sr_transform *t)
 	return ret;
 }
 
+/** @cond PRIVATE */
+/* Samples per block of a fused pass over logic data. */
+#define FUSE_BLOCK_SAMPLES 64
+/** @endcond */
+
+static gboolean fusable(GSList *l)
+{
+	return l && ((const struct sr_transform *)l->data)->module->kernel;
+}
+
+static void fuse_logic_init(struct sr_transform_fuse *fuse, size_t unitsize)
+{
+	if (fuse->unitsize != unitsize) {
+		fuse->and_mask = g_realloc(fuse->and_mask, unitsize);
+		fuse->xor_mask = g_realloc(fuse->xor_mask, unitsize);
+		fuse->and_block = g_realloc(fuse->and_block,
+			FUSE_BLOCK_SAMPLES * unitsize);
+		fuse->xor_block = g_realloc(fuse->xor_block,
+			FUSE_BLOCK_SAMPLES * unitsize);
+		fuse->unitsize = unitsize;
+		fuse->block_unitsize = 0;
+	}
+	memset(fuse->and_mask, 0xff, unitsize);
+	memset(fuse->xor_mask, 0, unitsize);
+}
+
+/* Append a kernel: ((s & a1) ^ x1) & a2 ^ x2 == (s & a1 & a2) ^ (x1 & a2 ^ x2). */
+static void fuse_logic_add(struct sr_transform_fuse *fuse,
+		const struct sr_transform_kernel *kernel)
+{
+	uint8_t a, x;
+	size_t i;
+
+	for (i = 0; i < fuse->unitsize; i++) {
+		a = kernel->and_mask ? kernel->and_mask[i] : 0xff;
+		x = kernel->xor_mask ? kernel->xor_mask[i] : 0;
+		fuse->xor_mask[i] = (fuse->xor_mask[i] & a) ^ x;
+		fuse->and_mask[i] &= a;
+	}
+}
+
+static void fuse_logic_apply(struct sr_transform_fuse *fuse,
+		const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *and_block, *xor_block;
+	uint8_t *data;
+	uint64_t length, i, j;
+	size_t unitsize, block;
+	gboolean identity;
+
+	unitsize = fuse->unitsize;
+	identity = TRUE;
+	for (i = 0; i < unitsize && identity; i++)
+		identity = fuse->and_mask[i] == 0xff && !fuse->xor_mask[i];
+	if (identity)
+		return;
+
+	block = FUSE_BLOCK_SAMPLES * unitsize;
+	if (fuse->block_unitsize != unitsize
+			|| memcmp(fuse->and_block, fuse->and_mask, unitsize)
+			|| memcmp(fuse->xor_block, fuse->xor_mask, unitsize)) {
+		memcpy(fuse->and_block, fuse->and_mask, unitsize);
+		memcpy(fuse->xor_block, fuse->xor_mask, unitsize);
+		for (i = unitsize; i < block; i++) {
+			fuse->and_block[i] = fuse->and_block[i - unitsize];
+			fuse->xor_block[i] = fuse->xor_block[i - unitsize];
+		}
+		fuse->block_unitsize = unitsize;
+	}
+
+	and_block = fuse->and_block;
+	xor_block = fuse->xor_block;
+	length = logic->length / unitsize * unitsize;
+	/* Compilers turn the inner loop into vector instructions. */
+	for (i = 0; i + block <= length; i += block) {
+		data = (uint8_t *)logic->data + i;
+		for (j = 0; j < block; j++)
+			data[j] = (data[j] & and_block[j]) ^ xor_block[j];
+	}
+	data = (uint8_t *)logic->data + i;
+	for (j = 0; j < length - i; j++)
+		data[j] = (data[j] & and_block[j]) ^ xor_block[j];
+}
+
+/**
+ * Run transforms with element-wise kernels in a single pass.
+ *
+ * Starting at the first of the transforms, the kernels of all adjacent
+ * transforms which provide one for the packet are composed and applied
+ * at once. Nothing is done unless there are at least two of them, a
+ * single transform is better off in its own receive().
+ *
+ * @param fuse Scratch space, kept across calls.
+ * @param transforms List of struct sr_transform, the first of which is
+ *                   the next to run on the packet.
+ * @param packet The packet. Modified in place.
+ * @param count Number of transforms run. 0 if the first one is to be
+ *              run by its receive().
+ *
+ * @retval SR_OK Success.
+ * @retval other Error code of a transform module.
+ *
+ * @private
+ */
+SR_PRIV int sr_transform_fuse_run(struct sr_transform_fuse *fuse,
+		GSList *transforms, struct sr_datafeed_packet *packet,
+		unsigned int *count)
+{
+	const struct sr_transform *t;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	struct sr_transform_kernel kernel;
+	struct sr_rational scale;
+	unsigned int n;
+	GSList *l;
+	int ret;
+
+	*count = 0;
+	if (packet->type != SR_DF_LOGIC && packet->type != SR_DF_ANALOG)
+		return SR_OK;
+	if (!fusable(transforms) || !fusable(transforms->next))
+		return SR_OK;
+
+	logic = NULL;
+	analog = NULL;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		if (!logic->unitsize)
+			return SR_OK;
+		fuse_logic_init(fuse, logic->unitsize);
+	} else {
+		analog = packet->payload;
+	}
+	scale.p = 1;
+	scale.q = 1;
+
+	for (n = 0, l = transforms; fusable(l); n++, l = l->next) {
+		t = l->data;
+		kernel.and_mask = NULL;
+		kernel.xor_mask = NULL;
+		kernel.scale.p = 1;
+		kernel.scale.q = 1;
+		ret = t->module->kernel(t, packet, &kernel);
+		if (ret == SR_ERR_NA)
+			break;
+		if (ret != SR_OK)
+			return ret;
+		if (logic) {
+			fuse_logic_add(fuse, &kernel);
+		} else {
+			/* Same products as multiplying in sequence. */
+			scale.p *= kernel.scale.p;
+			scale.q *= kernel.scale.q;
+		}
+	}
+	if (n < 2)
+		return SR_OK;
+
+	sr_spew("Running %u transform modules in one pass.", n);
+	if (logic) {
+		fuse_logic_apply(fuse, logic);
+	} else {
+		analog->encoding->scale.p *= scale.p;
+		analog->encoding->scale.q *= scale.q;
+	}
+	*count = n;
+
+	return SR_OK;
+}
+
+/**
+ * Get the device as seen downstream of a list of transforms.
+ *
+ * Transforms which change the channel layout of logic packets publish
+ * a device instance with the channels of their output, see
+ * sr_transform.sdi_out. Outputs and datafeed callbacks map logic bits
+ * to channels by index, so they must be given that one.
+ *
+ * @param transforms List of struct sr_transform, in order.
+ * @param sdi The device the packets come from.
+ *
+ * @return The device instance of the last transform publishing one,
+ *         or sdi.
+ *
+ * @private
+ */
+SR_PRIV const struct sr_dev_inst *sr_transform_dev_inst_get(GSList *transforms,
+		const struct sr_dev_inst *sdi)
+{
+	const struct sr_transform *t;
+	GSList *l;
+
+	for (l = transforms; l; l = l->next) {
+		t = l->data;
+		if (t->sdi_out)
+			sdi = t->sdi_out;
+	}
+
+	return sdi;
+}
+
+/**
+ * Free the buffers of transform fusion scratch space.
+ *
+ * @private
+ */
+SR_PRIV void sr_transform_fuse_clear(struct sr_transform_fuse *fuse)
+{
+	g_free(fuse->and_mask);
+	g_free(fuse->xor_mask);
+	g_free(fuse->and_block);
+	g_free(fuse->xor_block);
+	memset(fuse, 0, sizeof(*fuse));
+}
+
 /** @} */
@@ -33,6 +33,9 @@
 
 #define LOG_PREFIX "usb"
 
+/* Longest wait of the libusb event thread, to notice it is done. */
+#define USB_EVENT_POLL_MS 100
+
 #if !HAVE_LIBUSB_OS_HANDLE
 typedef int libusb_os_handle;
 #endif
@@ -47,11 +50,153 @@ struct usb_source {
 
 	/* Needed to keep track of installed sources */
 	struct sr_session *session;
+	void *key;
 
+	struct sr_context *ctx;
 	struct libusb_context *usb_ctx;
 	GPtrArray *pollfds;
+	/*
+	 * Set for devices in device threads: the libusb event thread
+	 * handles I/O, the source only calls the driver.
+	 */
+	gboolean threaded;
 };
 
+/*
+ * libusb allows one set of pollfd notifiers per context, so devices in
+ * device threads can't each poll the context's descriptors. One thread
+ * per context handles libusb events for all of them instead, for as
+ * long as any of their sources exists. Transfer callbacks run in this
+ * thread; usb_mutex serializes them with the drivers' calls from the
+ * device threads, so drivers still never run concurrently with
+ * themselves.
+ */
+static gpointer usb_event_thread(gpointer data)
+{
+	struct sr_context *ctx;
+	const struct libusb_pollfd **upollfds;
+	GArray *pollfds;
+	GPollFD pollfd;
+	struct timeval tv;
+	int64_t timeout_ms;
+	unsigned int i;
+
+	ctx = data;
+	pollfds = g_array_new(FALSE, FALSE, sizeof(GPollFD));
+	/* Hand packets to the session threads, like device threads. */
+	sr_session_async_thread_set(TRUE);
+
+	for (;;) {
+		g_mutex_lock(&ctx->usb_thread_mutex);
+		if (!ctx->usb_thread_users) {
+			ctx->usb_thread_running = FALSE;
+			g_mutex_unlock(&ctx->usb_thread_mutex);
+			break;
+		}
+		g_mutex_unlock(&ctx->usb_thread_mutex);
+
+		/* Wait without the lock, drivers may run meanwhile. */
+		timeout_ms = USB_EVENT_POLL_MS;
+		if (libusb_get_next_timeout(ctx->libusb_ctx, &tv) == 1)
+			timeout_ms = MIN(timeout_ms, (int64_t)tv.tv_sec * 1000
+				+ (tv.tv_usec + 999) / 1000);
+		if ((upollfds = libusb_get_pollfds(ctx->libusb_ctx))) {
+			g_array_set_size(pollfds, 0);
+			for (i = 0; upollfds[i]; i++) {
+				pollfd.fd = (gintptr)upollfds[i]->fd;
+#ifdef _WIN32
+				pollfd.events = G_IO_IN;
+#else
+				pollfd.events = upollfds[i]->events;
+#endif
+				pollfd.revents = 0;
+				g_array_append_val(pollfds, pollfd);
+			}
+#if (LIBUSB_API_VERSION >= 0x01000104)
+			libusb_free_pollfds(upollfds);
+#else
+			free(upollfds);
+#endif
+			g_poll((GPollFD *)pollfds->data, pollfds->len, timeout_ms);
+		} else {
+			g_usleep(1000);
+		}
+
+		tv.tv_sec = tv.tv_usec = 0;
+		usb_events_lock(ctx);
+		libusb_handle_events_timeout_completed(ctx->libusb_ctx, &tv, NULL);
+		usb_events_unlock(ctx);
+	}
+
+	sr_session_async_thread_set(FALSE);
+	g_array_free(pollfds, TRUE);
+
+	return NULL;
+}
+
+/* Start the libusb event thread with the first source needing it. */
+static void usb_events_thread_ref(struct sr_context *ctx)
+{
+	g_mutex_lock(&ctx->usb_thread_mutex);
+	if (ctx->usb_thread_users++ == 0 && !ctx->usb_thread_running) {
+		/* A previous thread is on its way out. */
+		if (ctx->usb_thread)
+			g_thread_join(ctx->usb_thread);
+		ctx->usb_thread_running = TRUE;
+		ctx->usb_thread = g_thread_new("sr-usb", &usb_event_thread, ctx);
+	}
+	g_mutex_unlock(&ctx->usb_thread_mutex);
+}
+
+/*
+ * The thread exits on its own once the last source is gone. It is not
+ * joined here: the last source may be destroyed from a transfer callback,
+ * which runs in the thread itself.
+ */
+static void usb_events_thread_unref(struct sr_context *ctx)
+{
+	g_mutex_lock(&ctx->usb_thread_mutex);
+	ctx->usb_thread_users--;
+	g_mutex_unlock(&ctx->usb_thread_mutex);
+}
+
+SR_PRIV void usb_events_init(struct sr_context *ctx)
+{
+	g_rec_mutex_init(&ctx->usb_mutex);
+	g_mutex_init(&ctx->usb_thread_mutex);
+}
+
+SR_PRIV void usb_events_exit(struct sr_context *ctx)
+{
+	g_mutex_lock(&ctx->usb_thread_mutex);
+	if (ctx->usb_thread_users) {
+		sr_err("%u USB event source(s) left at exit.",
+			ctx->usb_thread_users);
+		ctx->usb_thread_users = 0;
+	}
+	g_mutex_unlock(&ctx->usb_thread_mutex);
+	if (ctx->usb_thread)
+		g_thread_join(ctx->usb_thread);
+	ctx->usb_thread = NULL;
+
+	g_rec_mutex_clear(&ctx->usb_mutex);
+	g_mutex_clear(&ctx->usb_thread_mutex);
+}
+
+/*
+ * Serialize a driver's calls for a device in a device thread with the
+ * libusb event thread, which runs the driver's transfer callbacks.
+ */
+SR_PRIV void usb_events_lock(struct sr_context *ctx)
+{
+	g_rec_mutex_lock(&ctx->usb_mutex);
+}
+
+SR_PRIV void usb_events_unlock(struct sr_context *ctx)
+{
+	g_rec_mutex_unlock(&ctx->usb_mutex);
+}
+
 /** USB event source prepare() method.
  */
 static gboolean usb_source_prepare(GSource *source, int *timeout)
@@ -64,7 +209,8 @@ static gboolean usb_source_prepare(GSource *source, int *timeout)
 
 	usource = (struct usb_source *)source;
 
-	ret = libusb_get_next_timeout(usource->usb_ctx, &usb_timeout);
+	ret = usource->threaded ? 0
+		: libusb_get_next_timeout(usource->usb_ctx, &usb_timeout);
 	if (G_UNLIKELY(ret < 0)) {
 		sr_err("Failed to get libusb timeout: %s",
 			libusb_error_name(ret));
@@ -138,7 +284,13 @@ static gboolean usb_source_dispatch(GSource *source,
 		sr_err("Callback not set, cannot dispatch event.");
 		return G_SOURCE_REMOVE;
 	}
-	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, revents, user_data);
+	if (usource->threaded) {
+		usb_events_lock(usource->ctx);
+		keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, revents, user_data);
+		usb_events_unlock(usource->ctx);
+	} else {
+		keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, revents, user_data);
+	}
 
 	if (G_LIKELY(keep) && G_LIKELY(!g_source_is_destroyed(source))) {
 		if (usource->timeout_us >= 0)
@@ -160,13 +312,15 @@ static void usb_source_finalize(GSource *source)
 
 	sr_spew("%s", __func__);
 
-	libusb_set_pollfd_notifiers(usource->usb_ctx, NULL, NULL, NULL);
+	if (usource->threaded)
+		usb_events_thread_unref(usource->ctx);
+	else
+		libusb_set_pollfd_notifiers(usource->usb_ctx, NULL, NULL, NULL);
 
 	g_ptr_array_unref(usource->pollfds);
 	usource->pollfds = NULL;
 
-	sr_session_source_destroyed(usource->session,
-			usource->usb_ctx, source);
+	sr_session_source_destroyed(usource->session, usource->key, source);
 }
 
 /** Callback invoked when a new libusb FD should be added to the poll set.
@@ -243,13 +397,19 @@ static void usb_source_free_pollfd(void *data)
  * API at some point. Instead, drivers should install separate timer
  * event sources for their polling needs.
  *
+ * Sources of devices in device threads leave libusb's events to the
+ * libusb event thread, and only call the driver on timeout.
+ *
  * @param session The session the event source belongs to.
- * @param usb_ctx The libusb context for which to handle events.
+ * @param ctx The libsigrok context for whose libusb context to handle events.
+ * @param key The key the source is registered under.
+ * @param threaded Whether the device runs in a device thread.
  * @param timeout_ms The timeout interval in ms, or -1 to wait indefinitely.
  * @return A new event source object, or NULL on failure.
  */
 static GSource *usb_source_new(struct sr_session *session,
-		struct libusb_context *usb_ctx, int timeout_ms)
+		struct sr_context *ctx, void *key, gboolean threaded,
+		int timeout_ms)
 {
 	static GSourceFuncs usb_source_funcs = {
 		.prepare  = &usb_source_prepare,
@@ -259,10 +419,12 @@ static GSource *usb_source_new(struct sr_session *session,
 	};
 	GSource *source;
 	struct usb_source *usource;
+	struct libusb_context *usb_ctx;
 	const struct libusb_pollfd **upollfds, **upfd;
 
-	upollfds = libusb_get_pollfds(usb_ctx);
-	if (!upollfds) {
+	usb_ctx = ctx->libusb_ctx;
+	upollfds = NULL;
+	if (!threaded && !(upollfds = libusb_get_pollfds(usb_ctx))) {
 		sr_err("Failed to get libusb file descriptors.");
 		return NULL;
 	}
@@ -279,8 +441,16 @@ static GSource *usb_source_new(struct sr_session *session,
 		usource->due_us = INT64_MAX;
 	}
 	usource->session = session;
+	usource->key = key;
+	usource->ctx = ctx;
 	usource->usb_ctx = usb_ctx;
 	usource->pollfds = g_ptr_array_new_full(8, &usb_source_free_pollfd);
+	usource->threaded = threaded;
+
+	if (threaded) {
+		usb_events_thread_ref(ctx);
+		return source;
+	}
 
 	for (upfd = upollfds; *upfd != NULL; upfd++)
 		usb_pollfd_added((*upfd)->fd, (*upfd)->events, usource);
@@ -445,29 +615,51 @@ SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb)
 	sr_dbg("Closed USB device %d.%d.", usb->bus, usb->address);
 }
 
-SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
-		int timeout, sr_receive_data_callback cb, void *cb_data)
+/*
+ * Devices in the session thread share one source per libusb context,
+ * which owns the context's pollfd notifiers. Devices in device threads
+ * have a source of their own, keyed on the device.
+ */
+static void *usb_source_key(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx)
+{
+	if (sr_session_dev_threaded(sdi->session, sdi))
+		return (void *)sdi;
+
+	return ctx->libusb_ctx;
+}
+
+SR_PRIV int usb_source_add(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int timeout, sr_receive_data_callback cb,
+		void *cb_data)
 {
 	GSource *source;
+	gboolean threaded;
+	void *key;
 	int ret;
 
-	source = usb_source_new(session, ctx->libusb_ctx, timeout);
+	threaded = sr_session_dev_threaded(sdi->session, sdi);
+	key = usb_source_key(sdi, ctx);
+	source = usb_source_new(sdi->session, ctx, key, threaded, timeout);
 	if (!source)
 		return SR_ERR;
 
 	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
 
-	ret = sr_session_source_add_internal(session, ctx->libusb_ctx, source);
+	ret = sr_session_dev_source_add(sdi->session, sdi, key, source);
 	g_source_unref(source);
 
 	return ret;
 }
 
-SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx)
+SR_PRIV int usb_source_remove(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx)
 {
-	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
+	return sr_session_source_remove_internal(sdi->session,
+		usb_source_key(sdi, ctx));
 }
 
+
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 {
 	uint8_t port_numbers[8];
@@ -550,3 +742,426 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 
 	return ret;
 }
+
+/** @cond PRIVATE */
+#define USB_STREAM_TRANSFER_MS	10
+#define USB_STREAM_RING_MS	500
+#define USB_STREAM_MAX_TRANSFERS	32
+#define USB_STREAM_SIZE_ALIGN	512
+/** @endcond */
+
+/** Ring of bulk IN transfers which continuously stream data to a driver.
+ *
+ * The transfers and their buffers are allocated once, and get submitted
+ * again as soon as the driver has consumed their content. The stream does
+ * not care what the data means, the driver's data callback does.
+ */
+struct sr_usb_stream {
+	struct libusb_device_handle *devhdl;
+	struct sr_usb_stream_config config;
+
+	sr_usb_stream_data_callback data_cb;
+	sr_usb_stream_done_callback done_cb;
+	void *cb_data;
+
+	struct libusb_transfer **transfers;
+	unsigned char **buffers;
+	unsigned int num_transfers;
+	unsigned int submitted;
+	size_t buffer_size;
+	unsigned int timeout_ms;
+	/* Time it takes the device to fill one transfer buffer. */
+	int64_t fill_time_us;
+	gboolean zero_copy;
+	gboolean aborting;
+	unsigned int empty_count;
+
+	struct sr_usb_stream_stats stats;
+};
+
+static void usb_stream_retire(struct sr_usb_stream *stream)
+{
+	struct sr_usb_stream_stats *stats;
+
+	stream->submitted--;
+	if (stream->submitted > 0)
+		return;
+
+	stats = &stream->stats;
+	sr_dbg("USB stream done: %" PRIu64 " transfers, %" PRIu64 " bytes, "
+		"%" PRIu64 " empty, %" PRIu64 " errors, %" PRIu64 " overruns, "
+		"%" PRIu64 " late resubmits.", stats->transfers, stats->bytes,
+		stats->empty, stats->errors, stats->overruns,
+		stats->late_resubmits);
+
+	/* Must be last, the callback may free the stream. */
+	if (stream->done_cb)
+		stream->done_cb(stream->cb_data);
+}
+
+static void usb_stream_resubmit(struct sr_usb_stream *stream,
+		struct libusb_transfer *transfer)
+{
+	int ret;
+
+	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+		return;
+
+	sr_err("%s: %s", __func__, libusb_error_name(ret));
+	sr_usb_stream_abort(stream);
+	usb_stream_retire(stream);
+}
+
+static void LIBUSB_CALL usb_stream_receive(struct libusb_transfer *transfer)
+{
+	struct sr_usb_stream *stream;
+	gboolean packet_has_error, keep;
+	int64_t start_us, elapsed_us;
+
+	stream = transfer->user_data;
+
+	/*
+	 * If the stream is shutting down, just retire any queued up
+	 * transfer that comes in.
+	 */
+	if (stream->aborting) {
+		usb_stream_retire(stream);
+		return;
+	}
+
+	sr_spew("%s: status %s, received %d bytes.", __func__,
+		libusb_error_name(transfer->status), transfer->actual_length);
+
+	packet_has_error = FALSE;
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		stream->stats.errors++;
+		sr_usb_stream_abort(stream);
+		usb_stream_retire(stream);
+		return;
+	case LIBUSB_TRANSFER_COMPLETED:
+	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
+		break;
+	case LIBUSB_TRANSFER_OVERFLOW:
+		stream->stats.overruns++;
+		packet_has_error = TRUE;
+		break;
+	default:
+		stream->stats.errors++;
+		packet_has_error = TRUE;
+		break;
+	}
+
+	if (transfer->actual_length == 0 || packet_has_error) {
+		stream->stats.empty++;
+		stream->empty_count++;
+		if (stream->config.max_empty &&
+				stream->empty_count > stream->config.max_empty) {
+			/*
+			 * The device gave up. End the acquisition, the
+			 * frontend will work out that the samplecount
+			 * is short.
+			 */
+			sr_usb_stream_abort(stream);
+			usb_stream_retire(stream);
+		} else {
+			usb_stream_resubmit(stream, transfer);
+		}
+		return;
+	}
+	stream->empty_count = 0;
+	stream->stats.transfers++;
+	stream->stats.bytes += transfer->actual_length;
+
+	start_us = g_get_monotonic_time();
+	keep = stream->data_cb(stream->cb_data,
+		transfer->buffer, transfer->actual_length);
+	if (!keep) {
+		sr_usb_stream_abort(stream);
+		usb_stream_retire(stream);
+		return;
+	}
+
+	/*
+	 * Processing the data took longer than the device needs to fill
+	 * a buffer. If this keeps happening the ring runs dry, and the
+	 * device overruns.
+	 */
+	elapsed_us = g_get_monotonic_time() - start_us;
+	if (elapsed_us > stream->fill_time_us)
+		stream->stats.late_resubmits++;
+
+	usb_stream_resubmit(stream, transfer);
+}
+
+/*
+ * Buffers are either all from libusb_dev_mem_alloc() or all from the
+ * heap, so that stream->zero_copy tells how to release any of them.
+ */
+static void usb_stream_buffers_free(struct sr_usb_stream *stream)
+{
+	unsigned int i;
+
+	if (!stream->buffers)
+		return;
+
+	for (i = 0; i < stream->num_transfers; i++) {
+		if (!stream->buffers[i])
+			continue;
+#if (LIBUSB_API_VERSION >= 0x01000105)
+		if (stream->zero_copy) {
+			libusb_dev_mem_free(stream->devhdl, stream->buffers[i],
+				stream->buffer_size);
+			stream->buffers[i] = NULL;
+			continue;
+		}
+#endif
+		g_free(stream->buffers[i]);
+		stream->buffers[i] = NULL;
+	}
+}
+
+static int usb_stream_buffers_alloc(struct sr_usb_stream *stream)
+{
+	unsigned int i;
+
+	stream->buffers = g_malloc0(sizeof(*stream->buffers)
+		* stream->num_transfers);
+
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	if (stream->zero_copy) {
+		for (i = 0; i < stream->num_transfers; i++) {
+			stream->buffers[i] = libusb_dev_mem_alloc(stream->devhdl,
+				stream->buffer_size);
+			if (!stream->buffers[i])
+				break;
+		}
+		if (i == stream->num_transfers)
+			return SR_OK;
+		/* Fall back to heap memory for the whole ring. */
+		sr_dbg("Zero-copy USB buffers unavailable, using heap memory.");
+		usb_stream_buffers_free(stream);
+	}
+#endif
+	stream->zero_copy = FALSE;
+
+	for (i = 0; i < stream->num_transfers; i++) {
+		stream->buffers[i] = g_try_malloc(stream->buffer_size);
+		if (!stream->buffers[i])
+			return SR_ERR_MALLOC;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Allocate a ring of bulk IN transfers for continuous data acquisition.
+ *
+ * The size and number of transfers is derived from the data rate given
+ * in @a config: each transfer holds config->transfer_ms worth of data,
+ * and all transfers together hold config->ring_ms worth of data, limited
+ * to config->max_transfers transfers.
+ *
+ * @param devhdl The USB device handle. Must not be NULL.
+ * @param config The stream parameters. Must not be NULL.
+ * @param data_cb Called with the content of each transfer that received
+ *                data. Returning FALSE ends the stream. Must not be NULL.
+ * @param done_cb Called when the stream has ended, after all transfers
+ *                have been returned by libusb. Can be NULL.
+ * @param cb_data Passed to the callbacks.
+ *
+ * @return A new stream, or NULL upon allocation errors.
+ *
+ * @private
+ */
+SR_PRIV struct sr_usb_stream *sr_usb_stream_new(
+		struct libusb_device_handle *devhdl,
+		const struct sr_usb_stream_config *config,
+		sr_usb_stream_data_callback data_cb,
+		sr_usb_stream_done_callback done_cb, void *cb_data)
+{
+	struct sr_usb_stream *stream;
+	struct libusb_transfer *transfer;
+	unsigned int i, transfer_ms, ring_ms, max_transfers;
+	uint64_t bytes_per_ms;
+	size_t align;
+
+	if (!devhdl || !config || !data_cb)
+		return NULL;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->devhdl = devhdl;
+	stream->config = *config;
+	stream->data_cb = data_cb;
+	stream->done_cb = done_cb;
+	stream->cb_data = cb_data;
+	stream->zero_copy = config->zero_copy;
+
+	transfer_ms = config->transfer_ms ? : USB_STREAM_TRANSFER_MS;
+	ring_ms = config->ring_ms ? : USB_STREAM_RING_MS;
+	max_transfers = config->max_transfers ? : USB_STREAM_MAX_TRANSFERS;
+	align = config->size_align ? : USB_STREAM_SIZE_ALIGN;
+	bytes_per_ms = MAX(config->bytes_per_sec / 1000, 1);
+
+	stream->buffer_size = transfer_ms * bytes_per_ms;
+	stream->buffer_size = (stream->buffer_size + align - 1) / align * align;
+	stream->num_transfers = ring_ms * bytes_per_ms / stream->buffer_size;
+	stream->num_transfers = CLAMP(stream->num_transfers, 1, max_transfers);
+	stream->fill_time_us = 1000 * stream->buffer_size / bytes_per_ms;
+
+	stream->timeout_ms = stream->num_transfers * stream->buffer_size
+		/ bytes_per_ms;
+	/* Leave a headroom of 25%. */
+	stream->timeout_ms += stream->timeout_ms / 4;
+
+	sr_dbg("USB stream: %u transfers of %zu bytes, timeout %u ms.",
+		stream->num_transfers, stream->buffer_size, stream->timeout_ms);
+
+	if (usb_stream_buffers_alloc(stream) != SR_OK) {
+		sr_err("USB transfer buffer malloc failed.");
+		sr_usb_stream_free(stream);
+		return NULL;
+	}
+
+	stream->transfers = g_malloc0(sizeof(*stream->transfers)
+		* stream->num_transfers);
+	for (i = 0; i < stream->num_transfers; i++) {
+		if (!(transfer = libusb_alloc_transfer(0))) {
+			sr_err("USB transfer malloc failed.");
+			sr_usb_stream_free(stream);
+			return NULL;
+		}
+		libusb_fill_bulk_transfer(transfer, devhdl, config->endpoint,
+			stream->buffers[i], stream->buffer_size,
+			usb_stream_receive, stream, stream->timeout_ms);
+		stream->transfers[i] = transfer;
+	}
+
+	return stream;
+}
+
+/**
+ * Release a stream's transfers and buffers.
+ *
+ * Must not be called while transfers are still pending, i.e. only
+ * before sr_usb_stream_start() or from within (or after) the done
+ * callback.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *stream)
+{
+	struct libusb_transfer *transfer;
+	unsigned int i;
+
+	if (!stream)
+		return;
+
+	if (stream->submitted)
+		sr_err("Freeing USB stream with %u pending transfers.",
+			stream->submitted);
+
+	for (i = 0; stream->transfers && i < stream->num_transfers; i++) {
+		if (!(transfer = stream->transfers[i]))
+			continue;
+		libusb_free_transfer(transfer);
+	}
+	usb_stream_buffers_free(stream);
+	g_free(stream->buffers);
+	g_free(stream->transfers);
+	g_free(stream);
+}
+
+/**
+ * Submit all of a stream's transfers.
+ *
+ * Once this was called, the done callback will be invoked exactly once,
+ * after all transfers were returned. If no transfer could be submitted
+ * at all, this happens before sr_usb_stream_start() returns.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Failed to submit the transfers.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_stream_start(struct sr_usb_stream *stream)
+{
+	unsigned int i;
+	int ret;
+
+	if (!stream)
+		return SR_ERR_ARG;
+
+	if (stream->submitted) {
+		sr_err("USB stream is already running.");
+		return SR_ERR;
+	}
+
+	stream->aborting = FALSE;
+	stream->empty_count = 0;
+	memset(&stream->stats, 0, sizeof(stream->stats));
+
+	for (i = 0; i < stream->num_transfers; i++) {
+		ret = libusb_submit_transfer(stream->transfers[i]);
+		if (ret != 0) {
+			sr_err("Failed to submit transfer: %s.",
+				libusb_error_name(ret));
+			/* Account for the failed transfer, too. */
+			stream->submitted++;
+			sr_usb_stream_abort(stream);
+			usb_stream_retire(stream);
+			return SR_ERR;
+		}
+		stream->submitted++;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Stop a running stream.
+ *
+ * Pending transfers are cancelled, the done callback gets invoked once
+ * libusb has returned all of them.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_stream_abort(struct sr_usb_stream *stream)
+{
+	unsigned int i;
+
+	if (!stream || stream->aborting)
+		return;
+
+	stream->aborting = TRUE;
+
+	for (i = stream->num_transfers; i > 0; i--)
+		libusb_cancel_transfer(stream->transfers[i - 1]);
+}
+
+/** Parameters the stream was created with. @private */
+SR_PRIV const struct sr_usb_stream_config *sr_usb_stream_config_get(
+		const struct sr_usb_stream *stream)
+{
+	return &stream->config;
+}
+
+/** Timeout of the stream's transfers in ms. @private */
+SR_PRIV unsigned int sr_usb_stream_timeout(const struct sr_usb_stream *stream)
+{
+	return stream->timeout_ms;
+}
+
+/** Size of each of the stream's transfer buffers. @private */
+SR_PRIV size_t sr_usb_stream_buffer_size(const struct sr_usb_stream *stream)
+{
+	return stream->buffer_size;
+}
+
+/** Counters of the stream's current or most recent run. @private */
+SR_PRIV const struct sr_usb_stream_stats *sr_usb_stream_stats_get(
+		const struct sr_usb_stream *stream)
+{
+	return &stream->stats;
+}
@@ -0,0 +1,172 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Async suite: helper threads feed a running session through
+ * sr_session_send_async(). A slow demo device keeps the session alive
+ * for the duration of a case. Latencies are from the send call to the
+ * datafeed callback.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+/* Producer packets are the only ones this wide. */
+#define ASYNC_UNITSIZE 8
+
+static const unsigned int producer_counts[] = { 1, 4 };
+static const size_t packet_sizes[] = { 4096, 65536 };
+
+struct async_case {
+	struct sr_dev_inst *sdi;
+	struct srbench_result *r;
+	size_t packet_size;
+};
+
+static gpointer async_producer(gpointer data)
+{
+	struct async_case *c;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t stamp;
+	uint8_t *buf;
+
+	c = data;
+	buf = g_malloc(c->packet_size);
+	srbench_fill_logic(buf, c->packet_size);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = c->packet_size;
+	logic.unitsize = ASYNC_UNITSIZE;
+	logic.data = buf;
+	do {
+		stamp = srbench_now_ns();
+		memcpy(buf, &stamp, sizeof(stamp));
+	} while (sr_session_send_async(c->sdi, &packet) == SR_OK);
+	g_free(buf);
+
+	return NULL;
+}
+
+static void async_datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct async_case *c;
+	const struct sr_datafeed_logic *logic;
+	uint64_t stamp;
+
+	(void)sdi;
+
+	c = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	if (logic->unitsize != ASYNC_UNITSIZE)
+		return;
+	memcpy(&stamp, logic->data, sizeof(stamp));
+	srbench_result_add_latency(c->r, srbench_now_ns() - stamp);
+	c->r->packets++;
+	c->r->bytes += logic->length;
+}
+
+static void async_run(struct sr_dev_driver *driver, unsigned int producers,
+		size_t packet_size)
+{
+	struct srbench_result r;
+	struct async_case c;
+	struct sr_session *session;
+	GThread *threads[4];
+	GSList *devices;
+	uint64_t start, allocs;
+	unsigned int i;
+	char variant[32];
+	int ret;
+
+	g_snprintf(variant, sizeof(variant), "%u-producer%s", producers,
+		producers > 1 ? "s" : "");
+	srbench_result_init(&r, "async", "demo");
+	r.variant = variant;
+	r.type = "logic";
+	r.unitsize = ASYNC_UNITSIZE;
+	r.packet_size = packet_size;
+
+	if (!(devices = sr_driver_scan(driver, NULL))) {
+		srbench_skip("async", "demo", "scan failed");
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	c.sdi = devices->data;
+	c.r = &r;
+	c.packet_size = packet_size;
+	g_slist_free(devices);
+
+	sr_session_new(srbench_ctx, &session);
+	sr_dev_open(c.sdi);
+	sr_session_dev_add(session, c.sdi);
+	sr_config_set(c.sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(1)));
+	sr_config_set(c.sdi, NULL, SR_CONF_LIMIT_MSEC,
+		g_variant_new_uint64(srbench_min_time_ns / 1000 / 1000));
+	sr_session_datafeed_callback_add(session, async_datafeed_in, &c);
+
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	if ((ret = sr_session_start(session)) == SR_OK) {
+		for (i = 0; i < producers; i++)
+			threads[i] = g_thread_new("producer", async_producer, &c);
+		ret = sr_session_run(session);
+		for (i = 0; i < producers; i++)
+			g_thread_join(threads[i]);
+	}
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	sr_session_destroy(session);
+	sr_dev_close(c.sdi);
+
+	if (ret != SR_OK) {
+		srbench_skip("async", variant, sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	srbench_report(&r);
+}
+
+void srbench_async(void)
+{
+	struct sr_dev_driver **drivers, *driver;
+	unsigned int i, j;
+
+	driver = NULL;
+	drivers = sr_driver_list(srbench_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(srbench_ctx, driver) != SR_OK) {
+		srbench_skip("async", "demo", "driver not available");
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(producer_counts); i++) {
+		for (j = 0; j < ARRAY_SIZE(packet_sizes); j++)
+			async_run(driver, producer_counts[i], packet_sizes[j]);
+	}
+}
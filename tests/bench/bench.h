@@ -0,0 +1,87 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBSIGROK_TESTS_BENCH_BENCH_H
+#define LIBSIGROK_TESTS_BENCH_BENCH_H
+
+#include <stdint.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+G_BEGIN_DECLS
+
+extern struct sr_context *srbench_ctx;
+
+/* Minimum wall clock time a single benchmark case runs for. */
+extern uint64_t srbench_min_time_ns;
+
+/**
+ * Accumulated measurements of one benchmark case. A case covers one
+ * module (or pipeline configuration) with one data shape.
+ */
+struct srbench_result {
+	const char *suite;
+	const char *module;
+	/* Free form case variant, e.g. the transform in front of a sink. */
+	const char *variant;
+	/* "logic" or "analog". */
+	const char *type;
+	size_t unitsize;
+	size_t packet_size;
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t time_ns;
+	uint64_t allocs;
+	/* Per-operation latencies in ns (uint64_t), may stay empty. */
+	GArray *latencies;
+};
+
+uint64_t srbench_now_ns(void);
+uint64_t srbench_allocs(void);
+gboolean srbench_allocs_counted(void);
+
+void srbench_result_init(struct srbench_result *r, const char *suite,
+		const char *module);
+void srbench_result_add_latency(struct srbench_result *r, uint64_t ns);
+void srbench_report(struct srbench_result *r);
+void srbench_skip(const char *suite, const char *module, const char *reason);
+
+void srbench_fill_logic(uint8_t *buf, size_t len);
+void srbench_fill_analog(float *buf, size_t num_samples);
+
+/* Suites. */
+void srbench_session(void);
+void srbench_output(void);
+void srbench_text(void);
+void srbench_input(void);
+void srbench_log(void);
+void srbench_startup(void);
+void srbench_config(void);
+void srbench_async(void);
+void srbench_sources(void);
+void srbench_convert(void);
+void srbench_transform(void);
+void srbench_envelope(void);
+#ifdef SRBENCH_CXX
+void srbench_cxx(void);
+#endif
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Config API: key lookups and option checks, as done by frontends
+ * that poll a device's settings from their UI loop.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+enum config_op {
+	CONFIG_KEY_INFO,
+	CONFIG_KEY_INFO_NAME,
+	CONFIG_HAS_OPTION,
+	CONFIG_CAPABILITIES,
+	CONFIG_GET,
+	CONFIG_SET,
+	CONFIG_LIST,
+	CONFIG_OPTIONS,
+};
+
+static void config_op_run(struct sr_dev_driver *driver,
+		struct sr_dev_inst *sdi, enum config_op op)
+{
+	GVariant *gvar;
+	GArray *opts;
+
+	switch (op) {
+	case CONFIG_KEY_INFO:
+		sr_key_info_get(SR_KEY_CONFIG, SR_CONF_SAMPLERATE);
+		break;
+	case CONFIG_KEY_INFO_NAME:
+		sr_key_info_name_get(SR_KEY_CONFIG, "samplerate");
+		break;
+	case CONFIG_HAS_OPTION:
+		sr_dev_has_option(sdi, SR_CONF_SAMPLERATE);
+		break;
+	case CONFIG_CAPABILITIES:
+		sr_dev_config_capabilities_list(sdi, NULL, SR_CONF_SAMPLERATE);
+		break;
+	case CONFIG_GET:
+		if (sr_config_get(driver, sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK)
+			g_variant_unref(gvar);
+		break;
+	case CONFIG_SET:
+		sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+			g_variant_new_uint64(1000));
+		break;
+	case CONFIG_LIST:
+		if (sr_config_list(driver, sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK)
+			g_variant_unref(gvar);
+		break;
+	case CONFIG_OPTIONS:
+		if ((opts = sr_dev_options(driver, sdi, NULL)))
+			g_array_free(opts, TRUE);
+		break;
+	}
+}
+
+static void config_run(struct sr_dev_driver *driver,
+		struct sr_dev_inst *sdi, const char *variant, enum config_op op)
+{
+	struct srbench_result r;
+	uint64_t start, t, allocs;
+
+	srbench_result_init(&r, "config", "demo");
+	r.variant = variant;
+	r.type = "op";
+
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	do {
+		t = srbench_now_ns();
+		config_op_run(driver, sdi, op);
+		srbench_result_add_latency(&r, srbench_now_ns() - t);
+		r.packets++;
+	} while (srbench_now_ns() - start < srbench_min_time_ns);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	srbench_report(&r);
+}
+
+void srbench_config(void)
+{
+	struct sr_dev_driver **drivers, *driver;
+	struct sr_dev_inst *sdi;
+	GSList *devices;
+	unsigned int i;
+
+	driver = NULL;
+	drivers = sr_driver_list(srbench_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(srbench_ctx, driver) != SR_OK) {
+		srbench_skip("config", "demo", "driver not available");
+		return;
+	}
+	if (!(devices = sr_driver_scan(driver, NULL))) {
+		srbench_skip("config", "demo", "scan failed");
+		return;
+	}
+	sdi = devices->data;
+	g_slist_free(devices);
+	sr_dev_open(sdi);
+
+	config_run(driver, sdi, "key-info-get", CONFIG_KEY_INFO);
+	config_run(driver, sdi, "key-info-name-get", CONFIG_KEY_INFO_NAME);
+	config_run(driver, sdi, "has-option", CONFIG_HAS_OPTION);
+	config_run(driver, sdi, "capabilities", CONFIG_CAPABILITIES);
+	config_run(driver, sdi, "config-get", CONFIG_GET);
+	config_run(driver, sdi, "config-set", CONFIG_SET);
+	config_run(driver, sdi, "config-list", CONFIG_LIST);
+	config_run(driver, sdi, "dev-options", CONFIG_OPTIONS);
+
+	sr_dev_close(sdi);
+}
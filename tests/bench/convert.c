@@ -0,0 +1,233 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Convert suite: sr_convert_file() between file formats, with all
+ * stages in the calling thread ("1-thread") and with input, transform
+ * and output stages in threads of their own ("pipeline"). Input
+ * documents are converted from a binary file up front. Throughput
+ * counts input file bytes, latencies are the times of whole
+ * conversions. The pipeline has at most three busy threads, so on
+ * machines with more cores the gain is bounded by the slowest stage.
+ * The "chain" variants run three transforms, which are fused into a
+ * single pass over the data.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+#define CONVERT_BINARY_BYTES	(4 * 1024 * 1024)
+#define SAMPLERATE		SR_MHZ(1)
+
+static const struct {
+	const char *input;
+	const char *output;
+} conversions[] = {
+	{ "binary", "csv" },
+	{ "binary", "vcd" },
+	{ "vcd", "binary" },
+	{ "csv", "vcd" },
+	{ "vcd", "srzip" },
+	{ "binary", "binary" },
+};
+
+/* Transforms of a variant. The last one inverts channel 0 only. */
+static const struct {
+	const char *name;
+	const char *ids[4];
+	gboolean channel_option;
+} chains[] = {
+	{ "", { NULL }, FALSE },
+	{ "-invert", { "invert", NULL }, FALSE },
+	{ "-chain", { "invert", "nop", "invert", NULL }, TRUE },
+};
+
+static char *tmpdir;
+
+static char *convert_path(const char *format)
+{
+	char *name, *path;
+
+	name = g_strconcat("input.", format, NULL);
+	path = g_build_filename(tmpdir, name, NULL);
+	g_free(name);
+
+	return path;
+}
+
+/* Write the binary document, and convert it into the other formats. */
+static gboolean convert_setup(void)
+{
+	struct sr_convert_options opts;
+	GHashTable *options;
+	uint8_t *data;
+	char *binary, *path;
+	unsigned int i;
+	gboolean ok;
+
+	if (!(tmpdir = g_dir_make_tmp("srbench-XXXXXX", NULL)))
+		return FALSE;
+
+	data = g_malloc(CONVERT_BINARY_BYTES);
+	srbench_fill_logic(data, CONVERT_BINARY_BYTES);
+	binary = convert_path("binary");
+	ok = g_file_set_contents(binary, (char *)data, CONVERT_BINARY_BYTES,
+		NULL);
+	g_free(data);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("samplerate"),
+		g_variant_ref_sink(g_variant_new_uint64(SAMPLERATE)));
+	memset(&opts, 0, sizeof(opts));
+	opts.input_format = "binary";
+	opts.input_options = options;
+	for (i = 0; ok && i < ARRAY_SIZE(conversions); i++) {
+		if (!strcmp(conversions[i].input, "binary"))
+			continue;
+		path = convert_path(conversions[i].input);
+		opts.output_format = conversions[i].input;
+		if (!g_file_test(path, G_FILE_TEST_EXISTS))
+			ok = sr_convert_file(srbench_ctx, binary, path,
+				&opts) == SR_OK;
+		g_free(path);
+	}
+	g_hash_table_destroy(options);
+	g_free(binary);
+
+	return ok;
+}
+
+static void convert_teardown(void)
+{
+	const char *name;
+	char *path;
+	GDir *dir;
+
+	if (!tmpdir)
+		return;
+	if ((dir = g_dir_open(tmpdir, 0, NULL))) {
+		while ((name = g_dir_read_name(dir))) {
+			path = g_build_filename(tmpdir, name, NULL);
+			g_unlink(path);
+			g_free(path);
+		}
+		g_dir_close(dir);
+	}
+	g_rmdir(tmpdir);
+	g_free(tmpdir);
+	tmpdir = NULL;
+}
+
+static void convert_run(const char *input, const char *output,
+		gboolean threaded, unsigned int chain)
+{
+	struct srbench_result r;
+	struct sr_convert_options opts;
+	GHashTable *options[3];
+	GStatBuf st;
+	char *input_file, *output_file, *module;
+	char variant[32];
+	uint64_t start, t, allocs;
+	int ret;
+
+	module = g_strconcat(input, "-", output, NULL);
+	g_snprintf(variant, sizeof(variant), "%s%s",
+		threaded ? "pipeline" : "1-thread", chains[chain].name);
+	srbench_result_init(&r, "convert", module);
+	r.variant = variant;
+	r.type = "logic";
+	r.unitsize = 1;
+
+	input_file = convert_path(input);
+	output_file = g_build_filename(tmpdir, "output", NULL);
+	memset(&opts, 0, sizeof(opts));
+	opts.input_format = input;
+	opts.output_format = output;
+	opts.transforms = chains[chain].ids[0] ?
+		(const char **)chains[chain].ids : NULL;
+	opts.single_thread = !threaded;
+	memset(options, 0, sizeof(options));
+	if (chains[chain].channel_option) {
+		options[2] = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)g_variant_unref);
+		/* Channel names of the binary input module are numbers. */
+		g_hash_table_insert(options[2], g_strdup("channels"),
+			g_variant_ref_sink(g_variant_new_string("0")));
+		opts.transform_options = options;
+	}
+
+	ret = g_stat(input_file, &st) < 0 ? SR_ERR_IO : SR_OK;
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	while (ret == SR_OK && srbench_now_ns() - start < srbench_min_time_ns) {
+		t = srbench_now_ns();
+		ret = sr_convert_file(srbench_ctx, input_file, output_file,
+			&opts);
+		srbench_result_add_latency(&r, srbench_now_ns() - t);
+		r.packets++;
+		r.bytes += st.st_size;
+	}
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	g_unlink(output_file);
+	g_free(output_file);
+	g_free(input_file);
+	if (options[2])
+		g_hash_table_destroy(options[2]);
+
+	if (ret != SR_OK) {
+		srbench_skip("convert", module, sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+	} else {
+		srbench_report(&r);
+	}
+	g_free(module);
+}
+
+void srbench_convert(void)
+{
+	unsigned int i, j;
+
+	if (!convert_setup()) {
+		srbench_skip("convert", "binary", "setup failed");
+		convert_teardown();
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(conversions); i++) {
+		if (!sr_input_find((char *)conversions[i].input)
+				|| !sr_output_find((char *)conversions[i].output)) {
+			srbench_skip("convert", conversions[i].output,
+				"module not available");
+			continue;
+		}
+		for (j = 0; j < ARRAY_SIZE(chains); j++) {
+			convert_run(conversions[i].input,
+				conversions[i].output, FALSE, j);
+			convert_run(conversions[i].input,
+				conversions[i].output, TRUE, j);
+		}
+	}
+
+	convert_teardown();
+}
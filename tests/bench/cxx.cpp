@@ -0,0 +1,160 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * C++ suite: the demo driver in its unthrottled test mode feeds a
+ * libsigrokcxx session, whose datafeed callback accesses the packets
+ * the way frontends do. Allocation counts cover the C++ dispatch of
+ * each packet on top of the session's own.
+ */
+
+#include <config.h>
+#include <libsigrokcxx/libsigrokcxx.hpp>
+#include "bench.h"
+
+using namespace std;
+using namespace sigrok;
+
+enum cxx_access {
+	/* Payload and its size. */
+	CXX_PAYLOAD,
+	/* Typed samples, summed up. */
+	CXX_SAMPLES,
+	/* Analog only: the channels of the samples, too. */
+	CXX_CHANNELS,
+};
+
+/* Keeps the compiler from dropping the sample sums. */
+static volatile double sink;
+
+static void cxx_datafeed_in(struct srbench_result *r, enum cxx_access access,
+		const shared_ptr<Packet> &packet)
+{
+	double sum = 0;
+
+	if (packet->type() == PacketType::LOGIC) {
+		auto logic = static_pointer_cast<Logic>(packet->payload());
+		auto bytes = logic->bytes();
+		if (access == CXX_SAMPLES)
+			for (auto sample : logic->samples<uint8_t>())
+				sum += sample;
+		r->packets++;
+		r->bytes += bytes.size();
+	} else if (packet->type() == PacketType::ANALOG) {
+		auto analog = static_pointer_cast<Analog>(packet->payload());
+		if (access == CXX_CHANNELS)
+			sum += analog->channels().size();
+		if (access != CXX_PAYLOAD)
+			for (auto sample : analog->samples<float>())
+				sum += sample;
+		r->packets++;
+		r->bytes += analog->num_samples() * analog->unitsize();
+	}
+	sink = sum;
+}
+
+static void cxx_run(shared_ptr<Context> context, shared_ptr<Driver> driver,
+		const char *variant, bool analog, enum cxx_access access)
+{
+	struct srbench_result r;
+	uint64_t start, allocs;
+
+	srbench_result_init(&r, "cxx", "demo");
+	r.variant = variant;
+	r.type = analog ? "analog" : "logic";
+	r.unitsize = analog ? 0 : 1;
+	r.packet_size = analog ? 0 : 4096;
+
+	try {
+		auto devices = driver->scan({
+			{ ConfigKey::NUM_LOGIC_CHANNELS,
+				Glib::Variant<gint32>::create(analog ? 0 : 8) },
+			{ ConfigKey::NUM_ANALOG_CHANNELS,
+				Glib::Variant<gint32>::create(analog ? 1 : 0) },
+		});
+		if (devices.empty()) {
+			srbench_skip("cxx", variant, "scan failed");
+			g_array_free(r.latencies, TRUE);
+			return;
+		}
+		auto device = devices.front();
+		device->open();
+		auto session = context->create_session();
+		session->add_device(device);
+		device->config_set(ConfigKey::TEST_MODE,
+			Glib::Variant<Glib::ustring>::create("max-throughput"));
+		if (!analog)
+			device->config_set(ConfigKey::BUFFERSIZE,
+				Glib::Variant<guint64>::create(r.packet_size));
+		device->config_set(ConfigKey::LIMIT_MSEC,
+			Glib::Variant<guint64>::create(
+				srbench_min_time_ns / 1000 / 1000));
+		session->add_datafeed_callback(
+			[&r, access](shared_ptr<Device>, shared_ptr<Packet> packet) {
+				try {
+					cxx_datafeed_in(&r, access, packet);
+				} catch (Error &) {
+					/* Encoding not as expected, count nothing. */
+				}
+			});
+
+		allocs = srbench_allocs();
+		start = srbench_now_ns();
+		session->start();
+		session->run();
+		r.time_ns = srbench_now_ns() - start;
+		r.allocs = srbench_allocs() - allocs;
+
+		session->remove_datafeed_callbacks();
+		session->remove_devices();
+		device->close();
+	} catch (Error &e) {
+		srbench_skip("cxx", variant, e.what());
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+
+	if (analog && r.packets)
+		r.packet_size = r.bytes / r.packets;
+	srbench_report(&r);
+}
+
+void srbench_cxx(void)
+{
+	shared_ptr<Context> context;
+	shared_ptr<Driver> driver;
+
+	try {
+		context = Context::create();
+		auto drivers = context->drivers();
+		if (drivers.count("demo"))
+			driver = drivers["demo"];
+	} catch (Error &e) {
+		srbench_skip("cxx", "demo", e.what());
+		return;
+	}
+	if (!driver) {
+		srbench_skip("cxx", "demo", "driver not available");
+		return;
+	}
+
+	cxx_run(context, driver, "payload", false, CXX_PAYLOAD);
+	cxx_run(context, driver, "samples", false, CXX_SAMPLES);
+	cxx_run(context, driver, "payload", true, CXX_PAYLOAD);
+	cxx_run(context, driver, "samples", true, CXX_SAMPLES);
+	cxx_run(context, driver, "channels", true, CXX_CHANNELS);
+}
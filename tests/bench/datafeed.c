@@ -0,0 +1,638 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <string.h>
+#include <sys/time.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+#define ANALOG_SAMPLES		4096
+#define INPUT_GEN_BYTES		(1024 * 1024)
+#define SAMPLERATE		SR_MHZ(1)
+
+static const size_t unitsizes[] = { 1, 2, 4, 8 };
+static const size_t packet_sizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+static const size_t input_chunk_sizes[] = { 4 * 1024, 64 * 1024 };
+
+struct feed_stats {
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t last_ns;
+	struct srbench_result *r;
+};
+
+static void feed_count(struct feed_stats *st,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	uint64_t now;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		st->bytes += logic->length;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		st->bytes += analog->num_samples * analog->encoding->unitsize;
+		break;
+	default:
+		return;
+	}
+	st->packets++;
+
+	/* Delivery interval: the per-packet cost of the whole pipeline. */
+	now = srbench_now_ns();
+	if (st->last_ns && st->r)
+		srbench_result_add_latency(st->r, now - st->last_ns);
+	st->last_ns = now;
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+
+	feed_count(cb_data, packet);
+}
+
+static struct sr_config *config_new(uint32_t key, GVariant *data)
+{
+	struct sr_config *src;
+
+	src = g_malloc(sizeof(*src));
+	src->key = key;
+	src->data = g_variant_ref_sink(data);
+
+	return src;
+}
+
+static void config_free(gpointer data)
+{
+	struct sr_config *src;
+
+	src = data;
+	g_variant_unref(src->data);
+	g_free(src);
+}
+
+/*
+ * Session suite: the demo driver in its unthrottled test mode feeds the
+ * session, optionally through one transform, into a counting callback.
+ */
+static void session_run(struct sr_dev_driver *driver, const char *transform,
+		size_t unitsize, size_t packet_size)
+{
+	struct srbench_result r;
+	struct feed_stats st;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	const struct sr_transform_module *tmod;
+	GSList *options, *devices;
+	uint64_t start, allocs;
+	int ret;
+
+	srbench_result_init(&r, "session", "demo");
+	r.variant = transform ? transform : "none";
+	r.type = unitsize ? "logic" : "analog";
+	r.unitsize = unitsize;
+	r.packet_size = packet_size;
+
+	options = g_slist_append(NULL, config_new(SR_CONF_NUM_LOGIC_CHANNELS,
+		g_variant_new_int32(unitsize * 8)));
+	options = g_slist_append(options, config_new(SR_CONF_NUM_ANALOG_CHANNELS,
+		g_variant_new_int32(unitsize ? 0 : 1)));
+	devices = sr_driver_scan(driver, options);
+	g_slist_free_full(options, config_free);
+	if (!devices) {
+		srbench_skip("session", "demo", "scan failed");
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	sr_session_new(srbench_ctx, &session);
+	sr_dev_open(sdi);
+	sr_session_dev_add(session, sdi);
+	sr_config_set(sdi, NULL, SR_CONF_TEST_MODE,
+		g_variant_new_string("max-throughput"));
+	if (unitsize)
+		sr_config_set(sdi, NULL, SR_CONF_BUFFERSIZE,
+			g_variant_new_uint64(packet_size));
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_MSEC,
+		g_variant_new_uint64(srbench_min_time_ns / 1000 / 1000));
+
+	memset(&st, 0, sizeof(st));
+	st.r = &r;
+	sr_session_datafeed_callback_add(session, datafeed_in, &st);
+
+	if (transform) {
+		tmod = sr_transform_find(transform);
+		if (!tmod || !sr_transform_new(tmod, NULL, sdi)) {
+			srbench_skip("session", transform, "transform init failed");
+			g_array_free(r.latencies, TRUE);
+			sr_session_destroy(session);
+			sr_dev_close(sdi);
+			return;
+		}
+	}
+
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	if ((ret = sr_session_start(session)) == SR_OK)
+		ret = sr_session_run(session);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+	r.packets = st.packets;
+	r.bytes = st.bytes;
+
+	sr_session_destroy(session);
+	sr_dev_close(sdi);
+
+	if (ret != SR_OK) {
+		srbench_skip("session", r.variant, sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	if (!unitsize && r.packets)
+		r.packet_size = r.bytes / r.packets;
+	srbench_report(&r);
+}
+
+void srbench_session(void)
+{
+	struct sr_dev_driver **drivers, *driver;
+	const struct sr_transform_module **tmods;
+	GSList *transforms, *l;
+	unsigned int i, j;
+
+	driver = NULL;
+	drivers = sr_driver_list(srbench_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(srbench_ctx, driver) != SR_OK) {
+		srbench_skip("session", "demo", "driver not available");
+		return;
+	}
+
+	/* NULL stands for "no transform". */
+	transforms = g_slist_append(NULL, NULL);
+	tmods = sr_transform_list();
+	for (i = 0; tmods && tmods[i]; i++) {
+		transforms = g_slist_append(transforms,
+			(gpointer)sr_transform_id_get(tmods[i]));
+	}
+
+	for (l = transforms; l; l = l->next) {
+		for (i = 0; i < ARRAY_SIZE(unitsizes); i++) {
+			for (j = 0; j < ARRAY_SIZE(packet_sizes); j++)
+				session_run(driver, l->data, unitsizes[i],
+					packet_sizes[j]);
+		}
+		session_run(driver, l->data, 0, 0);
+	}
+	g_slist_free(transforms);
+
+	sr_dev_clear(driver);
+}
+
+static struct sr_dev_inst *user_dev_new(size_t unitsize, gboolean analog)
+{
+	struct sr_dev_inst *sdi;
+	unsigned int i;
+	char name[8];
+
+	sdi = sr_dev_inst_user_new("sigrok", "bench", NULL);
+	for (i = 0; i < unitsize * 8; i++) {
+		g_snprintf(name, sizeof(name), "D%u", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	if (analog)
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_ANALOG, "A0");
+
+	return sdi;
+}
+
+static int output_send(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString **out)
+{
+	GString *s;
+	int ret;
+
+	s = NULL;
+	ret = sr_output_send(o, packet, &s);
+	if (s && out && *out)
+		g_string_append_len(*out, s->str, s->len);
+	if (s)
+		g_string_free(s, TRUE);
+
+	return ret;
+}
+
+static void output_begin(const struct sr_output *o, GString **out)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+
+	header.feed_version = 1;
+	gettimeofday(&header.starttime, NULL);
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	output_send(o, &packet, out);
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(SAMPLERATE));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	output_send(o, &packet, out);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+}
+
+static void output_end(const struct sr_output *o, GString **out)
+{
+	struct sr_datafeed_packet packet;
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	output_send(o, &packet, out);
+}
+
+static void analog_packet_init(struct sr_datafeed_analog *analog,
+		struct sr_analog_encoding *encoding,
+		struct sr_analog_meaning *meaning, struct sr_analog_spec *spec,
+		struct sr_channel *ch, float *data, size_t num_samples)
+{
+	memset(encoding, 0, sizeof(*encoding));
+	encoding->unitsize = sizeof(float);
+	encoding->is_signed = TRUE;
+	encoding->is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding->is_bigendian = TRUE;
+#endif
+	encoding->digits = 3;
+	encoding->is_digits_decimal = TRUE;
+	encoding->scale.p = encoding->scale.q = 1;
+	encoding->offset.p = 0;
+	encoding->offset.q = 1;
+
+	memset(meaning, 0, sizeof(*meaning));
+	meaning->mq = SR_MQ_VOLTAGE;
+	meaning->unit = SR_UNIT_VOLT;
+	meaning->mqflags = SR_MQFLAG_DC;
+	meaning->channels = g_slist_append(NULL, ch);
+
+	spec->spec_digits = 3;
+
+	analog->data = data;
+	analog->num_samples = num_samples;
+	analog->encoding = encoding;
+	analog->meaning = meaning;
+	analog->spec = spec;
+}
+
+/*
+ * Output suite: synthetic packets go straight into every output module,
+ * the per-packet latency is the time sr_output_send() takes. The "sink"
+ * variants use sr_output_send_append() with a reused buffer instead.
+ */
+static void output_run(const struct sr_output_module *omod, size_t unitsize,
+		size_t packet_size, gboolean sink)
+{
+	struct srbench_result r;
+	struct sr_dev_inst *sdi;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	GSList *channels;
+	GString *buf;
+	void *data;
+	uint64_t start, t, allocs;
+
+	srbench_result_init(&r, "output", sr_output_id_get(omod));
+	if (sink)
+		r.variant = "sink";
+	r.type = unitsize ? "logic" : "analog";
+	r.unitsize = unitsize ? unitsize : sizeof(float);
+	r.packet_size = packet_size;
+
+	sdi = user_dev_new(unitsize, !unitsize);
+	o = sr_output_new(omod, NULL, sdi, NULL);
+	if (!o) {
+		srbench_skip("output", r.module, "init failed");
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+
+	data = g_malloc(packet_size);
+	if (unitsize) {
+		srbench_fill_logic(data, packet_size);
+		logic.length = packet_size;
+		logic.unitsize = unitsize;
+		logic.data = data;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+	} else {
+		srbench_fill_analog(data, packet_size / sizeof(float));
+		channels = sr_dev_inst_channels_get(sdi);
+		analog_packet_init(&analog, &encoding, &meaning, &spec,
+			channels->data, data, packet_size / sizeof(float));
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+	}
+
+	output_begin(o, NULL);
+	buf = g_string_sized_new(packet_size);
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	do {
+		t = srbench_now_ns();
+		if (sink) {
+			g_string_truncate(buf, 0);
+			sr_output_send_append(o, &packet, buf);
+		} else {
+			output_send(o, &packet, NULL);
+		}
+		srbench_result_add_latency(&r, srbench_now_ns() - t);
+		r.packets++;
+		r.bytes += packet_size;
+	} while (srbench_now_ns() - start < srbench_min_time_ns);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+	output_end(o, NULL);
+	g_string_free(buf, TRUE);
+
+	sr_output_free(o);
+	if (!unitsize)
+		g_slist_free(meaning.channels);
+	g_free(data);
+
+	srbench_report(&r);
+}
+
+void srbench_output(void)
+{
+	const struct sr_output_module **omods;
+	unsigned int i, j, k;
+
+	omods = sr_output_list();
+	for (i = 0; omods && omods[i]; i++) {
+		if (sr_output_test_flag(omods[i], SR_OUTPUT_INTERNAL_IO_HANDLING)) {
+			srbench_skip("output", sr_output_id_get(omods[i]),
+				"needs a file");
+			continue;
+		}
+		for (j = 0; j < ARRAY_SIZE(unitsizes); j++) {
+			for (k = 0; k < ARRAY_SIZE(packet_sizes); k++) {
+				output_run(omods[i], unitsizes[j],
+					packet_sizes[k], FALSE);
+				output_run(omods[i], unitsizes[j],
+					packet_sizes[k], TRUE);
+			}
+		}
+		output_run(omods[i], 0, ANALOG_SAMPLES * sizeof(float), FALSE);
+	}
+}
+
+/*
+ * Text suite: logic data rendered by the text output modules, through
+ * the sink API. Bytes are the rendered text, not the samples.
+ */
+static void text_run(const char *id, size_t unitsize)
+{
+	struct srbench_result r;
+	struct sr_dev_inst *sdi;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GString *buf;
+	uint64_t start, t, allocs;
+	char variant[16];
+
+	g_snprintf(variant, sizeof(variant), "%zuch", unitsize * 8);
+	srbench_result_init(&r, "text", id);
+	r.variant = variant;
+	r.type = "logic";
+	r.unitsize = unitsize;
+	r.packet_size = 64 * 1024;
+
+	sdi = user_dev_new(unitsize, FALSE);
+	if (!(o = sr_output_new(sr_output_find((char *)id), NULL, sdi, NULL))) {
+		srbench_skip("text", id, "init failed");
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+
+	logic.length = r.packet_size;
+	logic.unitsize = unitsize;
+	logic.data = g_malloc(r.packet_size);
+	srbench_fill_logic(logic.data, r.packet_size);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	output_begin(o, NULL);
+	buf = g_string_sized_new(16 * r.packet_size);
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	do {
+		g_string_truncate(buf, 0);
+		t = srbench_now_ns();
+		sr_output_send_append(o, &packet, buf);
+		srbench_result_add_latency(&r, srbench_now_ns() - t);
+		r.packets++;
+		r.bytes += buf->len;
+	} while (srbench_now_ns() - start < srbench_min_time_ns);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+	output_end(o, NULL);
+
+	g_string_free(buf, TRUE);
+	sr_output_free(o);
+	g_free(logic.data);
+
+	srbench_report(&r);
+}
+
+void srbench_text(void)
+{
+	static const char *ids[] = { "hex", "bits", "ascii" };
+	static const size_t text_unitsizes[] = { 1, 2, 4 };
+	unsigned int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(ids); i++) {
+		for (j = 0; j < ARRAY_SIZE(text_unitsizes); j++)
+			text_run(ids[i], text_unitsizes[j]);
+	}
+}
+
+/* Render synthetic logic data into the file format of an output module. */
+static GString *input_generate(const struct sr_output_module *omod)
+{
+	struct sr_dev_inst *sdi;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GString *out;
+	uint8_t *data;
+	size_t len;
+
+	sdi = user_dev_new(1, FALSE);
+	if (!(o = sr_output_new(omod, NULL, sdi, NULL)))
+		return NULL;
+
+	out = g_string_sized_new(INPUT_GEN_BYTES);
+	len = 64 * 1024;
+	data = g_malloc(len);
+	srbench_fill_logic(data, len);
+	logic.length = len;
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	output_begin(o, &out);
+	while (out->len < INPUT_GEN_BYTES)
+		if (output_send(o, &packet, &out) != SR_OK)
+			break;
+	output_end(o, &out);
+
+	sr_output_free(o);
+	g_free(data);
+
+	return out;
+}
+
+static void chunk_free(gpointer data)
+{
+	g_string_free(data, TRUE);
+}
+
+/*
+ * Input suite: every input module parses a document which its output
+ * module counterpart generated, in chunks of a fixed size. The latency
+ * is the time one sr_input_send() call takes.
+ */
+static void input_run(const struct sr_input_module *imod, GString *doc,
+		size_t chunk_size)
+{
+	struct srbench_result r;
+	struct feed_stats st;
+	struct sr_session *session;
+	const struct sr_input *in;
+	struct sr_dev_inst *sdi;
+	GPtrArray *chunks;
+	GString *chunk;
+	gboolean added;
+	uint64_t start, t, allocs;
+	unsigned int i;
+	size_t offset, len;
+	int ret;
+
+	srbench_result_init(&r, "input", sr_input_id_get(imod));
+	r.packet_size = chunk_size;
+
+	/* Split up front, so that the copies aren't measured. */
+	chunks = g_ptr_array_new_with_free_func(chunk_free);
+	for (offset = 0; offset < doc->len; offset += len) {
+		len = MIN(chunk_size, doc->len - offset);
+		g_ptr_array_add(chunks,
+			g_string_new_len(doc->str + offset, len));
+	}
+
+	memset(&st, 0, sizeof(st));
+	ret = SR_OK;
+	start = srbench_now_ns();
+	allocs = srbench_allocs();
+	do {
+		sr_session_new(srbench_ctx, &session);
+		sr_session_datafeed_callback_add(session, datafeed_in, &st);
+		if (!(in = sr_input_new(imod, NULL))) {
+			ret = SR_ERR;
+			sr_session_destroy(session);
+			break;
+		}
+		added = FALSE;
+		for (i = 0; i < chunks->len && ret == SR_OK; i++) {
+			chunk = g_ptr_array_index(chunks, i);
+			t = srbench_now_ns();
+			ret = sr_input_send(in, chunk);
+			srbench_result_add_latency(&r, srbench_now_ns() - t);
+			/* Some modules only create their device once they saw a header. */
+			if (!added && (sdi = sr_input_dev_inst_get(in))) {
+				sr_session_dev_add(session, sdi);
+				added = TRUE;
+			}
+			r.bytes += chunk->len;
+		}
+		if (ret == SR_OK)
+			ret = sr_input_end(in);
+		sr_input_free(in);
+		sr_session_destroy(session);
+	} while (ret == SR_OK && srbench_now_ns() - start < srbench_min_time_ns);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+	/* Input throughput counts document bytes, packets are what came out. */
+	r.packets = st.packets;
+	g_ptr_array_free(chunks, TRUE);
+
+	if (ret != SR_OK) {
+		srbench_skip("input", r.module, sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	srbench_report(&r);
+}
+
+void srbench_input(void)
+{
+	const struct sr_input_module **imods;
+	const struct sr_output_module *omod;
+	const char *id;
+	GString *doc;
+	unsigned int i, j;
+
+	imods = sr_input_list();
+	for (i = 0; imods && imods[i]; i++) {
+		id = sr_input_id_get(imods[i]);
+		omod = sr_output_find((char *)id);
+		if (!omod || sr_output_test_flag(omod, SR_OUTPUT_INTERNAL_IO_HANDLING)) {
+			srbench_skip("input", id, "no generator for this format");
+			continue;
+		}
+		if (!(doc = input_generate(omod))) {
+			srbench_skip("input", id, "generator failed");
+			continue;
+		}
+		for (j = 0; j < ARRAY_SIZE(input_chunk_sizes); j++)
+			input_run(imods[i], doc, input_chunk_sizes[j]);
+		g_string_free(doc, TRUE);
+	}
+}
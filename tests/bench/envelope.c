@@ -0,0 +1,189 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Envelope suite: building envelopes from packets ("feed", latencies
+ * per packet) and querying them ("query", one bucket per pixel of a
+ * 1920 pixel wide view of all data fed, latencies per query). Query
+ * throughput counts the sample bytes a query summarizes.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+#define ENVELOPE_PACKET_SIZE	(1024 * 1024)
+#define ENVELOPE_BUCKETS	1920
+
+static const size_t unitsizes[] = { 1, 2, 4, 8 };
+
+/* Analog packets of a single channel, in floats. */
+struct envelope_analog {
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel ch;
+};
+
+static void envelope_analog_init(struct envelope_analog *a, float *values,
+		uint64_t num_samples)
+{
+	memset(a, 0, sizeof(*a));
+	a->ch.type = SR_CHANNEL_ANALOG;
+	a->ch.name = "A0";
+	a->encoding.unitsize = sizeof(float);
+	a->encoding.is_signed = TRUE;
+	a->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	a->encoding.is_bigendian = TRUE;
+#endif
+	a->encoding.scale.p = a->encoding.scale.q = 1;
+	a->encoding.offset.q = 1;
+	a->meaning.channels = g_slist_append(NULL, &a->ch);
+	a->analog.data = values;
+	a->analog.num_samples = num_samples;
+	a->analog.encoding = &a->encoding;
+	a->analog.meaning = &a->meaning;
+	a->analog.spec = &a->spec;
+}
+
+static void envelope_feed(struct sr_envelope *env,
+		const struct sr_datafeed_packet *packet, const char *type,
+		size_t unitsize)
+{
+	struct srbench_result r;
+	uint64_t start, t, allocs;
+	int ret;
+
+	srbench_result_init(&r, "envelope", "feed");
+	r.type = type;
+	r.unitsize = unitsize;
+	r.packet_size = ENVELOPE_PACKET_SIZE;
+
+	ret = SR_OK;
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	while (ret == SR_OK && srbench_now_ns() - start < srbench_min_time_ns) {
+		t = srbench_now_ns();
+		ret = sr_envelope_feed(env, packet);
+		srbench_result_add_latency(&r, srbench_now_ns() - t);
+		r.packets++;
+		r.bytes += ENVELOPE_PACKET_SIZE;
+	}
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	if (ret != SR_OK) {
+		srbench_skip("envelope", "feed", sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	srbench_report(&r);
+}
+
+static void envelope_query(struct sr_envelope *env, const char *type,
+		size_t unitsize)
+{
+	struct srbench_result r;
+	uint64_t num_samples, start, t, allocs;
+	uint8_t *low, *high;
+	float *min, *max;
+	int ret;
+
+	srbench_result_init(&r, "envelope", "query");
+	r.type = type;
+	r.unitsize = unitsize;
+
+	low = g_malloc(ENVELOPE_BUCKETS * unitsize);
+	high = g_malloc(ENVELOPE_BUCKETS * unitsize);
+	min = g_malloc(ENVELOPE_BUCKETS * sizeof(float));
+	max = g_malloc(ENVELOPE_BUCKETS * sizeof(float));
+	if (!strcmp(type, "logic"))
+		ret = sr_envelope_logic_info(env, &num_samples, NULL);
+	else
+		ret = sr_envelope_analog_info(env, "A0", &num_samples);
+
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	while (ret == SR_OK && srbench_now_ns() - start < srbench_min_time_ns) {
+		t = srbench_now_ns();
+		if (!strcmp(type, "logic"))
+			ret = sr_envelope_logic_get(env, 0, num_samples,
+				ENVELOPE_BUCKETS, low, high);
+		else
+			ret = sr_envelope_analog_get(env, "A0", 0,
+				num_samples, ENVELOPE_BUCKETS, min, max);
+		srbench_result_add_latency(&r, srbench_now_ns() - t);
+		r.packets++;
+		r.bytes += num_samples * unitsize;
+	}
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	g_free(low);
+	g_free(high);
+	g_free(min);
+	g_free(max);
+
+	if (ret != SR_OK) {
+		srbench_skip("envelope", "query", sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	srbench_report(&r);
+}
+
+void srbench_envelope(void)
+{
+	struct sr_envelope *env;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct envelope_analog a;
+	uint8_t *buf;
+	unsigned int i;
+
+	buf = g_malloc(ENVELOPE_PACKET_SIZE);
+
+	srbench_fill_logic(buf, ENVELOPE_PACKET_SIZE);
+	logic.length = ENVELOPE_PACKET_SIZE;
+	logic.data = buf;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (i = 0; i < ARRAY_SIZE(unitsizes); i++) {
+		logic.unitsize = unitsizes[i];
+		sr_envelope_new(&env, 0);
+		envelope_feed(env, &packet, "logic", unitsizes[i]);
+		envelope_query(env, "logic", unitsizes[i]);
+		sr_envelope_free(env);
+	}
+
+	srbench_fill_analog((float *)buf, ENVELOPE_PACKET_SIZE / sizeof(float));
+	envelope_analog_init(&a, (float *)buf,
+		ENVELOPE_PACKET_SIZE / sizeof(float));
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &a.analog;
+	sr_envelope_new(&env, 0);
+	envelope_feed(env, &packet, "analog", sizeof(float));
+	envelope_query(env, "analog", sizeof(float));
+	sr_envelope_free(env);
+	g_slist_free(a.meaning.channels);
+
+	g_free(buf);
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Per-call cost of disabled log messages.
+ *
+ * This compiles the message logging macros of libsigrok-internal.h into
+ * the benchmark. The library's sr_log() and level variable are hidden
+ * symbols, so this file provides equivalents with the same logic. They
+ * get names of their own, so as not to clash with the library's symbols
+ * when it is linked statically.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "bench.h"
+
+#define LOG_PREFIX "bench"
+
+#define LOG_BENCH_BATCH	(1024 * 1024)
+
+/* The logging macros expand to these. */
+#define sr_log bench_log
+#define sr_log_cur_level bench_log_cur_level
+
+static int sr_log_cur_level = SR_LOG_WARN;
+
+static uint64_t log_calls;
+
+__attribute__((noinline))
+static int sr_log(int loglevel, const char *format, ...)
+{
+	(void)format;
+
+	if (loglevel > sr_log_cur_level)
+		return SR_OK;
+	log_calls++;
+
+	return SR_OK;
+}
+
+/* Stands in for the work of a transfer callback, and for its arguments. */
+static volatile int sink;
+
+__attribute__((noinline))
+static void work(int i)
+{
+	sink = i;
+}
+
+__attribute__((noinline))
+static const char *status_name(int status)
+{
+	return status ? "LIBUSB_TRANSFER_ERROR" : "LIBUSB_TRANSFER_COMPLETED";
+}
+
+static void loop_baseline(void)
+{
+	for (int i = 0; i < LOG_BENCH_BATCH; i++)
+		work(i);
+}
+
+/* The expansion before the level test moved into the macros. */
+static void loop_call(void)
+{
+	for (int i = 0; i < LOG_BENCH_BATCH; i++) {
+		work(i);
+		sr_log(SR_LOG_DBG, LOG_PREFIX ": receive_transfer(): status %s "
+			"received %d bytes.", status_name(i & 1), i);
+	}
+}
+
+static void loop_gated(void)
+{
+	for (int i = 0; i < LOG_BENCH_BATCH; i++) {
+		work(i);
+		sr_dbg("receive_transfer(): status %s received %d bytes.",
+			status_name(i & 1), i);
+	}
+}
+
+/* As if configured with --with-max-loglevel=info. */
+#undef SR_LOG_MAX_LEVEL
+#define SR_LOG_MAX_LEVEL SR_LOG_INFO
+
+static void loop_stripped(void)
+{
+	for (int i = 0; i < LOG_BENCH_BATCH; i++) {
+		work(i);
+		sr_dbg("receive_transfer(): status %s received %d bytes.",
+			status_name(i & 1), i);
+	}
+}
+
+static void log_run(const char *variant, void (*loop)(void), int loglevel)
+{
+	struct srbench_result r;
+	uint64_t start, allocs;
+
+	srbench_result_init(&r, "log", "sr_dbg");
+	r.variant = variant;
+	r.type = "call";
+
+	sr_log_cur_level = loglevel;
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	do {
+		loop();
+		r.packets += LOG_BENCH_BATCH;
+	} while (srbench_now_ns() - start < srbench_min_time_ns);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+	sr_log_cur_level = SR_LOG_WARN;
+
+	srbench_report(&r);
+}
+
+void srbench_log(void)
+{
+	log_run("baseline", loop_baseline, SR_LOG_WARN);
+	log_run("call-disabled", loop_call, SR_LOG_WARN);
+	log_run("gated-disabled", loop_gated, SR_LOG_WARN);
+	log_run("stripped", loop_stripped, SR_LOG_SPEW);
+	log_run("call-enabled", loop_call, SR_LOG_SPEW);
+	log_run("gated-enabled", loop_gated, SR_LOG_SPEW);
+}
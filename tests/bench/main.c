@@ -0,0 +1,349 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Datafeed benchmark harness.
+ *
+ * Runs the benchmark suites and writes one JSON document with one
+ * result object per case, so that numbers from different builds can be
+ * compared by scripts. Run it via "make bench", or directly:
+ *
+ *   tests/bench/bench [-t msec] [-o file] [-l loglevel] [suite...]
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+struct sr_context *srbench_ctx;
+uint64_t srbench_min_time_ns = 200 * 1000 * 1000;
+
+static FILE *json;
+static gboolean first_result = TRUE;
+
+static const struct {
+	const char *name;
+	void (*run)(void);
+} suites[] = {
+	{ "session", srbench_session },
+	{ "output", srbench_output },
+	{ "text", srbench_text },
+	{ "input", srbench_input },
+	{ "log", srbench_log },
+	{ "startup", srbench_startup },
+	{ "config", srbench_config },
+	{ "async", srbench_async },
+	{ "sources", srbench_sources },
+	{ "convert", srbench_convert },
+	{ "transform", srbench_transform },
+	{ "envelope", srbench_envelope },
+#ifdef SRBENCH_CXX
+	{ "cxx", srbench_cxx },
+#endif
+};
+
+/*
+ * Allocation counting. With glibc the harness interposes the malloc
+ * family for the whole process (libsigrok and glib included) and counts
+ * calls; elsewhere the counts are reported as null.
+ */
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define SRBENCH_COUNT_ALLOCS 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static uint64_t alloc_count;
+
+void *malloc(size_t size)
+{
+	__atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	__atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	__atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(ptr, size);
+}
+
+uint64_t srbench_allocs(void)
+{
+	return __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+}
+#else
+uint64_t srbench_allocs(void)
+{
+	return 0;
+}
+#endif
+
+gboolean srbench_allocs_counted(void)
+{
+#ifdef SRBENCH_COUNT_ALLOCS
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+uint64_t srbench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void srbench_result_init(struct srbench_result *r, const char *suite,
+		const char *module)
+{
+	memset(r, 0, sizeof(*r));
+	r->suite = suite;
+	r->module = module;
+	r->type = "logic";
+	r->latencies = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+}
+
+void srbench_result_add_latency(struct srbench_result *r, uint64_t ns)
+{
+	g_array_append_val(r->latencies, ns);
+}
+
+static void json_string(const char *key, const char *s)
+{
+	fprintf(json, "\"%s\": ", key);
+	if (!s) {
+		fprintf(json, "null");
+		return;
+	}
+	fputc('"', json);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(json, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(json, "\\u%04x", *s);
+		else
+			fputc(*s, json);
+	}
+	fputc('"', json);
+}
+
+static void result_begin(const char *suite, const char *module)
+{
+	fprintf(json, "%s\n\t\t{ ", first_result ? "" : ",");
+	first_result = FALSE;
+	json_string("suite", suite);
+	fprintf(json, ", ");
+	json_string("module", module);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x, y;
+
+	x = *(const uint64_t *)a;
+	y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile, in per mille. */
+static uint64_t percentile(const GArray *sorted, unsigned int permille)
+{
+	return g_array_index(sorted, uint64_t,
+		(uint64_t)(sorted->len - 1) * permille / 1000);
+}
+
+void srbench_report(struct srbench_result *r)
+{
+	double secs;
+	GArray *lat;
+
+	secs = r->time_ns / 1e9;
+
+	result_begin(r->suite, r->module);
+	fprintf(json, ", ");
+	json_string("variant", r->variant);
+	fprintf(json, ", ");
+	json_string("type", r->type);
+	fprintf(json, ", \"unitsize\": %zu, \"packet_bytes\": %zu",
+		r->unitsize, r->packet_size);
+	fprintf(json, ", \"packets\": %" PRIu64 ", \"bytes\": %" PRIu64,
+		r->packets, r->bytes);
+	fprintf(json, ", \"time_ns\": %" PRIu64, r->time_ns);
+	if (secs > 0) {
+		fprintf(json, ", \"mb_per_s\": %.3f, \"packets_per_s\": %.1f",
+			r->bytes / secs / 1e6, r->packets / secs);
+	} else {
+		fprintf(json, ", \"mb_per_s\": null, \"packets_per_s\": null");
+	}
+	if (r->packets) {
+		fprintf(json, ", \"ns_per_packet\": %.2f",
+			(double)r->time_ns / r->packets);
+	}
+	if (srbench_allocs_counted() && r->packets) {
+		fprintf(json, ", \"allocs_per_packet\": %.3f",
+			(double)r->allocs / r->packets);
+	} else {
+		fprintf(json, ", \"allocs_per_packet\": null");
+	}
+
+	lat = r->latencies;
+	if (lat && lat->len) {
+		g_array_sort(lat, cmp_u64);
+		fprintf(json, ", \"latency_ns\": { \"p50\": %" PRIu64
+			", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64
+			", \"max\": %" PRIu64 " }",
+			percentile(lat, 500), percentile(lat, 990),
+			percentile(lat, 999), percentile(lat, 1000));
+	} else {
+		fprintf(json, ", \"latency_ns\": null");
+	}
+	fprintf(json, " }");
+	fflush(json);
+
+	if (lat)
+		g_array_free(lat, TRUE);
+	r->latencies = NULL;
+}
+
+void srbench_skip(const char *suite, const char *module, const char *reason)
+{
+	result_begin(suite, module);
+	fprintf(json, ", ");
+	json_string("skipped", reason);
+	fprintf(json, " }");
+	fflush(json);
+}
+
+/*
+ * Deterministic test data. Logic data is a mix of slowly and quickly
+ * toggling bits, so that run length based outputs see realistic edges.
+ */
+void srbench_fill_logic(uint8_t *buf, size_t len)
+{
+	uint32_t state;
+	size_t i;
+
+	state = 0x12345678;
+	for (i = 0; i < len; i++) {
+		state = state * 1103515245 + 12345;
+		buf[i] = (i >> 4) ^ ((state >> 24) & 0xc0);
+	}
+}
+
+void srbench_fill_analog(float *buf, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+		buf[i] = 3.3 * sin(2 * G_PI * (i % 1000) / 1000.0);
+}
+
+static void show_help(const char *prog)
+{
+	printf("Usage: %s [-t msec] [-o file] [-l loglevel] [suite...]\n", prog);
+	printf("Suites:");
+	for (unsigned int i = 0; i < ARRAY_SIZE(suites); i++)
+		printf(" %s", suites[i].name);
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *outfile;
+	unsigned int i;
+	int opt, j, ret;
+	gboolean run;
+
+	outfile = NULL;
+	sr_log_loglevel_set(SR_LOG_WARN);
+	while ((opt = getopt(argc, argv, "ht:o:l:")) != -1) {
+		switch (opt) {
+		case 't':
+			srbench_min_time_ns = g_ascii_strtoull(optarg, NULL, 10)
+				* 1000 * 1000;
+			break;
+		case 'o':
+			outfile = optarg;
+			break;
+		case 'l':
+			sr_log_loglevel_set(atoi(optarg));
+			break;
+		case 'h':
+			show_help(argv[0]);
+			return 0;
+		default:
+			show_help(argv[0]);
+			return 1;
+		}
+	}
+
+	json = stdout;
+	if (outfile && !(json = fopen(outfile, "w"))) {
+		fprintf(stderr, "Cannot open %s: %s\n", outfile, g_strerror(errno));
+		return 1;
+	}
+
+	if ((ret = sr_init(&srbench_ctx)) != SR_OK) {
+		fprintf(stderr, "sr_init() failed: %s\n", sr_strerror(ret));
+		return 1;
+	}
+
+	fprintf(json, "{\n\t");
+	json_string("libsigrok", sr_package_version_string_get());
+	fprintf(json, ",\n\t\"min_time_ms\": %" PRIu64 ",",
+		srbench_min_time_ns / 1000 / 1000);
+	fprintf(json, "\n\t\"allocs_counted\": %s,",
+		srbench_allocs_counted() ? "true" : "false");
+	fprintf(json, "\n\t\"results\": [");
+
+	for (i = 0; i < ARRAY_SIZE(suites); i++) {
+		run = optind >= argc;
+		for (j = optind; j < argc; j++)
+			run |= !strcmp(argv[j], suites[i].name);
+		if (run)
+			suites[i].run();
+	}
+
+	fprintf(json, "\n\t]\n}\n");
+	if (json != stdout)
+		fclose(json);
+
+	sr_exit(srbench_ctx);
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+##
+## This file is part of the libsigrok project.
+##
+## This program is free software; you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation; either version 2 of the License, or
+## (at your option) any later version.
+##
+## This program is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with this program; if not, see <http://www.gnu.org/licenses/>.
+##
+
+# Python packet conversion benchmark: unpacks logic packets into a
+# (samples x channels) array the way analysis scripts did before the
+# bindings grew unpack_bits(), and compares that against numpy's own
+# unpackbits() over the payload view and against unpack_bits().
+#
+# Usage: packets.py [-t seconds]
+
+import argparse
+import time
+import numpy
+from sigrok.core.classes import Context
+
+UNITSIZES = (1, 2, 4)
+PACKET_SIZE = 65536
+
+def per_sample(payload):
+    # Per-packet conversion as done without vectorized helpers.
+    data = bytes(payload.data)
+    unitsize = payload.unit_size()
+    out = numpy.empty((len(data) // unitsize, unitsize * 8), numpy.uint8)
+    for i in range(out.shape[0]):
+        for c in range(unitsize * 8):
+            out[i, c] = (data[i * unitsize + c // 8] >> (c % 8)) & 1
+    return out
+
+def numpy_unpack(payload):
+    return numpy.unpackbits(payload.data, axis=1, bitorder='little')
+
+def unpack_bits(payload):
+    return payload.unpack_bits()
+
+def measure(func, payload, min_time):
+    count = 0
+    start = time.perf_counter()
+    while True:
+        func(payload)
+        count += 1
+        elapsed = time.perf_counter() - start
+        if elapsed >= min_time:
+            return count, elapsed
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmark logic packet conversion to NumPy arrays.")
+    parser.add_argument('-t', '--time', type=float, default=1.0,
+        help='minimum time per case, in seconds')
+    args = parser.parse_args()
+
+    context = Context.create()
+    rng = numpy.random.default_rng(0)
+    print('%-12s %8s %12s %10s' % ('method', 'unitsize', 'MB/s', 'speedup'))
+    for unitsize in UNITSIZES:
+        buf = rng.integers(0, 256, PACKET_SIZE, numpy.uint8).tobytes()
+        packet = context.create_logic_packet(buf, unitsize)
+        payload = packet.payload
+        expected = per_sample(payload)
+        baseline = None
+        for name, func in (('per-sample', per_sample),
+                ('numpy', numpy_unpack), ('unpack_bits', unpack_bits)):
+            if not numpy.array_equal(func(payload), expected):
+                raise SystemExit('%s: wrong result' % name)
+            count, elapsed = measure(func, payload, args.time)
+            rate = count * PACKET_SIZE / elapsed / 1e6
+            if baseline is None:
+                baseline = rate
+            print('%-12s %8u %12.2f %9.1fx' % (name, unitsize, rate,
+                rate / baseline))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,157 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Sources suite: many devices in one session, each with its own event
+ * source. Small packets keep the per-iteration cost of the event loop
+ * in the measurement. Latencies are the event sources' dispatch delays
+ * (time between a source's timeout expiring and its callback running),
+ * as collected by the session's performance counters. The "threads"
+ * variants run each device in a device thread of its own.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+static const unsigned int device_counts[] = { 1, 8, 40 };
+
+static void dev_close(void *data)
+{
+	sr_dev_close(data);
+}
+
+static void sources_datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct srbench_result *r;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	r = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	r->packets++;
+	r->bytes += logic->length;
+}
+
+static void sources_run(struct sr_dev_driver *driver, unsigned int count,
+		gboolean throttled, gboolean threads)
+{
+	struct srbench_result r;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_session_stats *entry;
+	GSList *devices, *devs, *stats, *l;
+	uint64_t start, allocs;
+	unsigned int i;
+	char variant[48];
+	int ret;
+
+	g_snprintf(variant, sizeof(variant), "%u-device%s%s%s", count,
+		count > 1 ? "s" : "", throttled ? "-throttled" : "",
+		threads ? "-threads" : "");
+	srbench_result_init(&r, "sources", "demo");
+	r.variant = variant;
+	r.type = "logic";
+	r.unitsize = 1;
+	r.packet_size = 4096;
+
+	sr_session_new(srbench_ctx, &session);
+	sr_session_stats_enable(session, TRUE);
+	devs = NULL;
+	for (i = 0; i < count; i++) {
+		if (!(devices = sr_driver_scan(driver, NULL)))
+			break;
+		sdi = devices->data;
+		g_slist_free(devices);
+		devs = g_slist_append(devs, sdi);
+		sr_dev_open(sdi);
+		sr_session_dev_add(session, sdi);
+		if (threads)
+			sr_session_dev_thread_set(session, sdi, i);
+		if (!throttled)
+			sr_config_set(sdi, NULL, SR_CONF_TEST_MODE,
+				g_variant_new_string("max-throughput"));
+		sr_config_set(sdi, NULL, SR_CONF_BUFFERSIZE,
+			g_variant_new_uint64(r.packet_size));
+		sr_config_set(sdi, NULL, SR_CONF_LIMIT_MSEC,
+			g_variant_new_uint64(srbench_min_time_ns / 1000 / 1000));
+	}
+	if (i < count) {
+		srbench_skip("sources", variant, "scan failed");
+		g_array_free(r.latencies, TRUE);
+		sr_session_destroy(session);
+		g_slist_free_full(devs, dev_close);
+		return;
+	}
+	sr_session_datafeed_callback_add(session, sources_datafeed_in, &r);
+
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	if ((ret = sr_session_start(session)) == SR_OK)
+		ret = sr_session_run(session);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	if (sr_session_stats_get(session, &stats) == SR_OK) {
+		for (l = stats; l; l = l->next) {
+			entry = l->data;
+			if (entry->kind == SR_STATS_SOURCE && entry->count)
+				srbench_result_add_latency(&r,
+					entry->late_ns / entry->count);
+		}
+		sr_session_stats_free(stats);
+	}
+
+	sr_session_destroy(session);
+	g_slist_free_full(devs, dev_close);
+
+	if (ret != SR_OK) {
+		srbench_skip("sources", variant, sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	srbench_report(&r);
+}
+
+void srbench_sources(void)
+{
+	struct sr_dev_driver **drivers, *driver;
+	unsigned int i;
+
+	driver = NULL;
+	drivers = sr_driver_list(srbench_ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(srbench_ctx, driver) != SR_OK) {
+		srbench_skip("sources", "demo", "driver not available");
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(device_counts); i++) {
+		sources_run(driver, device_counts[i], FALSE, FALSE);
+		sources_run(driver, device_counts[i], FALSE, TRUE);
+		sources_run(driver, device_counts[i], TRUE, FALSE);
+	}
+}
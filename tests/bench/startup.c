@@ -0,0 +1,99 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Startup latency: what a short-lived job pays before it gets to work.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "bench.h"
+
+enum startup_job {
+	/* sr_init() and sr_exit() only. */
+	STARTUP_INIT,
+	/* Plus one scan with the demo driver, as for reading one device. */
+	STARTUP_SCAN,
+	/* Plus one input module instance, as for converting a file. */
+	STARTUP_INPUT,
+};
+
+static void startup_job_run(enum startup_job job)
+{
+	struct sr_context *ctx;
+	struct sr_dev_driver **drivers;
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	GSList *devices;
+	unsigned int i;
+
+	if (sr_init(&ctx) != SR_OK)
+		return;
+
+	switch (job) {
+	case STARTUP_INIT:
+		break;
+	case STARTUP_SCAN:
+		drivers = sr_driver_list(ctx);
+		for (i = 0; drivers[i]; i++) {
+			if (strcmp(drivers[i]->name, "demo"))
+				continue;
+			devices = sr_driver_scan(drivers[i], NULL);
+			g_slist_free(devices);
+		}
+		break;
+	case STARTUP_INPUT:
+		if ((imod = sr_input_find("vcd")) && (in = sr_input_new(imod, NULL)))
+			sr_input_free(in);
+		break;
+	}
+
+	sr_exit(ctx);
+}
+
+static void startup_run(const char *variant, enum startup_job job)
+{
+	struct srbench_result r;
+	uint64_t start, t, allocs;
+
+	srbench_result_init(&r, "startup", "sr_init");
+	r.variant = variant;
+	r.type = "job";
+
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	do {
+		t = srbench_now_ns();
+		startup_job_run(job);
+		srbench_result_add_latency(&r, srbench_now_ns() - t);
+		r.packets++;
+	} while (srbench_now_ns() - start < srbench_min_time_ns);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	srbench_report(&r);
+}
+
+void srbench_startup(void)
+{
+	startup_run("init-exit", STARTUP_INIT);
+	startup_run("scan-demo", STARTUP_SCAN);
+	startup_run("input-vcd", STARTUP_INPUT);
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Transform suite: transform modules' receive() on logic packets, called
+ * directly, without the session around it. The "loop" module is the
+ * per-byte invert loop the invert transform used to have, for comparison.
+ * The subset variants pick channels from up to three bytes of a sample,
+ * decimate reduces by a factor of 64. Latencies are per packet.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "bench.h"
+
+#define TRANSFORM_PACKET_SIZE	(1024 * 1024)
+
+static const size_t unitsizes[] = { 1, 2, 4, 8 };
+
+/* The former invert transform: every bit of every byte, byte by byte. */
+static void invert_loop(const struct sr_datafeed_logic *logic)
+{
+	uint64_t i, j;
+	uint8_t *b;
+
+	for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
+		for (j = 0; j < logic->unitsize; j++) {
+			b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
+			*b = ~(*b);
+		}
+	}
+}
+
+static struct sr_dev_inst *transform_dev_new(void)
+{
+	struct sr_dev_inst *sdi;
+	unsigned int i;
+	char name[8];
+
+	sdi = sr_dev_inst_user_new("sigrok", "bench", NULL);
+	for (i = 0; i < 64; i++) {
+		g_snprintf(name, sizeof(name), "D%u", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+
+	return sdi;
+}
+
+/*
+ * Run one module (NULL for the former invert loop) with the given
+ * options over packets of the unit size.
+ */
+static void transform_run(struct sr_dev_inst *sdi, const char *id,
+		const char *variant, GHashTable *options, size_t unitsize)
+{
+	struct srbench_result r;
+	const struct sr_transform_module *tmod;
+	const struct sr_transform *t;
+	struct sr_datafeed_packet packet, *packet_out;
+	struct sr_datafeed_logic logic;
+	uint64_t start, ts, allocs;
+	int ret;
+
+	srbench_result_init(&r, "transform", id ? id : "loop");
+	r.variant = variant;
+	r.type = "logic";
+	r.unitsize = unitsize;
+	r.packet_size = TRANSFORM_PACKET_SIZE;
+
+	t = NULL;
+	if (id && (!(tmod = sr_transform_find(id))
+			|| !(t = sr_transform_new(tmod, options, sdi)))) {
+		srbench_skip("transform", id, "init failed");
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+
+	logic.length = TRANSFORM_PACKET_SIZE;
+	logic.unitsize = unitsize;
+	logic.data = g_malloc(TRANSFORM_PACKET_SIZE);
+	srbench_fill_logic(logic.data, TRANSFORM_PACKET_SIZE);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	ret = SR_OK;
+	allocs = srbench_allocs();
+	start = srbench_now_ns();
+	do {
+		ts = srbench_now_ns();
+		if (t)
+			ret = t->module->receive(t, &packet, &packet_out);
+		else
+			invert_loop(&logic);
+		srbench_result_add_latency(&r, srbench_now_ns() - ts);
+		r.packets++;
+		r.bytes += logic.length;
+	} while (ret == SR_OK && srbench_now_ns() - start < srbench_min_time_ns);
+	r.time_ns = srbench_now_ns() - start;
+	r.allocs = srbench_allocs() - allocs;
+
+	g_free(logic.data);
+	if (t) {
+		sdi->session->transforms = g_slist_remove(
+			sdi->session->transforms, t);
+		sr_transform_free(t);
+	}
+
+	if (ret != SR_OK) {
+		srbench_skip("transform", r.module, sr_strerror(ret));
+		g_array_free(r.latencies, TRUE);
+		return;
+	}
+	srbench_report(&r);
+}
+
+void srbench_transform(void)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *one, *three, *factor;
+	unsigned int i;
+
+	sr_session_new(srbench_ctx, &session);
+	sdi = transform_dev_new();
+	sr_session_dev_add(session, sdi);
+
+	one = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(one, g_strdup("channels"),
+		g_variant_ref_sink(g_variant_new_string("D0")));
+	three = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(three, g_strdup("channels"),
+		g_variant_ref_sink(g_variant_new_string("D1,D9,D17")));
+	factor = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(factor, g_strdup("factor"),
+		g_variant_ref_sink(g_variant_new_uint64(64)));
+
+	for (i = 0; i < ARRAY_SIZE(unitsizes); i++) {
+		transform_run(sdi, NULL, "all", NULL, unitsizes[i]);
+		transform_run(sdi, "invert", "all", NULL, unitsizes[i]);
+		transform_run(sdi, "invert", "1ch", one, unitsizes[i]);
+		transform_run(sdi, "subset", "3ch", three, unitsizes[i]);
+		transform_run(sdi, "decimate", "x64", factor, unitsizes[i]);
+	}
+
+	g_hash_table_destroy(one);
+	g_hash_table_destroy(three);
+	g_hash_table_destroy(factor);
+	/* User devices have no public destructor, like in the output suite. */
+	sr_session_destroy(session);
+}
@@ -0,0 +1,390 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <check.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#define DATA_SIZE (256 * 1024 + 7)
+
+static char *tmpdir, *input_file, *output_file;
+static uint8_t *data;
+
+static void setup(void)
+{
+	gsize i;
+
+	srtest_setup();
+
+	tmpdir = g_dir_make_tmp("sr-convert-XXXXXX", NULL);
+	fail_unless(tmpdir != NULL, "Failed to create a temporary directory.");
+	input_file = g_build_filename(tmpdir, "input.bin", NULL);
+	output_file = g_build_filename(tmpdir, "output.bin", NULL);
+
+	data = g_malloc(DATA_SIZE);
+	for (i = 0; i < DATA_SIZE; i++)
+		data[i] = (i * 7) ^ (i >> 8);
+	fail_unless(g_file_set_contents(input_file, (char *)data, DATA_SIZE,
+		NULL), "Failed to write the input file.");
+}
+
+static void teardown(void)
+{
+	g_unlink(input_file);
+	g_unlink(output_file);
+	g_rmdir(tmpdir);
+	g_free(input_file);
+	g_free(output_file);
+	g_free(tmpdir);
+	g_free(data);
+
+	srtest_teardown();
+}
+
+/* Convert the input file binary to binary, and check the result. */
+static void check_convert_result(struct sr_convert_options *opts,
+		const uint8_t *expected, gsize expected_len)
+{
+	gchar *out;
+	gsize len, i;
+	int ret;
+
+	opts->input_format = "binary";
+	opts->output_format = "binary";
+	ret = sr_convert_file(srtest_ctx, input_file, output_file, opts);
+	fail_unless(ret == SR_OK, "Conversion failed: %d.", ret);
+
+	fail_unless(g_file_get_contents(output_file, &out, &len, NULL));
+	fail_unless(len == expected_len, "Output has %zu bytes, expected %zu.",
+		len, expected_len);
+	for (i = 0; i < len; i++) {
+		if ((uint8_t)out[i] != expected[i])
+			fail("Output differs at byte %zu.", i);
+	}
+	g_free(out);
+}
+
+/* Check that the result is the input with the given bits inverted. */
+static void check_convert(struct sr_convert_options *opts, uint8_t inverted)
+{
+	uint8_t *expected;
+	gsize i;
+
+	expected = g_malloc(DATA_SIZE);
+	for (i = 0; i < DATA_SIZE; i++)
+		expected[i] = data[i] ^ inverted;
+	check_convert_result(opts, expected, DATA_SIZE);
+	g_free(expected);
+}
+
+static GHashTable *options_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+}
+
+/* Check conversion with the stages in threads of their own, or not. */
+START_TEST(test_convert_binary)
+{
+	struct sr_convert_options opts;
+
+	memset(&opts, 0, sizeof(opts));
+	check_convert(&opts, 0);
+	opts.single_thread = TRUE;
+	check_convert(&opts, 0);
+}
+END_TEST
+
+/* Check that small chunks and short queues don't lose or reorder data. */
+START_TEST(test_convert_short_queues)
+{
+	struct sr_convert_options opts;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.chunk_size = 1000;
+	opts.queue_length = 1;
+	check_convert(&opts, 0);
+}
+END_TEST
+
+/* Check that transforms are applied, in either mode. */
+START_TEST(test_convert_transforms)
+{
+	static const char *nop[] = { "nop", NULL };
+	static const char *invert[] = { "nop", "invert", NULL };
+	struct sr_convert_options opts;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.transforms = nop;
+	check_convert(&opts, 0);
+	opts.transforms = invert;
+	check_convert(&opts, 0xff);
+	opts.single_thread = TRUE;
+	check_convert(&opts, 0xff);
+}
+END_TEST
+
+/* Check that fused transforms give the same result as running them in turn. */
+START_TEST(test_convert_fused)
+{
+	static const char *chain[] = { "invert", "nop", "invert", NULL };
+	struct sr_convert_options opts;
+	GHashTable *options[3];
+
+	memset(options, 0, sizeof(options));
+	options[2] = options_new();
+	g_hash_table_insert(options[2], g_strdup("channels"),
+		g_variant_ref_sink(g_variant_new_string("0,3")));
+
+	memset(&opts, 0, sizeof(opts));
+	opts.transforms = chain;
+	opts.transform_options = options;
+	check_convert(&opts, 0xff ^ 0x09);
+	opts.single_thread = TRUE;
+	check_convert(&opts, 0xff ^ 0x09);
+
+	g_hash_table_destroy(options[2]);
+}
+END_TEST
+
+/* Check that the subset transform gathers the selected channels. */
+START_TEST(test_convert_subset)
+{
+	static const char *subset[] = { "subset", NULL };
+	struct sr_convert_options opts;
+	GHashTable *options[1];
+	uint8_t *expected;
+	gsize i;
+
+	options[0] = options_new();
+	g_hash_table_insert(options[0], g_strdup("channels"),
+		g_variant_ref_sink(g_variant_new_string("5,0,7")));
+	memset(&opts, 0, sizeof(opts));
+	opts.transforms = subset;
+	opts.transform_options = options;
+	/* Several packets, of odd sizes. */
+	opts.chunk_size = 1003;
+
+	expected = g_malloc(DATA_SIZE);
+	for (i = 0; i < DATA_SIZE; i++)
+		expected[i] = ((data[i] >> 5) & 1) | ((data[i] & 1) << 1)
+			| ((data[i] >> 7) << 2);
+	check_convert_result(&opts, expected, DATA_SIZE);
+
+	g_free(expected);
+	g_hash_table_destroy(options[0]);
+}
+END_TEST
+
+struct hex_render {
+	const struct sr_output *o;
+	GString *out;
+};
+
+/* Create the output for the device the session passes along. */
+static void hex_datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct hex_render *r;
+
+	r = cb_data;
+	if (packet->type == SR_DF_HEADER) {
+		r->o = sr_output_new(sr_output_find("hex"), NULL, sdi, NULL);
+		fail_unless(r->o != NULL, "Failed to create 'hex' output.");
+	}
+	if (!r->o)
+		return;
+	sr_output_send_append(r->o, packet, r->out);
+	if (packet->type == SR_DF_END) {
+		sr_output_free(r->o);
+		r->o = NULL;
+	}
+}
+
+/*
+ * Render the input file as hex with a channel disabled, through the
+ * subset transform with its default selection, or not. Without the
+ * header lines, which count the device's channels.
+ */
+static GString *hex_render(const char *disabled, gboolean subset)
+{
+	const struct sr_input *in;
+	const struct sr_transform *t;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	struct hex_render r;
+	GString *buf;
+	GSList *l;
+	char *lines;
+
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	buf = g_string_new_len((gchar *)data, DATA_SIZE);
+	fail_unless(sr_input_send(in, buf) == SR_OK);
+	g_string_free(buf, TRUE);
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "No device instance.");
+
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (!strcmp(ch->name, disabled))
+			sr_dev_channel_enable(ch, FALSE);
+	}
+
+	r.o = NULL;
+	r.out = g_string_new(NULL);
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, hex_datafeed_in, &r);
+	sr_session_dev_add(session, sdi);
+	t = NULL;
+	if (subset) {
+		t = sr_transform_new(sr_transform_find("subset"), NULL, sdi);
+		fail_unless(t != NULL, "Failed to create 'subset' transform.");
+	}
+	fail_unless(sr_input_end(in) == SR_OK);
+	sr_session_destroy(session);
+	sr_transform_free(t);
+	sr_input_free(in);
+
+	lines = strchr(r.out->str, '\n');
+	fail_unless(lines && (lines = strchr(lines + 1, '\n')), "No header.");
+	g_string_erase(r.out, 0, lines + 1 - r.out->str);
+
+	return r.out;
+}
+
+/*
+ * Check that outputs after the subset transform see its channels. With
+ * all enabled channels selected, the result is that of the device.
+ */
+START_TEST(test_convert_subset_output)
+{
+	GString *ref, *out;
+
+	ref = hex_render("3", FALSE);
+	out = hex_render("3", TRUE);
+	fail_unless(strstr(out->str, "\n4:") != NULL, "Channel 4 missing.");
+	fail_unless(strstr(out->str, "\n3:") == NULL, "Channel 3 not disabled.");
+	fail_unless(out->len == ref->len
+		&& !memcmp(out->str, ref->str, ref->len),
+		"Output differs from the device's.");
+
+	g_string_free(ref, TRUE);
+	g_string_free(out, TRUE);
+}
+END_TEST
+
+/* Check the decimate transform's logic envelopes. */
+START_TEST(test_convert_decimate)
+{
+	static const char *decimate[] = { "decimate", NULL };
+	struct sr_convert_options opts;
+	GHashTable *options[1];
+	uint8_t *expected, and_acc, or_acc;
+	gsize i, j, groups;
+
+	options[0] = options_new();
+	g_hash_table_insert(options[0], g_strdup("factor"),
+		g_variant_ref_sink(g_variant_new_uint64(10)));
+	memset(&opts, 0, sizeof(opts));
+	opts.transforms = decimate;
+	opts.transform_options = options;
+	/* Groups span packets, the state is carried over. */
+	opts.chunk_size = 1003;
+
+	/* Min/max: AND and OR of each group, the incomplete one is dropped. */
+	groups = DATA_SIZE / 10;
+	expected = g_malloc(2 * groups);
+	for (i = 0; i < groups; i++) {
+		and_acc = 0xff;
+		or_acc = 0;
+		for (j = 0; j < 10; j++) {
+			and_acc &= data[i * 10 + j];
+			or_acc |= data[i * 10 + j];
+		}
+		expected[2 * i] = and_acc;
+		expected[2 * i + 1] = or_acc;
+	}
+	check_convert_result(&opts, expected, 2 * groups);
+
+	/* Average: the first sample of each group, the last one included. */
+	g_hash_table_insert(options[0], g_strdup("mode"),
+		g_variant_ref_sink(g_variant_new_string("average")));
+	for (i = 0; i < groups + 1; i++)
+		expected[i] = data[i * 10];
+	check_convert_result(&opts, expected, groups + 1);
+
+	g_free(expected);
+	g_hash_table_destroy(options[0]);
+}
+END_TEST
+
+/* Check that invalid arguments are rejected. */
+START_TEST(test_convert_errors)
+{
+	static const char *bogus[] = { "bogus", NULL };
+	struct sr_convert_options opts;
+	char *missing;
+	int ret;
+
+	memset(&opts, 0, sizeof(opts));
+	ret = sr_convert_file(srtest_ctx, input_file, output_file, &opts);
+	fail_unless(ret == SR_ERR_ARG, "No output format not rejected.");
+
+	opts.input_format = "binary";
+	opts.output_format = "bogus";
+	ret = sr_convert_file(srtest_ctx, input_file, output_file, &opts);
+	fail_unless(ret == SR_ERR_ARG, "Unknown output format not rejected.");
+
+	opts.output_format = "binary";
+	opts.transforms = bogus;
+	ret = sr_convert_file(srtest_ctx, input_file, output_file, &opts);
+	fail_unless(ret == SR_ERR_ARG, "Unknown transform not rejected.");
+
+	opts.transforms = NULL;
+	missing = g_build_filename(tmpdir, "missing.bin", NULL);
+	ret = sr_convert_file(srtest_ctx, missing, output_file, &opts);
+	fail_unless(ret == SR_ERR_IO, "Missing input file not reported.");
+	g_free(missing);
+}
+END_TEST
+
+Suite *suite_convert(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("convert");
+
+	tc = tcase_create("basic");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_convert_binary);
+	tcase_add_test(tc, test_convert_short_queues);
+	tcase_add_test(tc, test_convert_transforms);
+	tcase_add_test(tc, test_convert_fused);
+	tcase_add_test(tc, test_convert_subset);
+	tcase_add_test(tc, test_convert_subset_output);
+	tcase_add_test(tc, test_convert_decimate);
+	tcase_add_test(tc, test_convert_errors);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
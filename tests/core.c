@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -149,6 +150,43 @@ START_TEST(test_init_null)
 }
 END_TEST
 
+/*
+ * Check that drivers get initialized on first use with a context which
+ * was created after a failed sr_init() call.
+ */
+START_TEST(test_init_fail_init)
+{
+	int i, ret;
+	struct sr_context *sr_ctx;
+	struct sr_dev_driver **drivers, *demo;
+	GSList *devices;
+
+	ret = sr_log_loglevel_set(SR_LOG_NONE);
+	fail_unless(ret == SR_OK, "sr_log_loglevel_set() failed: %d.", ret);
+
+	ret = sr_init(NULL);
+	fail_unless(ret != SR_OK, "sr_init(NULL) should have failed.");
+	ret = sr_init(&sr_ctx);
+	fail_unless(ret == SR_OK, "sr_init() failed: %d.", ret);
+
+	demo = NULL;
+	drivers = sr_driver_list(sr_ctx);
+	for (i = 0; drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			demo = drivers[i];
+	}
+	if (demo) {
+		devices = sr_driver_scan(demo, NULL);
+		fail_unless(demo->context != NULL, "Driver not initialized.");
+		fail_unless(devices != NULL, "No demo device found.");
+		g_slist_free(devices);
+	}
+
+	ret = sr_exit(sr_ctx);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+}
+END_TEST
+
 /* Check whether sr_exit(NULL) fails as it should. */
 START_TEST(test_exit_null)
 {
@@ -176,6 +214,7 @@ Suite *suite_core(void)
 	tcase_add_test(tc, test_init_exit_3);
 	tcase_add_test(tc, test_init_exit_3_reverse);
 	tcase_add_test(tc, test_init_null);
+	tcase_add_test(tc, test_init_fail_init);
 	tcase_add_test(tc, test_exit_null);
 	suite_add_tcase(s, tc);
 
@@ -40,6 +40,207 @@ START_TEST(test_driver_init_all)
 }
 END_TEST
 
+/* Check whether scanning initializes a driver on first use. */
+START_TEST(test_driver_scan_lazy_init)
+{
+	struct sr_dev_driver *driver;
+	GSList *devices;
+
+	driver = srtest_driver_get("demo");
+	fail_unless(driver->context == NULL, "Driver initialized by sr_init().");
+
+	devices = sr_driver_scan(driver, NULL);
+	fail_unless(devices != NULL, "Scan without sr_driver_init() failed.");
+	fail_unless(driver->context != NULL, "Driver not initialized.");
+	g_slist_free(devices);
+}
+END_TEST
+
+/* Check whether sr_driver_scan_multi() handles invalid/empty job lists. */
+START_TEST(test_driver_scan_multi_args)
+{
+	struct sr_driver_scan_job jobs[1];
+	int ret;
+
+	ret = sr_driver_scan_multi(NULL, 1, 0);
+	fail_unless(ret == SR_ERR_ARG, "NULL jobs accepted: %d.", ret);
+
+	ret = sr_driver_scan_multi(NULL, 0, 0);
+	fail_unless(ret == SR_OK, "Empty job list rejected: %d.", ret);
+
+	ret = sr_driver_scan_multi(jobs, 0, 4);
+	fail_unless(ret == SR_OK, "Empty job list rejected: %d.", ret);
+}
+END_TEST
+
+#define SCAN_JOBS_DEMO 8
+#define SCAN_JOBS_CONN 8
+
+/*
+ * Check whether concurrently running jobs each get their devices, and
+ * all of them end up in the driver's instance list. The conn= jobs of
+ * other drivers run in parallel with the demo ones and find nothing.
+ */
+START_TEST(test_driver_scan_multi_concurrent)
+{
+	struct sr_driver_scan_job jobs[SCAN_JOBS_DEMO + SCAN_JOBS_CONN];
+	struct sr_config src[SCAN_JOBS_DEMO + SCAN_JOBS_CONN];
+	struct sr_dev_driver **drivers, *demo;
+	struct sr_dev_inst *sdi;
+	GArray *opts, *channels;
+	unsigned int i, k, num_jobs, num_instances;
+	int ret;
+
+	demo = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, demo);
+	num_instances = g_slist_length(sr_dev_list(demo));
+
+	num_jobs = 0;
+	for (i = 0; i < SCAN_JOBS_DEMO; i++) {
+		src[num_jobs].key = SR_CONF_NUM_LOGIC_CHANNELS;
+		src[num_jobs].data = g_variant_ref_sink(
+			g_variant_new_int32(i + 1));
+		jobs[num_jobs].driver = demo;
+		jobs[num_jobs].options = g_slist_append(NULL, &src[num_jobs]);
+		num_jobs++;
+	}
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers[i] && num_jobs < G_N_ELEMENTS(jobs); i++) {
+		if (!(opts = sr_driver_scan_options_list(drivers[i])))
+			continue;
+		for (k = 0; k < opts->len; k++) {
+			if (g_array_index(opts, uint32_t, k) == SR_CONF_CONN)
+				break;
+		}
+		if (k < opts->len) {
+			srtest_driver_init(srtest_ctx, drivers[i]);
+			src[num_jobs].key = SR_CONF_CONN;
+			src[num_jobs].data = g_variant_ref_sink(g_variant_new_printf(
+				"/dev/srtest-nonexistent-%u", num_jobs));
+			jobs[num_jobs].driver = drivers[i];
+			jobs[num_jobs].options = g_slist_append(NULL, &src[num_jobs]);
+			num_jobs++;
+		}
+		g_array_free(opts, TRUE);
+	}
+
+	ret = sr_driver_scan_multi(jobs, num_jobs, 8);
+	fail_unless(ret == SR_OK, "Multi-driver scan failed: %d.", ret);
+
+	for (i = 0; i < SCAN_JOBS_DEMO; i++) {
+		fail_unless(g_slist_length(jobs[i].devices) == 1,
+			"Demo job %u found %u devices.", i,
+			g_slist_length(jobs[i].devices));
+		sdi = jobs[i].devices->data;
+		/* In job order, whichever thread ran the scan. */
+		channels = srtest_get_enabled_logic_channels(sdi);
+		fail_unless(channels->len == i + 1,
+			"Demo job %u got another job's device.", i);
+		g_array_free(channels, TRUE);
+	}
+	fail_unless(g_slist_length(sr_dev_list(demo))
+		== num_instances + SCAN_JOBS_DEMO,
+		"Driver lists %u of %u demo devices.",
+		g_slist_length(sr_dev_list(demo)) - num_instances,
+		SCAN_JOBS_DEMO);
+
+	for (i = 0; i < num_jobs; i++) {
+		g_slist_free(jobs[i].devices);
+		g_slist_free(jobs[i].options);
+		g_variant_unref(src[i].data);
+	}
+}
+END_TEST
+
+/* Check whether key lookups by key and by id agree. */
+START_TEST(test_key_info_lookup)
+{
+	const struct sr_key_info *info, *by_id;
+
+	info = sr_key_info_get(SR_KEY_CONFIG, SR_CONF_SAMPLERATE);
+	fail_unless(info != NULL, "Samplerate key not found.");
+	by_id = sr_key_info_name_get(SR_KEY_CONFIG, info->id);
+	fail_unless(by_id == info, "Lookup by id returned another key.");
+	fail_unless(sr_key_info_get(SR_KEY_CONFIG, 0xfffffff) == NULL,
+		"Invalid key found.");
+	fail_unless(sr_key_info_name_get(SR_KEY_CONFIG, "nonexistent") == NULL,
+		"Invalid key id found.");
+	fail_unless(sr_key_info_get(-1, SR_CONF_SAMPLERATE) == NULL,
+		"Invalid keytype accepted.");
+}
+END_TEST
+
+/* Check whether published options stay valid across config changes. */
+START_TEST(test_config_capabilities)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GSList *devices;
+	int i, caps;
+
+	driver = srtest_driver_get("demo");
+	devices = sr_driver_scan(driver, NULL);
+	fail_unless(devices != NULL, "Scan failed.");
+	sdi = devices->data;
+	g_slist_free(devices);
+	fail_unless(sr_dev_open(sdi) == SR_OK, "Open failed.");
+
+	/* Once to fill the cache, once to hit it. */
+	for (i = 0; i < 2; i++) {
+		fail_unless(sr_dev_has_option(sdi, SR_CONF_SAMPLERATE),
+			"Samplerate option missing.");
+		fail_unless(!sr_dev_has_option(sdi, SR_CONF_DATALOG),
+			"Unpublished option reported.");
+		caps = sr_dev_config_capabilities_list(sdi, NULL,
+			SR_CONF_SAMPLERATE);
+		fail_unless(caps == (SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST),
+			"Wrong samplerate capabilities 0x%x.", caps);
+	}
+
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(19))) == SR_OK, "Set failed.");
+	fail_unless(sr_dev_has_option(sdi, SR_CONF_SAMPLERATE),
+		"Samplerate option missing after set.");
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Check whether config lists are reused until the config changes. */
+START_TEST(test_config_list_cached)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GVariant *first, *second;
+	GSList *devices;
+
+	driver = srtest_driver_get("demo");
+	devices = sr_driver_scan(driver, NULL);
+	fail_unless(devices != NULL, "Scan failed.");
+	sdi = devices->data;
+	g_slist_free(devices);
+	fail_unless(sr_dev_open(sdi) == SR_OK, "Open failed.");
+
+	fail_unless(sr_config_list(driver, sdi, NULL, SR_CONF_SAMPLERATE,
+		&first) == SR_OK, "List failed.");
+	fail_unless(sr_config_list(driver, sdi, NULL, SR_CONF_SAMPLERATE,
+		&second) == SR_OK, "List failed.");
+	fail_unless(first == second, "List not reused.");
+	g_variant_unref(second);
+
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(19))) == SR_OK, "Set failed.");
+	fail_unless(sr_config_list(driver, sdi, NULL, SR_CONF_SAMPLERATE,
+		&second) == SR_OK, "List failed.");
+	fail_unless(first != second, "Stale list returned after set.");
+	fail_unless(g_variant_equal(first, second), "List changed.");
+	g_variant_unref(first);
+	g_variant_unref(second);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
 /*
  * Check whether setting a samplerate works.
  *
@@ -70,6 +271,12 @@ Suite *suite_driver_all(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_driver_available);
 	tcase_add_test(tc, test_driver_init_all);
+	tcase_add_test(tc, test_driver_scan_lazy_init);
+	tcase_add_test(tc, test_driver_scan_multi_args);
+	tcase_add_test(tc, test_driver_scan_multi_concurrent);
+	tcase_add_test(tc, test_key_info_lookup);
+	tcase_add_test(tc, test_config_capabilities);
+	tcase_add_test(tc, test_config_list_cached);
 	// TODO: Currently broken.
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
@@ -0,0 +1,363 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <check.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#define NUM_SAMPLES	200003
+#define UNITSIZE	2
+/* Default block size, and the factor between levels. */
+#define BLOCK		256
+#define FACTOR		16
+
+static uint8_t *data;
+
+/* Random low byte, a slowly toggling and a constant channel. */
+static void setup(void)
+{
+	uint32_t i, v;
+
+	srtest_setup();
+
+	data = g_malloc(NUM_SAMPLES * UNITSIZE);
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		v = ((i * 2654435761u) >> 13) & 0xff;
+		v |= ((i / 5000) & 1) << 8;
+		v |= 1 << 9;
+		data[i * UNITSIZE] = v & 0xff;
+		data[i * UNITSIZE + 1] = v >> 8;
+	}
+}
+
+static void teardown(void)
+{
+	g_free(data);
+
+	srtest_teardown();
+}
+
+static void feed_logic(struct sr_envelope *env, const uint8_t *buf,
+		unsigned int unitsize, uint64_t num_samples)
+{
+	static const uint64_t chunks[] = { 1, 17, 1000, 4099, 255, 65536 };
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t n;
+	unsigned int i;
+	int ret;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = unitsize;
+	for (i = 0; num_samples; i = (i + 1) % ARRAY_SIZE(chunks)) {
+		n = MIN(chunks[i], num_samples);
+		logic.length = n * unitsize;
+		logic.data = (void *)buf;
+		ret = sr_envelope_feed(env, &packet);
+		fail_unless(ret == SR_OK, "Feeding failed: %d.", ret);
+		buf += n * unitsize;
+		num_samples -= n;
+	}
+}
+
+/* AND and OR of the samples in a range. */
+static void logic_bounds(uint64_t start, uint64_t end, uint8_t *low,
+		uint8_t *high)
+{
+	uint64_t i;
+	unsigned int j;
+
+	memset(low, 0xff, UNITSIZE);
+	memset(high, 0, UNITSIZE);
+	for (i = start; i < end; i++) {
+		for (j = 0; j < UNITSIZE; j++) {
+			low[j] &= data[i * UNITSIZE + j];
+			high[j] |= data[i * UNITSIZE + j];
+		}
+	}
+}
+
+/*
+ * Query buckets and compare them with the samples: exactly for buckets
+ * aligned to blocks, else they must at least cover their samples.
+ */
+static void check_logic(struct sr_envelope *env, uint64_t start,
+		uint64_t end, unsigned int num_buckets, gboolean exact)
+{
+	uint8_t *low, *high, l[UNITSIZE], h[UNITSIZE];
+	uint64_t span, b0, b1;
+	unsigned int i, j;
+	int ret;
+
+	low = g_malloc(num_buckets * UNITSIZE);
+	high = g_malloc(num_buckets * UNITSIZE);
+	ret = sr_envelope_logic_get(env, start, end, num_buckets, low, high);
+	fail_unless(ret == SR_OK, "Query failed: %d.", ret);
+
+	span = end - start;
+	for (i = 0; i < num_buckets; i++) {
+		b0 = start + span * i / num_buckets;
+		b1 = start + span * (i + 1) / num_buckets;
+		logic_bounds(b0, b1, l, h);
+		for (j = 0; j < UNITSIZE; j++) {
+			if (exact) {
+				fail_unless(low[i * UNITSIZE + j] == l[j]
+					&& high[i * UNITSIZE + j] == h[j],
+					"Bucket %u differs.", i);
+			} else {
+				fail_unless(!(low[i * UNITSIZE + j] & ~l[j])
+					&& !(h[j] & ~high[i * UNITSIZE + j]),
+					"Bucket %u doesn't cover its samples.", i);
+			}
+		}
+	}
+
+	g_free(low);
+	g_free(high);
+}
+
+START_TEST(test_envelope_logic)
+{
+	struct sr_envelope *env;
+	uint64_t num_samples;
+	unsigned int unitsize;
+	uint8_t low[UNITSIZE], high[UNITSIZE];
+	int ret;
+
+	fail_unless(sr_envelope_new(&env, 0) == SR_OK);
+	ret = sr_envelope_logic_info(env, NULL, NULL);
+	fail_unless(ret == SR_ERR_NA, "Empty envelope has logic data.");
+
+	feed_logic(env, data, UNITSIZE, NUM_SAMPLES);
+	ret = sr_envelope_logic_info(env, &num_samples, &unitsize);
+	fail_unless(ret == SR_OK, "No logic data: %d.", ret);
+	fail_unless(num_samples == NUM_SAMPLES && unitsize == UNITSIZE,
+		"Wrong extent: %" PRIu64 " samples of %u bytes.",
+		num_samples, unitsize);
+
+	/* Buckets of whole level 0, 1 and 2 blocks. */
+	check_logic(env, 0, 640 * BLOCK, 640, TRUE);
+	check_logic(env, 0, 40 * BLOCK * FACTOR, 40, TRUE);
+	check_logic(env, 0, 3 * BLOCK * FACTOR * FACTOR, 3, TRUE);
+	/* The incomplete blocks of all levels at the end. */
+	check_logic(env, 3 * BLOCK * FACTOR * FACTOR, NUM_SAMPLES, 1, TRUE);
+
+	check_logic(env, 123, NUM_SAMPLES, 100, FALSE);
+	check_logic(env, 0, NUM_SAMPLES, 1000, FALSE);
+	check_logic(env, NUM_SAMPLES - 10, NUM_SAMPLES, 3, FALSE);
+
+	/* Nothing past the end. */
+	ret = sr_envelope_logic_get(env, NUM_SAMPLES, NUM_SAMPLES + 100, 1,
+		low, high);
+	fail_unless(ret == SR_OK, "Query failed: %d.", ret);
+	fail_unless(low[0] == 0xff && low[1] == 0xff && !high[0] && !high[1],
+		"Samples past the end.");
+
+	ret = sr_envelope_logic_get(env, 0, NUM_SAMPLES, 0, low, high);
+	fail_unless(ret == SR_ERR_ARG, "No buckets not rejected.");
+
+	sr_envelope_free(env);
+}
+END_TEST
+
+START_TEST(test_envelope_analog)
+{
+	struct sr_envelope *env;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel ch[2];
+	float *values, min[4], max[4], lo, hi;
+	uint64_t num_samples, i, j;
+	int ret;
+
+	memset(ch, 0, sizeof(ch));
+	ch[0].type = ch[1].type = SR_CHANNEL_ANALOG;
+	ch[0].name = "A0";
+	ch[1].name = "A1";
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	encoding.unitsize = sizeof(float);
+	encoding.is_signed = TRUE;
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	meaning.channels = g_slist_append(NULL, &ch[0]);
+	meaning.channels = g_slist_append(meaning.channels, &ch[1]);
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+
+	/* Two channels, interleaved, in packets of 1000 samples. */
+	values = g_malloc(2 * 1000 * sizeof(float));
+	analog.data = values;
+	analog.num_samples = 1000;
+	fail_unless(sr_envelope_new(&env, 0) == SR_OK);
+	for (i = 0; i < 10; i++) {
+		for (j = 0; j < 1000; j++) {
+			values[2 * j] = ((i * 1000 + j) % 1000) / 10.0;
+			values[2 * j + 1] = -(float)(i * 1000 + j);
+		}
+		ret = sr_envelope_feed(env, &packet);
+		fail_unless(ret == SR_OK, "Feeding failed: %d.", ret);
+	}
+
+	ret = sr_envelope_analog_info(env, "A1", &num_samples);
+	fail_unless(ret == SR_OK && num_samples == 10000,
+		"Wrong number of samples.");
+	ret = sr_envelope_analog_info(env, "A2", &num_samples);
+	fail_unless(ret == SR_ERR_NA, "Unknown channel has data.");
+
+	/* Buckets of level 1 blocks, and one past the end. */
+	ret = sr_envelope_analog_get(env, "A1", 0, 4 * BLOCK * FACTOR, 4,
+		min, max);
+	fail_unless(ret == SR_OK, "Query failed: %d.", ret);
+	for (i = 0; i < 2; i++) {
+		lo = -(float)((i + 1) * BLOCK * FACTOR - 1);
+		hi = -(float)(i * BLOCK * FACTOR);
+		fail_unless(min[i] == lo && max[i] == hi,
+			"Bucket %u: %f..%f, expected %f..%f.",
+			(unsigned int)i, min[i], max[i], lo, hi);
+	}
+	fail_unless(isnan(min[3]) && isnan(max[3]), "Samples past the end.");
+
+	ret = sr_envelope_analog_get(env, "A0", 0, 10000, 1, min, max);
+	fail_unless(ret == SR_OK, "Query failed: %d.", ret);
+	fail_unless(min[0] == 0 && max[0] == 99.9f, "Wrong bounds: %f..%f.",
+		min[0], max[0]);
+
+	g_free(values);
+	g_slist_free(meaning.channels);
+	sr_envelope_free(env);
+}
+END_TEST
+
+/* Check that a new acquisition starts the envelope over. */
+START_TEST(test_envelope_header)
+{
+	struct sr_envelope *env;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	int ret;
+
+	fail_unless(sr_envelope_new(&env, 0) == SR_OK);
+	feed_logic(env, data, UNITSIZE, 1000);
+
+	memset(&header, 0, sizeof(header));
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	sr_envelope_feed(env, &packet);
+	ret = sr_envelope_logic_info(env, NULL, NULL);
+	fail_unless(ret == SR_ERR_NA, "Header didn't reset the envelope.");
+
+	sr_envelope_free(env);
+}
+END_TEST
+
+/* Check that srzip files carry the same envelope as the data. */
+START_TEST(test_envelope_srzip)
+{
+	struct sr_convert_options opts;
+	struct sr_envelope *env, *loaded;
+	GHashTable *output_options;
+	uint8_t low[2][64], high[2][64];
+	char *tmpdir, *input_file, *output_file;
+	uint64_t num_samples;
+	int ret;
+
+	tmpdir = g_dir_make_tmp("sr-envelope-XXXXXX", NULL);
+	fail_unless(tmpdir != NULL, "Failed to create a temporary directory.");
+	input_file = g_build_filename(tmpdir, "input.bin", NULL);
+	output_file = g_build_filename(tmpdir, "output.sr", NULL);
+	fail_unless(g_file_set_contents(input_file, (char *)data,
+		NUM_SAMPLES, NULL), "Failed to write the input file.");
+
+	memset(&opts, 0, sizeof(opts));
+	opts.input_format = "binary";
+	opts.output_format = "srzip";
+	ret = sr_convert_file(srtest_ctx, input_file, output_file, &opts);
+	fail_unless(ret == SR_OK, "Conversion failed: %d.", ret);
+
+	ret = sr_envelope_load(output_file, &loaded);
+	fail_unless(ret == SR_OK, "Loading failed: %d.", ret);
+	ret = sr_envelope_logic_info(loaded, &num_samples, NULL);
+	fail_unless(ret == SR_OK && num_samples == NUM_SAMPLES,
+		"Wrong number of samples.");
+
+	/* The binary input has 8 channels, one byte per sample. */
+	sr_envelope_new(&env, 0);
+	feed_logic(env, data, 1, NUM_SAMPLES);
+	sr_envelope_logic_get(env, 7, NUM_SAMPLES, 64, low[0], high[0]);
+	sr_envelope_logic_get(loaded, 7, NUM_SAMPLES, 64, low[1], high[1]);
+	fail_unless(!memcmp(low[0], low[1], 64) && !memcmp(high[0], high[1], 64),
+		"Loaded envelope differs.");
+	sr_envelope_free(env);
+	sr_envelope_free(loaded);
+
+	/* Without an envelope. */
+	output_options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(output_options, g_strdup("envelope"),
+		g_variant_ref_sink(g_variant_new_boolean(FALSE)));
+	opts.output_options = output_options;
+	ret = sr_convert_file(srtest_ctx, input_file, output_file, &opts);
+	fail_unless(ret == SR_OK, "Conversion failed: %d.", ret);
+	ret = sr_envelope_load(output_file, &loaded);
+	fail_unless(ret == SR_ERR_NA, "Missing envelope not reported.");
+	g_hash_table_destroy(output_options);
+
+	g_unlink(input_file);
+	g_unlink(output_file);
+	g_rmdir(tmpdir);
+	g_free(input_file);
+	g_free(output_file);
+	g_free(tmpdir);
+}
+END_TEST
+
+Suite *suite_envelope(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("envelope");
+
+	tc = tcase_create("basic");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_envelope_logic);
+	tcase_add_test(tc, test_envelope_analog);
+	tcase_add_test(tc, test_envelope_header);
+	tcase_add_test(tc, test_envelope_srzip);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
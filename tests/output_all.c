@@ -19,6 +19,9 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -96,6 +99,167 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+static const char *send_modules[] = { "bits", "binary" };
+
+/* Render a few packets of 8 channel logic data through an output module. */
+static GString *output_render(const char *id, int api)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_logic logic;
+	GString *out, *s;
+	gchar *contents, *path;
+	gsize len;
+	uint8_t data[100];
+	unsigned int i;
+	int fd, ret;
+	char name[8];
+
+	sdi = sr_dev_inst_user_new("sigrok", "test", NULL);
+	for (i = 0; i < 8; i++) {
+		g_snprintf(name, sizeof(name), "D%u", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	o = sr_output_new(sr_output_find((char *)id), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create '%s' output.", id);
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+	header.feed_version = 1;
+	header.starttime.tv_sec = header.starttime.tv_usec = 0;
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+
+	out = g_string_new(NULL);
+	fd = -1;
+	path = NULL;
+	if (api == 2) {
+		fd = g_file_open_tmp(NULL, &path, NULL);
+		fail_unless(fd >= 0, "Failed to open a temporary file.");
+	}
+	for (i = 0; i < 5; i++) {
+		if (i == 0) {
+			packet.type = SR_DF_HEADER;
+			packet.payload = &header;
+		} else if (i < 4) {
+			packet.type = SR_DF_LOGIC;
+			packet.payload = &logic;
+		} else {
+			packet.type = SR_DF_END;
+			packet.payload = NULL;
+		}
+		if (api == 0) {
+			s = NULL;
+			ret = sr_output_send(o, &packet, &s);
+			if (s) {
+				g_string_append_len(out, s->str, s->len);
+				g_string_free(s, TRUE);
+			}
+		} else if (api == 1) {
+			ret = sr_output_send_append(o, &packet, out);
+		} else {
+			ret = sr_output_send_fd(o, &packet, fd);
+		}
+		fail_unless(ret == SR_OK, "Failed to send packet %u.", i);
+	}
+	if (api == 2) {
+		close(fd);
+		fail_unless(g_file_get_contents(path, &contents, &len, NULL));
+		g_string_append_len(out, contents, len);
+		g_free(contents);
+		g_unlink(path);
+		g_free(path);
+	}
+
+	sr_output_free(o);
+
+	return out;
+}
+
+/*
+ * Check whether sr_output_send_append() and sr_output_send_fd() produce
+ * the same output as sr_output_send(), for modules implementing either
+ * of the module APIs.
+ */
+START_TEST(test_output_send_sink)
+{
+	GString *ref, *out;
+	unsigned int i;
+	int api;
+
+	for (i = 0; i < G_N_ELEMENTS(send_modules); i++) {
+		ref = output_render(send_modules[i], 0);
+		fail_unless(ref->len > 0, "No '%s' output.", send_modules[i]);
+		for (api = 1; api <= 2; api++) {
+			out = output_render(send_modules[i], api);
+			fail_unless(out->len == ref->len
+				&& !memcmp(out->str, ref->str, ref->len),
+				"Output of '%s' differs.", send_modules[i]);
+			g_string_free(out, TRUE);
+		}
+		g_string_free(ref, TRUE);
+	}
+}
+END_TEST
+
+/*
+ * Check the hex module's rendering, with a packet boundary within and
+ * one at the end of a byte's worth of samples.
+ */
+START_TEST(test_output_hex_text)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *options;
+	GString *out;
+	uint8_t data[24];
+	unsigned int i;
+	char name[8];
+
+	sdi = sr_dev_inst_user_new("sigrok", "test", NULL);
+	for (i = 0; i < 8; i++) {
+		g_snprintf(name, sizeof(name), "D%u", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "width",
+		g_variant_ref_sink(g_variant_new_uint32(16)));
+	o = sr_output_new(sr_output_find("hex"), options, sdi, NULL);
+	g_hash_table_destroy(options);
+	fail_unless(o != NULL, "Failed to create 'hex' output.");
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+	out = g_string_new(NULL);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = 1;
+	logic.data = data;
+	logic.length = 5;
+	sr_output_send_append(o, &packet, out);
+	logic.data = data + 5;
+	logic.length = 19;
+	sr_output_send_append(o, &packet, out);
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	sr_output_send_append(o, &packet, out);
+
+	fail_unless(strstr(out->str, "D0:55 55 \nD1:33 33 \nD2:0f 0f \n"
+		"D3:00 ff \nD4:00 00 \n") != NULL, "Wrong first line.");
+	fail_unless(strstr(out->str, "D0:55 \nD1:33 \nD2:0f \n"
+		"D3:00 \nD4:ff \n") != NULL, "Wrong last line.");
+
+	sr_output_free(o);
+	g_string_free(out, TRUE);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -112,5 +276,11 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_options);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("send");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_output_send_sink);
+	tcase_add_test(tc, test_output_hex_text);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
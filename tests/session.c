@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -185,6 +186,411 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+static void datafeed_nop(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+}
+
+START_TEST(test_session_stats_disabled)
+{
+	int ret;
+	struct sr_session *sess;
+	GSList *stats;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	/* Counters are off by default. */
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_ERR_NA);
+	ret = sr_session_stats_reset(sess);
+	fail_unless(ret == SR_ERR_NA);
+
+	/* NULL session or list, must not segfault. */
+	ret = sr_session_stats_enable(NULL, TRUE);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_stats_get(NULL, &stats);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_stats_get(sess, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+START_TEST(test_session_stats_demo)
+{
+	int ret;
+	struct sr_dev_driver *driver;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_session_stats *entry;
+	GSList *devices, *stats, *l;
+	uint64_t device_bytes, callback_packets;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devices = sr_driver_scan(driver, NULL);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_stats_enable(sess, TRUE);
+	fail_unless(ret == SR_OK);
+	sr_dev_open(sdi);
+	sr_session_dev_add(sess, sdi);
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(10000));
+	sr_session_datafeed_callback_add(sess, datafeed_nop, NULL);
+
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK);
+
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	device_bytes = callback_packets = 0;
+	for (l = stats; l; l = l->next) {
+		entry = l->data;
+		if (entry->kind == SR_STATS_DEVICE) {
+			fail_unless(entry->id == sdi);
+			fail_unless(!strcmp(entry->name, "demo"));
+			device_bytes += entry->bytes;
+		} else if (entry->kind == SR_STATS_CALLBACK) {
+			callback_packets += entry->count;
+		}
+	}
+	sr_session_stats_free(stats);
+	fail_unless(device_bytes > 0, "No device bytes counted.");
+	fail_unless(callback_packets > 0, "No callback packets counted.");
+
+	/* Reset clears all entries. */
+	ret = sr_session_stats_reset(sess);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats == NULL);
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+#define ASYNC_PACKETS 1000
+
+struct async_state {
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	uint64_t received;
+	gboolean in_order;
+};
+
+static gpointer async_producer(gpointer data)
+{
+	struct async_state *st;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t seq;
+
+	st = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = sizeof(seq);
+	logic.unitsize = sizeof(seq);
+	logic.data = &seq;
+	for (seq = 0; seq < ASYNC_PACKETS; seq++) {
+		if (sr_session_send_async(st->sdi, &packet) != SR_OK)
+			break;
+	}
+
+	return NULL;
+}
+
+/* Counts the producer's packets, which are the only 8-byte wide ones. */
+static void datafeed_async(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct async_state *st;
+	const struct sr_datafeed_logic *logic;
+	uint64_t seq;
+
+	(void)sdi;
+
+	st = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	if (logic->unitsize != sizeof(seq))
+		return;
+	memcpy(&seq, logic->data, sizeof(seq));
+	if (seq != st->received)
+		st->in_order = FALSE;
+	if (++st->received == ASYNC_PACKETS)
+		sr_session_stop(st->sess);
+}
+
+/* Check that copies of queued packets hold the whole payload. */
+START_TEST(test_session_packet_copy)
+{
+	static const uint8_t bytes[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+	static const float values[6] = { 1, -1, 2, -2, 3, -3 };
+	struct sr_datafeed_packet packet, *copy;
+	struct sr_datafeed_logic logic;
+	const struct sr_datafeed_logic *logic_copy;
+	struct sr_datafeed_analog analog;
+	const struct sr_datafeed_analog *analog_copy;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel ch[2];
+	int ret;
+
+	/* Three samples of four bytes, the length is in bytes. */
+	logic.length = sizeof(bytes);
+	logic.unitsize = 4;
+	logic.data = (void *)bytes;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	ret = sr_packet_copy(&packet, &copy);
+	fail_unless(ret == SR_OK);
+	logic_copy = copy->payload;
+	fail_unless(logic_copy->length == sizeof(bytes)
+		&& !memcmp(logic_copy->data, bytes, sizeof(bytes)));
+	sr_packet_free(copy);
+
+	/* Three samples of two interleaved channels. */
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	memset(ch, 0, sizeof(ch));
+	encoding.unitsize = sizeof(float);
+	encoding.is_float = TRUE;
+	meaning.channels = g_slist_append(NULL, &ch[0]);
+	meaning.channels = g_slist_append(meaning.channels, &ch[1]);
+	analog.data = (void *)values;
+	analog.num_samples = 3;
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	ret = sr_packet_copy(&packet, &copy);
+	fail_unless(ret == SR_OK);
+	analog_copy = copy->payload;
+	fail_unless(analog_copy->num_samples == 3
+		&& g_slist_length(analog_copy->meaning->channels) == 2
+		&& !memcmp(analog_copy->data, values, sizeof(values)));
+	sr_packet_free(copy);
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/* Check whether sr_session_send_async() needs a running session. */
+START_TEST(test_session_send_async_not_running)
+{
+	int ret;
+	struct sr_dev_driver *driver;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	GSList *devices;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devices = sr_driver_scan(driver, NULL);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sdi);
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	ret = sr_session_send_async(sdi, &packet);
+	fail_unless(ret == SR_ERR, "Packet accepted without running session.");
+	ret = sr_session_send_async(NULL, &packet);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_async_limit_set(sess, 0, 42);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_async_limit_set(sess, 4096, SR_ASYNC_DROP);
+	fail_unless(ret == SR_OK);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check whether packets from another thread arrive complete and in order. */
+START_TEST(test_session_send_async_thread)
+{
+	int ret;
+	struct sr_dev_driver *driver;
+	struct async_state st;
+	GSList *devices;
+	GThread *thread;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devices = sr_driver_scan(driver, NULL);
+	fail_unless(devices != NULL, "No demo device found.");
+	st.sdi = devices->data;
+	g_slist_free(devices);
+	st.received = 0;
+	st.in_order = TRUE;
+
+	sr_session_new(srtest_ctx, &st.sess);
+	/* Small enough to make the producer wait now and then. */
+	sr_session_async_limit_set(st.sess, 4096, SR_ASYNC_BLOCK);
+	sr_dev_open(st.sdi);
+	sr_session_dev_add(st.sess, st.sdi);
+	/* Upper bound only, the callback stops the session. */
+	sr_config_set(st.sdi, NULL, SR_CONF_LIMIT_MSEC,
+		g_variant_new_uint64(3000));
+	sr_session_datafeed_callback_add(st.sess, datafeed_async, &st);
+
+	ret = sr_session_start(st.sess);
+	fail_unless(ret == SR_OK);
+	thread = g_thread_new("producer", async_producer, &st);
+	ret = sr_session_run(st.sess);
+	fail_unless(ret == SR_OK);
+	g_thread_join(thread);
+
+	fail_unless(st.received == ASYNC_PACKETS,
+		"Received %" PRIu64 " of %d packets.", st.received, ASYNC_PACKETS);
+	fail_unless(st.in_order, "Packets arrived out of order.");
+
+	sr_session_destroy(st.sess);
+	sr_dev_close(st.sdi);
+}
+END_TEST
+
+#define MULTI_DEVICES 4
+
+static void datafeed_count_end(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+
+	if (packet->type == SR_DF_END)
+		(*(int *)cb_data)++;
+}
+
+/* Check whether several devices' event sources run side by side. */
+START_TEST(test_session_multi_device)
+{
+	int ret, ends;
+	unsigned int i;
+	struct sr_dev_driver *driver;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi[MULTI_DEVICES];
+	GSList *devices;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	sr_session_new(srtest_ctx, &sess);
+	for (i = 0; i < MULTI_DEVICES; i++) {
+		devices = sr_driver_scan(driver, NULL);
+		fail_unless(devices != NULL, "No demo device found.");
+		sdi[i] = devices->data;
+		g_slist_free(devices);
+		sr_dev_open(sdi[i]);
+		sr_session_dev_add(sess, sdi[i]);
+		/* Different lengths, so the sources go away one by one. */
+		sr_config_set(sdi[i], NULL, SR_CONF_LIMIT_SAMPLES,
+			g_variant_new_uint64(1000 * (i + 1)));
+	}
+	ends = 0;
+	sr_session_datafeed_callback_add(sess, datafeed_count_end, &ends);
+
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK);
+	fail_unless(ends == MULTI_DEVICES, "%d of %d devices ended.",
+		ends, MULTI_DEVICES);
+
+	sr_session_destroy(sess);
+	for (i = 0; i < MULTI_DEVICES; i++)
+		sr_dev_close(sdi[i]);
+}
+END_TEST
+
+struct dev_threads_case {
+	GThread *session_thread;
+	int ends;
+	int foreign;
+};
+
+static void datafeed_dev_threads(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct dev_threads_case *c;
+
+	(void)sdi;
+
+	c = cb_data;
+	if (g_thread_self() != c->session_thread)
+		c->foreign++;
+	if (packet->type == SR_DF_END)
+		c->ends++;
+}
+
+/*
+ * Check whether devices in thread groups run to their end, with their
+ * packets delivered in the session thread. Demo devices key their event
+ * sources on the device, so each group polls its own.
+ */
+START_TEST(test_session_dev_threads)
+{
+	int ret;
+	unsigned int i;
+	struct sr_dev_driver *driver;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi[MULTI_DEVICES];
+	struct dev_threads_case c;
+	GSList *devices;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	sr_session_new(srtest_ctx, &sess);
+	for (i = 0; i < MULTI_DEVICES; i++) {
+		devices = sr_driver_scan(driver, NULL);
+		fail_unless(devices != NULL, "No demo device found.");
+		sdi[i] = devices->data;
+		g_slist_free(devices);
+		sr_dev_open(sdi[i]);
+		sr_session_dev_add(sess, sdi[i]);
+		sr_config_set(sdi[i], NULL, SR_CONF_LIMIT_SAMPLES,
+			g_variant_new_uint64(1000 * (i + 1)));
+		/* Two devices share a thread, the last stays in the session's. */
+		if (i < MULTI_DEVICES - 1) {
+			ret = sr_session_dev_thread_set(sess, sdi[i], i / 2);
+			fail_unless(ret == SR_OK);
+		}
+	}
+	fail_unless(sr_session_dev_thread_set(NULL, sdi[0], 0) == SR_ERR_ARG);
+	c.session_thread = g_thread_self();
+	c.ends = c.foreign = 0;
+	sr_session_datafeed_callback_add(sess, datafeed_dev_threads, &c);
+
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK);
+	fail_unless(c.ends == MULTI_DEVICES, "%d of %d devices ended.",
+		c.ends, MULTI_DEVICES);
+	fail_unless(c.foreign == 0, "%d packets outside the session thread.",
+		c.foreign);
+
+	sr_session_destroy(sess);
+	for (i = 0; i < MULTI_DEVICES; i++)
+		sr_dev_close(sdi[i]);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +615,28 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("stats");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_stats_disabled);
+	tcase_add_test(tc, test_session_stats_demo);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("sources");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_multi_device);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("threads");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_dev_threads);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("async");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_packet_copy);
+	tcase_add_test(tc, test_session_send_async_not_running);
+	tcase_add_test(tc, test_session_send_async_thread);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -96,6 +97,198 @@ START_TEST(test_transform_options)
 }
 END_TEST
 
+struct logic_case {
+	uint8_t expected;
+	int logic;
+	int wrong;
+};
+
+static void datafeed_logic(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	struct logic_case *c;
+	uint64_t i;
+
+	(void)sdi;
+
+	c = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	c->logic++;
+	for (i = 0; i < logic->length; i++) {
+		if (((const uint8_t *)logic->data)[i] != c->expected)
+			c->wrong++;
+	}
+}
+
+/* A demo device with 8 logic channels and the pattern, in a new session. */
+static struct sr_dev_inst *demo_new(struct sr_session **sess,
+		struct logic_case *c, const char *pattern)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_channel_group *cg;
+	GSList *devices, *l;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devices = sr_driver_scan(driver, NULL);
+	fail_unless(devices != NULL, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+	fail_unless(sr_dev_open(sdi) == SR_OK, "Open failed.");
+
+	for (l = sr_dev_inst_channel_groups_get(sdi); l; l = l->next) {
+		cg = l->data;
+		if (strcmp(cg->name, "Logic"))
+			continue;
+		sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+			g_variant_new_string(pattern));
+	}
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1000));
+
+	sr_session_new(srtest_ctx, sess);
+	sr_session_dev_add(*sess, sdi);
+	sr_session_datafeed_callback_add(*sess, datafeed_logic, c);
+
+	return sdi;
+}
+
+static void logic_run(struct sr_session *sess, struct logic_case *c,
+		uint8_t expected)
+{
+	c->expected = expected;
+	c->logic = c->wrong = 0;
+	fail_unless(sr_session_start(sess) == SR_OK, "Start failed.");
+	fail_unless(sr_session_run(sess) == SR_OK, "Run failed.");
+	fail_unless(c->logic > 0, "No logic packets.");
+	fail_unless(c->wrong == 0, "%d bytes differ from 0x%02x.",
+		c->wrong, expected);
+}
+
+static void channel_disable(const struct sr_dev_inst *sdi, const char *name)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (!strcmp(ch->name, name))
+			sr_dev_channel_enable(ch, FALSE);
+	}
+}
+
+/* Check that all enabled channels are inverted, as enabled at the start. */
+START_TEST(test_transform_invert_enabled)
+{
+	const struct sr_transform *t;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct logic_case c;
+
+	sdi = demo_new(&sess, &c, "all-low");
+	t = sr_transform_new(sr_transform_find("invert"), NULL, sdi);
+	fail_unless(t != NULL, "Transform not created.");
+
+	logic_run(sess, &c, 0xff);
+	/* Same unit size, fewer channels. */
+	channel_disable(sdi, "D1");
+	channel_disable(sdi, "D6");
+	logic_run(sess, &c, 0xff & ~0x42);
+
+	sr_session_destroy(sess);
+	sr_transform_free(t);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Check that only the selected channels are inverted, enabled or not. */
+START_TEST(test_transform_invert_channels)
+{
+	const struct sr_transform *t;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct logic_case c;
+	GHashTable *options;
+
+	sdi = demo_new(&sess, &c, "all-low");
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("channels"),
+		g_variant_ref_sink(g_variant_new_string(" D2,,D5, ")));
+	t = sr_transform_new(sr_transform_find("invert"), options, sdi);
+	fail_unless(t != NULL, "Transform not created.");
+	g_hash_table_destroy(options);
+
+	logic_run(sess, &c, 0x24);
+	channel_disable(sdi, "D5");
+	logic_run(sess, &c, 0x24);
+
+	sr_session_destroy(sess);
+	sr_transform_free(t);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Check that bad channel lists are rejected. */
+START_TEST(test_transform_invert_channels_errors)
+{
+	const struct sr_transform_module *tmod;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct logic_case c;
+	GHashTable *options;
+
+	sdi = demo_new(&sess, &c, "all-low");
+	tmod = sr_transform_find("invert");
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+
+	g_hash_table_insert(options, g_strdup("channels"),
+		g_variant_ref_sink(g_variant_new_string("D2,bogus")));
+	fail_unless(sr_transform_new(tmod, options, sdi) == NULL,
+		"Unknown channel accepted.");
+	g_hash_table_insert(options, g_strdup("channels"),
+		g_variant_ref_sink(g_variant_new_uint64(2)));
+	fail_unless(sr_transform_new(tmod, options, sdi) == NULL,
+		"Channel list of the wrong type accepted.");
+
+	/* Nothing was added, the data passes as is. */
+	logic_run(sess, &c, 0x00);
+
+	g_hash_table_destroy(options);
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Check that the subset of all enabled channels follows enable changes. */
+START_TEST(test_transform_subset_enabled)
+{
+	const struct sr_transform *t;
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	struct logic_case c;
+
+	sdi = demo_new(&sess, &c, "all-high");
+	t = sr_transform_new(sr_transform_find("subset"), NULL, sdi);
+	fail_unless(t != NULL, "Transform not created.");
+
+	logic_run(sess, &c, 0xff);
+	/* Same unit size, fewer channels. */
+	channel_disable(sdi, "D1");
+	channel_disable(sdi, "D6");
+	logic_run(sess, &c, 0x3f);
+
+	sr_session_destroy(sess);
+	sr_transform_free(t);
+	sr_dev_close(sdi);
+}
+END_TEST
+
 Suite *suite_transform_all(void)
 {
 	Suite *s;
@@ -112,5 +305,17 @@ Suite *suite_transform_all(void)
 	tcase_add_test(tc, test_transform_options);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("invert");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_transform_invert_enabled);
+	tcase_add_test(tc, test_transform_invert_channels);
+	tcase_add_test(tc, test_transform_invert_channels_errors);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("subset");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_transform_subset_enabled);
+	suite_add_tcase(s, tc);
+
 	return s;
 }